@@ -0,0 +1,302 @@
+/*
+ * cfs-bandwidth-test.c - how closely CFS bandwidth control holds a quota
+ *
+ * Creates a group in the cpu controller hierarchy, gives it a quota and a
+ * period, and runs threads in it that spin for the whole test.  The cpu
+ * time the threads got is compared with what the quota allows, which is
+ * quota / period cpus, or as many cpus as there are threads when that is
+ * less.  Cases run:
+ *
+ *	- 10%, 25%, 50% and 90% of one cpu, for one thread
+ *	- the same, spread over two threads
+ *	- 1.5 cpus for as many threads as there are cpus, on SMP
+ *	- a group without a quota nested in one limited to 30% of a cpu
+ *
+ * For each case, the cpu time used, the error against the quota and how
+ * much the nr_periods, nr_throttled and throttled_time counters of
+ * cpu.stat went up are printed.  The exit status is 1 if any case is off
+ * by more than the tolerance, in percent of the expected cpu time.
+ * Nothing else should keep the cpus busy while the test runs.
+ *
+ * The smallest quota allowed is 1ms, so the period has to be at least
+ * 10ms for the 10% case.
+ *
+ * Needs CONFIG_CFS_BANDWIDTH and the cpu controller mounted, for example
+ *	mount -t cgroup -o cpu none /dev/cpuctl
+ *
+ * Usage: cfs-bandwidth-test [-c cpu cgroup mount] [-p period us]
+ *			     [-t seconds] [-e tolerance %]
+ *
+ * This file is released under the GPLv2.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+static const char *mnt = "/dev/cpuctl";
+static long period = 100000;
+static int seconds = 5;
+static double tolerance = 5;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int write_file(const char *dir, const char *name, long val)
+{
+	char path[256];
+	FILE *f;
+	int ret;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	f = fopen(path, "w");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	ret = fprintf(f, "%ld\n", val) < 0;
+	if (fclose(f) || ret) {
+		perror(path);
+		return -1;
+	}
+	return 0;
+}
+
+struct cpu_stat {
+	long nr_periods, nr_throttled;
+	long long throttled_time;
+};
+
+static int read_stat(const char *dir, struct cpu_stat *st)
+{
+	char path[256], name[32];
+	long long val;
+	FILE *f;
+
+	memset(st, 0, sizeof(*st));
+	snprintf(path, sizeof(path), "%s/cpu.stat", dir);
+	f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	while (fscanf(f, "%31s %lld", name, &val) == 2) {
+		if (!strcmp(name, "nr_periods"))
+			st->nr_periods = val;
+		else if (!strcmp(name, "nr_throttled"))
+			st->nr_throttled = val;
+		else if (!strcmp(name, "throttled_time"))
+			st->throttled_time = val;
+	}
+	fclose(f);
+	return 0;
+}
+
+static volatile double deadline;
+
+static void *spin(void *arg)
+{
+	while (now() < deadline)
+		;
+	return NULL;
+}
+
+/*
+ * Run @threads spinning threads in @dir and return the cpus they used on
+ * average, or a negative value on failure.  A child process does the
+ * spinning, so that the test itself stays out of the group.
+ */
+static double run_group(const char *dir, int threads)
+{
+	pthread_t *t;
+	double result[2];
+	struct timespec cpu;
+	int fd[2], i, status;
+	pid_t pid;
+
+	if (pipe(fd)) {
+		perror("pipe");
+		return -1;
+	}
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return -1;
+	}
+	if (!pid) {
+		close(fd[0]);
+		/* Threads created from now on inherit the group */
+		if (write_file(dir, "tasks", getpid()))
+			exit(1);
+		t = calloc(threads, sizeof(*t));
+		if (!t)
+			exit(1);
+		result[0] = now();
+		deadline = result[0] + seconds;
+		for (i = 0; i < threads; i++)
+			if (pthread_create(&t[i], NULL, spin, NULL))
+				exit(1);
+		for (i = 0; i < threads; i++)
+			pthread_join(t[i], NULL);
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+		result[0] = now() - result[0];
+		result[1] = cpu.tv_sec + cpu.tv_nsec / 1e9;
+		if (write(fd[1], result, sizeof(result)) != sizeof(result))
+			exit(1);
+		exit(0);
+	}
+
+	close(fd[1]);
+	i = read(fd[0], result, sizeof(result));
+	close(fd[0]);
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+	    WEXITSTATUS(status) || i != sizeof(result)) {
+		fprintf(stderr, "%s: test process failed\n", dir);
+		return -1;
+	}
+	return result[1] / result[0];
+}
+
+/*
+ * Limit @dir to @quota_pct percent of a cpu per period, or leave it
+ * unlimited for a negative value.
+ */
+static int set_quota(const char *dir, long quota_pct)
+{
+	if (write_file(dir, "cpu.cfs_period_us", period))
+		return -1;
+	return write_file(dir, "cpu.cfs_quota_us",
+			  quota_pct < 0 ? -1 : period * quota_pct / 100);
+}
+
+/*
+ * Run @threads threads in @group, which is @parent or a group below it,
+ * and check they got @limit_pct percent of a cpu.  Returns 1 if they did
+ * not, -1 if the test could not be run.
+ */
+static int check(const char *what, const char *parent, const char *group,
+		 int threads, long limit_pct)
+{
+	double expected = limit_pct / 100.0, used, err;
+	struct cpu_stat before, st;
+
+	if (expected > threads)
+		expected = threads;
+	if (read_stat(parent, &before))
+		return -1;
+	used = run_group(group, threads);
+	if (used < 0 || read_stat(parent, &st))
+		return -1;
+	st.nr_periods -= before.nr_periods;
+	st.nr_throttled -= before.nr_throttled;
+	st.throttled_time -= before.throttled_time;
+
+	err = (used - expected) * 100 / expected;
+	printf("%-28s %d thread%s: %.3f of %.3f cpus, %+6.2f%%, "
+	       "%ld periods, %ld throttled, %.3f s throttled: %s\n",
+	       what, threads, threads > 1 ? "s" : " ", used, expected, err,
+	       st.nr_periods, st.nr_throttled, st.throttled_time / 1e9,
+	       err > tolerance || err < -tolerance ? "FAILED" : "ok");
+	return err > tolerance || err < -tolerance;
+}
+
+static int make_group(const char *dir)
+{
+	if (mkdir(dir, 0755) && errno != EEXIST) {
+		perror(dir);
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	static const long quota_pct[] = { 10, 25, 50, 90 };
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	char group[256], child[sizeof(group) + 8], what[64];
+	int opt, threads, ret, failed = 0;
+	size_t i;
+
+	while ((opt = getopt(argc, argv, "c:p:t:e:")) != -1) {
+		switch (opt) {
+		case 'c':
+			mnt = optarg;
+			break;
+		case 'p':
+			period = atol(optarg);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		case 'e':
+			tolerance = atof(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != argc || period < 10000 || period > 1000000 ||
+	    seconds <= 0 || tolerance < 0)
+		goto usage;
+
+	snprintf(group, sizeof(group), "%s/cfs_bandwidth_test", mnt);
+	snprintf(child, sizeof(child), "%s/child", group);
+	if (make_group(group))
+		return 1;
+
+	for (threads = 1; threads <= 2; threads++) {
+		for (i = 0; i < sizeof(quota_pct) / sizeof(*quota_pct); i++) {
+			snprintf(what, sizeof(what), "quota %ld%%",
+				 quota_pct[i]);
+			if (set_quota(group, quota_pct[i]))
+				goto out;
+			ret = check(what, group, group, threads, quota_pct[i]);
+			if (ret < 0)
+				goto out;
+			failed |= ret;
+		}
+	}
+
+	if (cpus > 1) {
+		if (set_quota(group, 150))
+			goto out;
+		ret = check("quota 150%", group, group, cpus, 150);
+		if (ret < 0)
+			goto out;
+		failed |= ret;
+	}
+
+	/* The limit of a group holds for everything below it */
+	if (set_quota(group, 30) || make_group(child) || set_quota(child, -1))
+		goto out;
+	ret = check("quota 30%, unlimited child", group, child, 2, 30);
+	if (ret < 0)
+		goto out;
+	failed |= ret;
+
+	rmdir(child);
+	rmdir(group);
+	return failed;
+
+out:
+	rmdir(child);
+	rmdir(group);
+	return 1;
+
+usage:
+	fprintf(stderr, "usage: %s [-c cpu cgroup mount] [-p period us] "
+		"[-t seconds] [-e tolerance %%]\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,302 @@
+/*
+ * deadline-test.c - wakeup latencies and deadline misses of periodic threads
+ *
+ * Runs threads that, like cyclictest, sleep until the start of every
+ * period with an absolute timer, and then do a given amount of work, as
+ * an audio thread handling one period of samples would.  For each thread
+ * the latency from the timer expiry to the thread running is measured,
+ * and a deadline miss is counted when the work of a period is not done
+ * by the deadline.  The threads run as
+ *
+ *	deadline: SCHED_DEADLINE, with the work plus a margin as runtime
+ *	fifo:	  SCHED_FIFO at priority 50
+ *	other:	  SCHED_OTHER
+ *
+ * next to fair threads that spin on every cpu and, with -r, a SCHED_FIFO
+ * thread at priority 90 that spins for 10ms in every 20ms, standing for
+ * misbehaving rt load.  Only a deadline reservation keeps the periodic
+ * threads from missing under that one.
+ *
+ * For every thread, the percentiles and the maximum of the latency, the
+ * periods run and the deadlines missed are printed.  The exit status is
+ * 1 if a deadline was missed.  SCHED_DEADLINE and SCHED_FIFO need root.
+ *
+ * Usage: deadline-test [-p deadline|fifo|other] [-n threads]
+ *			[-P period us] [-D deadline us] [-w work us]
+ *			[-b hogs] [-r] [-t seconds]
+ *
+ * This file is released under the GPLv2.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/prctl.h>
+
+#ifndef PR_SET_DEADLINE
+#define PR_SET_DEADLINE		0x54554e03
+
+struct sched_dl_param {
+	unsigned long long sched_runtime;
+	unsigned long long sched_deadline;
+	unsigned long long sched_period;
+};
+#endif
+
+#define NSEC_PER_SEC	1000000000LL
+#define MAX_SAMPLES	(1 << 20)
+
+enum { POLICY_DEADLINE, POLICY_FIFO, POLICY_OTHER };
+static const char *policy_name[] = { "deadline", "fifo", "other" };
+
+static int policy = POLICY_DEADLINE;
+static long long period = 5000000, deadline, work = 500000;
+static int seconds = 10;
+static volatile int stop;
+
+struct periodic {
+	pthread_t thread;
+	int err;
+	long long *lat;		/* ns, one per period */
+	long nr, misses;
+	long long max;
+};
+
+static long long now_ns(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void ns_to_ts(long long ns, struct timespec *ts)
+{
+	ts->tv_sec = ns / NSEC_PER_SEC;
+	ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+/* Use up @ns of cpu time of the calling thread */
+static void burn(long long ns)
+{
+	long long end = now_ns(CLOCK_THREAD_CPUTIME_ID) + ns;
+
+	while (now_ns(CLOCK_THREAD_CPUTIME_ID) < end)
+		;
+}
+
+static int set_policy(int which)
+{
+	struct sched_param sp = { .sched_priority = 50 };
+	struct sched_dl_param dl;
+
+	switch (which) {
+	case POLICY_DEADLINE:
+		/* Leave some room for the wakeup and the time reads */
+		dl.sched_runtime = work + work / 4 + 50000;
+		dl.sched_deadline = deadline;
+		dl.sched_period = period;
+		if (dl.sched_runtime > dl.sched_deadline)
+			dl.sched_runtime = dl.sched_deadline;
+		if (prctl(PR_SET_DEADLINE, &dl, 0, 0, 0)) {
+			perror("PR_SET_DEADLINE");
+			return -1;
+		}
+		return 0;
+	case POLICY_FIFO:
+		if (sched_setscheduler(0, SCHED_FIFO, &sp)) {
+			perror("SCHED_FIFO");
+			return -1;
+		}
+		return 0;
+	}
+	return 0;
+}
+
+static void *periodic_thread(void *arg)
+{
+	struct periodic *p = arg;
+	struct timespec ts;
+	long long next, lat;
+
+	if (set_policy(policy)) {
+		p->err = 1;
+		return NULL;
+	}
+
+	next = now_ns(CLOCK_MONOTONIC) + period;
+	while (!stop && p->nr < MAX_SAMPLES) {
+		ns_to_ts(next, &ts);
+		if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL))
+			continue;
+		lat = now_ns(CLOCK_MONOTONIC) - next;
+		burn(work);
+		if (now_ns(CLOCK_MONOTONIC) - next > deadline)
+			p->misses++;
+		p->lat[p->nr++] = lat;
+		if (lat > p->max)
+			p->max = lat;
+
+		next += period;
+		/* Skip the periods that went by while we were held up */
+		while (next < now_ns(CLOCK_MONOTONIC))
+			next += period;
+		/* Done with the period: give back what is left of it */
+		if (policy == POLICY_DEADLINE)
+			sched_yield();
+	}
+	return NULL;
+}
+
+static void *fair_hog(void *arg)
+{
+	while (!stop)
+		;
+	return NULL;
+}
+
+static void *rt_hog(void *arg)
+{
+	struct sched_param sp = { .sched_priority = 90 };
+	struct timespec ts = { 0, 10000000 };
+
+	if (sched_setscheduler(0, SCHED_FIFO, &sp)) {
+		perror("rt hog: SCHED_FIFO");
+		return NULL;
+	}
+	while (!stop) {
+		burn(10000000);
+		nanosleep(&ts, NULL);
+	}
+	return NULL;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void report(int i, struct periodic *p)
+{
+	static const double pct[] = { 50, 90, 99, 99.9 };
+	size_t j;
+
+	printf("thread %2d: %7ld periods, %5ld missed", i, p->nr, p->misses);
+	if (!p->nr) {
+		printf("\n");
+		return;
+	}
+	qsort(p->lat, p->nr, sizeof(*p->lat), cmp_ll);
+	printf(", latency us:");
+	for (j = 0; j < sizeof(pct) / sizeof(*pct); j++)
+		printf(" p%g %.1f", pct[j],
+		       p->lat[(long)((p->nr - 1) * pct[j] / 100)] / 1e3);
+	printf(" max %.1f\n", p->max / 1e3);
+}
+
+int main(int argc, char **argv)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int opt, i, nr = 1, hogs = -1, rt = 0, failed = 0;
+	pthread_t *hog, rt_thread;
+	struct periodic *p;
+	long misses = 0;
+
+	while ((opt = getopt(argc, argv, "p:n:P:D:w:b:rt:")) != -1) {
+		switch (opt) {
+		case 'p':
+			for (i = 0; i < 3; i++)
+				if (!strcmp(optarg, policy_name[i]))
+					break;
+			if (i == 3)
+				goto usage;
+			policy = i;
+			break;
+		case 'n':
+			nr = atoi(optarg);
+			break;
+		case 'P':
+			period = atoll(optarg) * 1000;
+			break;
+		case 'D':
+			deadline = atoll(optarg) * 1000;
+			break;
+		case 'w':
+			work = atoll(optarg) * 1000;
+			break;
+		case 'b':
+			hogs = atoi(optarg);
+			break;
+		case 'r':
+			rt = 1;
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (!deadline)
+		deadline = period;
+	if (hogs < 0)
+		hogs = cpus;
+	if (optind != argc || nr <= 0 || period <= 0 || work <= 0 ||
+	    work > deadline || deadline > period || seconds <= 0)
+		goto usage;
+
+	p = calloc(nr, sizeof(*p));
+	hog = calloc(hogs + 1, sizeof(*hog));
+	if (!p || !hog) {
+		perror("calloc");
+		return 1;
+	}
+	for (i = 0; i < hogs; i++)
+		pthread_create(&hog[i], NULL, fair_hog, NULL);
+	if (rt)
+		pthread_create(&rt_thread, NULL, rt_hog, NULL);
+	for (i = 0; i < nr; i++) {
+		p[i].lat = malloc(MAX_SAMPLES * sizeof(*p[i].lat));
+		if (!p[i].lat) {
+			perror("malloc");
+			return 1;
+		}
+		pthread_create(&p[i].thread, NULL, periodic_thread, &p[i]);
+	}
+
+	sleep(seconds);
+	stop = 1;
+
+	for (i = 0; i < nr; i++)
+		pthread_join(p[i].thread, NULL);
+	for (i = 0; i < hogs; i++)
+		pthread_join(hog[i], NULL);
+	if (rt)
+		pthread_join(rt_thread, NULL);
+
+	printf("%s: %d thread%s, period %lldus, deadline %lldus, work %lldus, "
+	       "%d fair hog%s%s\n", policy_name[policy], nr, nr > 1 ? "s" : "",
+	       period / 1000, deadline / 1000, work / 1000, hogs,
+	       hogs != 1 ? "s" : "", rt ? ", rt hog" : "");
+	for (i = 0; i < nr; i++) {
+		if (p[i].err)
+			failed = 1;
+		report(i, &p[i]);
+		misses += p[i].misses;
+	}
+	return failed || misses;
+
+usage:
+	fprintf(stderr, "usage: %s [-p deadline|fifo|other] [-n threads] "
+		"[-P period us] [-D deadline us] [-w work us] [-b hogs] [-r] "
+		"[-t seconds]\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,222 @@
+/*
+ * schedstat-latency.c - wakeup latency percentiles from /proc/schedstat
+ *
+ * Reads the per-cpu histograms of version 16 of /proc/schedstat and
+ * prints, for each cpu and for all of them together, percentiles of the
+ * wakeup to run latency of the rt and the fair class and the mean
+ * runqueue depth at the tick.  The buckets are log2 sized, so a
+ * percentile is given as the upper bound of the bucket it falls in: "p99
+ * <64us" means 99% of the wakeups waited less than 65.536us.
+ *
+ * Without -i, everything counted since boot or since the histograms were
+ * last cleared is reported.  With -i, only what was counted during the
+ * interval.  -r clears the histograms first.
+ *
+ * Usage: schedstat-latency [-i seconds] [-r]
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LAT_BUCKETS	24
+#define LAT_SHIFT	10
+#define NR_BUCKETS	17
+#define MAX_CPUS	1024
+
+struct cpu_hist {
+	int seen;
+	unsigned long long lat[2][LAT_BUCKETS];
+	unsigned long long nr[NR_BUCKETS];
+};
+
+static const char *lat_name[2] = { "rt", "fair" };
+static const double pct[] = { 50, 90, 99, 99.9 };
+
+static int read_hist(const char *line, const char *name,
+		     unsigned long long *hist, int buckets)
+{
+	size_t len = strlen(name);
+	char *end;
+	int i;
+
+	if (strncmp(line, name, len) || line[len] != ' ')
+		return 0;
+	line += len;
+	for (i = 0; i < buckets; i++) {
+		hist[i] = strtoull(line, &end, 10);
+		if (end == line)
+			return -1;
+		line = end;
+	}
+	return 1;
+}
+
+static int read_schedstat(struct cpu_hist *h)
+{
+	char line[4096];
+	int version = 0, cpu = -1, ret = 0;
+	FILE *f;
+
+	memset(h, 0, sizeof(*h) * MAX_CPUS);
+	f = fopen("/proc/schedstat", "r");
+	if (!f) {
+		perror("/proc/schedstat");
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "version %d", &version) == 1) {
+			if (version < 16) {
+				fprintf(stderr, "schedstat version %d has no "
+					"histograms\n", version);
+				ret = -1;
+				break;
+			}
+		} else if (sscanf(line, "cpu%d ", &cpu) == 1) {
+			if (cpu < 0 || cpu >= MAX_CPUS) {
+				cpu = -1;
+				continue;
+			}
+			h[cpu].seen = 1;
+		} else if (cpu >= 0 &&
+			   (read_hist(line, "lat_rt", h[cpu].lat[0],
+				      LAT_BUCKETS) < 0 ||
+			    read_hist(line, "lat_fair", h[cpu].lat[1],
+				      LAT_BUCKETS) < 0 ||
+			    read_hist(line, "nr_running", h[cpu].nr,
+				      NR_BUCKETS) < 0)) {
+			fprintf(stderr, "cannot parse: %s", line);
+			ret = -1;
+			break;
+		}
+	}
+	fclose(f);
+	return ret;
+}
+
+static void print_bound(int bucket)
+{
+	unsigned long long ns = 1ULL << (bucket + LAT_SHIFT);
+	char buf[16];
+
+	if (bucket == LAT_BUCKETS - 1)
+		snprintf(buf, sizeof(buf), ">4s");
+	else if (ns < 1000000)
+		snprintf(buf, sizeof(buf), "<%lluus", ns >> 10);
+	else if (ns < 1000000000)
+		snprintf(buf, sizeof(buf), "<%llums", ns >> 20);
+	else
+		snprintf(buf, sizeof(buf), "<%llus", ns >> 30);
+	printf(" %-7s", buf);
+}
+
+static void print_lat(const char *what, unsigned long long *hist)
+{
+	unsigned long long total = 0, sum;
+	size_t i;
+	int b;
+
+	for (b = 0; b < LAT_BUCKETS; b++)
+		total += hist[b];
+	printf("  %-5s %12llu wakeups", what, total);
+	if (!total) {
+		printf("\n");
+		return;
+	}
+	for (i = 0; i < sizeof(pct) / sizeof(*pct); i++) {
+		sum = 0;
+		for (b = 0; b < LAT_BUCKETS - 1; b++) {
+			sum += hist[b];
+			if (sum * 100.0 >= total * pct[i])
+				break;
+		}
+		printf("  p%g", pct[i]);
+		print_bound(b);
+	}
+	printf("\n");
+}
+
+static void print_nr(unsigned long long *hist)
+{
+	unsigned long long ticks = 0, sum = 0;
+	int b;
+
+	for (b = 0; b < NR_BUCKETS; b++) {
+		ticks += hist[b];
+		sum += hist[b] * b;
+	}
+	if (ticks)
+		printf("  depth %12llu ticks    mean %.2f, %.1f%% with more "
+		       "than one task\n", ticks, (double)sum / ticks,
+		       100.0 * (ticks - hist[0] - hist[1]) / ticks);
+}
+
+int main(int argc, char **argv)
+{
+	static struct cpu_hist before[MAX_CPUS], after[MAX_CPUS], all;
+	int opt, interval = 0, reset = 0, cpu, c, b;
+	FILE *f;
+
+	while ((opt = getopt(argc, argv, "i:r")) != -1) {
+		switch (opt) {
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		case 'r':
+			reset = 1;
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != argc || interval < 0)
+		goto usage;
+
+	if (reset) {
+		f = fopen("/proc/schedstat", "w");
+		if (!f || fputs("reset\n", f) < 0 || fclose(f)) {
+			perror("/proc/schedstat");
+			return 1;
+		}
+	}
+	if (interval) {
+		if (read_schedstat(before))
+			return 1;
+		sleep(interval);
+	}
+	if (read_schedstat(after))
+		return 1;
+
+	for (cpu = 0; cpu < MAX_CPUS; cpu++) {
+		struct cpu_hist *h = &after[cpu];
+
+		if (!h->seen)
+			continue;
+		for (c = 0; c < 2; c++)
+			for (b = 0; b < LAT_BUCKETS; b++) {
+				h->lat[c][b] -= before[cpu].lat[c][b];
+				all.lat[c][b] += h->lat[c][b];
+			}
+		for (b = 0; b < NR_BUCKETS; b++) {
+			h->nr[b] -= before[cpu].nr[b];
+			all.nr[b] += h->nr[b];
+		}
+
+		printf("cpu%d\n", cpu);
+		for (c = 0; c < 2; c++)
+			print_lat(lat_name[c], h->lat[c]);
+		print_nr(h->nr);
+	}
+	printf("all\n");
+	for (c = 0; c < 2; c++)
+		print_lat(lat_name[c], all.lat[c]);
+	print_nr(all.nr);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-i seconds] [-r]\n", argv[0]);
+	return 1;
+}
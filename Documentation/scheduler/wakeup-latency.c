@@ -0,0 +1,188 @@
+/*
+ * wakeup-latency.c - wakeup to run latency under a compile style load
+ *
+ * Starts background jobs that, like the jobs of a parallel build, burn
+ * the cpu for a few milliseconds at a time with short sleeps for I/O in
+ * between, and runs a foreground task that wakes up periodically, like
+ * a render thread at every frame, does a little work and goes back to
+ * sleep.  How late the foreground task got to run after each of its
+ * timers expired is reported as percentiles.
+ *
+ * The foreground task can be given a latency nice value (-l), which
+ * changes how soon it runs after waking up but not its share of the cpu,
+ * or a nice value (-n), which changes both.  Compare for example
+ *	wakeup-latency -l 0
+ *	wakeup-latency -l -20
+ *	wakeup-latency -n -10
+ *
+ * Usage: wakeup-latency [-j jobs] [-t seconds] [-p period us]
+ *			 [-w work us] [-l latency nice] [-n nice]
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#ifndef PR_SET_LATENCY_NICE
+#define PR_SET_LATENCY_NICE	0x54554e01
+#endif
+
+#define NSEC_PER_SEC	1000000000LL
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void spin_ns(long long ns)
+{
+	long long end = now_ns() + ns;
+
+	while (now_ns() < end)
+		;
+}
+
+/* A build job: cpu bursts of 1-20ms, with sleeps of up to 1ms */
+static void background_job(unsigned int seed)
+{
+	struct timespec ts = { 0, 0 };
+
+	srandom(seed);
+	for (;;) {
+		spin_ns((1 + random() % 20) * 1000000LL);
+		ts.tv_nsec = random() % 1000000;
+		nanosleep(&ts, NULL);
+	}
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+	long jobs = sysconf(_SC_NPROCESSORS_ONLN) * 2;
+	long long period = 4000, work = 500, seconds = 10;
+	int opt, latency_nice = 0, nice = 0;
+	int set_latency_nice = 0, set_nice = 0, ret = 1;
+	long long *lat, next;
+	size_t i, n, nr;
+	pid_t *pids;
+	struct timespec ts;
+
+	while ((opt = getopt(argc, argv, "j:t:p:w:l:n:")) != -1) {
+		switch (opt) {
+		case 'j':
+			jobs = atol(optarg);
+			break;
+		case 't':
+			seconds = atoll(optarg);
+			break;
+		case 'p':
+			period = atoll(optarg);
+			break;
+		case 'w':
+			work = atoll(optarg);
+			break;
+		case 'l':
+			latency_nice = atoi(optarg);
+			set_latency_nice = 1;
+			break;
+		case 'n':
+			nice = atoi(optarg);
+			set_nice = 1;
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != argc || jobs < 0 || seconds <= 0 || period <= 0 ||
+	    work < 0 || work >= period || period > seconds * 1000000)
+		goto usage;
+	period *= 1000;
+	work *= 1000;
+
+	pids = calloc(jobs + 1, sizeof(*pids));
+	nr = seconds * NSEC_PER_SEC / period;
+	lat = calloc(nr, sizeof(*lat));
+	if (!pids || !lat) {
+		perror("calloc");
+		return 1;
+	}
+
+	for (i = 0; i < (size_t)jobs; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			perror("fork");
+			goto out;
+		}
+		if (!pids[i])
+			background_job(i + 1);
+	}
+
+	if (set_latency_nice &&
+	    prctl(PR_SET_LATENCY_NICE, latency_nice, 0, 0, 0)) {
+		perror("PR_SET_LATENCY_NICE");
+		goto out;
+	}
+	if (set_nice && setpriority(PRIO_PROCESS, 0, nice)) {
+		perror("setpriority");
+		goto out;
+	}
+	/* Measure the scheduler, not the timer slack */
+	prctl(PR_SET_TIMERSLACK, 1, 0, 0, 0);
+
+	/* Let the background load get going */
+	sleep(1);
+
+	next = now_ns();
+	for (n = 0; n < nr; n++) {
+		next += period;
+		ts.tv_sec = next / NSEC_PER_SEC;
+		ts.tv_nsec = next % NSEC_PER_SEC;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+				       &ts, NULL) == EINTR)
+			;
+		lat[n] = now_ns() - next;
+		spin_ns(work);
+		/* Do not let a long delay turn into a burst of frames */
+		if (now_ns() > next + period)
+			next = now_ns();
+	}
+
+	qsort(lat, nr, sizeof(*lat), cmp_ll);
+	printf("%ld jobs, %zu wakeups every %lld us, latency nice %d, nice %d\n",
+	       jobs, nr, period / 1000, latency_nice, nice);
+	printf("latency us: p50 %lld p90 %lld p99 %lld p99.9 %lld max %lld\n",
+	       lat[nr / 2] / 1000, lat[nr * 9 / 10] / 1000,
+	       lat[nr * 99 / 100] / 1000, lat[nr * 999 / 1000] / 1000,
+	       lat[nr - 1] / 1000);
+	ret = 0;
+
+out:
+	for (i = 0; i < (size_t)jobs && pids[i] > 0; i++)
+		kill(pids[i], SIGKILL);
+	while (wait(NULL) > 0)
+		;
+	return ret;
+
+usage:
+	fprintf(stderr, "usage: %s [-j jobs] [-t seconds] [-p period us] "
+		"[-w work us] [-l latency nice] [-n nice]\n", argv[0]);
+	return 1;
+}
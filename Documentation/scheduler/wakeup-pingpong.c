@@ -0,0 +1,322 @@
+/*
+ * wakeup-pingpong.c - throughput of tasks that keep waking each other
+ *
+ * Two workloads whose speed depends on where wakeups put the wakee:
+ *
+ *  pipe:   pairs of processes pass a token back and forth through two
+ *	    pipes, each writing a buffer the other one reads, like a
+ *	    producer and a consumer.
+ *  binder: client threads send requests to a pool of server threads and
+ *	    sleep until the reply comes, as with a binder style IPC.  The
+ *	    server reads the request and writes the reply in a buffer the
+ *	    client then reads.
+ *
+ * Reported are the round trips per second, the mean round trip time,
+ * and how often a task found itself on another cpu than the round trip
+ * before.  Compare, with CONFIG_SCHED_DEBUG, runs with
+ *	echo NO_WAKE_PAIR > /sys/kernel/debug/sched_features
+ *	echo NO_LLC_IDLE_HINT > /sys/kernel/debug/sched_features
+ * and without.
+ *
+ * Usage: wakeup-pingpong [-m pipe|binder] [-n pairs or clients]
+ *			  [-s server threads] [-b buffer bytes] [-t seconds]
+ *
+ * This file is released under the GPLv2.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+static size_t buf_size = 4096;
+static int seconds = 5;
+static volatile int stop;
+static unsigned long moves;	/* cpu changes of all tasks */
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Read what the other side wrote, and write for it to read */
+static unsigned long touch(unsigned char *buf, unsigned char val)
+{
+	unsigned long sum = 0;
+	size_t i;
+
+	for (i = 0; i < buf_size; i += 64) {
+		sum += buf[i];
+		buf[i] = val;
+	}
+	return sum;
+}
+
+/* Count it when the caller runs on another cpu than last time */
+static void check_cpu(int *last, unsigned long *moves)
+{
+	int cpu = sched_getcpu();
+
+	if (cpu != *last) {
+		if (*last >= 0)
+			(*moves)++;
+		*last = cpu;
+	}
+}
+
+static void xread(int fd, void *p, size_t len)
+{
+	if (read(fd, p, len) != (ssize_t)len) {
+		perror("read");
+		exit(1);
+	}
+}
+
+static void xwrite(int fd, const void *p, size_t len)
+{
+	if (write(fd, p, len) != (ssize_t)len) {
+		perror("write");
+		exit(1);
+	}
+}
+
+/* Shared between the processes of the pipe workload */
+struct pipe_pair {
+	unsigned long round_trips;
+	unsigned long moves[2];
+	unsigned char buf[];
+};
+
+static void pipe_side(struct pipe_pair *pp, int in, int out, int first)
+{
+	int last_cpu = -1;
+	char token = 0;
+
+	if (first)
+		xwrite(out, &token, 1);
+	for (;;) {
+		xread(in, &token, 1);
+		check_cpu(&last_cpu, &pp->moves[first]);
+		touch(pp->buf, token);
+		if (first)
+			pp->round_trips++;
+		xwrite(out, &token, 1);
+	}
+}
+
+static unsigned long pipe_bench(int pairs)
+{
+	size_t size = sizeof(struct pipe_pair) + buf_size;
+	unsigned long total = 0;
+	struct pipe_pair *pp;
+	pid_t *pids;
+	int i, ab[2], ba[2];
+
+	pp = mmap(NULL, size * pairs, PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	pids = calloc(2 * pairs, sizeof(*pids));
+	if (pp == MAP_FAILED || !pids) {
+		perror("mmap");
+		exit(1);
+	}
+
+	for (i = 0; i < pairs; i++) {
+		struct pipe_pair *p = (void *)((char *)pp + i * size);
+
+		if (pipe(ab) || pipe(ba)) {
+			perror("pipe");
+			exit(1);
+		}
+		pids[2 * i] = fork();
+		if (!pids[2 * i])
+			pipe_side(p, ba[0], ab[1], 1);
+		pids[2 * i + 1] = fork();
+		if (!pids[2 * i + 1])
+			pipe_side(p, ab[0], ba[1], 0);
+		close(ab[0]);
+		close(ab[1]);
+		close(ba[0]);
+		close(ba[1]);
+	}
+
+	sleep(seconds);
+
+	for (i = 0; i < 2 * pairs; i++)
+		kill(pids[i], SIGKILL);
+	while (wait(NULL) > 0)
+		;
+	for (i = 0; i < pairs; i++) {
+		struct pipe_pair *p = (void *)((char *)pp + i * size);
+
+		total += p->round_trips;
+		moves += p->moves[0] + p->moves[1];
+	}
+	munmap(pp, size * pairs);
+	free(pids);
+	return total;
+}
+
+/*
+ * The binder workload: requests go through one pipe that all servers
+ * read, each client waits for its reply on a pipe of its own.
+ */
+struct client {
+	pthread_t thread;
+	int reply[2];
+	unsigned long round_trips;
+	unsigned long moves;
+	unsigned char *buf;
+};
+
+static int request[2];
+static pthread_mutex_t moves_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *client_thread(void *arg)
+{
+	struct client *c = arg;
+	int last_cpu = -1;
+	char token;
+
+	while (!stop) {
+		touch(c->buf, 1);
+		xwrite(request[1], &c, sizeof(c));
+		xread(c->reply[0], &token, 1);
+		check_cpu(&last_cpu, &c->moves);
+		touch(c->buf, 3);
+		c->round_trips++;
+	}
+	return NULL;
+}
+
+static void *server_thread(void *arg)
+{
+	unsigned long server_moves = 0;
+	int last_cpu = -1;
+	struct client *c;
+	char token = 0;
+
+	for (;;) {
+		xread(request[0], &c, sizeof(c));
+		if (!c)
+			break;
+		check_cpu(&last_cpu, &server_moves);
+		touch(c->buf, 2);
+		xwrite(c->reply[1], &token, 1);
+	}
+
+	pthread_mutex_lock(&moves_lock);
+	moves += server_moves;
+	pthread_mutex_unlock(&moves_lock);
+	return NULL;
+}
+
+static unsigned long binder_bench(int clients, int servers)
+{
+	struct client *c = calloc(clients, sizeof(*c));
+	pthread_t *s = calloc(servers, sizeof(*s));
+	unsigned long total = 0;
+	int i;
+
+	if (!c || !s || pipe(request)) {
+		perror("binder setup");
+		exit(1);
+	}
+	for (i = 0; i < servers; i++)
+		pthread_create(&s[i], NULL, server_thread, NULL);
+	for (i = 0; i < clients; i++) {
+		c[i].buf = malloc(buf_size);
+		if (!c[i].buf || pipe(c[i].reply)) {
+			perror("binder setup");
+			exit(1);
+		}
+		memset(c[i].buf, 0, buf_size);
+		pthread_create(&c[i].thread, NULL, client_thread, &c[i]);
+	}
+
+	sleep(seconds);
+	stop = 1;
+
+	for (i = 0; i < clients; i++) {
+		pthread_join(c[i].thread, NULL);
+		total += c[i].round_trips;
+		moves += c[i].moves;
+	}
+	for (i = 0; i < servers; i++) {
+		struct client *none = NULL;
+
+		xwrite(request[1], &none, sizeof(none));
+	}
+	for (i = 0; i < servers; i++)
+		pthread_join(s[i], NULL);
+	return total;
+}
+
+int main(int argc, char **argv)
+{
+	int opt, n = 1, servers = 0, binder = 0;
+	unsigned long round_trips;
+	double t;
+
+	while ((opt = getopt(argc, argv, "m:n:s:b:t:")) != -1) {
+		switch (opt) {
+		case 'm':
+			if (!strcmp(optarg, "binder"))
+				binder = 1;
+			else if (strcmp(optarg, "pipe"))
+				goto usage;
+			break;
+		case 'n':
+			n = atoi(optarg);
+			break;
+		case 's':
+			servers = atoi(optarg);
+			break;
+		case 'b':
+			buf_size = atol(optarg);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != argc || n <= 0 || servers < 0 || seconds <= 0)
+		goto usage;
+	if (!servers)
+		servers = n;
+
+	t = now();
+	if (binder)
+		round_trips = binder_bench(n, servers);
+	else
+		round_trips = pipe_bench(n);
+	t = now() - t;
+	if (!round_trips) {
+		fprintf(stderr, "no round trips\n");
+		return 1;
+	}
+
+	printf("%s: %d %s, %zu byte buffers: %.0f round trips/s, %.2f us each, "
+	       "%.3f cpu changes per round trip\n",
+	       binder ? "binder" : "pipe", n, binder ? "clients" : "pairs",
+	       buf_size, round_trips / t, t * 1e6 * n / round_trips,
+	       (double)moves / round_trips);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-m pipe|binder] [-n pairs or clients] "
+		"[-s server threads] [-b buffer bytes] [-t seconds]\n",
+		argv[0]);
+	return 1;
+}
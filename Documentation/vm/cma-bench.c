@@ -0,0 +1,182 @@
+/*
+ * cma-bench.c - ion allocation latency under memory pressure
+ *
+ * Starts a number of memory hogs that keep anonymous memory and page
+ * cache busy, so that the movable pages the page allocator placed in a
+ * contiguous memory area have to be migrated out whenever a buffer is
+ * allocated from it.  Then allocates and frees buffers from the given
+ * ion heap and reports the allocation latencies.  Running it against a
+ * carveout heap of the same size gives the baseline.
+ *
+ * With CONFIG_CMA and debugfs, /sys/kernel/debug/cma has the kernel's
+ * view of the same allocations.
+ *
+ * Usage: cma-bench [-n allocs] [-s KB per buffer] [-i heap id]
+ *		    [-w hogs] [-m MB per hog] file
+ *
+ * The hogs together should map more than the free memory, the file is
+ * read over and over by them to keep the page cache full as well.  The
+ * default heap id is the cma heap of the OMAP4 boards.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/* From include/linux/ion.h */
+struct ion_allocation_data {
+	size_t		len;
+	size_t		align;
+	unsigned int	flags;
+	void		*handle;
+};
+
+struct ion_handle_data {
+	void		*handle;
+};
+
+#define ION_IOC_MAGIC	'I'
+#define ION_IOC_ALLOC	_IOWR(ION_IOC_MAGIC, 0, struct ion_allocation_data)
+#define ION_IOC_FREE	_IOWR(ION_IOC_MAGIC, 1, struct ion_handle_data)
+
+#define BUCKETS	24
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void hog(const char *path, size_t size)
+{
+	static char buf[1 << 20];
+	size_t off;
+	char *p;
+	int fd;
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+	for (;;) {
+		for (off = 0; off < size; off += 4096)
+			p[off]++;
+		fd = open(path, O_RDONLY);
+		if (fd < 0) {
+			perror(path);
+			exit(1);
+		}
+		while (read(fd, buf, sizeof(buf)) > 0)
+			;
+		close(fd);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct ion_allocation_data alloc;
+	struct ion_handle_data handle;
+	unsigned long hist[BUCKETS] = { 0 };
+	int allocs = 100, kb = 8192, heap_id = 6, hogs = 4, mb = 128;
+	double t, total = 0, worst = 0;
+	int opt, i, b, fd, failed = 0;
+	pid_t *pids;
+
+	while ((opt = getopt(argc, argv, "n:s:i:w:m:")) != -1) {
+		switch (opt) {
+		case 'n':
+			allocs = atoi(optarg);
+			break;
+		case 's':
+			kb = atoi(optarg);
+			break;
+		case 'i':
+			heap_id = atoi(optarg);
+			break;
+		case 'w':
+			hogs = atoi(optarg);
+			break;
+		case 'm':
+			mb = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != argc - 1)
+		goto usage;
+
+	fd = open("/dev/ion", O_RDONLY);
+	if (fd < 0) {
+		perror("/dev/ion");
+		return 1;
+	}
+
+	pids = calloc(hogs, sizeof(*pids));
+	for (i = 0; i < hogs; i++) {
+		pids[i] = fork();
+		if (pids[i] == 0)
+			hog(argv[optind], (size_t)mb << 20);
+	}
+	/* Let the hogs fill memory before the first allocation */
+	sleep(5);
+
+	for (i = 0; i < allocs; i++) {
+		memset(&alloc, 0, sizeof(alloc));
+		alloc.len = (size_t)kb << 10;
+		alloc.align = 4096;
+		alloc.flags = 1 << heap_id;
+
+		t = now_us();
+		if (ioctl(fd, ION_IOC_ALLOC, &alloc) < 0) {
+			failed++;
+			continue;
+		}
+		t = now_us() - t;
+
+		handle.handle = alloc.handle;
+		ioctl(fd, ION_IOC_FREE, &handle);
+
+		total += t;
+		if (t > worst)
+			worst = t;
+		for (b = 0; b < BUCKETS - 1 && (1UL << b) <= t; b++)
+			;
+		hist[b]++;
+		usleep(100000);
+	}
+
+	for (i = 0; i < hogs; i++) {
+		kill(pids[i], SIGKILL);
+		waitpid(pids[i], NULL, 0);
+	}
+
+	printf("%d allocations of %d KB, %d failed\n", allocs, kb, failed);
+	if (allocs > failed)
+		printf("average %.0f usecs, worst %.0f usecs\n",
+		       total / (allocs - failed), worst);
+	printf("alloc latency (usecs)      count\n");
+	for (b = 0; b < BUCKETS; b++)
+		if (hist[b])
+			printf("%8lu - %8lu %10lu\n",
+			       b ? 1UL << (b - 1) : 0, 1UL << b, hist[b]);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-n allocs] [-s KB per buffer] "
+		"[-i heap id] [-w hogs] [-m MB per hog] file\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,200 @@
+/*
+ * launch-bench.c - minor faults and time to main() of a program launch
+ *
+ * Two ways to launch:
+ *
+ * - By default, re-executes itself and maps the given file the way the
+ *   dynamic linker maps a large library or an app maps its APK: the
+ *   text is touched page by page, first every page of the leading
+ *   quarter in order, then the rest with a stride.  The time from the
+ *   fork to main() of the new image and the time and minor faults it
+ *   takes to touch the file are reported.
+ *
+ * - With -x, executes the file itself with the remaining arguments and
+ *   reports the minor faults and the time until it exits, e.g.
+ *	launch-bench -x /system/bin/app_process -- --help
+ *
+ * The first launch warms the page cache and is not counted, so all the
+ * faults counted are minor faults.  Compare runs with different values
+ * of /proc/sys/vm/fault_around_bytes, 4096 turns fault-around off.
+ *
+ * Usage: launch-bench [-n launches] [-s stride] [-x] file [args...]
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+struct result {
+	double		to_main_us;	/* fork to main() of the child */
+	double		touch_us;	/* mapping and touching the file */
+	long		touch_faults;	/* minor faults while touching */
+};
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static long minflt(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_minflt;
+}
+
+/* The re-executed child: map and touch the file, report to fd */
+static int child(double start, const char *path, long stride, int fd)
+{
+	struct result r;
+	struct stat st;
+	volatile char c;
+	size_t npages, i, head;
+	long faults;
+	char *p;
+	int file;
+
+	r.to_main_us = now_us() - start;
+
+	file = open(path, O_RDONLY);
+	if (file < 0 || fstat(file, &st) < 0) {
+		perror(path);
+		return 1;
+	}
+	faults = minflt();
+	r.touch_us = now_us();
+	p = mmap(NULL, st.st_size, PROT_READ | PROT_EXEC, MAP_PRIVATE,
+		 file, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	npages = (st.st_size + 4095) / 4096;
+	head = npages / 4;
+	for (i = 0; i < head; i++)
+		c = p[i * 4096];
+	for (i = head; i < npages; i += stride)
+		c = p[i * 4096];
+	r.touch_us = now_us() - r.touch_us;
+	r.touch_faults = minflt() - faults;
+	(void)c;
+
+	if (write(fd, &r, sizeof(r)) != sizeof(r))
+		return 1;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int launches = 20, stride = 4, exec_file = 0;
+	double total_main = 0, total_touch = 0, total_run = 0, t;
+	long total_faults = 0, total_touch_faults = 0;
+	char start_arg[32], stride_arg[32], fd_arg[16];
+	struct rusage ru;
+	struct result r;
+	int opt, i, status, fds[2];
+	pid_t pid;
+
+	if (argc == 6 && !strcmp(argv[1], "--child"))
+		return child(atof(argv[2]), argv[3], atol(argv[4]),
+			     atoi(argv[5]));
+
+	while ((opt = getopt(argc, argv, "n:s:x")) != -1) {
+		switch (opt) {
+		case 'n':
+			launches = atoi(optarg);
+			break;
+		case 's':
+			stride = atoi(optarg);
+			break;
+		case 'x':
+			exec_file = 1;
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind >= argc || launches < 1 || stride < 1)
+		goto usage;
+
+	if (pipe(fds) < 0) {
+		perror("pipe");
+		return 1;
+	}
+
+	/* Launch 0 only warms the page cache */
+	for (i = 0; i <= launches; i++) {
+		t = now_us();
+		pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			return 1;
+		}
+		if (pid == 0) {
+			if (exec_file) {
+				execv(argv[optind], &argv[optind]);
+			} else {
+				snprintf(start_arg, sizeof(start_arg), "%f", t);
+				snprintf(stride_arg, sizeof(stride_arg), "%d",
+					 stride);
+				snprintf(fd_arg, sizeof(fd_arg), "%d", fds[1]);
+				execl("/proc/self/exe", argv[0], "--child",
+				      start_arg, argv[optind], stride_arg,
+				      fd_arg, (char *)NULL);
+			}
+			perror("exec");
+			_exit(127);
+		}
+		if (wait4(pid, &status, 0, &ru) < 0) {
+			perror("wait4");
+			return 1;
+		}
+		t = now_us() - t;
+		if (!WIFEXITED(status) || (!exec_file && WEXITSTATUS(status))) {
+			fprintf(stderr, "launch %d failed\n", i);
+			return 1;
+		}
+		if (!exec_file && read(fds[0], &r, sizeof(r)) != sizeof(r)) {
+			perror("read");
+			return 1;
+		}
+		if (!i)
+			continue;
+
+		total_run += t;
+		total_faults += ru.ru_minflt;
+		if (!exec_file) {
+			total_main += r.to_main_us;
+			total_touch += r.touch_us;
+			total_touch_faults += r.touch_faults;
+		}
+	}
+
+	printf("%d launches of %s\n", launches, argv[optind]);
+	printf("per launch: %.0f usecs, %ld minor faults\n",
+	       total_run / launches, total_faults / launches);
+	if (!exec_file) {
+		printf("time to main: %.0f usecs\n", total_main / launches);
+		printf("touching the file: %.0f usecs, %ld minor faults\n",
+		       total_touch / launches, total_touch_faults / launches);
+	}
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-n launches] [-s stride] [-x] "
+		"file [args...]\n", argv[0]);
+	return 1;
+}
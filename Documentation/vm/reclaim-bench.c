@@ -0,0 +1,158 @@
+/*
+ * reclaim-bench.c - direct reclaim under allocation pressure from all cpus
+ *
+ * Starts one worker process per cpu.  Each one repeatedly maps an
+ * anonymous region and a private mapping of its own file, touches every
+ * page and unmaps them again, so that all cpus keep allocating while
+ * memory is full and have to enter direct reclaim.  The time of every
+ * touch is measured and a per-worker log2 histogram of page fault
+ * latencies is reported at the end, together with the throughput.
+ *
+ * With CONFIG_LRU_LOCK_STATS, compare /sys/kernel/debug/lru_lock_stats
+ * before and after a run, and between values of vm.reclaim_batch.
+ *
+ * Usage: reclaim-bench [-w workers] [-s seconds] [-m MB per worker] dir
+ *
+ * The workers together should map well over the amount of free memory.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define BUCKETS	24
+
+struct result {
+	unsigned long	pages;
+	unsigned long	hist[BUCKETS];	/* log2 of usecs */
+};
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void touch(char *p, size_t size, struct result *r)
+{
+	double t;
+	size_t off;
+	int b;
+
+	for (off = 0; off < size; off += 4096) {
+		t = now_us();
+		p[off] = 1;
+		t = now_us() - t;
+		for (b = 0; b < BUCKETS - 1 && (1UL << b) <= t; b++)
+			;
+		r->hist[b]++;
+		r->pages++;
+	}
+}
+
+static void worker(const char *dir, int id, size_t size, int secs,
+		   struct result *r)
+{
+	char path[256];
+	double end = now_us() + secs * 1e6;
+	char *anon, *file;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/reclaim-bench.%d", dir, id);
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0 || ftruncate(fd, size) < 0) {
+		perror(path);
+		exit(1);
+	}
+	unlink(path);
+
+	while (now_us() < end) {
+		anon = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		file = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			    MAP_SHARED, fd, 0);
+		if (anon == MAP_FAILED || file == MAP_FAILED) {
+			perror("mmap");
+			exit(1);
+		}
+		touch(anon, size, r);
+		touch(file, size, r);
+		munmap(anon, size);
+		munmap(file, size);
+	}
+	close(fd);
+}
+
+int main(int argc, char **argv)
+{
+	int workers = sysconf(_SC_NPROCESSORS_ONLN);
+	int secs = 30, mb = 256;
+	struct result *res, sum;
+	int opt, i, b;
+
+	while ((opt = getopt(argc, argv, "w:s:m:")) != -1) {
+		switch (opt) {
+		case 'w':
+			workers = atoi(optarg);
+			break;
+		case 's':
+			secs = atoi(optarg);
+			break;
+		case 'm':
+			mb = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != argc - 1)
+		goto usage;
+
+	res = mmap(NULL, workers * sizeof(*res), PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (res == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	memset(res, 0, workers * sizeof(*res));
+
+	for (i = 0; i < workers; i++) {
+		if (fork() == 0) {
+			worker(argv[optind], i, (size_t)mb << 20, secs,
+			       &res[i]);
+			exit(0);
+		}
+	}
+	for (i = 0; i < workers; i++)
+		wait(NULL);
+
+	memset(&sum, 0, sizeof(sum));
+	for (i = 0; i < workers; i++) {
+		sum.pages += res[i].pages;
+		for (b = 0; b < BUCKETS; b++)
+			sum.hist[b] += res[i].hist[b];
+	}
+
+	printf("%d workers, %lu pages touched, %.0f pages/s\n", workers,
+	       sum.pages, (double)sum.pages / secs);
+	printf("fault latency (usecs)      count\n");
+	for (b = 0; b < BUCKETS; b++)
+		if (sum.hist[b])
+			printf("%8lu - %8lu %10lu\n",
+			       b ? 1UL << (b - 1) : 0, 1UL << b, sum.hist[b]);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-w workers] [-s seconds] "
+		"[-m MB per worker] dir\n", argv[0]);
+	return 1;
+}
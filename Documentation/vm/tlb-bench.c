@@ -0,0 +1,149 @@
+/*
+ * tlb-bench.c - TLB bound access latency of anonymous memory
+ *
+ * Faults in anonymous buffers of growing size, then chases pointers
+ * through them that visit every page once in a random order, which is
+ * what a garbage collector marking a large heap looks like to the TLB.
+ * Once the buffer is larger than the TLB reach, nearly every access
+ * misses the TLB.  The time per access and the time it took to fault
+ * the buffer in are reported for each size.
+ *
+ * With CONFIG_CONT_PTE, compare runs with
+ *	echo 0 > /sys/kernel/mm/cont_pte/enabled
+ * and 1, the cont_pte lines of /proc/vmstat tell how much of the
+ * buffers was mapped in blocks.
+ *
+ * Usage: tlb-bench [-m max MB] [-n accesses per page]
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#define PAGE_SIZE	4096
+#define LINE_SIZE	64
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static long vmstat(const char *name)
+{
+	char line[128];
+	size_t len = strlen(name);
+	long val = -1;
+	FILE *f;
+
+	f = fopen("/proc/vmstat", "r");
+	if (!f)
+		return -1;
+	while (fgets(line, sizeof(line), f))
+		if (!strncmp(line, name, len) && line[len] == ' ') {
+			val = atol(line + len + 1);
+			break;
+		}
+	fclose(f);
+	return val;
+}
+
+static void bench(size_t mb, int rounds)
+{
+	size_t size = mb << 20, npages = size / PAGE_SIZE, i, j, tmp;
+	long blocks = vmstat("cont_pte_fault_alloc");
+	double t, fault_ns;
+	size_t *order;
+	void **p, **first;
+	char *buf;
+
+	t = now_ns();
+	buf = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+	for (i = 0; i < size; i += PAGE_SIZE)
+		buf[i] = 1;
+	fault_ns = now_ns() - t;
+	if (blocks >= 0)
+		blocks = vmstat("cont_pte_fault_alloc") - blocks;
+
+	/* A random cycle through all pages, at varying lines of each */
+	order = malloc(npages * sizeof(*order));
+	if (!order) {
+		perror("malloc");
+		exit(1);
+	}
+	for (i = 0; i < npages; i++)
+		order[i] = i;
+	for (i = npages - 1; i > 0; i--) {
+		j = random() % (i + 1);
+		tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+	for (i = 0; i < npages; i++) {
+		p = (void **)(buf + order[i] * PAGE_SIZE +
+			      (order[i] % (PAGE_SIZE / LINE_SIZE)) * LINE_SIZE);
+		j = order[(i + 1) % npages];
+		*p = buf + j * PAGE_SIZE +
+			(j % (PAGE_SIZE / LINE_SIZE)) * LINE_SIZE;
+	}
+	first = (void **)(buf + order[0] * PAGE_SIZE +
+			  (order[0] % (PAGE_SIZE / LINE_SIZE)) * LINE_SIZE);
+	free(order);
+
+	p = first;
+	t = now_ns();
+	for (i = 0; i < npages * rounds; i++)
+		p = *p;
+	t = now_ns() - t;
+	if (p != first)
+		fprintf(stderr, "pointer chase went astray\n");
+
+	printf("%6zu MB %10.1f ns/access %10.1f us fault-in", mb,
+	       t / (npages * rounds), fault_ns / 1000);
+	if (blocks >= 0)
+		printf(" %8ld blocks", blocks);
+	printf("\n");
+	munmap(buf, size);
+}
+
+int main(int argc, char **argv)
+{
+	size_t mb, max_mb = 256;
+	int opt, rounds = 4;
+
+	while ((opt = getopt(argc, argv, "m:n:")) != -1) {
+		switch (opt) {
+		case 'm':
+			max_mb = atol(optarg);
+			break;
+		case 'n':
+			rounds = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != argc || !max_mb || rounds < 1)
+		goto usage;
+
+	for (mb = 1; mb <= max_mb; mb *= 2)
+		bench(mb, rounds);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-m max MB] [-n accesses per page]\n",
+		argv[0]);
+	return 1;
+}
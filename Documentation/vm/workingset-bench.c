@@ -0,0 +1,157 @@
+/*
+ * workingset-bench.c - app launch latency under streaming I/O
+ *
+ * Simulates application launches while a background process streams
+ * through a large file.  Each launch maps every file given on the
+ * command line and touches all of its pages, the way the dynamic
+ * linker and the first frames of an app fault in their code and
+ * resources.  The time of each launch is printed along with the
+ * workingset counters from /proc/vmstat, so that a kernel evicting the
+ * launch working set in favour of the streamed data shows up as slow
+ * launches and refaults that are not activated.
+ *
+ * Usage: workingset-bench [-n launches] [-d delay_ms] stream_file app_file...
+ *
+ * The stream file should be larger than the page cache, the app files
+ * together should fit comfortably in it.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+static unsigned long vmstat(const char *name)
+{
+	char key[64];
+	unsigned long val, ret = 0;
+	FILE *f = fopen("/proc/vmstat", "r");
+
+	if (!f)
+		return 0;
+	while (fscanf(f, "%63s %lu", key, &val) == 2)
+		if (!strcmp(key, name)) {
+			ret = val;
+			break;
+		}
+	fclose(f);
+	return ret;
+}
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void stream(const char *path)
+{
+	static char buf[1 << 20];
+	int fd;
+
+	for (;;) {
+		fd = open(path, O_RDONLY);
+		if (fd < 0) {
+			perror(path);
+			exit(1);
+		}
+		while (read(fd, buf, sizeof(buf)) > 0)
+			;
+		close(fd);
+	}
+}
+
+static void launch(char **files, int nr)
+{
+	volatile char sum = 0;
+	struct stat st;
+	char *p;
+	off_t off;
+	int i, fd;
+
+	for (i = 0; i < nr; i++) {
+		fd = open(files[i], O_RDONLY);
+		if (fd < 0 || fstat(fd, &st) < 0) {
+			perror(files[i]);
+			exit(1);
+		}
+		p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) {
+			perror("mmap");
+			exit(1);
+		}
+		for (off = 0; off < st.st_size; off += 4096)
+			sum += p[off];
+		munmap(p, st.st_size);
+		close(fd);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long refault, activate;
+	int launches = 20, delay_ms = 1000;
+	double t, total = 0, worst = 0;
+	pid_t streamer;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "n:d:")) != -1) {
+		switch (opt) {
+		case 'n':
+			launches = atoi(optarg);
+			break;
+		case 'd':
+			delay_ms = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (argc - optind < 2)
+		goto usage;
+
+	/* Warm up the app files once before the streamer starts */
+	launch(argv + optind + 1, argc - optind - 1);
+
+	streamer = fork();
+	if (streamer == 0)
+		stream(argv[optind]);
+
+	refault = vmstat("workingset_refault");
+	activate = vmstat("workingset_activate");
+
+	for (i = 0; i < launches; i++) {
+		usleep(delay_ms * 1000);
+		t = now_ms();
+		launch(argv + optind + 1, argc - optind - 1);
+		t = now_ms() - t;
+		total += t;
+		if (t > worst)
+			worst = t;
+		printf("launch %3d: %8.2f ms\n", i + 1, t);
+	}
+
+	kill(streamer, SIGKILL);
+	waitpid(streamer, NULL, 0);
+
+	printf("average %.2f ms, worst %.2f ms\n", total / launches, worst);
+	printf("workingset_refault %lu, workingset_activate %lu\n",
+	       vmstat("workingset_refault") - refault,
+	       vmstat("workingset_activate") - activate);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-n launches] [-d delay_ms] "
+		"stream_file app_file...\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,22 @@
+#ifndef __ASM_ARM_CMA_H
+#define __ASM_ARM_CMA_H
+
+#ifdef CONFIG_CMA
+
+#include <linux/types.h>
+#include <asm/pgtable.h>
+
+struct page;
+
+/*
+ * The lowmem of the CMA areas is mapped with pages, see arch/arm/mm/mmu.c.  A
+ * buffer that is mapped with other attributes elsewhere has to have its
+ * part of the linear mapping changed to match, and back when it is
+ * freed: ARMv7 does not allow one physical page to be mapped cacheable
+ * and non-cacheable at once.
+ */
+extern void cma_remap_lowmem(struct page *page, size_t size, pgprot_t prot);
+
+#endif
+
+#endif
@@ -78,6 +78,13 @@
 #define PTE_EXT_SHARED		(1 << 10)	/* v6 */
 #define PTE_EXT_NG		(1 << 11)	/* v6 */
 
+/*
+ *   - large page
+ */
+#define PTE_LARGE_BASE_MASK	(0xffff << 16)
+#define PTE_LARGE_TEX(x)	((x) << 12)	/* v5 */
+#define PTE_LARGE_XN		(1 << 15)	/* v6 */
+
 /*
  *   - small page
  */
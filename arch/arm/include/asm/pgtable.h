@@ -173,6 +173,7 @@ extern void __pgd_error(const char *file, int line, pgd_t);
 #define L_PTE_USER		(_AT(pteval_t, 1) << 8)
 #define L_PTE_XN		(_AT(pteval_t, 1) << 9)
 #define L_PTE_SHARED		(_AT(pteval_t, 1) << 10)	/* shared(v6), coherent(xsc3) */
+#define L_PTE_CONT		(_AT(pteval_t, 1) << 11)	/* part of a 64K block */
 
 /*
  * These are the memory types, defined to be compatible with
@@ -361,7 +362,73 @@ static inline pte_t *pmd_page_vaddr(pmd_t pmd)
 #define mk_pte(page,prot)	pfn_pte(page_to_pfn(page), prot)
 
 #define set_pte_ext(ptep,pte,ext) cpu_set_pte_ext(ptep,pte,ext)
-#define pte_clear(mm,addr,ptep)	set_pte_ext(ptep, __pte(0), 0)
+
+/*
+ * With CONFIG_CONT_PTE, anonymous memory may be mapped in naturally
+ * aligned blocks of CONT_PTES physically contiguous pages, which the
+ * hardware table describes with 64K large page descriptors so that the
+ * whole block takes a single TLB entry.  The Linux ptes of a block are
+ * ordinary ptes with L_PTE_CONT set.  Changing any of them splits the
+ * whole block back into small pages first, so the rest of the mm never
+ * sees anything but small ptes.  Only the young bit is kept across the
+ * block in place.  See arch/arm/mm/cont-pte.c.
+ */
+#define CONT_PTE_SHIFT		(PAGE_SHIFT + 4)
+#define CONT_PTES		(1 << (CONT_PTE_SHIFT - PAGE_SHIFT))
+#define CONT_PTE_SIZE		(_AC(1, UL) << CONT_PTE_SHIFT)
+#define CONT_PTE_MASK		(~(CONT_PTE_SIZE - 1))
+
+#ifdef CONFIG_CONT_PTE
+#define pte_cont(pte)		(pte_val(pte) & L_PTE_CONT)
+
+extern void set_cont_ptes(struct mm_struct *mm, unsigned long addr,
+			  pte_t *ptep, pte_t pteval);
+extern void __split_cont_ptes(struct mm_struct *mm, unsigned long addr,
+			      pte_t *ptep);
+
+static inline void split_cont_ptes(struct mm_struct *mm, unsigned long addr,
+				   pte_t *ptep)
+{
+	if (unlikely((pte_val(*ptep) & (L_PTE_PRESENT | L_PTE_CONT)) ==
+		     (L_PTE_PRESENT | L_PTE_CONT)))
+		__split_cont_ptes(mm, addr, ptep);
+}
+
+/* Bit 11 is part of the offset in swap, migration and file ptes */
+static inline pte_t pte_mknoncont(pte_t pte)
+{
+	if (pte_val(pte) & L_PTE_PRESENT)
+		pte_val(pte) &= ~L_PTE_CONT;
+	return pte;
+}
+
+/*
+ * Reclaim aging and the faults that follow it only move the young bit,
+ * which they do across the whole block instead of splitting it.
+ */
+struct vm_area_struct;
+
+#define __HAVE_ARCH_PTEP_TEST_AND_CLEAR_YOUNG
+extern int ptep_test_and_clear_young(struct vm_area_struct *vma,
+				     unsigned long addr, pte_t *ptep);
+#define __HAVE_ARCH_PTEP_SET_ACCESS_FLAGS
+extern int ptep_set_access_flags(struct vm_area_struct *vma,
+				 unsigned long addr, pte_t *ptep,
+				 pte_t entry, int dirty);
+#else
+static inline void split_cont_ptes(struct mm_struct *mm, unsigned long addr,
+				   pte_t *ptep)
+{
+}
+
+#define pte_mknoncont(pte)	(pte)
+#endif
+
+#define pte_clear(mm,addr,ptep)					\
+	do {							\
+		split_cont_ptes(mm, addr, ptep);		\
+		set_pte_ext(ptep, __pte(0), 0);			\
+	} while (0)
 
 #define pte_none(pte)		(!pte_val(pte))
 #define pte_present(pte)	(pte_val(pte) & L_PTE_PRESENT)
@@ -388,6 +455,10 @@ static inline void set_pte_at(struct mm_struct *mm, unsigned long addr,
 {
 	unsigned long ext = 0;
 
+	/* Blocks are only ever made by set_cont_ptes() */
+	split_cont_ptes(mm, addr, ptep);
+	pteval = pte_mknoncont(pteval);
+
 	if (addr < TASK_SIZE && pte_present_user(pteval)) {
 		__sync_icache_dcache(pteval);
 		ext |= PTE_EXT_NG;
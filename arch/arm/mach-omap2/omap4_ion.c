@@ -10,6 +10,7 @@
  * published by the Free Software Foundation.
  */
 
+#include <linux/cma.h>
 #include <linux/ion.h>
 #include <linux/memblock.h>
 #include <linux/omap_ion.h>
@@ -43,8 +44,15 @@ static size_t omap4_ducati_heap_size;
 static size_t omap4_ion_heap_tiler_mem_size;
 static size_t omap4_ion_heap_nonsec_tiler_mem_size;
 
+/* Lent to the rest of the system while no buffers are allocated from it */
+#define OMAP4_ION_HEAP_CMA_SIZE		(SZ_1M * 64)
+
 static struct ion_platform_data omap4_ion_data = {
+#ifdef CONFIG_ION_CMA_HEAP
+	.nr = 7,
+#else
 	.nr = 6,
+#endif
 	.heaps = {
 		{
 			.type = ION_HEAP_TYPE_CARVEOUT,
@@ -75,6 +83,14 @@ static struct ion_platform_data omap4_ion_data = {
 			.id = OMAP_ION_HEAP_TILER_RESERVATION,
 			.name = "tiler_reservation",
 		},
+#ifdef CONFIG_ION_CMA_HEAP
+		/* must stay last, it is dropped if the area is missing */
+		{
+			.type = ION_HEAP_TYPE_CMA,
+			.id = OMAP_ION_HEAP_CMA,
+			.name = "cma",
+		},
+#endif
 	},
 };
 
@@ -194,6 +210,17 @@ void __init omap_ion_init(void)
 			h->base = omap4_ion_heap_tiler_mem_addr;
 			h->size = omap4_ion_heap_tiler_mem_size;
 			break;
+		case OMAP_ION_HEAP_CMA:
+			if (system_512m || cma_declare_contiguous(
+					OMAP4_ION_HEAP_CMA_SIZE, 0,
+					omap4_ion_heap_nonsec_tiler_mem_addr,
+					h->name, (struct cma **)&h->priv)) {
+				omap4_ion_data.nr--;
+				continue;
+			}
+			h->base = cma_get_base(h->priv);
+			h->size = cma_get_size(h->priv);
+			break;
 		default:
 			break;
 		}
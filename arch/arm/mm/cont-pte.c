@@ -0,0 +1,191 @@
+/*
+ *  linux/arch/arm/mm/cont-pte.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * 64K large page mappings of anonymous memory, see mm/cont_pte.c.
+ *
+ * A large page takes 16 consecutive entries of the hardware table, each
+ * of which is an identical large page descriptor with the base address
+ * of the block.  The Linux ptes of the block stay one per page, with
+ * L_PTE_CONT set, so everything that walks them still finds the page it
+ * is looking for.
+ *
+ * The TLB must never hold a small page entry and the large page entry
+ * for the same address, so blocks are only made where no valid entries
+ * are left, and taken apart break-before-make: all 16 entries go, the
+ * TLB is flushed, and then the small page entries are written.
+ *
+ * Reclaim aging does not split blocks.  Clearing the young bit of a
+ * page of a block takes all 16 hardware entries away, like an old small
+ * pte has none, and the next access to the block puts them back and
+ * marks all of its pages young again.
+ */
+#include <linux/mm.h>
+#include <linux/vmstat.h>
+
+#include <asm/cacheflush.h>
+#include <asm/pgtable.h>
+#include <asm/tlbflush.h>
+
+/*
+ * The large page equivalent of what cpu_v7_set_pte_ext() writes for a
+ * small page, with TEX remapping enabled.
+ */
+static u32 cont_pte_hw_large(pte_t pte)
+{
+	pteval_t val = pte_val(pte);
+	u32 hw;
+
+	hw = (val & PTE_LARGE_BASE_MASK) | PTE_TYPE_LARGE;
+	hw |= val & (PTE_BUFFERABLE | PTE_CACHEABLE);
+	hw |= PTE_EXT_AP0 | PTE_EXT_NG;
+	if (val & L_PTE_SHARED)
+		hw |= PTE_EXT_SHARED;
+	if (val & (1 << 4))
+		hw |= PTE_LARGE_TEX(1);
+	if ((val & L_PTE_RDONLY) || !(val & L_PTE_DIRTY))
+		hw |= PTE_EXT_APX;
+	if (val & L_PTE_USER) {
+		hw |= PTE_EXT_AP1;
+#ifdef CONFIG_CPU_USE_DOMAINS
+		/* allow kernel read/write access to read-only user pages */
+		if (hw & PTE_EXT_APX)
+			hw &= ~(PTE_EXT_APX | PTE_EXT_AP0);
+#endif
+	}
+	if (val & L_PTE_XN)
+		hw |= PTE_LARGE_XN;
+	return hw;
+}
+
+/**
+ * set_cont_ptes - map a 64K block of user memory with a large page
+ * @mm: the mm the block belongs to
+ * @addr: 64K aligned user address of the block
+ * @ptep: the first of the CONT_PTES ptes of the block
+ * @pteval: pte of the first page, young and 64K aligned
+ *
+ * The ptes must be none or cleared and flushed from the TLB, and the
+ * page table lock held.
+ */
+void set_cont_ptes(struct mm_struct *mm, unsigned long addr, pte_t *ptep,
+		   pte_t pteval)
+{
+	u32 *hwptep = (u32 *)ptep + PTE_HWTABLE_PTRS;
+	u32 hw;
+	int i;
+
+	VM_BUG_ON((addr & ~CONT_PTE_MASK) || addr >= TASK_SIZE);
+	VM_BUG_ON(pte_pfn(pteval) & (CONT_PTES - 1));
+	VM_BUG_ON(!pte_young(pteval));
+
+	pte_val(pteval) |= L_PTE_CONT;
+	hw = cont_pte_hw_large(pteval);
+	for (i = 0; i < CONT_PTES; i++) {
+		__sync_icache_dcache(pteval);
+		ptep[i] = pteval;
+		hwptep[i] = hw;
+		pte_val(pteval) += PAGE_SIZE;
+	}
+	clean_dcache_area(hwptep, CONT_PTES * sizeof(u32));
+}
+
+/*
+ * Called by set_pte_at() and pte_clear() when they are about to change a
+ * pte of a block, with the page table lock held.
+ */
+void __split_cont_ptes(struct mm_struct *mm, unsigned long addr, pte_t *ptep)
+{
+	struct vm_area_struct vma = {
+		/* All that the TLB flushing looks at */
+		.vm_mm = mm,
+		.vm_flags = VM_EXEC,
+	};
+	pte_t ptes[CONT_PTES];
+	int i;
+
+	ptep -= (addr >> PAGE_SHIFT) & (CONT_PTES - 1);
+	addr &= CONT_PTE_MASK;
+
+	for (i = 0; i < CONT_PTES; i++) {
+		ptes[i] = ptep[i];
+		set_pte_ext(ptep + i, __pte(0), 0);
+	}
+	flush_tlb_range(&vma, addr, addr + CONT_PTE_SIZE);
+
+	for (i = 0; i < CONT_PTES; i++) {
+		pte_val(ptes[i]) &= ~L_PTE_CONT;
+		set_pte_ext(ptep + i, ptes[i], PTE_EXT_NG);
+	}
+	count_vm_event(CONT_PTE_SPLIT);
+}
+
+/* Puts back the hardware entries of a block aged by the function below */
+static int cont_ptes_mkyoung(unsigned long addr, pte_t *ptep)
+{
+	u32 *hwptep;
+	u32 hw;
+	int i;
+
+	ptep -= (addr >> PAGE_SHIFT) & (CONT_PTES - 1);
+	hwptep = (u32 *)ptep + PTE_HWTABLE_PTRS;
+	if (hwptep[0])
+		return 0;
+
+	hw = cont_pte_hw_large(pte_mkyoung(ptep[0]));
+	for (i = 0; i < CONT_PTES; i++) {
+		ptep[i] = pte_mkyoung(ptep[i]);
+		hwptep[i] = hw;
+	}
+	clean_dcache_area(hwptep, CONT_PTES * sizeof(u32));
+	return 1;
+}
+
+int ptep_test_and_clear_young(struct vm_area_struct *vma, unsigned long addr,
+			      pte_t *ptep)
+{
+	pte_t pte = *ptep;
+	u32 *hwptep;
+	int i;
+
+	if (!pte_young(pte))
+		return 0;
+	if (!pte_present(pte) || !pte_cont(pte)) {
+		set_pte_at(vma->vm_mm, addr, ptep, pte_mkold(pte));
+		return 1;
+	}
+
+	*ptep = pte_mkold(pte);
+	ptep -= (addr >> PAGE_SHIFT) & (CONT_PTES - 1);
+	hwptep = (u32 *)ptep + PTE_HWTABLE_PTRS;
+	if (hwptep[0]) {
+		for (i = 0; i < CONT_PTES; i++)
+			hwptep[i] = 0;
+		clean_dcache_area(hwptep, CONT_PTES * sizeof(u32));
+		addr &= CONT_PTE_MASK;
+		flush_tlb_range(vma, addr, addr + CONT_PTE_SIZE);
+	}
+	return 1;
+}
+
+int ptep_set_access_flags(struct vm_area_struct *vma, unsigned long addr,
+			  pte_t *ptep, pte_t entry, int dirty)
+{
+	pte_t pte = *ptep;
+	int changed;
+
+	/* Any other change than the young bit splits the block */
+	if (pte_present(pte) && pte_cont(pte) &&
+	    !((pte_val(pte) ^ pte_val(entry)) & ~L_PTE_YOUNG))
+		return cont_ptes_mkyoung(addr, ptep);
+
+	changed = !pte_same(pte, entry);
+	if (changed) {
+		set_pte_at(vma->vm_mm, addr, ptep, entry);
+		flush_tlb_page(vma, addr);
+	}
+	return changed;
+}
@@ -22,6 +22,7 @@
 #include <asm/memory.h>
 #include <asm/highmem.h>
 #include <asm/cacheflush.h>
+#include <asm/cma.h>
 #include <asm/tlbflush.h>
 #include <asm/sizes.h>
 
@@ -681,3 +682,28 @@ static int __init dma_debug_do_init(void)
 	return 0;
 }
 fs_initcall(dma_debug_do_init);
+
+#ifdef CONFIG_CMA
+static int cma_update_pte(pte_t *pte, pgtable_t token, unsigned long addr,
+			  void *data)
+{
+	struct page *page = virt_to_page(addr);
+	pgprot_t prot = *(pgprot_t *)data;
+
+	set_pte_ext(pte, mk_pte(page, prot), 0);
+	return 0;
+}
+
+void cma_remap_lowmem(struct page *page, size_t size, pgprot_t prot)
+{
+	unsigned long start = (unsigned long)page_address(page);
+
+	if (PageHighMem(page))
+		return;
+
+	apply_to_page_range(&init_mm, start, size, cma_update_pte, &prot);
+	dsb();
+	flush_tlb_kernel_range(start, start + size);
+}
+EXPORT_SYMBOL(cma_remap_lowmem);
+#endif
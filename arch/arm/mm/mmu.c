@@ -15,6 +15,7 @@
 #include <linux/nodemask.h>
 #include <linux/memblock.h>
 #include <linux/fs.h>
+#include <linux/cma.h>
 
 #include <asm/cputype.h>
 #include <asm/sections.h>
@@ -281,6 +282,11 @@ static struct mem_type mem_types[] = {
 				PMD_SECT_UNCACHED | PMD_SECT_XN,
 		.domain    = DOMAIN_KERNEL,
 	},
+	[MT_MEMORY_DMA_READY] = {
+		.prot_pte  = L_PTE_PRESENT | L_PTE_YOUNG | L_PTE_DIRTY,
+		.prot_l1   = PMD_TYPE_TABLE,
+		.domain    = DOMAIN_KERNEL,
+	},
 };
 
 const struct mem_type *get_mem_type(unsigned int type)
@@ -424,6 +430,7 @@ static void __init build_mem_type_table(void)
 		mem_types[MT_MEMORY].prot_pte |= L_PTE_SHARED;
 		mem_types[MT_MEMORY_NONCACHED].prot_sect |= PMD_SECT_S;
 		mem_types[MT_MEMORY_NONCACHED].prot_pte |= L_PTE_SHARED;
+		mem_types[MT_MEMORY_DMA_READY].prot_pte |= L_PTE_SHARED;
 	}
 	/*
 	 * ARMv6 and above have extended page tables.
@@ -453,6 +460,7 @@ static void __init build_mem_type_table(void)
 			mem_types[MT_MEMORY].prot_pte |= L_PTE_SHARED;
 			mem_types[MT_MEMORY_NONCACHED].prot_sect |= PMD_SECT_S;
 			mem_types[MT_MEMORY_NONCACHED].prot_pte |= L_PTE_SHARED;
+			mem_types[MT_MEMORY_DMA_READY].prot_pte |= L_PTE_SHARED;
 		}
 	}
 
@@ -490,6 +498,7 @@ static void __init build_mem_type_table(void)
 	mem_types[MT_HIGH_VECTORS].prot_l1 |= ecc_mask;
 	mem_types[MT_MEMORY].prot_sect |= ecc_mask | cp->pmd;
 	mem_types[MT_MEMORY].prot_pte |= kern_pgprot;
+	mem_types[MT_MEMORY_DMA_READY].prot_pte |= kern_pgprot;
 	mem_types[MT_MEMORY_NONCACHED].prot_sect |= ecc_mask;
 	mem_types[MT_ROM].prot_sect |= cp->pmd;
 
@@ -569,7 +578,7 @@ static void __init alloc_init_section(pud_t *pud, unsigned long addr,
 	 * L1 entries, whereas PGDs refer to a group of L1 entries making
 	 * up one logical pointer to an L2 table.
 	 */
-	if (((addr | end | phys) & ~SECTION_MASK) == 0) {
+	if (type->prot_sect && ((addr | end | phys) & ~SECTION_MASK) == 0) {
 		pmd_t *p = pmd;
 
 		if (addr & SECTION_SIZE)
@@ -1032,6 +1041,60 @@ static void __init map_lowmem(void)
 	}
 }
 
+#ifdef CONFIG_CMA
+static struct {
+	phys_addr_t base;
+	unsigned long size;
+} cma_mmu_remap[MAX_CMA_AREAS] __initdata;
+static unsigned cma_mmu_remap_num __initdata;
+
+/* Called by cma_declare_contiguous(), before paging_init() */
+void __init cma_early_fixup(phys_addr_t base, unsigned long size)
+{
+	cma_mmu_remap[cma_mmu_remap_num].base = base;
+	cma_mmu_remap[cma_mmu_remap_num].size = size;
+	cma_mmu_remap_num++;
+}
+
+/*
+ * Map the lowmem of the CMA areas with pages instead of sections, so
+ * that cma_remap_lowmem() can change the attributes of the part of an
+ * area a buffer takes.
+ */
+static void __init cma_remap_areas(void)
+{
+	unsigned i;
+
+	for (i = 0; i < cma_mmu_remap_num; i++) {
+		phys_addr_t start = cma_mmu_remap[i].base;
+		phys_addr_t end = start + cma_mmu_remap[i].size;
+		unsigned long addr;
+		struct map_desc map;
+
+		if (end > lowmem_limit)
+			end = lowmem_limit;
+		if (start >= end)
+			continue;
+
+		map.pfn = __phys_to_pfn(start);
+		map.virtual = __phys_to_virt(start);
+		map.length = end - start;
+		map.type = MT_MEMORY_DMA_READY;
+
+		/* The areas are aligned to at least PMD_SIZE */
+		for (addr = map.virtual; addr < map.virtual + map.length;
+		     addr += PMD_SIZE)
+			pmd_clear(pmd_off_k(addr));
+
+		iotable_init(&map, 1);
+	}
+}
+#else
+static inline void cma_remap_areas(void)
+{
+}
+#endif
+
 /*
  * paging_init() sets up the page tables, initialises the zone memory
  * maps, and sets up the zero page, bad page and bad page tables.
@@ -1045,6 +1108,7 @@ void __init paging_init(struct machine_desc *mdesc)
 	build_mem_type_table();
 	prepare_page_table();
 	map_lowmem();
+	cma_remap_areas();
 	devicemaps_init(mdesc);
 	kmap_init();
 
@@ -60,6 +60,13 @@ struct driver_private {
  * @knode_bus - node in bus list
  * @driver_data - private pointer for driver specific info.  Will turn into a
  * list soon.
+ * @deferred_probe - entry in deferred_probe_list which is used to retry the
+ *	binding of drivers which were unable to get all the resources needed by
+ *	the device; typically because it depends on another driver getting
+ *	probed first.
+ * @async_driver - driver to probe the device with from an async worker.
+ * @probe_time - time spent in the probe of the device, all attempts
+ *	together.
  * @device - pointer back to the struct class that this structure is
  * associated with.
  *
@@ -70,6 +77,9 @@ struct device_private {
 	struct klist_node knode_parent;
 	struct klist_node knode_driver;
 	struct klist_node knode_bus;
+	struct list_head deferred_probe;
+	struct device_driver *async_driver;
+	ktime_t probe_time;
 	void *driver_data;
 	struct device *device;
 };
@@ -105,6 +115,8 @@ extern void bus_remove_driver(struct device_driver *drv);
 
 extern void driver_detach(struct device_driver *drv);
 extern int driver_probe_device(struct device_driver *drv, struct device *dev);
+extern void driver_deferred_probe_del(struct device *dev);
+extern int device_initial_probe(struct device *dev);
 static inline int driver_match_device(struct device_driver *drv,
 				      struct device *dev)
 {
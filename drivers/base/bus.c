@@ -490,7 +490,7 @@ void bus_probe_device(struct device *dev)
 	int ret;
 
 	if (bus && bus->p->drivers_autoprobe) {
-		ret = device_attach(dev);
+		ret = device_initial_probe(dev);
 		WARN_ON(ret < 0);
 	}
 }
@@ -310,6 +310,15 @@ static ssize_t store_uevent(struct device *dev, struct device_attribute *attr,
 static struct device_attribute uevent_attr =
 	__ATTR(uevent, S_IRUGO | S_IWUSR, show_uevent, store_uevent);
 
+static ssize_t show_probe_time(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lld\n", ktime_to_us(dev->p->probe_time));
+}
+
+static struct device_attribute probe_time_attr =
+	__ATTR(probe_time_us, S_IRUGO, show_probe_time, NULL);
+
 static int device_add_attributes(struct device *dev,
 				 struct device_attribute *attrs)
 {
@@ -870,6 +879,7 @@ int device_private_init(struct device *dev)
 	dev->p->device = dev;
 	klist_init(&dev->p->klist_children, klist_children_get,
 		   klist_children_put);
+	INIT_LIST_HEAD(&dev->p->deferred_probe);
 	return 0;
 }
 
@@ -963,6 +973,11 @@ int device_add(struct device *dev)
 	error = bus_add_device(dev);
 	if (error)
 		goto BusError;
+	if (dev->bus) {
+		error = device_create_file(dev, &probe_time_attr);
+		if (error)
+			goto ProbeTimeError;
+	}
 	error = dpm_sysfs_add(dev);
 	if (error)
 		goto DPMError;
@@ -998,6 +1013,9 @@ done:
 	put_device(dev);
 	return error;
  DPMError:
+	if (dev->bus)
+		device_remove_file(dev, &probe_time_attr);
+ ProbeTimeError:
 	bus_remove_device(dev);
  BusError:
 	device_remove_attrs(dev);
@@ -1119,7 +1137,10 @@ void device_del(struct device *dev)
 	}
 	device_remove_file(dev, &uevent_attr);
 	device_remove_attrs(dev);
+	if (dev->bus)
+		device_remove_file(dev, &probe_time_attr);
 	bus_remove_device(dev);
+	driver_deferred_probe_del(dev);
 
 	/*
 	 * Some platform devices are driven without driver attached
@@ -284,6 +284,10 @@ int platform_device_add(struct platform_device *pdev)
 	pr_debug("Registering platform device '%s'. Parent at %s\n",
 		 dev_name(&pdev->dev), dev_name(pdev->dev.parent));
 
+#ifdef CONFIG_PM_ASYNC_PLATFORM
+	device_enable_async_suspend(&pdev->dev);
+#endif
+
 	ret = device_add(&pdev->dev);
 	if (ret == 0)
 		return ret;
@@ -480,6 +484,12 @@ int __init_or_module platform_driver_probe(struct platform_driver *drv,
 {
 	int retval, code;
 
+	/*
+	 * The devices have to be bound when platform_driver_register()
+	 * returns, for the check below.
+	 */
+	drv->driver.probe_type = PROBE_FORCE_SYNCHRONOUS;
+
 	/* make sure driver won't have bind/unbind attributes */
 	drv->driver.suppress_bind_attrs = true;
 
@@ -25,6 +25,7 @@
 #include <linux/resume-trace.h>
 #include <linux/interrupt.h>
 #include <linux/sched.h>
+#include <linux/slab.h>
 #include <linux/async.h>
 #include <linux/suspend.h>
 #include <linux/timer.h>
@@ -58,6 +59,49 @@ struct dpm_drv_wd_data {
 
 static int async_error;
 
+/*
+ * Suspend/resume ordering constraints beyond the device hierarchy, see
+ * device_pm_add_dependency().  The lists are modified under
+ * dpm_list_mtx and dpm_deps_lock, and walked under dpm_deps_lock only.
+ */
+struct pm_dependency {
+	struct device		*supplier;
+	struct device		*consumer;
+	struct list_head	supplier_node;	/* in consumer's suppliers */
+	struct list_head	consumer_node;	/* in supplier's consumers */
+};
+
+static DEFINE_SPINLOCK(dpm_deps_lock);
+
+/**
+ * device_pm_remove_dependencies - Drop the ordering constraints of a device.
+ * @dev: Device being removed from the PM core's list.
+ *
+ * Caller must hold dpm_list_mtx.
+ */
+static void device_pm_remove_dependencies(struct device *dev)
+{
+	struct pm_dependency *dep, *n;
+	LIST_HEAD(suppliers);
+	LIST_HEAD(consumers);
+
+	spin_lock(&dpm_deps_lock);
+	list_for_each_entry_safe(dep, n, &dev->power.suppliers, supplier_node) {
+		list_del(&dep->consumer_node);
+		list_move(&dep->supplier_node, &suppliers);
+	}
+	list_for_each_entry_safe(dep, n, &dev->power.consumers, consumer_node) {
+		list_del(&dep->supplier_node);
+		list_move(&dep->consumer_node, &consumers);
+	}
+	spin_unlock(&dpm_deps_lock);
+
+	list_for_each_entry_safe(dep, n, &suppliers, supplier_node)
+		kfree(dep);
+	list_for_each_entry_safe(dep, n, &consumers, consumer_node)
+		kfree(dep);
+}
+
 /**
  * device_pm_init - Initialize the PM-related part of a device object.
  * @dev: Device object being initialized.
@@ -72,6 +116,8 @@ void device_pm_init(struct device *dev)
 	spin_lock_init(&dev->power.lock);
 	pm_runtime_init(dev);
 	INIT_LIST_HEAD(&dev->power.entry);
+	INIT_LIST_HEAD(&dev->power.suppliers);
+	INIT_LIST_HEAD(&dev->power.consumers);
 }
 
 /**
@@ -117,6 +163,7 @@ void device_pm_remove(struct device *dev)
 	complete_all(&dev->power.completion);
 	mutex_lock(&dpm_list_mtx);
 	list_del_init(&dev->power.entry);
+	device_pm_remove_dependencies(dev);
 	mutex_unlock(&dpm_list_mtx);
 	device_wakeup_disable(dev);
 	pm_runtime_remove(dev);
@@ -161,17 +208,101 @@ void device_pm_move_last(struct device *dev)
 	list_move_tail(&dev->power.entry, &dpm_list);
 }
 
-static ktime_t initcall_debug_start(struct device *dev)
+/*
+ * Check whether @dev has to be resumed after @target, through the device
+ * hierarchy or explicit dependencies.  Caller must hold dpm_list_mtx.
+ */
+static bool device_pm_depends_on(struct device *dev, struct device *target)
+{
+	struct pm_dependency *dep;
+
+	if (dev == target)
+		return true;
+	if (dev->parent && device_pm_depends_on(dev->parent, target))
+		return true;
+	list_for_each_entry(dep, &dev->power.suppliers, supplier_node)
+		if (device_pm_depends_on(dep->supplier, target))
+			return true;
+	return false;
+}
+
+/*
+ * Move @dev, its descendants and its consumers to the end of dpm_list.
+ * Caller must hold dpm_list_mtx.
+ */
+static int device_pm_reorder(struct device *dev, void *not_used)
+{
+	struct pm_dependency *dep;
+
+	if (!list_empty(&dev->power.entry))
+		device_pm_move_last(dev);
+	device_for_each_child(dev, NULL, device_pm_reorder);
+	list_for_each_entry(dep, &dev->power.consumers, consumer_node)
+		device_pm_reorder(dep->consumer, NULL);
+	return 0;
+}
+
+/**
+ * device_pm_add_dependency - Order system suspend and resume of two devices.
+ * @consumer: Device that needs @supplier to be functional.
+ * @supplier: Device @consumer relies on.
+ *
+ * Make @consumer suspend before and resume after @supplier, as if it was a
+ * descendant of @supplier, whether either of them is handled asynchronously
+ * or not.  @consumer, its descendants and consumers are moved to the end of
+ * dpm_list for the synchronous ordering to agree.  The constraint is
+ * dropped when either device is removed.
+ *
+ * Returns -EBUSY during a system transition and -EINVAL if @supplier already
+ * depends on @consumer.
+ */
+int device_pm_add_dependency(struct device *consumer, struct device *supplier)
 {
-	ktime_t calltime = ktime_set(0, 0);
+	struct pm_dependency *dep, *d;
+	int error = 0;
+
+	if (!consumer || !supplier)
+		return -EINVAL;
+
+	dep = kzalloc(sizeof(*dep), GFP_KERNEL);
+	if (!dep)
+		return -ENOMEM;
+
+	mutex_lock(&dpm_list_mtx);
+	if (consumer->power.is_prepared || supplier->power.is_prepared) {
+		error = -EBUSY;
+		goto out;
+	}
+	if (device_pm_depends_on(supplier, consumer)) {
+		error = -EINVAL;
+		goto out;
+	}
+	list_for_each_entry(d, &consumer->power.suppliers, supplier_node)
+		if (d->supplier == supplier)
+			goto out;
+
+	dep->supplier = supplier;
+	dep->consumer = consumer;
+	spin_lock(&dpm_deps_lock);
+	list_add_tail(&dep->supplier_node, &consumer->power.suppliers);
+	list_add_tail(&dep->consumer_node, &supplier->power.consumers);
+	spin_unlock(&dpm_deps_lock);
+	device_pm_reorder(consumer, NULL);
+	dep = NULL;
+ out:
+	mutex_unlock(&dpm_list_mtx);
+	kfree(dep);
+	return error;
+}
+EXPORT_SYMBOL_GPL(device_pm_add_dependency);
 
-	if (initcall_debug) {
+static ktime_t initcall_debug_start(struct device *dev)
+{
+	if (initcall_debug)
 		pr_info("calling  %s+ @ %i\n",
 				dev_name(dev), task_pid_nr(current));
-		calltime = ktime_get();
-	}
 
-	return calltime;
+	return ktime_get();
 }
 
 static void initcall_debug_report(struct device *dev, ktime_t calltime,
@@ -179,12 +310,18 @@ static void initcall_debug_report(struct device *dev, ktime_t calltime,
 {
 	ktime_t delta, rettime;
 
-	if (initcall_debug) {
-		rettime = ktime_get();
-		delta = ktime_sub(rettime, calltime);
+	rettime = ktime_get();
+	delta = ktime_sub(rettime, calltime);
+	dpm_times_record(dev, delta);
+
+	if (initcall_debug)
 		pr_info("call %s+ returned %d after %Ld usecs\n", dev_name(dev),
 			error, (unsigned long long)ktime_to_ns(delta) >> 10);
-	}
+}
+
+static bool dpm_need_wait(struct device *dev, bool async)
+{
+	return async || (pm_async_enabled && dev->power.async_suspend);
 }
 
 /**
@@ -197,10 +334,55 @@ static void dpm_wait(struct device *dev, bool async)
 	if (!dev)
 		return;
 
-	if (async || (pm_async_enabled && dev->power.async_suspend))
+	if (dpm_need_wait(dev, async))
 		wait_for_completion(&dev->power.completion);
 }
 
+/**
+ * dpm_wait_for_deps - Wait for the suppliers or consumers of a device.
+ * @dev: Device whose dependencies to wait for.
+ * @async: If unset, wait only for devices with power.async_suspend set.
+ * @suppliers: Wait for the suppliers (resume) or the consumers (suspend).
+ *
+ * dpm_deps_lock is dropped for waiting, so the walk restarts after each
+ * wait; the devices waited for are complete by then and get skipped.
+ */
+static void dpm_wait_for_deps(struct device *dev, bool async, bool suppliers)
+{
+	struct pm_dependency *dep;
+	struct device *target;
+
+	for (;;) {
+		target = NULL;
+		spin_lock(&dpm_deps_lock);
+		if (suppliers) {
+			list_for_each_entry(dep, &dev->power.suppliers,
+					    supplier_node)
+				if (dpm_need_wait(dep->supplier, async) &&
+				    !completion_done(&dep->supplier->power.completion)) {
+					target = dep->supplier;
+					break;
+				}
+		} else {
+			list_for_each_entry(dep, &dev->power.consumers,
+					    consumer_node)
+				if (dpm_need_wait(dep->consumer, async) &&
+				    !completion_done(&dep->consumer->power.completion)) {
+					target = dep->consumer;
+					break;
+				}
+		}
+		if (target)
+			get_device(target);
+		spin_unlock(&dpm_deps_lock);
+
+		if (!target)
+			return;
+		wait_for_completion(&target->power.completion);
+		put_device(target);
+	}
+}
+
 static int dpm_wait_fn(struct device *dev, void *async_ptr)
 {
 	dpm_wait(dev, *((bool *)async_ptr));
@@ -293,14 +475,13 @@ static int pm_noirq_op(struct device *dev,
 			pm_message_t state)
 {
 	int error = 0;
-	ktime_t calltime = ktime_set(0, 0), delta, rettime;
+	ktime_t calltime, delta, rettime;
 
-	if (initcall_debug) {
+	if (initcall_debug)
 		pr_info("calling  %s+ @ %i, parent: %s\n",
 				dev_name(dev), task_pid_nr(current),
 				dev->parent ? dev_name(dev->parent) : "none");
-		calltime = ktime_get();
-	}
+	calltime = ktime_get();
 
 	switch (state.event) {
 #ifdef CONFIG_SUSPEND
@@ -349,13 +530,14 @@ static int pm_noirq_op(struct device *dev,
 		error = -EINVAL;
 	}
 
-	if (initcall_debug) {
-		rettime = ktime_get();
-		delta = ktime_sub(rettime, calltime);
+	rettime = ktime_get();
+	delta = ktime_sub(rettime, calltime);
+	dpm_times_record(dev, delta);
+
+	if (initcall_debug)
 		printk("initcall %s_i+ returned %d after %Ld usecs\n",
 			dev_name(dev), error,
 			(unsigned long long)ktime_to_ns(delta) >> 10);
-	}
 
 	return error;
 }
@@ -461,6 +643,7 @@ void dpm_resume_noirq(pm_message_t state)
 {
 	ktime_t starttime = ktime_get();
 
+	dpm_times_start(DPM_PHASE_RESUME_NOIRQ);
 	mutex_lock(&dpm_list_mtx);
 	while (!list_empty(&dpm_noirq_list)) {
 		struct device *dev = to_device(dpm_noirq_list.next);
@@ -478,6 +661,7 @@ void dpm_resume_noirq(pm_message_t state)
 		put_device(dev);
 	}
 	mutex_unlock(&dpm_list_mtx);
+	dpm_times_end(starttime);
 	dpm_show_time(starttime, state, "early");
 	resume_device_irqs();
 }
@@ -517,6 +701,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	TRACE_RESUME(0);
 
 	dpm_wait(dev->parent, async);
+	dpm_wait_for_deps(dev, async, true);
 	device_lock(dev);
 
 	/*
@@ -628,6 +813,7 @@ void dpm_resume(pm_message_t state)
 
 	might_sleep();
 
+	dpm_times_start(DPM_PHASE_RESUME);
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
@@ -660,6 +846,7 @@ void dpm_resume(pm_message_t state)
 	}
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
+	dpm_times_end(starttime);
 	dpm_show_time(starttime, state, NULL);
 }
 
@@ -812,6 +999,7 @@ int dpm_suspend_noirq(pm_message_t state)
 	ktime_t starttime = ktime_get();
 	int error = 0;
 
+	dpm_times_start(DPM_PHASE_SUSPEND_NOIRQ);
 	suspend_device_irqs();
 	mutex_lock(&dpm_list_mtx);
 	while (!list_empty(&dpm_suspended_list)) {
@@ -833,6 +1021,7 @@ int dpm_suspend_noirq(pm_message_t state)
 		put_device(dev);
 	}
 	mutex_unlock(&dpm_list_mtx);
+	dpm_times_end(starttime);
 	if (error)
 		dpm_resume_noirq(resume_event(state));
 	else
@@ -876,6 +1065,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	struct dpm_drv_wd_data data;
 
 	dpm_wait_for_children(dev, async);
+	dpm_wait_for_deps(dev, async, false);
 
 	data.dev = dev;
 	data.tsk = get_current();
@@ -982,6 +1172,7 @@ int dpm_suspend(pm_message_t state)
 
 	might_sleep();
 
+	dpm_times_start(DPM_PHASE_SUSPEND);
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
@@ -1007,6 +1198,7 @@ int dpm_suspend(pm_message_t state)
 	}
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
+	dpm_times_end(starttime);
 	if (!error)
 		error = async_error;
 	if (!error)
@@ -30,6 +30,29 @@ extern void device_pm_move_before(struct device *, struct device *);
 extern void device_pm_move_after(struct device *, struct device *);
 extern void device_pm_move_last(struct device *);
 
+enum dpm_phase {
+	DPM_PHASE_SUSPEND,
+	DPM_PHASE_SUSPEND_NOIRQ,
+	DPM_PHASE_RESUME_NOIRQ,
+	DPM_PHASE_RESUME,
+	DPM_PHASE_COUNT,
+};
+
+#ifdef CONFIG_PM_DEVICE_TIMES
+
+/* drivers/base/power/times.c */
+extern void dpm_times_start(enum dpm_phase phase);
+extern void dpm_times_record(struct device *dev, ktime_t duration);
+extern void dpm_times_end(ktime_t starttime);
+
+#else /* !CONFIG_PM_DEVICE_TIMES */
+
+static inline void dpm_times_start(enum dpm_phase phase) {}
+static inline void dpm_times_record(struct device *dev, ktime_t duration) {}
+static inline void dpm_times_end(ktime_t starttime) {}
+
+#endif /* !CONFIG_PM_DEVICE_TIMES */
+
 #else /* !CONFIG_PM_SLEEP */
 
 static inline void device_pm_init(struct device *dev)
@@ -0,0 +1,159 @@
+/*
+ * drivers/base/power/times.c - Slowest device callbacks of system transitions.
+ *
+ * This file is released under the GPLv2.
+ *
+ * The PM core reports the duration of every device suspend and resume
+ * callback here.  For each phase of the last system transition the
+ * slowest callbacks are kept in a small sorted table, so that the devices
+ * that dominate suspend or resume latency can be read from debugfs
+ * without turning on initcall_debug and parsing the kernel log.
+ */
+
+#include <linux/device.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/math64.h>
+
+#include "power.h"
+
+#define DPM_SLOWEST	10
+
+struct dpm_time_entry {
+	char		dev_name[32];
+	char		drv_name[24];
+	s64		usecs;
+};
+
+struct dpm_phase_times {
+	unsigned int		count;		/* devices handled */
+	s64			total_usecs;	/* wall time of the phase */
+	struct dpm_time_entry	slowest[DPM_SLOWEST];
+};
+
+static const char * const dpm_phase_names[DPM_PHASE_COUNT] = {
+	[DPM_PHASE_SUSPEND]		= "suspend",
+	[DPM_PHASE_SUSPEND_NOIRQ]	= "suspend_noirq",
+	[DPM_PHASE_RESUME_NOIRQ]	= "resume_noirq",
+	[DPM_PHASE_RESUME]		= "resume",
+};
+
+static struct dpm_phase_times dpm_times[DPM_PHASE_COUNT];
+static enum dpm_phase dpm_cur_phase;
+static DEFINE_SPINLOCK(dpm_times_lock);
+
+/**
+ * dpm_times_start - Start timing a phase of a system transition.
+ * @phase: Phase about to run.
+ *
+ * Drops the results of the previous run of @phase.
+ */
+void dpm_times_start(enum dpm_phase phase)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dpm_times_lock, flags);
+	dpm_cur_phase = phase;
+	memset(&dpm_times[phase], 0, sizeof(dpm_times[phase]));
+	spin_unlock_irqrestore(&dpm_times_lock, flags);
+}
+
+/**
+ * dpm_times_record - Account a device callback to the current phase.
+ * @dev: Device whose callback returned.
+ * @duration: Time spent in the callback.
+ *
+ * May be called concurrently for asynchronously handled devices.
+ */
+void dpm_times_record(struct device *dev, ktime_t duration)
+{
+	struct dpm_phase_times *pt;
+	struct dpm_time_entry *e;
+	s64 usecs = ktime_to_us(duration);
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&dpm_times_lock, flags);
+	pt = &dpm_times[dpm_cur_phase];
+	pt->count++;
+
+	for (i = 0; i < DPM_SLOWEST; i++)
+		if (usecs > pt->slowest[i].usecs)
+			break;
+	if (i < DPM_SLOWEST) {
+		memmove(&pt->slowest[i + 1], &pt->slowest[i],
+			(DPM_SLOWEST - i - 1) * sizeof(*e));
+		e = &pt->slowest[i];
+		e->usecs = usecs;
+		strlcpy(e->dev_name, dev_name(dev), sizeof(e->dev_name));
+		strlcpy(e->drv_name, dev->driver ? dev->driver->name : "",
+			sizeof(e->drv_name));
+	}
+	spin_unlock_irqrestore(&dpm_times_lock, flags);
+}
+
+/**
+ * dpm_times_end - Finish timing the current phase.
+ * @starttime: Time the phase was started at.
+ */
+void dpm_times_end(ktime_t starttime)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dpm_times_lock, flags);
+	dpm_times[dpm_cur_phase].total_usecs =
+		ktime_to_us(ktime_sub(ktime_get(), starttime));
+	spin_unlock_irqrestore(&dpm_times_lock, flags);
+}
+
+static int dpm_slowest_show(struct seq_file *m, void *unused)
+{
+	static struct dpm_phase_times pt;
+	static DEFINE_MUTEX(show_mutex);
+	unsigned long flags;
+	s64 msecs;
+	s32 rem;
+	int phase, i;
+
+	mutex_lock(&show_mutex);
+	for (phase = 0; phase < DPM_PHASE_COUNT; phase++) {
+		spin_lock_irqsave(&dpm_times_lock, flags);
+		pt = dpm_times[phase];
+		spin_unlock_irqrestore(&dpm_times_lock, flags);
+
+		msecs = div_s64_rem(pt.total_usecs, USEC_PER_MSEC, &rem);
+		seq_printf(m, "%s: %u devices, %lld.%03d msecs\n",
+			   dpm_phase_names[phase], pt.count, msecs, rem);
+		for (i = 0; i < DPM_SLOWEST && pt.slowest[i].usecs; i++)
+			seq_printf(m, "  %2d %10lld usecs  %s %s\n", i + 1,
+				   pt.slowest[i].usecs, pt.slowest[i].dev_name,
+				   pt.slowest[i].drv_name);
+	}
+	mutex_unlock(&show_mutex);
+	return 0;
+}
+
+static int dpm_slowest_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dpm_slowest_show, NULL);
+}
+
+static const struct file_operations dpm_slowest_fops = {
+	.open		= dpm_slowest_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dpm_times_debugfs_init(void)
+{
+	debugfs_create_file("dpm_slowest", S_IRUGO, NULL, NULL,
+			    &dpm_slowest_fops);
+	return 0;
+}
+
+late_initcall(dpm_times_debugfs_init);
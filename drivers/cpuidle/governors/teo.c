@@ -0,0 +1,309 @@
+/*
+ * teo.c - the timer events oriented idle governor
+ *
+ * This code is licenced under the GPL version 2 as described
+ * in the COPYING file that acompanies the Linux Kernel.
+ */
+
+#include <linux/kernel.h>
+#include <linux/cpuidle.h>
+#include <linux/pm_qos_params.h>
+#include <linux/ktime.h>
+#include <linux/hrtimer.h>
+#include <linux/tick.h>
+#include <linux/sched.h>
+#include <linux/interrupt.h>
+#include <linux/math64.h>
+
+/*
+ * Concepts and ideas behind the teo governor
+ *
+ * Wakeups from idle come from two kinds of sources:
+ * 1) Timer events.  These are known in advance: the nohz code computes
+ *    the distance to the next expiring hrtimer or timer wheel entry
+ *    before the cpu goes idle, which tick_nohz_get_sleep_length()
+ *    returns.  Unlike menu, this value is used as is and never scaled
+ *    by a correction factor.
+ * 2) Interrupts.  These are not known in advance, but many of them
+ *    (audio periods, vsync, touch sampling, network coalescing) arrive
+ *    at a regular pace.  The irq core keeps per-cpu arrival statistics
+ *    for each interrupt line (see kernel/irq/timings.c), from which the
+ *    earliest expected interrupt on this cpu is derived.
+ *
+ * The idle duration candidate is the nearest of those two events.
+ *
+ * Interrupts that do not follow a pattern still cut idle periods
+ * short.  To account for them every idle state has a bin that counts,
+ * with exponential decay, how often the cpu woke up in that state's
+ * residency range:
+ * - "hits" when the wakeup happened where the timer said it would,
+ * - "intercepts" when something woke the cpu up earlier.
+ * If the intercepts in the bins below the candidate state outweigh the
+ * hits and intercepts of the candidate and the deeper bins, a shallower
+ * state is selected: the deepest one for which most of the recent
+ * early wakeups still happened after its target residency.
+ */
+
+/* Weight of one event in the bins */
+#define PULSE		1024
+/* Bins decay with a weight of 1/(1 << DECAY_SHIFT) per idle period */
+#define DECAY_SHIFT	3
+/* Wakeups within this much of the timer event count as timer wakeups */
+#define TIMER_SLACK_US	50
+
+struct teo_bin {
+	unsigned int	intercepts;
+	unsigned int	hits;
+};
+
+struct teo_device {
+	int		last_state_idx;
+	int		needs_update;
+
+	unsigned int	sleep_length_us;	/* distance to next timer */
+	unsigned int	irq_length_us;		/* distance to predicted irq */
+	unsigned int	exit_us;
+	struct teo_bin	bins[CPUIDLE_STATE_MAX];
+};
+
+static DEFINE_PER_CPU(struct teo_device, teo_devices);
+
+static void teo_update(struct cpuidle_device *dev);
+
+static inline unsigned int ktime_to_us_capped(ktime_t t)
+{
+	s64 us = ktime_to_us(t);
+
+	if (us < 0)
+		return 0;
+	return us > UINT_MAX ? UINT_MAX : us;
+}
+
+/*
+ * Index of the deepest usable state whose target residency fits in
+ * @duration_us, or 0 if none does.
+ */
+static int teo_find_state(struct cpuidle_device *dev,
+			  unsigned int duration_us, int latency_req)
+{
+	int i, idx = 0;
+
+	for (i = CPUIDLE_DRIVER_STATE_START; i < dev->state_count; i++) {
+		struct cpuidle_state *s = &dev->states[i];
+
+		if (s->flags & CPUIDLE_FLAG_IGNORE)
+			continue;
+		if (s->exit_latency > latency_req)
+			continue;
+		if (s->target_residency > duration_us)
+			continue;
+		idx = i;
+	}
+
+	return idx;
+}
+
+/**
+ * teo_select - selects the next idle state to enter
+ * @dev: the CPU
+ */
+static int teo_select(struct cpuidle_device *dev)
+{
+	struct teo_device *data = &__get_cpu_var(teo_devices);
+	int latency_req = pm_qos_request(PM_QOS_CPU_DMA_LATENCY);
+	unsigned int duration_us, intercepts, events;
+	u64 now, irq_next;
+	int i, idx;
+
+	if (data->needs_update) {
+		teo_update(dev);
+		data->needs_update = 0;
+	}
+
+	data->last_state_idx = 0;
+	data->exit_us = 0;
+
+	/* Special case when user has set very strict latency requirement */
+	if (unlikely(latency_req == 0))
+		return 0;
+
+	data->sleep_length_us =
+		ktime_to_us_capped(tick_nohz_get_sleep_length());
+
+	now = local_clock();
+	irq_next = irq_timings_next_event(now);
+	if (irq_next != ~0ULL)
+		data->irq_length_us = min_t(u64, div_u64(irq_next - now,
+							 NSEC_PER_USEC),
+					    UINT_MAX);
+	else
+		data->irq_length_us = UINT_MAX;
+
+	duration_us = min(data->sleep_length_us, data->irq_length_us);
+
+	idx = teo_find_state(dev, duration_us, latency_req);
+
+	/*
+	 * Weigh the early wakeups seen below the candidate state against
+	 * everything seen at or above it.
+	 */
+	intercepts = 0;
+	events = 0;
+	for (i = 0; i < dev->state_count; i++) {
+		if (i < idx)
+			intercepts += data->bins[i].intercepts;
+		else
+			events += data->bins[i].intercepts + data->bins[i].hits;
+	}
+
+	if (intercepts > events) {
+		unsigned int sum = 0;
+
+		/*
+		 * Walk down from the candidate until the states above
+		 * account for at least half of the early wakeups, so that
+		 * the selected state would still have broken even for most
+		 * of them.
+		 */
+		for (i = idx - 1; i > 0; i--) {
+			sum += data->bins[i].intercepts;
+			if (2 * sum >= intercepts)
+				break;
+		}
+		while (i > 0 && (dev->states[i].flags & CPUIDLE_FLAG_IGNORE ||
+				 dev->states[i].exit_latency > latency_req))
+			i--;
+		idx = i;
+	}
+
+	/*
+	 * We want to default to C1 (hlt), not to busy polling
+	 * unless the timer is happening really really soon.
+	 */
+	if (!idx && duration_us > 5 &&
+	    CPUIDLE_DRIVER_STATE_START < dev->state_count)
+		idx = CPUIDLE_DRIVER_STATE_START;
+
+	data->last_state_idx = idx;
+	data->exit_us = dev->states[idx].exit_latency;
+
+	return idx;
+}
+
+/**
+ * teo_reflect - records that data structures need update
+ * @dev: the CPU
+ *
+ * NOTE: it's important to be fast here because this operation will add to
+ *       the overall exit latency.
+ */
+static void teo_reflect(struct cpuidle_device *dev)
+{
+	struct teo_device *data = &__get_cpu_var(teo_devices);
+	data->needs_update = 1;
+}
+
+/* Index of the bin covering an idle period of @us microseconds */
+static int teo_bin_idx(struct cpuidle_device *dev, unsigned int us)
+{
+	int i, idx = 0;
+
+	for (i = 1; i < dev->state_count; i++) {
+		if (dev->states[i].target_residency > us)
+			break;
+		idx = i;
+	}
+
+	return idx;
+}
+
+/**
+ * teo_update - classifies the last wakeup as a timer hit or an intercept
+ * @dev: the CPU
+ */
+static void teo_update(struct cpuidle_device *dev)
+{
+	struct teo_device *data = &__get_cpu_var(teo_devices);
+	struct cpuidle_state *target = &dev->states[data->last_state_idx];
+	unsigned int measured_us;
+	int i;
+
+	/*
+	 * Without residency measurements assume the cpu slept until the
+	 * timer, which leaves the bins untouched in effect.
+	 */
+	if (unlikely(!(target->flags & CPUIDLE_FLAG_TIME_VALID)))
+		measured_us = data->sleep_length_us;
+	else
+		measured_us = cpuidle_get_last_residency(dev);
+
+	/* The event happened before the exit latency was paid */
+	if (measured_us > data->exit_us)
+		measured_us -= data->exit_us;
+
+	for (i = 0; i < dev->state_count; i++) {
+		struct teo_bin *bin = &data->bins[i];
+
+		bin->intercepts -= bin->intercepts >> DECAY_SHIFT;
+		bin->hits -= bin->hits >> DECAY_SHIFT;
+	}
+
+	if (measured_us + TIMER_SLACK_US >= data->sleep_length_us)
+		data->bins[teo_bin_idx(dev, data->sleep_length_us)].hits +=
+			PULSE;
+	else
+		data->bins[teo_bin_idx(dev, measured_us)].intercepts += PULSE;
+}
+
+/**
+ * teo_enable_device - scans a CPU's states and does setup
+ * @dev: the CPU
+ */
+static int teo_enable_device(struct cpuidle_device *dev)
+{
+	struct teo_device *data = &per_cpu(teo_devices, dev->cpu);
+
+	memset(data, 0, sizeof(struct teo_device));
+	irq_timings_enable();
+
+	return 0;
+}
+
+/**
+ * teo_disable_device - stops interrupt tracking for a CPU
+ * @dev: the CPU
+ */
+static void teo_disable_device(struct cpuidle_device *dev)
+{
+	irq_timings_disable();
+}
+
+static struct cpuidle_governor teo_governor = {
+	.name =		"teo",
+	.rating =	19,
+	.enable =	teo_enable_device,
+	.disable =	teo_disable_device,
+	.select =	teo_select,
+	.reflect =	teo_reflect,
+	.owner =	THIS_MODULE,
+};
+
+/**
+ * init_teo - initializes the governor
+ */
+static int __init init_teo(void)
+{
+	return cpuidle_register_governor(&teo_governor);
+}
+
+/**
+ * exit_teo - exits the governor
+ */
+static void __exit exit_teo(void)
+{
+	cpuidle_unregister_governor(&teo_governor);
+}
+
+MODULE_LICENSE("GPL");
+module_init(init_teo);
+module_exit(exit_teo);
@@ -0,0 +1,171 @@
+/*
+ * drivers/gpu/ion/ion_cma_heap.c
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A heap of physically contiguous buffers allocated from a contiguous
+ * memory area, see mm/cma.c.  Buffers look just like carveout buffers
+ * to the rest of ion, but the memory backs movable allocations of the
+ * rest of the system while it is not handed out.
+ *
+ * Unlike a carveout, an area stays in the kernel's cacheable linear
+ * mapping.  Buffers are mapped write combined everywhere, so the part
+ * of the linear mapping a buffer takes is remapped write combined too
+ * while the buffer is allocated.
+ */
+
+#include <linux/err.h>
+#include <linux/cma.h>
+#include <linux/highmem.h>
+#include <linux/ion.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include "ion_priv.h"
+
+#include <asm/cacheflush.h>
+#include <asm/cma.h>
+
+struct ion_cma_heap {
+	struct ion_heap heap;
+	struct cma *cma;
+};
+
+static inline struct cma *to_cma(struct ion_heap *heap)
+{
+	return container_of(heap, struct ion_cma_heap, heap)->cma;
+}
+
+static inline struct page *ion_cma_buffer_page(struct ion_buffer *buffer)
+{
+	return pfn_to_page(__phys_to_pfn(buffer->priv_phys));
+}
+
+static int ion_cma_heap_allocate(struct ion_heap *heap,
+				 struct ion_buffer *buffer,
+				 unsigned long size, unsigned long align,
+				 unsigned long flags)
+{
+	unsigned long i, nr_pages = PAGE_ALIGN(size) >> PAGE_SHIFT;
+	struct page *page;
+	void *vaddr;
+
+	page = cma_alloc(to_cma(heap), nr_pages,
+			 align > PAGE_SIZE ? get_order(align) : 0);
+	if (!page)
+		return -ENOMEM;
+
+	/*
+	 * The pages held data of the rest of the system until now, clear
+	 * them and write the cache lines back before a device gets to them.
+	 */
+	for (i = 0; i < nr_pages; i++) {
+		vaddr = kmap_atomic(page + i);
+		memset(vaddr, 0, PAGE_SIZE);
+		__cpuc_flush_dcache_area(vaddr, PAGE_SIZE);
+		kunmap_atomic(vaddr);
+	}
+	buffer->priv_phys = page_to_phys(page);
+	outer_flush_range(buffer->priv_phys,
+			  buffer->priv_phys + (nr_pages << PAGE_SHIFT));
+
+	cma_remap_lowmem(page, nr_pages << PAGE_SHIFT,
+			 pgprot_writecombine(PAGE_KERNEL));
+	return 0;
+}
+
+static void ion_cma_heap_free(struct ion_buffer *buffer)
+{
+	unsigned long nr_pages = PAGE_ALIGN(buffer->size) >> PAGE_SHIFT;
+	struct page *page = ion_cma_buffer_page(buffer);
+
+	cma_remap_lowmem(page, nr_pages << PAGE_SHIFT, PAGE_KERNEL);
+	cma_release(to_cma(buffer->heap), page, nr_pages);
+	buffer->priv_phys = ION_CARVEOUT_ALLOCATE_FAIL;
+}
+
+static int ion_cma_heap_phys(struct ion_heap *heap,
+			     struct ion_buffer *buffer,
+			     ion_phys_addr_t *addr, size_t *len)
+{
+	*addr = buffer->priv_phys;
+	*len = buffer->size;
+	return 0;
+}
+
+static void *ion_cma_heap_map_kernel(struct ion_heap *heap,
+				     struct ion_buffer *buffer)
+{
+	unsigned long i, nr_pages = PAGE_ALIGN(buffer->size) >> PAGE_SHIFT;
+	struct page *page = ion_cma_buffer_page(buffer);
+	struct page **pages;
+	void *vaddr;
+
+	pages = vmalloc(sizeof(struct page *) * nr_pages);
+	if (!pages)
+		return NULL;
+	for (i = 0; i < nr_pages; i++)
+		pages[i] = page + i;
+	vaddr = vmap(pages, nr_pages, VM_MAP, pgprot_writecombine(PAGE_KERNEL));
+	vfree(pages);
+	return vaddr;
+}
+
+static void ion_cma_heap_unmap_kernel(struct ion_heap *heap,
+				      struct ion_buffer *buffer)
+{
+	vunmap(buffer->vaddr);
+	buffer->vaddr = NULL;
+}
+
+/* Cached mappings would alias the write combined linear mapping */
+static int ion_cma_heap_map_user(struct ion_heap *heap,
+				 struct ion_buffer *buffer,
+				 struct vm_area_struct *vma)
+{
+	return remap_pfn_range(vma, vma->vm_start,
+			       __phys_to_pfn(buffer->priv_phys) + vma->vm_pgoff,
+			       buffer->size,
+			       pgprot_writecombine(vma->vm_page_prot));
+}
+
+static struct ion_heap_ops cma_heap_ops = {
+	.allocate = ion_cma_heap_allocate,
+	.free = ion_cma_heap_free,
+	.phys = ion_cma_heap_phys,
+	.map_user = ion_cma_heap_map_user,
+	.flush_user = ion_carveout_heap_flush_user,
+	.inval_user = ion_carveout_heap_inval_user,
+	.map_kernel = ion_cma_heap_map_kernel,
+	.unmap_kernel = ion_cma_heap_unmap_kernel,
+};
+
+struct ion_heap *ion_cma_heap_create(struct ion_platform_heap *heap_data)
+{
+	struct ion_cma_heap *cma_heap;
+
+	if (!heap_data->priv)
+		return ERR_PTR(-EINVAL);
+
+	cma_heap = kzalloc(sizeof(struct ion_cma_heap), GFP_KERNEL);
+	if (!cma_heap)
+		return ERR_PTR(-ENOMEM);
+
+	cma_heap->cma = heap_data->priv;
+	cma_heap->heap.ops = &cma_heap_ops;
+	cma_heap->heap.type = ION_HEAP_TYPE_CMA;
+
+	return &cma_heap->heap;
+}
+
+void ion_cma_heap_destroy(struct ion_heap *heap)
+{
+	kfree(container_of(heap, struct ion_cma_heap, heap));
+}
@@ -246,6 +246,9 @@ void ion_system_contig_heap_destroy(struct ion_heap *);
 
 struct ion_heap *ion_carveout_heap_create(struct ion_platform_heap *);
 void ion_carveout_heap_destroy(struct ion_heap *);
+
+struct ion_heap *ion_cma_heap_create(struct ion_platform_heap *);
+void ion_cma_heap_destroy(struct ion_heap *);
 /**
  * kernel api to allocate/free from carveout -- used when carveout is
  * used to back an architecture specific custom heap
@@ -260,6 +263,17 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  */
 #define ION_CARVEOUT_ALLOCATE_FAIL -1
 
+/**
+ * carveout heap ops that work for any heap of physically contiguous
+ * buffers described by buffer->priv_phys
+ */
+int ion_carveout_heap_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
+			       struct vm_area_struct *vma);
+int ion_carveout_heap_flush_user(struct ion_buffer *buffer, size_t len,
+				 unsigned long vaddr);
+int ion_carveout_heap_inval_user(struct ion_buffer *buffer, size_t len,
+				 unsigned long vaddr);
+
 /**
  * Flushing entire cache is more efficient than flushing virtual address
  * range of a buffer whose size is 200Kbytes or higher, since line by
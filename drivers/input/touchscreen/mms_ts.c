@@ -830,7 +830,7 @@ static int __devinit mms_ts_probe(struct i2c_client *client,
 	info->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN + 1;
 	info->early_suspend.suspend = mms_ts_early_suspend;
 	info->early_suspend.resume = mms_ts_late_resume;
-	register_early_suspend(&info->early_suspend);
+	register_early_suspend_async(&info->early_suspend, NULL);
 #endif
 
 	return 0;
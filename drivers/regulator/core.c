@@ -1088,6 +1088,14 @@ static struct regulator *create_regulator(struct regulator_dev *rdev,
 				  dev->kobj.name, err);
 			goto link_name_err;
 		}
+
+#ifdef CONFIG_PM_REGULATOR_DEPS
+		/* Keep the supply up while the consumer suspends and resumes */
+		err = device_pm_add_dependency(dev, &rdev->dev);
+		if (err)
+			rdev_warn(rdev, "could not order PM of %s err %d\n",
+				  dev->kobj.name, err);
+#endif
 	}
 	mutex_unlock(&rdev->mutex);
 	return regulator;
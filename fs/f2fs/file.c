@@ -87,6 +87,7 @@ out:
 
 static const struct vm_operations_struct f2fs_file_vm_ops = {
 	.fault        = filemap_fault,
+	.map_pages    = filemap_map_pages,
 	.page_mkwrite = f2fs_vm_page_mkwrite,
 };
 
@@ -474,6 +474,13 @@ static int show_smap(struct seq_file *m, void *v)
 		   (vma->vm_flags & VM_LOCKED) ?
 			(unsigned long)(mss.pss >> (10 + PSS_SHIFT)) : 0);
 
+#ifdef CONFIG_SWAP
+	seq_printf(m,
+		   "SwapRaHits:     %8lu\n"
+		   "SwapRaMisses:   %8lu\n",
+		   vma->swap_ra_hits, vma->swap_ra_misses);
+#endif
+
 	if (m->count < m->size)  /* vma is copied successfully */
 		m->version = (vma != get_gate_vma(task->mm))
 			? vma->vm_start : 0;
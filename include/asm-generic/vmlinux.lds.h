@@ -616,31 +616,56 @@
 		*(.init.setup)						\
 		VMLINUX_SYMBOL(__setup_end) = .;
 
+/*
+ * Every level starts with a __initcall<level>_start symbol, so that
+ * do_initcalls() can tell where one level ends and the next begins.
+ */
 #define INITCALLS							\
 	*(.initcallearly.init)						\
 	VMLINUX_SYMBOL(__early_initcall_end) = .;			\
-  	*(.initcall0.init)						\
-  	*(.initcall0s.init)						\
-  	*(.initcall1.init)						\
-  	*(.initcall1s.init)						\
-  	*(.initcall2.init)						\
-  	*(.initcall2s.init)						\
-  	*(.initcall3.init)						\
-  	*(.initcall3s.init)						\
-  	*(.initcall4.init)						\
-  	*(.initcall4s.init)						\
-  	*(.initcall5.init)						\
-  	*(.initcall5s.init)						\
+	VMLINUX_SYMBOL(__initcall0_start) = .;				\
+	*(.initcall0.init)						\
+	VMLINUX_SYMBOL(__initcall0s_start) = .;				\
+	*(.initcall0s.init)						\
+	VMLINUX_SYMBOL(__initcall1_start) = .;				\
+	*(.initcall1.init)						\
+	VMLINUX_SYMBOL(__initcall1s_start) = .;				\
+	*(.initcall1s.init)						\
+	VMLINUX_SYMBOL(__initcall2_start) = .;				\
+	*(.initcall2.init)						\
+	VMLINUX_SYMBOL(__initcall2s_start) = .;				\
+	*(.initcall2s.init)						\
+	VMLINUX_SYMBOL(__initcall3_start) = .;				\
+	*(.initcall3.init)						\
+	VMLINUX_SYMBOL(__initcall3s_start) = .;				\
+	*(.initcall3s.init)						\
+	VMLINUX_SYMBOL(__initcall4_start) = .;				\
+	*(.initcall4.init)						\
+	VMLINUX_SYMBOL(__initcall4s_start) = .;				\
+	*(.initcall4s.init)						\
+	VMLINUX_SYMBOL(__initcall5_start) = .;				\
+	*(.initcall5.init)						\
+	VMLINUX_SYMBOL(__initcall5s_start) = .;				\
+	*(.initcall5s.init)						\
+	VMLINUX_SYMBOL(__initcallrootfs_start) = .;			\
 	*(.initcallrootfs.init)						\
-  	*(.initcall6.init)						\
-  	*(.initcall6s.init)						\
-  	*(.initcall7.init)						\
-  	*(.initcall7s.init)
+	VMLINUX_SYMBOL(__initcall6_start) = .;				\
+	*(.initcall6.init)						\
+	VMLINUX_SYMBOL(__initcall6s_start) = .;				\
+	*(.initcall6s.init)						\
+	VMLINUX_SYMBOL(__initcall7_start) = .;				\
+	*(.initcall7.init)						\
+	VMLINUX_SYMBOL(__initcall7s_start) = .;				\
+	*(.initcall7s.init)
 
 #define INIT_CALLS							\
 		VMLINUX_SYMBOL(__initcall_start) = .;			\
 		INITCALLS						\
-		VMLINUX_SYMBOL(__initcall_end) = .;
+		VMLINUX_SYMBOL(__initcall_end) = .;			\
+		. = ALIGN(8);						\
+		VMLINUX_SYMBOL(__initcall_deps_start) = .;		\
+		*(.initcall_deps.init)					\
+		VMLINUX_SYMBOL(__initcall_deps_end) = .;
 
 #define CON_INITCALL							\
 		VMLINUX_SYMBOL(__con_initcall_start) = .;		\
@@ -0,0 +1,72 @@
+#ifndef _LINUX_CMA_H
+#define _LINUX_CMA_H
+
+/*
+ * Contiguous Memory Allocator
+ *
+ * Memory areas reserved at boot for large physically contiguous buffers
+ * are handed to the page allocator as MIGRATE_CMA pageblocks, which only
+ * satisfy movable allocations.  When a contiguous buffer is requested,
+ * the pages in use in the requested part of the area are migrated out.
+ */
+
+#include <linux/types.h>
+#include <linux/errno.h>
+
+struct cma;
+struct page;
+
+#ifdef CONFIG_CMA
+
+#define MAX_CMA_AREAS	4
+
+/*
+ * Called for every area cma_declare_contiguous() reserves, for the
+ * architecture to map its lowmem differently.
+ */
+extern void cma_early_fixup(phys_addr_t base, unsigned long size);
+
+extern int cma_declare_contiguous(phys_addr_t size, phys_addr_t base,
+				  phys_addr_t limit, const char *name,
+				  struct cma **res_cma);
+extern struct page *cma_alloc(struct cma *cma, unsigned long count,
+			      unsigned int align);
+extern bool cma_release(struct cma *cma, struct page *pages,
+			unsigned long count);
+extern phys_addr_t cma_get_base(struct cma *cma);
+extern unsigned long cma_get_size(struct cma *cma);
+
+#else
+
+static inline int cma_declare_contiguous(phys_addr_t size, phys_addr_t base,
+					 phys_addr_t limit, const char *name,
+					 struct cma **res_cma)
+{
+	return -ENOSYS;
+}
+
+static inline struct page *cma_alloc(struct cma *cma, unsigned long count,
+				     unsigned int align)
+{
+	return NULL;
+}
+
+static inline bool cma_release(struct cma *cma, struct page *pages,
+			       unsigned long count)
+{
+	return false;
+}
+
+static inline phys_addr_t cma_get_base(struct cma *cma)
+{
+	return 0;
+}
+
+static inline unsigned long cma_get_size(struct cma *cma)
+{
+	return 0;
+}
+
+#endif
+
+#endif /* _LINUX_CMA_H */
@@ -0,0 +1,36 @@
+#ifndef _LINUX_CONT_PTE_H
+#define _LINUX_CONT_PTE_H
+
+#include <linux/sched.h>
+
+/*
+ * Anonymous memory mapped in blocks of contiguous ptes, see
+ * mm/cont_pte.c.  An architecture selecting HAVE_ARCH_CONT_PTE provides
+ * CONT_PTE_SHIFT, CONT_PTES, CONT_PTE_SIZE and CONT_PTE_MASK, pte_cont()
+ * and set_cont_ptes(), and splits a block whenever one of its ptes is
+ * changed through set_pte_at() or pte_clear().
+ */
+#ifdef CONFIG_CONT_PTE
+extern bool cont_pte_fault(struct mm_struct *mm, struct vm_area_struct *vma,
+			   unsigned long address, pmd_t *pmd);
+extern void __cont_pte_exit(struct mm_struct *mm);
+
+static inline void cont_pte_exit(struct mm_struct *mm)
+{
+	if (test_bit(MMF_CONT_PTE, &mm->flags))
+		__cont_pte_exit(mm);
+}
+#else
+static inline bool cont_pte_fault(struct mm_struct *mm,
+				  struct vm_area_struct *vma,
+				  unsigned long address, pmd_t *pmd)
+{
+	return false;
+}
+
+static inline void cont_pte_exit(struct mm_struct *mm)
+{
+}
+#endif /* CONFIG_CONT_PTE */
+
+#endif /* _LINUX_CONT_PTE_H */
@@ -151,6 +151,26 @@ extern int bus_unregister_notifier(struct bus_type *bus,
 extern struct kset *bus_get_kset(struct bus_type *bus);
 extern struct klist *bus_get_device_klist(struct bus_type *bus);
 
+/**
+ * enum probe_type - how the devices of a driver are probed
+ * @PROBE_DEFAULT_STRATEGY: Probe from the thread that registered the
+ *	driver or the device, unless the driver was named in the
+ *	driver_async_probe= kernel parameter.
+ * @PROBE_PREFER_ASYNCHRONOUS: Probe from a worker, so that a slow probe
+ *	does not hold up the registration of other drivers and devices.
+ *	Only for drivers that do not expect to be bound when
+ *	driver_register() or device_add() returns.
+ * @PROBE_FORCE_SYNCHRONOUS: Always probe from the registering thread,
+ *	whatever driver_async_probe= says.  For drivers that need to be
+ *	bound when driver_register() returns, like those registered with
+ *	platform_driver_probe().
+ */
+enum probe_type {
+	PROBE_DEFAULT_STRATEGY,
+	PROBE_PREFER_ASYNCHRONOUS,
+	PROBE_FORCE_SYNCHRONOUS,
+};
+
 /**
  * struct device_driver - The basic device driver structure
  * @name:	Name of the device driver.
@@ -158,10 +178,16 @@ extern struct klist *bus_get_device_klist(struct bus_type *bus);
  * @owner:	The module owner.
  * @mod_name:	Used for built-in modules.
  * @suppress_bind_attrs: Disables bind/unbind via sysfs.
+ * @probe_type:	Whether the driver core may probe the devices of this
+ *		driver from a worker, rather than from the thread that
+ *		registered the driver or the device.
  * @of_match_table: The open firmware table.
  * @probe:	Called to query the existence of a specific device,
  *		whether this driver can work with it, and bind the driver
- *		to a specific device.
+ *		to a specific device.  May return -EPROBE_DEFER when
+ *		something it needs, such as a regulator or a clock, is
+ *		not there yet; the device is probed again after another
+ *		driver bound.
  * @remove:	Called when the device is removed from the system to
  *		unbind a device from this driver.
  * @shutdown:	Called at shut-down time to quiesce the device.
@@ -190,6 +216,7 @@ struct device_driver {
 	const char		*mod_name;	/* used for built-in modules */
 
 	bool suppress_bind_attrs;	/* disables bind/unbind via sysfs */
+	enum probe_type probe_type;
 
 	const struct of_device_id	*of_match_table;
 
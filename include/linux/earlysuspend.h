@@ -18,6 +18,8 @@
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/list.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
 #endif
 
 /* The early_suspend structure defines suspend and resume hooks to be called
@@ -29,6 +31,12 @@
  * the suspend handlers have already been called without a matching call to the
  * resume handlers, the suspend handler will be called directly from
  * register_early_suspend. This direct call can violate the normal level order.
+ *
+ * Handlers registered with register_early_suspend_async may run concurrently
+ * with the other handlers of the same level. Such a handler can name another
+ * handler it depends on, asynchronous or not: the dependency resumes before
+ * it, and it suspends before the dependency. Across levels the level order
+ * already provides this, so a dependency must have the same or a higher level.
  */
 enum {
 	EARLY_SUSPEND_LEVEL_BLANK_SCREEN = 50,
@@ -41,14 +49,28 @@ struct early_suspend {
 	int level;
 	void (*suspend)(struct early_suspend *h);
 	void (*resume)(struct early_suspend *h);
+	unsigned int flags;
+	struct early_suspend *depends_on;
+	struct completion done;
+	struct {
+		ktime_t last_suspend;
+		ktime_t max_suspend;
+		ktime_t last_resume;
+		ktime_t max_resume;
+	} stat;
 #endif
 };
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
+#define EARLY_SUSPEND_ASYNC	(1U << 0)
+
 void register_early_suspend(struct early_suspend *handler);
+void register_early_suspend_async(struct early_suspend *handler,
+				  struct early_suspend *depends_on);
 void unregister_early_suspend(struct early_suspend *handler);
 #else
 #define register_early_suspend(handler) do { } while (0)
+#define register_early_suspend_async(handler, depends_on) do { } while (0)
 #define unregister_early_suspend(handler) do { } while (0)
 #endif
 
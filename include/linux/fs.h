@@ -910,6 +910,36 @@ struct fown_struct {
 	int signum;		/* posix.1b rt signal to be delivered on IO */
 };
 
+/*
+ * Access patterns told apart by the readahead code
+ */
+enum ra_pattern {
+	RA_PATTERN_NONE,		/* stream slot unused */
+	RA_PATTERN_RANDOM,
+	RA_PATTERN_SEQUENTIAL,
+	RA_PATTERN_STRIDED,
+	RA_PATTERN_REVERSE,
+	RA_PATTERN_INTERLEAVED,		/* sequential, alternating with others */
+};
+
+#define RA_STREAMS	4
+
+/*
+ * One of the concurrent read streams on a file
+ */
+struct ra_stream {
+	pgoff_t start;			/* readahead window of the stream */
+	unsigned int size;
+	unsigned int async_size;
+
+	pgoff_t prev_index;		/* start of the last request */
+	unsigned int prev_req;		/* pages in the last request */
+	int stride;			/* pages between request starts */
+	unsigned int max;		/* window limit after thrashing, or 0 */
+	unsigned char pattern;		/* enum ra_pattern */
+	unsigned char hits;		/* times the pattern repeated */
+};
+
 /*
  * Track a single file's readahead state
  */
@@ -922,6 +952,9 @@ struct file_ra_state {
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
 	loff_t prev_pos;		/* Cache last read() position */
+
+	/* Most recently used first, streams[0] shadows start/size/async_size */
+	struct ra_stream streams[RA_STREAMS];
 };
 
 /*
@@ -211,6 +211,35 @@ extern int initcall_debug;
 
 #define __initcall(fn) device_initcall(fn)
 
+/*
+ * With parallel initcalls, the initcalls of a level may run at the same
+ * time.  An initcall that needs another one of its level to have run
+ * says so by name: initcall_requires(fn, "name") makes @fn wait for every
+ * initcall of its level marked initcall_provides(other, "name").  Both
+ * sides are annotated next to their own initcall, so that neither needs
+ * to see the other's symbol.  Initcalls of earlier levels have always
+ * run already.
+ */
+struct initcall_dep {
+	initcall_t fn;
+	const char *name;
+	int provides;
+};
+
+#ifdef CONFIG_PARALLEL_INITCALLS
+#define __initcall_dep_id(fn, line)	__initcall_dep_##fn##_##line
+#define __initcall_dep_sym(fn, line)	__initcall_dep_id(fn, line)
+#define __define_initcall_dep(fn, dep, prov) \
+	static struct initcall_dep __initcall_dep_sym(fn, __LINE__) __used \
+	__attribute__((__section__(".initcall_deps.init"), \
+		       aligned(sizeof(void *)))) = { fn, dep, prov }
+#else
+#define __define_initcall_dep(fn, dep, prov)
+#endif
+
+#define initcall_provides(fn, name)	__define_initcall_dep(fn, name, 1)
+#define initcall_requires(fn, name)	__define_initcall_dep(fn, name, 0)
+
 #define __exitcall(fn) \
 	static exitcall_t __exitcall_##fn __exit_call = fn
 
@@ -291,6 +320,10 @@ void __init parse_early_options(char *cmdline);
 
 #define security_initcall(fn)		module_init(fn)
 
+/* A module runs its initcall alone */
+#define initcall_provides(fn, name)
+#define initcall_requires(fn, name)
+
 /* Each module must use one module_init(). */
 #define module_init(initfn)					\
 	static inline initcall_t __inittest(void)		\
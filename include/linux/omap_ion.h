@@ -92,6 +92,7 @@ enum {
 	OMAP_ION_HEAP_NONSECURE_TILER,
 	OMAP_ION_HEAP_TILER_RESERVATION,
 	OMAP_ION_HEAP_SECURE_OUTPUT_WFDHDCP,
+	OMAP_ION_HEAP_CMA,
 };
 
 #endif /* _LINUX_ION_H */
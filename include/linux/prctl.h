@@ -1,6 +1,8 @@
 #ifndef _LINUX_PRCTL_H
 #define _LINUX_PRCTL_H
 
+#include <linux/types.h>
+
 /* Values to pass as first argument to prctl() */
 
 #define PR_SET_PDEATHSIG  1  /* Second arg is a signal */
@@ -102,4 +104,33 @@
 
 #define PR_MCE_KILL_GET 34
 
+/*
+ * The options below are private to this tree.  They are numbered far
+ * from the upstream options, which may take the next free numbers.
+ */
+
+/*
+ * Set or get the latency nice value of a task: how soon after waking up
+ * it wants to run, from -20 to 19, without changing its share of the
+ * cpu.  arg3 is the pid of the task, 0 for the calling one.
+ */
+#define PR_SET_LATENCY_NICE	0x54554e01
+#define PR_GET_LATENCY_NICE	0x54554e02
+
+/*
+ * Give a task a SCHED_DEADLINE reservation, or read the one it has.
+ * arg2 points to a struct sched_dl_param, arg3 is the pid of the task,
+ * 0 for the calling one.  Times are in nanoseconds; a zero period means
+ * the same as the deadline.  sched_setscheduler() to another policy
+ * gives the reservation up.
+ */
+#define PR_SET_DEADLINE		0x54554e03
+#define PR_GET_DEADLINE		0x54554e04
+
+struct sched_dl_param {
+	__u64	sched_runtime;
+	__u64	sched_deadline;
+	__u64	sched_period;
+};
+
 #endif /* _LINUX_PRCTL_H */
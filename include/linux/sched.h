@@ -39,6 +39,7 @@
 #define SCHED_BATCH		3
 /* SCHED_ISO: reserved but not implemented yet */
 #define SCHED_IDLE		5
+#define SCHED_DEADLINE		6
 /* Can be ORed in to make sure the process is reverted back to SCHED_NORMAL on fork */
 #define SCHED_RESET_ON_FORK     0x40000000
 
@@ -270,6 +271,11 @@ extern void init_idle_bootup_task(struct task_struct *idle);
 
 extern int runqueue_is_locked(int cpu);
 
+/* Decayed averages of the fair class, see kernel/sched_fair.c */
+extern unsigned long sched_cpu_util(int cpu);
+extern unsigned long sched_cpu_load_avg(int cpu);
+extern unsigned long sched_task_util(struct task_struct *p);
+
 extern cpumask_var_t nohz_cpu_mask;
 #if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ)
 extern void select_nohz_load_balancer(int stop_tick);
@@ -435,6 +441,7 @@ extern int get_dumpable(struct mm_struct *mm);
 					/* leave room for more dump flags */
 #define MMF_VM_MERGEABLE	16	/* KSM may merge identical pages */
 #define MMF_VM_HUGEPAGE		17	/* set when VM_HUGEPAGE is set on vma */
+#define MMF_CONT_PTE		18	/* scanned by kcontpted */
 
 #define MMF_INIT_MASK		(MMF_DUMPABLE_MASK | MMF_DUMP_FILTER_MASK)
 
@@ -1078,6 +1085,7 @@ struct sched_domain;
 #else
 #define ENQUEUE_WAKING		0
 #endif
+#define ENQUEUE_REPLENISH	8	/* SCHED_DEADLINE runtime given back */
 
 #define DEQUEUE_SLEEP		1
 
@@ -1112,6 +1120,7 @@ struct sched_class {
 	void (*set_curr_task) (struct rq *rq);
 	void (*task_tick) (struct rq *rq, struct task_struct *p, int queued);
 	void (*task_fork) (struct task_struct *p);
+	void (*task_dead) (struct task_struct *p);
 
 	void (*switched_from) (struct rq *this_rq, struct task_struct *task);
 	void (*switched_to) (struct rq *this_rq, struct task_struct *task);
@@ -1163,14 +1172,35 @@ struct sched_statistics {
 	u64			nr_wakeups_affine_attempts;
 	u64			nr_wakeups_passive;
 	u64			nr_wakeups_idle;
+	u64			nr_wakeups_pair;
+
+	u64			nr_dl_throttled;
+	u64			nr_dl_misses;
+
+	u64			wakeup_start;
 };
 #endif
 
+/*
+ * Per-entity load tracking, see kernel/sched_fair.c: geometric series of
+ * the time spent runnable and running, in periods of 1024us.
+ */
+struct sched_avg {
+	u64			last_update;
+	u32			runnable_sum;
+	u32			running_sum;
+	u32			period_sum;
+	u32			period_contrib;
+	unsigned long		load_avg;	/* weighted runnable fraction */
+	unsigned long		util_avg;	/* running fraction, of SCHED_LOAD_SCALE */
+};
+
 struct sched_entity {
 	struct load_weight	load;		/* for load-balancing */
 	struct rb_node		run_node;
 	struct list_head	group_node;
 	unsigned int		on_rq;
+	int			latency_nice;	/* wakeup latency, not weight */
 
 	u64			exec_start;
 	u64			sum_exec_runtime;
@@ -1179,6 +1209,8 @@ struct sched_entity {
 
 	u64			nr_migrations;
 
+	struct sched_avg	avg;
+
 #ifdef CONFIG_SCHEDSTATS
 	struct sched_statistics statistics;
 #endif
@@ -1208,6 +1240,33 @@ struct sched_rt_entity {
 #endif
 };
 
+/*
+ * A SCHED_DEADLINE reservation, see kernel/sched_dl.c: up to dl_runtime
+ * of cpu time in every dl_period, to be used within dl_deadline of the
+ * start of the period.
+ */
+struct sched_dl_entity {
+	struct rb_node		rb_node;
+
+	u64			dl_runtime;
+	u64			dl_deadline;
+	u64			dl_period;
+	u64			dl_bw;		/* dl_runtime / dl_period, << 20 */
+
+	/* The current instance */
+	s64			runtime;	/* what is left of dl_runtime */
+	u64			deadline;	/* absolute, in rq->clock */
+
+	unsigned int		dl_new:1;	/* parameters not applied yet */
+	unsigned int		dl_throttled:1;	/* runtime used up */
+	unsigned int		dl_yielded:1;	/* gave up its runtime */
+
+	/* Gives back the runtime at the start of the next period */
+	struct hrtimer		dl_timer;
+	/* On dl_rq->throttled_list while throttled and queued */
+	struct list_head	throttled_node;
+};
+
 struct rcu_node;
 
 enum perf_event_task_context {
@@ -1227,6 +1286,10 @@ struct task_struct {
 #ifdef CONFIG_SMP
 	struct task_struct *wake_entry;
 	int on_cpu;
+	/* the task woken last, and how often that changed, see wake_wide() */
+	struct task_struct *last_wakee;
+	unsigned int wakee_flips;
+	unsigned long wakee_flip_decay_ts;
 #endif
 	int on_rq;
 
@@ -1235,6 +1298,7 @@ struct task_struct {
 	const struct sched_class *sched_class;
 	struct sched_entity se;
 	struct sched_rt_entity rt;
+	struct sched_dl_entity dl;
 #ifdef CONFIG_CGROUP_SCHED
 	struct task_group *sched_task_group;
 #endif
@@ -1609,6 +1673,25 @@ static inline int rt_task(struct task_struct *p)
 	return rt_prio(p->prio);
 }
 
+/*
+ * SCHED_DEADLINE tasks all have priority MAX_DL_PRIO-1, ahead of every
+ * rt priority, which is what priority inheritance and rt_task() see.
+ * Among themselves they are ordered by deadline.
+ */
+#define MAX_DL_PRIO		0
+
+static inline int dl_prio(int prio)
+{
+	if (unlikely(prio < MAX_DL_PRIO))
+		return 1;
+	return 0;
+}
+
+static inline int dl_task(struct task_struct *p)
+{
+	return dl_prio(p->prio);
+}
+
 static inline struct pid *task_pid(struct task_struct *task)
 {
 	return task->pids[PIDTYPE_PID].pid;
@@ -2008,6 +2091,10 @@ int sched_rt_handler(struct ctl_table *table, int write,
 		void __user *buffer, size_t *lenp,
 		loff_t *ppos);
 
+#ifdef CONFIG_CFS_BANDWIDTH
+extern unsigned int sysctl_sched_cfs_bandwidth_slice;
+#endif
+
 #ifdef CONFIG_SCHED_AUTOGROUP
 extern unsigned int sysctl_sched_autogroup_enabled;
 
@@ -2043,6 +2130,21 @@ extern void set_user_nice(struct task_struct *p, long nice);
 extern int task_prio(const struct task_struct *p);
 extern int task_nice(const struct task_struct *p);
 extern int can_nice(const struct task_struct *p, const int nice);
+
+/*
+ * Latency nice values go from -20, for tasks that want to run as soon as
+ * they wake up, to 19, for tasks that do not mind waiting.  They leave
+ * the share of cpu time of the task alone.
+ */
+#define MIN_LATENCY_NICE	-20
+#define MAX_LATENCY_NICE	19
+#define LATENCY_NICE_WIDTH	(MAX_LATENCY_NICE - MIN_LATENCY_NICE + 1)
+
+extern int sched_set_latency_nice(pid_t pid, int latency_nice);
+extern int sched_get_latency_nice(pid_t pid, int *latency_nice);
+struct sched_dl_param;
+extern int sched_set_deadline(pid_t pid, const struct sched_dl_param *param);
+extern int sched_get_deadline(pid_t pid, struct sched_dl_param *param);
 extern int task_curr(const struct task_struct *p);
 extern int idle_cpu(int cpu);
 extern int sched_setscheduler(struct task_struct *, int,
@@ -2618,6 +2720,8 @@ extern void sched_move_task(struct task_struct *tsk);
 #ifdef CONFIG_FAIR_GROUP_SCHED
 extern int sched_group_set_shares(struct task_group *tg, unsigned long shares);
 extern unsigned long sched_group_shares(struct task_group *tg);
+extern int sched_group_set_latency_nice(struct task_group *tg,
+					int latency_nice);
 #endif
 #ifdef CONFIG_RT_GROUP_SCHED
 extern int sched_group_set_rt_runtime(struct task_group *tg,
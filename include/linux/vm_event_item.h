@@ -39,6 +39,7 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 #ifdef CONFIG_COMPACTION
 		COMPACTBLOCKS, COMPACTPAGES, COMPACTPAGEFAILED,
 		COMPACTSTALL, COMPACTFAIL, COMPACTSUCCESS,
+		KCOMPACTD_WAKE, COMPACTSTALL_AVOIDED,
 #endif
 #ifdef CONFIG_HUGETLB_PAGE
 		HTLB_BUDDY_PGALLOC, HTLB_BUDDY_PGALLOC_FAIL,
@@ -51,12 +52,27 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		UNEVICTABLE_PGCLEARED,	/* on COW, page truncate */
 		UNEVICTABLE_PGSTRANDED,	/* unable to isolate on unlock */
 		UNEVICTABLE_MLOCKFREED,
+		RA_PAGES,	/* file pages read ahead */
+		RA_HIT,		/* read ahead file pages accessed */
+		RA_UNUSED,	/* read ahead file pages evicted unused */
+#ifdef CONFIG_SWAP
+		SWAP_RA,	/* swap pages read ahead */
+		SWAP_RA_HIT,	/* read ahead swap pages used */
+#endif
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 		THP_FAULT_ALLOC,
 		THP_FAULT_FALLBACK,
 		THP_COLLAPSE_ALLOC,
 		THP_COLLAPSE_ALLOC_FAILED,
 		THP_SPLIT,
+#endif
+#ifdef CONFIG_CONT_PTE
+		CONT_PTE_FAULT_ALLOC,
+		CONT_PTE_FAULT_FALLBACK,
+		CONT_PTE_COLLAPSE_ALLOC,
+		CONT_PTE_COLLAPSE_ALLOC_FAILED,
+		CONT_PTE_PROMOTE,
+		CONT_PTE_SPLIT,
 #endif
 		NR_VM_EVENT_ITEMS
 };
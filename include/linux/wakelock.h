@@ -17,6 +17,7 @@
 #define _LINUX_WAKELOCK_H
 
 #include <linux/list.h>
+#include <linux/rbtree.h>
 #include <linux/ktime.h>
 
 /* A wake_lock prevents the system from entering suspend or other low power
@@ -32,9 +33,16 @@ enum {
 	WAKE_LOCK_TYPE_COUNT
 };
 
+/* Hold times are binned in powers of two milliseconds: bucket 0 counts
+ * holds shorter than 1ms, bucket n holds of [2^(n-1), 2^n) ms and the last
+ * bucket everything longer.
+ */
+#define WAKE_LOCK_HIST_BUCKETS	16
+
 struct wake_lock {
 #ifdef CONFIG_HAS_WAKELOCK
 	struct list_head    link;
+	struct rb_node      expire_node;
 	int                 flags;
 	const char         *name;
 	unsigned long       expires;
@@ -47,6 +55,7 @@ struct wake_lock {
 		ktime_t         prevent_suspend_time;
 		ktime_t         max_time;
 		ktime_t         last_time;
+		unsigned int    hold_hist[WAKE_LOCK_HIST_BUCKETS];
 	} stat;
 #endif
 #endif
@@ -83,6 +83,9 @@ struct work_struct {
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map lockdep_map;
 #endif
+#ifdef CONFIG_WORKQUEUE_STATS
+	u64 queued_at;		/* local_clock() when queued */
+#endif
 };
 
 #define WORK_DATA_INIT()	ATOMIC_LONG_INIT(WORK_STRUCT_NO_CPU)
@@ -172,6 +175,12 @@ static inline unsigned int work_static(struct work_struct *work) { return 0; }
  * assignment of the work data initializer allows the compiler
  * to generate better code.
  */
+#ifdef CONFIG_WORKQUEUE_STATS
+#define __INIT_WORK_STATS(_work)	((_work)->queued_at = 0)
+#else
+#define __INIT_WORK_STATS(_work)	do { } while (0)
+#endif
+
 #ifdef CONFIG_LOCKDEP
 #define __INIT_WORK(_work, _func, _onstack)				\
 	do {								\
@@ -181,6 +190,7 @@ static inline unsigned int work_static(struct work_struct *work) { return 0; }
 		(_work)->data = (atomic_long_t) WORK_DATA_INIT();	\
 		lockdep_init_map(&(_work)->lockdep_map, #_work, &__key, 0);\
 		INIT_LIST_HEAD(&(_work)->entry);			\
+		__INIT_WORK_STATS(_work);				\
 		PREPARE_WORK((_work), (_func));				\
 	} while (0)
 #else
@@ -189,6 +199,7 @@ static inline unsigned int work_static(struct work_struct *work) { return 0; }
 		__init_work((_work), _onstack);				\
 		(_work)->data = (atomic_long_t) WORK_DATA_INIT();	\
 		INIT_LIST_HEAD(&(_work)->entry);			\
+		__INIT_WORK_STATS(_work);				\
 		PREPARE_WORK((_work), (_func));				\
 	} while (0)
 #endif
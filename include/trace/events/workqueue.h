@@ -115,6 +115,109 @@ DEFINE_EVENT(workqueue_work, workqueue_execute_end,
 	TP_ARGS(work)
 );
 
+DECLARE_EVENT_CLASS(workqueue_worker,
+
+	TP_PROTO(unsigned int cpu, int id, int nr_workers),
+
+	TP_ARGS(cpu, id, nr_workers),
+
+	TP_STRUCT__entry(
+		__field( unsigned int,	cpu		)
+		__field( int,		id		)
+		__field( int,		nr_workers	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu		= cpu;
+		__entry->id		= id;
+		__entry->nr_workers	= nr_workers;
+	),
+
+	TP_printk("cpu=%u id=%d nr_workers=%d",
+		  __entry->cpu, __entry->id, __entry->nr_workers)
+);
+
+/**
+ * workqueue_worker_create - called when a worker joins its gcwq
+ * @cpu:	the cpu of the gcwq, WORK_CPU_UNBOUND for the unbound one
+ * @id:		the worker id, N in kworker/cpu:N
+ * @nr_workers:	number of workers of the gcwq, this one included
+ *
+ * Bursts of this event show the worker pool growing because the
+ * running work items sleep.
+ */
+DEFINE_EVENT(workqueue_worker, workqueue_worker_create,
+
+	TP_PROTO(unsigned int cpu, int id, int nr_workers),
+
+	TP_ARGS(cpu, id, nr_workers)
+);
+
+/**
+ * workqueue_worker_destroy - called when an idle worker is destroyed
+ * @cpu:	the cpu of the gcwq, WORK_CPU_UNBOUND for the unbound one
+ * @id:		the worker id
+ * @nr_workers:	number of workers of the gcwq left
+ */
+DEFINE_EVENT(workqueue_worker, workqueue_worker_destroy,
+
+	TP_PROTO(unsigned int cpu, int id, int nr_workers),
+
+	TP_ARGS(cpu, id, nr_workers)
+);
+
+DECLARE_EVENT_CLASS(workqueue_rescue,
+
+	TP_PROTO(struct cpu_workqueue_struct *cwq, struct work_struct *work),
+
+	TP_ARGS(cwq, work),
+
+	TP_STRUCT__entry(
+		__field( void *,	work	)
+		__field( void *,	function)
+		__string( workqueue,	cwq->wq->name	)
+		__field( unsigned int,	cpu	)
+	),
+
+	TP_fast_assign(
+		__entry->work		= work;
+		__entry->function	= work->func;
+		__assign_str(workqueue, cwq->wq->name);
+		__entry->cpu		= cwq->gcwq->cpu;
+	),
+
+	TP_printk("work struct=%p function=%pf workqueue=%s cpu=%u",
+		  __entry->work, __entry->function, __get_str(workqueue),
+		  __entry->cpu)
+);
+
+/**
+ * workqueue_mayday - called when a gcwq calls a rescuer for a work
+ * @cwq:	pointer to struct cpu_workqueue_struct of the work
+ * @work:	pointer to struct work_struct
+ *
+ * This event occurs when no new worker could be created in time for
+ * pending works, and the rescuer of their workqueue is woken up.
+ */
+DEFINE_EVENT(workqueue_rescue, workqueue_mayday,
+
+	TP_PROTO(struct cpu_workqueue_struct *cwq, struct work_struct *work),
+
+	TP_ARGS(cwq, work)
+);
+
+/**
+ * workqueue_rescue_work - called when a rescuer takes over a work
+ * @cwq:	pointer to struct cpu_workqueue_struct of the work
+ * @work:	pointer to struct work_struct
+ */
+DEFINE_EVENT(workqueue_rescue, workqueue_rescue_work,
+
+	TP_PROTO(struct cpu_workqueue_struct *cwq, struct work_struct *work),
+
+	TP_ARGS(cwq, work)
+);
+
 #endif /*  _TRACE_WORKQUEUE_H */
 
 /* This part must be outside protection */
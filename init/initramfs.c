@@ -8,6 +8,10 @@
 #include <linux/dirent.h>
 #include <linux/syscalls.h>
 #include <linux/utime.h>
+#include <linux/async.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/wait.h>
 
 static __initdata char *message;
 static void __init error(char *x)
@@ -384,13 +388,21 @@ static int __init write_buffer(char *buf, unsigned len)
 	return len - count;
 }
 
+/* Output of the current segment, and the time spent extracting it */
+static __initdata unsigned long out_len;
+static __initdata ktime_t extract_time;
+
 static int __init flush_buffer(void *bufv, unsigned len)
 {
 	char *buf = (char *) bufv;
 	int written;
 	int origLen = len;
+	ktime_t start;
+
 	if (message)
 		return -1;
+	out_len += len;
+	start = ktime_get();
 	while ((written = write_buffer(buf, len)) < len && !message) {
 		char c = buf[written];
 		if (c == '0') {
@@ -404,6 +416,7 @@ static int __init flush_buffer(void *bufv, unsigned len)
 		} else
 			error("junk in compressed archive");
 	}
+	extract_time = ktime_add(extract_time, ktime_sub(ktime_get(), start));
 	return origLen;
 }
 
@@ -411,9 +424,396 @@ static unsigned my_inptr;   /* index of next byte to be processed in inbuf */
 
 #include <linux/decompress/generic.h>
 
-static char * __init unpack_to_rootfs(char *buf, unsigned len)
+/*
+ * Parallel decompression.
+ *
+ * The extraction of the cpio archives is one state machine writing
+ * through the syscalls, and runs in one thread.  The decompression
+ * feeding it does not have to: each image, the built-in one and the
+ * initrd, gets an "initramfs/N" thread that walks its segments ahead of
+ * the extraction, decompresses them and queues the output in pages.
+ * The extraction takes the output of a segment as it comes, and the
+ * segments in order, so that later files still replace earlier ones.
+ *
+ * Where a segment ends is only known once it has been decompressed, so
+ * the segments of one image are decompressed one after the other; it is
+ * the extraction, and the other image, that go on at the same time.
+ * The thread of an image only guesses where its segments start, the
+ * extraction decides: when they disagree, on a broken image, the
+ * extraction stops the thread and decompresses by itself.
+ */
+struct unpack_chunk {
+	struct unpack_chunk *next;
+	unsigned len;
+	char data[];
+};
+
+#define UNPACK_CHUNK_SIZE	(PAGE_SIZE - sizeof(struct unpack_chunk))
+/* How much decompressed output an image may have queued */
+#define UNPACK_MAX_QUEUED	(8 << 20)
+
+struct unpack_seg {
+	struct unpack_seg *next;
+	char *src;			/* start of the segment in the image */
+	int len;			/* compressed size, once done */
+	const char *method;
+	struct unpack_chunk *chunks, **tail;	/* output not extracted yet */
+	s64 usecs;			/* decompression time */
+	char *error;
+	bool done;
+};
+
+struct unpack_stream {
+	char *buf;
+	unsigned len;
+	struct task_struct *task;
+	struct unpack_seg *segs, **tail;	/* not taken by the extraction */
+	struct unpack_seg *cur;			/* being decompressed */
+	struct unpack_chunk *fill;		/* being filled */
+	unsigned long queued;			/* bytes in queued chunks */
+	bool done;				/* no more segments */
+	bool stop;				/* extraction gave up on it */
+	bool stopped;
+	struct completion exited;
+};
+
+static DEFINE_SPINLOCK(unpack_lock);
+static DECLARE_WAIT_QUEUE_HEAD(unpack_wait);
+static __initdata struct unpack_stream *unpack_streams[2];
+
+/* The stream the calling decompression thread works on */
+static struct unpack_stream * __init current_stream(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(unpack_streams); i++)
+		if (unpack_streams[i] && unpack_streams[i]->task == current)
+			return unpack_streams[i];
+	BUG();
+}
+
+static void __init queue_chunk(struct unpack_stream *s)
+{
+	struct unpack_seg *seg = s->cur;
+
+	spin_lock(&unpack_lock);
+	*seg->tail = s->fill;
+	seg->tail = &s->fill->next;
+	s->queued += s->fill->len;
+	spin_unlock(&unpack_lock);
+	s->fill = NULL;
+	wake_up_all(&unpack_wait);
+}
+
+static void __init queue_error(char *x)
+{
+	struct unpack_stream *s = current_stream();
+
+	if (!s->cur->error)
+		s->cur->error = x;
+}
+
+/* flush callback of the decompressors run by the decompression threads */
+static int __init queue_output(void *bufv, unsigned len)
+{
+	struct unpack_stream *s = current_stream();
+	char *buf = bufv;
+	unsigned n, left = len;
+
+	while (left) {
+		if (!s->fill) {
+			s->fill = kmalloc(PAGE_SIZE, GFP_KERNEL);
+			if (!s->fill) {
+				queue_error("can't allocate unpack buffer");
+				return -1;
+			}
+			s->fill->next = NULL;
+			s->fill->len = 0;
+		}
+		n = min_t(unsigned, left, UNPACK_CHUNK_SIZE - s->fill->len);
+		memcpy(s->fill->data + s->fill->len, buf, n);
+		s->fill->len += n;
+		buf += n;
+		left -= n;
+		if (s->fill->len == UNPACK_CHUNK_SIZE)
+			queue_chunk(s);
+	}
+	wait_event(unpack_wait, s->queued < UNPACK_MAX_QUEUED || s->stop);
+	return s->stop ? -1 : len;
+}
+
+/* Length of the uncompressed cpio archive at @buf, through its trailer */
+static unsigned __init cpio_len(char *buf, unsigned len)
 {
-	int written, res;
+	unsigned long pos = 0, next, namesize, filesize;
+	char field[9];
+
+	field[8] = '\0';
+	while (pos + 110 <= len) {
+		if (memcmp(buf + pos, "070701", 6))
+			return 0;
+		memcpy(field, buf + pos + 54, 8);
+		filesize = simple_strtoul(field, NULL, 16);
+		memcpy(field, buf + pos + 94, 8);
+		namesize = simple_strtoul(field, NULL, 16);
+		if (namesize > PATH_MAX || filesize > len)
+			return 0;
+		next = pos + 110 + N_ALIGN(namesize) + filesize;
+		next = (next + 3) & ~3;
+		if (next > len)
+			return 0;
+		if (namesize == sizeof("TRAILER!!!") &&
+		    !memcmp(buf + pos + 110, "TRAILER!!!", namesize))
+			return next;
+		pos = next;
+	}
+	return 0;
+}
+
+static int __init unpack_thread(void *data)
+{
+	struct unpack_stream *s = data;
+	char *buf = s->buf;
+	unsigned len = s->len;
+	unsigned long offset = 0;
+	decompress_fn decompress;
+	struct unpack_seg *seg;
+	ktime_t start;
+	int inptr, n;
+
+	s->task = current;
+	while (len && !s->stop) {
+		/* Step over what the extraction does without us */
+		if (*buf == '0' && !(offset & 3)) {
+			n = cpio_len(buf, len);
+			if (!n)
+				break;
+			buf += n;
+			len -= n;
+			offset += n;
+			continue;
+		}
+		if (!*buf) {
+			buf++;
+			len--;
+			offset++;
+			continue;
+		}
+		seg = kzalloc(sizeof(*seg), GFP_KERNEL);
+		if (!seg)
+			break;
+		decompress = decompress_method(buf, len, &seg->method);
+		if (!decompress) {
+			kfree(seg);
+			break;
+		}
+		seg->src = buf;
+		seg->tail = &seg->chunks;
+		s->cur = seg;
+		spin_lock(&unpack_lock);
+		*s->tail = seg;
+		s->tail = &seg->next;
+		spin_unlock(&unpack_lock);
+		wake_up_all(&unpack_wait);
+
+		inptr = 0;
+		start = ktime_get();
+		if (decompress(buf, len, NULL, queue_output, NULL, &inptr,
+			       queue_error) && !seg->error)
+			seg->error = "decompressor failed";
+		if (s->fill)
+			queue_chunk(s);
+		seg->usecs = ktime_us_delta(ktime_get(), start);
+		seg->len = inptr;
+
+		spin_lock(&unpack_lock);
+		seg->done = true;
+		spin_unlock(&unpack_lock);
+		wake_up_all(&unpack_wait);
+
+		if (seg->error || inptr <= 0 || inptr > len)
+			break;
+		buf += inptr;
+		len -= inptr;
+		offset += inptr;
+	}
+	spin_lock(&unpack_lock);
+	s->done = true;
+	spin_unlock(&unpack_lock);
+	wake_up_all(&unpack_wait);
+	complete_and_exit(&s->exited, 0);
+}
+
+/*
+ * Start decompressing the image at @buf ahead of its extraction.
+ * Returns NULL, to have it decompressed by the extraction, when there
+ * is no other cpu to do it or the thread cannot be started.
+ */
+static struct unpack_stream * __init unpack_stream_start(int nr, char *buf,
+							  unsigned len)
+{
+	struct unpack_stream *s;
+	struct task_struct *task;
+
+	if (num_online_cpus() < 2 || !len)
+		return NULL;
+	s = kzalloc(sizeof(*s), GFP_KERNEL);
+	if (!s)
+		return NULL;
+	s->buf = buf;
+	s->len = len;
+	s->tail = &s->segs;
+	init_completion(&s->exited);
+	unpack_streams[nr] = s;
+	task = kthread_run(unpack_thread, s, "initramfs/%d", nr);
+	if (IS_ERR(task)) {
+		unpack_streams[nr] = NULL;
+		kfree(s);
+		return NULL;
+	}
+	return s;
+}
+
+static void __init unpack_seg_free(struct unpack_seg *seg)
+{
+	struct unpack_chunk *chunk;
+
+	while ((chunk = seg->chunks)) {
+		seg->chunks = chunk->next;
+		kfree(chunk);
+	}
+	kfree(seg);
+}
+
+/* Have the decompression thread of @s exit, and drop what it queued */
+static void __init unpack_stream_stop(struct unpack_stream *s)
+{
+	struct unpack_seg *seg;
+
+	if (!s || s->stopped)
+		return;
+	spin_lock(&unpack_lock);
+	s->stop = true;
+	spin_unlock(&unpack_lock);
+	wake_up_all(&unpack_wait);
+	wait_for_completion(&s->exited);
+	kfree(s->fill);
+	s->fill = NULL;
+	while ((seg = s->segs)) {
+		s->segs = seg->next;
+		unpack_seg_free(seg);
+	}
+	s->stopped = true;
+}
+
+static void __init unpack_stream_free(int nr)
+{
+	struct unpack_stream *s = unpack_streams[nr];
+
+	if (!s)
+		return;
+	unpack_stream_stop(s);
+	unpack_streams[nr] = NULL;
+	kfree(s);
+}
+
+/*
+ * The segment of @s that starts at @buf, or NULL, after which the
+ * extraction does without @s, if its thread did not get there.
+ */
+static struct unpack_seg * __init unpack_next_seg(struct unpack_stream *s,
+						   char *buf)
+{
+	struct unpack_seg *seg;
+
+	if (!s || s->stop)
+		return NULL;
+	wait_event(unpack_wait, s->segs || s->done);
+	spin_lock(&unpack_lock);
+	seg = s->segs;
+	if (seg) {
+		s->segs = seg->next;
+		if (!s->segs)
+			s->tail = &s->segs;
+	}
+	spin_unlock(&unpack_lock);
+	if (seg && seg->src == buf)
+		return seg;
+	unpack_stream_stop(s);
+	if (seg)
+		unpack_seg_free(seg);
+	return NULL;
+}
+
+/* Extract the output of @seg as it is decompressed */
+static int __init unpack_seg_extract(struct unpack_stream *s,
+				     struct unpack_seg *seg)
+{
+	struct unpack_chunk *chunk;
+
+	for (;;) {
+		wait_event(unpack_wait, seg->chunks || seg->done);
+		spin_lock(&unpack_lock);
+		chunk = seg->chunks;
+		if (chunk) {
+			seg->chunks = chunk->next;
+			if (!seg->chunks)
+				seg->tail = &seg->chunks;
+			s->queued -= chunk->len;
+		}
+		spin_unlock(&unpack_lock);
+		if (!chunk)
+			break;
+		wake_up_all(&unpack_wait);
+		flush_buffer(chunk->data, chunk->len);
+		kfree(chunk);
+		if (message) {
+			/* @seg may still be being decompressed */
+			unpack_stream_stop(s);
+			return -1;
+		}
+	}
+	if (seg->error)
+		error(seg->error);
+	return seg->error ? -1 : 0;
+}
+
+/* Decompress and extract the segment at @buf, and set my_inptr past it */
+static void __init unpack_segment(decompress_fn decompress, const char *name,
+				  char *buf, unsigned len,
+				  struct unpack_stream *stream)
+{
+	struct unpack_seg *seg = unpack_next_seg(stream, buf);
+	ktime_t start;
+	s64 usecs;
+
+	out_len = 0;
+	extract_time = ktime_set(0, 0);
+	if (seg) {
+		unpack_seg_extract(stream, seg);
+		my_inptr = seg->len;
+		usecs = seg->usecs;
+		unpack_seg_free(seg);
+	} else {
+		start = ktime_get();
+		if (decompress(buf, len, NULL, flush_buffer, NULL, &my_inptr,
+			       error))
+			error("decompressor failed");
+		/* what the extraction did in flush_buffer() is not ours */
+		usecs = ktime_us_delta(ktime_get(), start) -
+			ktime_to_us(extract_time);
+	}
+	if (!message)
+		printk(KERN_INFO "initramfs: %s segment, %u -> %lu bytes, "
+		       "decompressed in %lld usecs, extracted in %lld usecs\n",
+		       name, my_inptr, out_len, usecs,
+		       ktime_to_us(extract_time));
+}
+
+static char * __init unpack_to_rootfs(char *buf, unsigned len,
+				      struct unpack_stream *stream)
+{
+	int written;
 	decompress_fn decompress;
 	const char *compress_name;
 	static __initdata char msg_buf[64];
@@ -446,10 +846,8 @@ static char * __init unpack_to_rootfs(char *buf, unsigned len)
 		this_header = 0;
 		decompress = decompress_method(buf, len, &compress_name);
 		if (decompress) {
-			res = decompress(buf, len, NULL, flush_buffer, NULL,
-				   &my_inptr, error);
-			if (res)
-				error("decompressor failed");
+			unpack_segment(decompress, compress_name, buf, len,
+				       stream);
 		} else if (compress_name) {
 			if (!message) {
 				snprintf(msg_buf, sizeof msg_buf,
@@ -569,23 +967,47 @@ static void __init clean_rootfs(void)
 }
 #endif
 
-static int __init populate_rootfs(void)
+static bool __initdata initramfs_async = true;
+
+static int __init initramfs_async_setup(char *str)
+{
+	strtobool(str, &initramfs_async);
+	return 1;
+}
+__setup("initramfs_async=", initramfs_async_setup);
+
+static LIST_HEAD(initramfs_domain);
+
+static void __init do_populate_rootfs(void *unused, async_cookie_t cookie)
 {
-	char *err = unpack_to_rootfs(__initramfs_start, __initramfs_size);
+	struct unpack_stream *builtin, *initrd = NULL;
+	ktime_t start = ktime_get();
+	char *err;
+
+	/* Both images are decompressed at once, and extracted in turn */
+	builtin = unpack_stream_start(0, __initramfs_start, __initramfs_size);
+	if (initrd_start)
+		initrd = unpack_stream_start(1, (char *)initrd_start,
+					     initrd_end - initrd_start);
+
+	err = unpack_to_rootfs(__initramfs_start, __initramfs_size, builtin);
 	if (err)
 		panic(err);	/* Failed to decompress INTERNAL initramfs */
+	unpack_stream_free(0);
 	if (initrd_start) {
 #ifdef CONFIG_BLK_DEV_RAM
 		int fd;
 		printk(KERN_INFO "Trying to unpack rootfs image as initramfs...\n");
 		err = unpack_to_rootfs((char *)initrd_start,
-			initrd_end - initrd_start);
+			initrd_end - initrd_start, initrd);
+		unpack_stream_free(1);
 		if (!err) {
 			free_initrd();
-			return 0;
+			goto done;
 		} else {
 			clean_rootfs();
-			unpack_to_rootfs(__initramfs_start, __initramfs_size);
+			unpack_to_rootfs(__initramfs_start, __initramfs_size,
+					 NULL);
 		}
 		printk(KERN_INFO "rootfs image is not initramfs (%s)"
 				"; looks like an initrd\n", err);
@@ -600,12 +1022,37 @@ static int __init populate_rootfs(void)
 #else
 		printk(KERN_INFO "Unpacking initramfs...\n");
 		err = unpack_to_rootfs((char *)initrd_start,
-			initrd_end - initrd_start);
+			initrd_end - initrd_start, initrd);
+		unpack_stream_free(1);
 		if (err)
 			printk(KERN_EMERG "Initramfs unpacking failed: %s\n", err);
 		free_initrd();
 #endif
 	}
+done:
+	printk(KERN_INFO "initramfs: unpacked in %lld usecs\n",
+	       ktime_us_delta(ktime_get(), start));
+}
+
+/**
+ * wait_for_initramfs - wait until the initramfs is unpacked
+ *
+ * Unless booted with initramfs_async=0, the rootfs is filled in the
+ * background while the initcalls go on.  Whatever looks for files in
+ * it before init runs has to wait for it first.
+ */
+void wait_for_initramfs(void)
+{
+	async_synchronize_full_domain(&initramfs_domain);
+}
+
+static int __init populate_rootfs(void)
+{
+	if (initramfs_async)
+		async_schedule_domain(do_populate_rootfs, NULL,
+				      &initramfs_domain);
+	else
+		do_populate_rootfs(NULL, 0);
 	return 0;
 }
 rootfs_initcall(populate_rootfs);
@@ -69,6 +69,8 @@
 #include <linux/slab.h>
 #include <linux/perf_event.h>
 #include <linux/random.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/io.h>
 #include <asm/bugs.h>
@@ -641,8 +643,6 @@ static void __init do_ctors(void)
 int initcall_debug;
 core_param(initcall_debug, initcall_debug, bool, 0644);
 
-static char msgbuf[64];
-
 static int __init_or_module do_one_initcall_debug(initcall_t fn)
 {
 	ktime_t calltime, delta, rettime;
@@ -664,6 +664,7 @@ static int __init_or_module do_one_initcall_debug(initcall_t fn)
 int __init_or_module do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
+	char msgbuf[64];
 	int ret;
 
 	if (initcall_debug)
@@ -693,13 +694,390 @@ int __init_or_module do_one_initcall(initcall_t fn)
 
 
 extern initcall_t __initcall_start[], __initcall_end[], __early_initcall_end[];
+extern initcall_t __initcall0_start[], __initcall0s_start[];
+extern initcall_t __initcall1_start[], __initcall1s_start[];
+extern initcall_t __initcall2_start[], __initcall2s_start[];
+extern initcall_t __initcall3_start[], __initcall3s_start[];
+extern initcall_t __initcall4_start[], __initcall4s_start[];
+extern initcall_t __initcall5_start[], __initcall5s_start[];
+extern initcall_t __initcallrootfs_start[];
+extern initcall_t __initcall6_start[], __initcall6s_start[];
+extern initcall_t __initcall7_start[], __initcall7s_start[];
+
+/* Where each level starts, and where the last one ends */
+static initcall_t *initcall_levels[] __initdata = {
+	__initcall0_start, __initcall0s_start,
+	__initcall1_start, __initcall1s_start,
+	__initcall2_start, __initcall2s_start,
+	__initcall3_start, __initcall3s_start,
+	__initcall4_start, __initcall4s_start,
+	__initcall5_start, __initcall5s_start,
+	__initcallrootfs_start,
+	__initcall6_start, __initcall6s_start,
+	__initcall7_start, __initcall7s_start,
+	__initcall_end,
+};
+
+static const char *initcall_level_names[] = {
+	"0", "0s", "1", "1s", "2", "2s", "3", "3s", "4", "4s", "5", "5s",
+	"rootfs", "6", "6s", "7", "7s",
+};
 
-static void __init do_initcalls(void)
+/*
+ * With initcall_debug, when every initcall of do_initcalls() ran, on
+ * which thread and what it returned, for debugfs initcall_timeline.
+ * Indexed by the position of the initcall in the table, so that threads
+ * running initcalls of the same level never share an entry.
+ */
+struct initcall_event {
+	initcall_t fn;
+	int level;
+	int thread;
+	int ret;
+	ktime_t start;
+	ktime_t end;
+};
+
+static struct initcall_event *initcall_events;
+static int nr_initcall_events;
+
+static void __init do_initcall_timed(initcall_t *call, int level, int thread)
+{
+	struct initcall_event *ev;
+
+	if (!initcall_events) {
+		do_one_initcall(*call);
+		return;
+	}
+	ev = &initcall_events[call - __early_initcall_end];
+	ev->level = level;
+	ev->thread = thread;
+	ev->start = ktime_get();
+	ev->ret = do_one_initcall(*call);
+	ev->end = ktime_get();
+	ev->fn = *call;
+}
+
+static int initcall_timeline_show(struct seq_file *m, void *v)
+{
+	struct initcall_event *ev;
+	struct timespec start, end;
+
+	seq_printf(m, "# level thread        start          end    ret"
+		   "  initcall\n");
+	for (ev = initcall_events; ev < initcall_events + nr_initcall_events;
+	     ev++) {
+		if (!ev->fn)
+			continue;
+		start = ktime_to_timespec(ev->start);
+		end = ktime_to_timespec(ev->end);
+		seq_printf(m, "%7s %6d %5ld.%06ld %5ld.%06ld %6d  %pf\n",
+			   initcall_level_names[ev->level], ev->thread,
+			   start.tv_sec, start.tv_nsec / NSEC_PER_USEC,
+			   end.tv_sec, end.tv_nsec / NSEC_PER_USEC,
+			   ev->ret, ev->fn);
+	}
+	return 0;
+}
+
+static int initcall_timeline_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, initcall_timeline_show, NULL);
+}
+
+static const struct file_operations initcall_timeline_fops = {
+	.open		= initcall_timeline_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+#ifdef CONFIG_PARALLEL_INITCALLS
+extern struct initcall_dep __initcall_deps_start[], __initcall_deps_end[];
+
+/*
+ * Threads running the initcalls of a parallel level, 0 for none.  No
+ * level is parallel unless named on the command line: link order inside
+ * a level is only safe to give up once its dependencies are annotated.
+ */
+static int initcall_threads __initdata;
+static char *initcall_parallel_levels __initdata;
+
+static int __init initcall_threads_setup(char *str)
+{
+	initcall_threads = simple_strtoul(str, NULL, 0);
+	return 1;
+}
+__setup("initcall_threads=", initcall_threads_setup);
+
+static int __init initcall_parallel_levels_setup(char *str)
+{
+	initcall_parallel_levels = str;
+	return 1;
+}
+__setup("initcall_parallel_levels=", initcall_parallel_levels_setup);
+
+static int __init initcall_level_parallel(int level)
+{
+	const char *name = initcall_level_names[level];
+	const char *s = initcall_parallel_levels;
+	size_t len = strlen(name);
+
+	if (initcall_threads < 2)
+		return 0;
+	while (s) {
+		if (!strncmp(s, name, len) && (s[len] == ',' || !s[len]))
+			return 1;
+		s = strchr(s, ',');
+		if (s)
+			s++;
+	}
+	return 0;
+}
+
+enum { INITCALL_WAITING, INITCALL_RUNNING, INITCALL_DONE };
+
+struct initcall_node {
+	int state;
+	int nr_waits;		/* initcalls to wait for */
+};
+
+/* One parallel level, shared by the threads that run it */
+struct initcall_run {
+	spinlock_t lock;
+	wait_queue_head_t wait;
+	int level;
+	initcall_t *start;
+	int nr;
+	struct initcall_node *node;
+	int *dep_node;		/* node of every initcall_dep, or -1 */
+	int first;		/* no initcall before it is waiting */
+	int pending;		/* not done */
+	int running;
+	struct completion exited;
+	int thread;		/* threads started so far */
+};
+
+static int __init initcall_index(struct initcall_run *run, initcall_t fn)
+{
+	int i;
+
+	for (i = 0; i < run->nr; i++)
+		if (run->start[i] == fn)
+			return i;
+	return -1;
+}
+
+/*
+ * Count the initcalls of the level at the other end of @dep: the
+ * providers of its name if it is a requirement, the requirers if it
+ * provides.  With @release, the provider @dep is done and the requirers
+ * wait for one initcall less.  Holds run->lock, unless still alone.
+ */
+static int __init initcall_dep_edges(struct initcall_run *run,
+				     struct initcall_dep *dep, int release)
+{
+	int self = run->dep_node[dep - __initcall_deps_start];
+	struct initcall_dep *other;
+	int n, count = 0;
+
+	for (other = __initcall_deps_start; other < __initcall_deps_end;
+	     other++) {
+		n = run->dep_node[other - __initcall_deps_start];
+		if (n < 0 || n == self || other->provides == dep->provides ||
+		    strcmp(other->name, dep->name))
+			continue;
+		if (release)
+			run->node[n].nr_waits--;
+		count++;
+	}
+	return count;
+}
+
+/* Returns the first initcall that can run, or -1.  Holds run->lock. */
+static int __init initcall_next(struct initcall_run *run)
+{
+	int i;
+
+	while (run->first < run->nr &&
+	       run->node[run->first].state != INITCALL_WAITING)
+		run->first++;
+	for (i = run->first; i < run->nr; i++)
+		if (run->node[i].state == INITCALL_WAITING &&
+		    !run->node[i].nr_waits)
+			return i;
+	return -1;
+}
+
+static int __init initcall_can_go(struct initcall_run *run)
+{
+	int ret;
+
+	spin_lock(&run->lock);
+	ret = !run->pending || !run->running || initcall_next(run) >= 0;
+	spin_unlock(&run->lock);
+	return ret;
+}
+
+static void __init initcall_run_thread(struct initcall_run *run, int thread)
+{
+	struct initcall_dep *dep;
+	int i;
+
+	spin_lock(&run->lock);
+	while (run->pending) {
+		i = initcall_next(run);
+		if (i < 0 && !run->running) {
+			/* Nothing runs, so nothing waiting can ever run */
+			i = run->first;
+			printk(KERN_WARNING "initcall %pF: dependency loop, "
+			       "running it anyway\n", run->start[i]);
+			run->node[i].nr_waits = 0;
+		}
+		if (i < 0) {
+			spin_unlock(&run->lock);
+			wait_event(run->wait, initcall_can_go(run));
+			spin_lock(&run->lock);
+			continue;
+		}
+
+		run->node[i].state = INITCALL_RUNNING;
+		run->running++;
+		spin_unlock(&run->lock);
+
+		do_initcall_timed(run->start + i, run->level, thread);
+
+		spin_lock(&run->lock);
+		run->node[i].state = INITCALL_DONE;
+		run->running--;
+		run->pending--;
+		for (dep = __initcall_deps_start; dep < __initcall_deps_end;
+		     dep++)
+			if (dep->provides &&
+			    run->dep_node[dep - __initcall_deps_start] == i)
+				initcall_dep_edges(run, dep, 1);
+		spin_unlock(&run->lock);
+		wake_up_all(&run->wait);
+		spin_lock(&run->lock);
+	}
+	spin_unlock(&run->lock);
+}
+
+static int __init initcall_thread(void *data)
+{
+	struct initcall_run *run = data;
+	int thread;
+
+	spin_lock(&run->lock);
+	thread = ++run->thread;
+	spin_unlock(&run->lock);
+
+	initcall_run_thread(run, thread);
+	complete(&run->exited);
+	return 0;
+}
+
+/*
+ * Run the initcalls of @level on initcall_threads threads, the calling
+ * one included.  An initcall starts as soon as a thread is free and the
+ * initcalls it requires are done, the first in link order first.
+ * Returns -ENOMEM if it could not, and then ran none of them.
+ */
+static int __init do_initcall_level_parallel(int level)
+{
+	int nr_deps = __initcall_deps_end - __initcall_deps_start;
+	struct initcall_run run;
+	struct initcall_dep *dep;
+	struct task_struct *t;
+	int i, started = 0;
+
+	run.level = level;
+	run.start = initcall_levels[level];
+	run.nr = initcall_levels[level + 1] - run.start;
+	if (run.nr < 2)
+		return -ENOMEM;
+	run.node = kcalloc(run.nr, sizeof(*run.node), GFP_KERNEL);
+	run.dep_node = kcalloc(nr_deps ?: 1, sizeof(int), GFP_KERNEL);
+	if (!run.node || !run.dep_node) {
+		kfree(run.node);
+		kfree(run.dep_node);
+		return -ENOMEM;
+	}
+
+	for (dep = __initcall_deps_start; dep < __initcall_deps_end; dep++)
+		run.dep_node[dep - __initcall_deps_start] =
+			initcall_index(&run, dep->fn);
+	for (dep = __initcall_deps_start; dep < __initcall_deps_end; dep++) {
+		i = run.dep_node[dep - __initcall_deps_start];
+		if (!dep->provides && i >= 0)
+			run.node[i].nr_waits += initcall_dep_edges(&run, dep, 0);
+	}
+
+	spin_lock_init(&run.lock);
+	init_waitqueue_head(&run.wait);
+	init_completion(&run.exited);
+	run.first = 0;
+	run.pending = run.nr;
+	run.running = 0;
+	run.thread = 0;
+
+	for (i = 1; i < initcall_threads && i < run.nr; i++) {
+		t = kthread_run(initcall_thread, &run, "initcall/%d", i);
+		if (IS_ERR(t))
+			break;
+		started++;
+	}
+	initcall_run_thread(&run, 0);
+	while (started--)
+		wait_for_completion(&run.exited);
+
+	kfree(run.node);
+	kfree(run.dep_node);
+	return 0;
+}
+#else
+static inline int initcall_level_parallel(int level)
+{
+	return 0;
+}
+
+static inline int do_initcall_level_parallel(int level)
+{
+	return -ENOMEM;
+}
+#endif
+
+static void __init do_initcall_level(int level)
 {
 	initcall_t *fn;
 
-	for (fn = __early_initcall_end; fn < __initcall_end; fn++)
-		do_one_initcall(*fn);
+	if (initcall_level_parallel(level) &&
+	    !do_initcall_level_parallel(level))
+		return;
+	for (fn = initcall_levels[level]; fn < initcall_levels[level + 1]; fn++)
+		do_initcall_timed(fn, level, 0);
+}
+
+static void __init do_initcalls(void)
+{
+	ktime_t start = ktime_get();
+	int level;
+
+	if (initcall_debug) {
+		nr_initcall_events = __initcall_end - __early_initcall_end;
+		initcall_events = kcalloc(nr_initcall_events,
+					  sizeof(*initcall_events), GFP_KERNEL);
+	}
+
+	for (level = 0; level < ARRAY_SIZE(initcall_levels) - 1; level++)
+		do_initcall_level(level);
+
+	if (initcall_debug)
+		printk(KERN_INFO "initcalls done in %lld usecs\n",
+		       ktime_to_us(ktime_sub(ktime_get(), start)));
+	if (initcall_events)
+		debugfs_create_file("initcall_timeline", S_IRUGO, NULL, NULL,
+				    &initcall_timeline_fops);
 }
 
 /*
@@ -807,6 +1185,9 @@ static int __init kernel_init(void * unused)
 
 	do_basic_setup();
 
+	/* The rootfs may still be being unpacked in the background */
+	wait_for_initramfs();
+
 	/* Open the /dev/console on the rootfs, this should never fail */
 	if (sys_open((const char __user *) "/dev/console", O_RDWR, 0) < 0)
 		printk(KERN_WARNING "Warning: unable to open an initial console.\n");
@@ -157,6 +157,7 @@ handle_irq_event_percpu(struct irq_desc *desc, struct irqaction *action)
 	} while (action);
 
 	add_interrupt_randomness(irq, flags);
+	irq_timings_record(desc);
 
 	if (!noirqdebug)
 		note_interrupt(irq, desc, retval);
@@ -169,3 +169,16 @@ static inline bool irqd_has_set(struct irq_data *d, unsigned int mask)
 {
 	return d->state_use_accessors & mask;
 }
+
+#ifdef CONFIG_IRQ_TIMINGS
+extern int irq_timings_enabled;
+extern void __irq_timings_record(struct irq_desc *desc);
+
+static inline void irq_timings_record(struct irq_desc *desc)
+{
+	if (irq_timings_enabled)
+		__irq_timings_record(desc);
+}
+#else
+static inline void irq_timings_record(struct irq_desc *desc) { }
+#endif
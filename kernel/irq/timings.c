@@ -0,0 +1,192 @@
+/*
+ * linux/kernel/irq/timings.c
+ *
+ * Per-cpu interrupt arrival statistics.
+ *
+ * Each cpu keeps a small table of the interrupts it recently handled,
+ * with a running average and variance of the interval between two
+ * consecutive arrivals of the same interrupt line.  Interrupts that
+ * arrive at a regular pace (audio periods, display vsync, touch
+ * sampling) can then be predicted, which is what idle governors need
+ * for the wakeup sources that the timer code does not know about.
+ *
+ * The recording side runs in hard irq context on the cpu taking the
+ * interrupt and only ever touches that cpu's table, so no locking is
+ * needed.  It is a no-op unless a user called irq_timings_enable().
+ */
+
+#include <linux/irq.h>
+#include <linux/module.h>
+#include <linux/interrupt.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
+
+#include "internals.h"
+
+/* Number of interrupt lines tracked per cpu */
+#define IRQT_SLOTS		16
+/* Intervals above this are not considered periodic (1s) */
+#define IRQT_MAX_INTERVAL	NSEC_PER_SEC
+/* Minimal number of samples before a prediction is made */
+#define IRQT_MIN_SAMPLES	4
+/* Running averages decay with a weight of 1/(1 << IRQT_DECAY_SHIFT) */
+#define IRQT_DECAY_SHIFT	3
+
+struct irqt_slot {
+	unsigned int	irq;
+	unsigned int	samples;
+	u64		last_ts;	/* ns, local_clock() */
+	u64		avg;		/* ns */
+	u64		variance;	/* ns^2, decayed */
+};
+
+struct irqt_cpu {
+	struct irqt_slot	slots[IRQT_SLOTS];
+	unsigned int		next_victim;
+};
+
+static DEFINE_PER_CPU(struct irqt_cpu, irqt_cpu);
+
+static atomic_t irq_timings_users = ATOMIC_INIT(0);
+int irq_timings_enabled __read_mostly;
+
+/**
+ * irq_timings_enable - start recording interrupt arrival statistics
+ *
+ * Calls nest; recording stops once every user called
+ * irq_timings_disable().
+ */
+void irq_timings_enable(void)
+{
+	if (atomic_inc_return(&irq_timings_users) == 1)
+		irq_timings_enabled = 1;
+}
+EXPORT_SYMBOL_GPL(irq_timings_enable);
+
+/**
+ * irq_timings_disable - drop a reference taken by irq_timings_enable()
+ */
+void irq_timings_disable(void)
+{
+	if (atomic_dec_and_test(&irq_timings_users))
+		irq_timings_enabled = 0;
+}
+EXPORT_SYMBOL_GPL(irq_timings_disable);
+
+static struct irqt_slot *irqt_find_slot(struct irqt_cpu *tc, unsigned int irq)
+{
+	struct irqt_slot *slot;
+	int i;
+
+	for (i = 0; i < IRQT_SLOTS; i++) {
+		slot = &tc->slots[i];
+		if (slot->samples && slot->irq == irq)
+			return slot;
+	}
+
+	/* Not tracked yet: recycle slots round robin */
+	slot = &tc->slots[tc->next_victim];
+	tc->next_victim = (tc->next_victim + 1) % IRQT_SLOTS;
+	memset(slot, 0, sizeof(*slot));
+	slot->irq = irq;
+	return slot;
+}
+
+void __irq_timings_record(struct irq_desc *desc)
+{
+	struct irqt_cpu *tc = &__get_cpu_var(irqt_cpu);
+	struct irqt_slot *slot;
+	u64 now = local_clock();
+	s64 interval, diff;
+
+	slot = irqt_find_slot(tc, desc->irq_data.irq);
+
+	if (!slot->samples) {
+		slot->samples = 1;
+		slot->last_ts = now;
+		return;
+	}
+
+	interval = now - slot->last_ts;
+	slot->last_ts = now;
+
+	/* A long gap breaks the pattern, start learning again */
+	if (interval <= 0 || interval > IRQT_MAX_INTERVAL) {
+		slot->samples = 1;
+		slot->avg = 0;
+		slot->variance = 0;
+		return;
+	}
+
+	if (slot->samples == 1) {
+		slot->avg = interval;
+		slot->variance = 0;
+	} else {
+		diff = interval - (s64)slot->avg;
+		slot->avg += diff >> IRQT_DECAY_SHIFT;
+		slot->variance -= slot->variance >> IRQT_DECAY_SHIFT;
+		slot->variance += ((u64)(diff * diff)) >> IRQT_DECAY_SHIFT;
+	}
+
+	if (slot->samples < UINT_MAX)
+		slot->samples++;
+}
+
+/*
+ * An interval is considered regular when its standard deviation is
+ * below a quarter of its mean, i.e. variance * 16 < avg^2.  Both sides
+ * are bounded by IRQT_MAX_INTERVAL^2 so this cannot overflow.
+ */
+static bool irqt_slot_regular(struct irqt_slot *slot)
+{
+	if (slot->samples < IRQT_MIN_SAMPLES || !slot->avg)
+		return false;
+
+	return slot->variance * 16 < slot->avg * slot->avg;
+}
+
+/**
+ * irq_timings_next_event - predict the next interrupt on this cpu
+ * @now: current time as returned by local_clock()
+ *
+ * Returns the absolute local_clock() time of the earliest predicted
+ * interrupt arrival on the calling cpu, or ~0ULL if no interrupt
+ * shows a regular enough pattern.  Must be called with
+ * interrupts disabled.
+ */
+u64 irq_timings_next_event(u64 now)
+{
+	struct irqt_cpu *tc = &__get_cpu_var(irqt_cpu);
+	u64 next = ~0ULL;
+	u64 expect;
+	int i;
+
+	if (!irq_timings_enabled)
+		return next;
+
+	for (i = 0; i < IRQT_SLOTS; i++) {
+		struct irqt_slot *slot = &tc->slots[i];
+
+		if (!irqt_slot_regular(slot))
+			continue;
+
+		expect = slot->last_ts + slot->avg;
+		/*
+		 * If the expected arrival is already in the past the
+		 * interrupt was missed or the pattern changed; try the
+		 * next period rather than predicting an immediate wakeup.
+		 */
+		if (expect <= now) {
+			if (now - slot->last_ts > 2 * slot->avg)
+				continue;
+			expect += slot->avg;
+		}
+
+		if (expect < next)
+			next = expect;
+	}
+
+	return next;
+}
+EXPORT_SYMBOL_GPL(irq_timings_next_event);
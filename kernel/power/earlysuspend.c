@@ -13,10 +13,13 @@
  *
  */
 
+#include <linux/async.h>
+#include <linux/debugfs.h>
 #include <linux/earlysuspend.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/rtc.h>
+#include <linux/seq_file.h>
 #include <linux/syscalls.h> /* sys_sync */
 #include <linux/wakelock.h>
 #include <linux/workqueue.h>
@@ -30,9 +33,12 @@ enum {
 };
 static int debug_mask = DEBUG_USER_STATE;
 module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
+static int async_handlers = 1;
+module_param_named(async, async_handlers, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
 static DEFINE_MUTEX(early_suspend_lock);
 static LIST_HEAD(early_suspend_handlers);
+static LIST_HEAD(early_suspend_async_domain);
 static void early_suspend(struct work_struct *work);
 static void late_resume(struct work_struct *work);
 static DECLARE_WORK(early_suspend_work, early_suspend);
@@ -45,10 +51,16 @@ enum {
 };
 static int state;
 
-void register_early_suspend(struct early_suspend *handler)
+/* Set in handler->flags once run_handlers() has started the handler */
+#define EARLY_SUSPEND_STARTED	(1U << 31)
+
+static void __register_early_suspend(struct early_suspend *handler)
 {
 	struct list_head *pos;
 
+	init_completion(&handler->done);
+	memset(&handler->stat, 0, sizeof(handler->stat));
+
 	mutex_lock(&early_suspend_lock);
 	list_for_each(pos, &early_suspend_handlers) {
 		struct early_suspend *e;
@@ -61,20 +73,213 @@ void register_early_suspend(struct early_suspend *handler)
 		handler->suspend(handler);
 	mutex_unlock(&early_suspend_lock);
 }
+
+void register_early_suspend(struct early_suspend *handler)
+{
+	handler->flags = 0;
+	handler->depends_on = NULL;
+	__register_early_suspend(handler);
+}
 EXPORT_SYMBOL(register_early_suspend);
 
+void register_early_suspend_async(struct early_suspend *handler,
+				  struct early_suspend *depends_on)
+{
+	struct early_suspend *dep;
+
+	/* A dependency at a lower level would suspend first, not last */
+	WARN_ON(depends_on && depends_on->level < handler->level);
+	for (dep = depends_on; dep; dep = dep->depends_on)
+		if (WARN_ON(dep == handler)) {
+			depends_on = NULL;
+			break;
+		}
+
+	handler->flags = EARLY_SUSPEND_ASYNC;
+	handler->depends_on = depends_on;
+	__register_early_suspend(handler);
+}
+EXPORT_SYMBOL(register_early_suspend_async);
+
 void unregister_early_suspend(struct early_suspend *handler)
 {
+	struct early_suspend *pos;
+
 	mutex_lock(&early_suspend_lock);
 	list_del(&handler->link);
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		if (pos->depends_on == handler)
+			pos->depends_on = NULL;
 	mutex_unlock(&early_suspend_lock);
 }
 EXPORT_SYMBOL(unregister_early_suspend);
 
-static void early_suspend(struct work_struct *work)
+static struct early_suspend *next_handler(struct early_suspend *pos,
+					  bool resume)
+{
+	struct list_head *next = resume ? pos->link.prev : pos->link.next;
+
+	if (next == &early_suspend_handlers)
+		return NULL;
+	return list_entry(next, struct early_suspend, link);
+}
+
+static struct early_suspend *first_handler(bool resume)
+{
+	struct list_head *first = resume ? early_suspend_handlers.prev :
+					   early_suspend_handlers.next;
+
+	if (first == &early_suspend_handlers)
+		return NULL;
+	return list_entry(first, struct early_suspend, link);
+}
+
+static void call_handler(struct early_suspend *pos, bool resume)
+{
+	void (*hook)(struct early_suspend *h);
+	ktime_t start, duration;
+
+	hook = resume ? pos->resume : pos->suspend;
+	if (hook != NULL) {
+		if (debug_mask & DEBUG_VERBOSE)
+			pr_info("%s: calling %pf\n",
+				resume ? "late_resume" : "early_suspend", hook);
+		start = ktime_get();
+		hook(pos);
+		duration = ktime_sub(ktime_get(), start);
+		if (resume) {
+			pos->stat.last_resume = duration;
+			if (duration.tv64 > pos->stat.max_resume.tv64)
+				pos->stat.max_resume = duration;
+		} else {
+			pos->stat.last_suspend = duration;
+			if (duration.tv64 > pos->stat.max_suspend.tv64)
+				pos->stat.max_suspend = duration;
+		}
+	}
+	complete_all(&pos->done);
+}
+
+/*
+ * Only handlers of the same level need to be waited for, the others were
+ * completed by an earlier level or will run in a later one.
+ */
+static void wait_for_dependencies(struct early_suspend *handler, bool resume)
 {
 	struct early_suspend *pos;
+
+	if (resume) {
+		pos = handler->depends_on;
+		if (pos && pos->level == handler->level)
+			wait_for_completion(&pos->done);
+		return;
+	}
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		if (pos->depends_on == handler && pos->level == handler->level)
+			wait_for_completion(&pos->done);
+}
+
+static void early_suspend_async(void *data, async_cookie_t cookie)
+{
+	struct early_suspend *handler = data;
+
+	wait_for_dependencies(handler, false);
+	call_handler(handler, false);
+}
+
+static void late_resume_async(void *data, async_cookie_t cookie)
+{
+	struct early_suspend *handler = data;
+
+	wait_for_dependencies(handler, true);
+	call_handler(handler, true);
+}
+
+static bool handler_is_async(struct early_suspend *pos)
+{
+	return async_handlers && (pos->flags & EARLY_SUSPEND_ASYNC);
+}
+
+/* Have all the handlers wait_for_dependencies() waits for been started? */
+static bool dependencies_started(struct early_suspend *handler, bool resume)
+{
+	struct early_suspend *pos;
+
+	if (resume) {
+		pos = handler->depends_on;
+		return !pos || pos->level != handler->level ||
+		       (pos->flags & EARLY_SUSPEND_STARTED);
+	}
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		if (pos->depends_on == handler && pos->level == handler->level &&
+		    !(pos->flags & EARLY_SUSPEND_STARTED))
+			return false;
+	return true;
+}
+
+static void start_handler(struct early_suspend *pos, bool resume)
+{
+	pos->flags |= EARLY_SUSPEND_STARTED;
+	if (handler_is_async(pos)) {
+		async_schedule_domain(resume ? late_resume_async :
+				      early_suspend_async,
+				      pos, &early_suspend_async_domain);
+	} else {
+		wait_for_dependencies(pos, resume);
+		call_handler(pos, resume);
+	}
+}
+
+/*
+ * Run the handlers one level at a time, in ascending level order for
+ * suspend and descending for resume.  Within a level the handlers are
+ * started in registration order, except that none is started before the
+ * handlers it waits for: a handler thus never waits for one that is not
+ * running yet, even when it is synchronous or async_schedule_domain()
+ * runs it right away.  The asynchronous handlers run while the next
+ * ones are started.  Caller must hold early_suspend_lock.
+ */
+static void run_handlers(bool resume)
+{
+	struct early_suspend *first, *pos;
+	int level, left, started;
+
+	first = first_handler(resume);
+	while (first) {
+		level = first->level;
+		left = 0;
+		for (pos = first; pos && pos->level == level;
+		     pos = next_handler(pos, resume)) {
+			INIT_COMPLETION(pos->done);
+			pos->flags &= ~EARLY_SUSPEND_STARTED;
+			left++;
+		}
+
+		while (left) {
+			started = 0;
+			for (pos = first; pos && pos->level == level;
+			     pos = next_handler(pos, resume)) {
+				if ((pos->flags & EARLY_SUSPEND_STARTED) ||
+				    !dependencies_started(pos, resume))
+					continue;
+				start_handler(pos, resume);
+				started++;
+			}
+			/* registration keeps the dependencies acyclic */
+			if (WARN_ON(!started))
+				break;
+			left -= started;
+		}
+
+		async_synchronize_full_domain(&early_suspend_async_domain);
+		first = pos;
+	}
+}
+
+static void early_suspend(struct work_struct *work)
+{
 	unsigned long irqflags;
+	ktime_t start;
 	int abort = 0;
 
 	mutex_lock(&early_suspend_lock);
@@ -94,13 +299,12 @@ static void early_suspend(struct work_struct *work)
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("early_suspend: call handlers\n");
-	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL) {
-			if (debug_mask & DEBUG_VERBOSE)
-				pr_info("early_suspend: calling %pf\n", pos->suspend);
-			pos->suspend(pos);
-		}
-	}
+	start = ktime_get();
+	run_handlers(false);
+	suspend_phase_early_suspend();
+	if (debug_mask & DEBUG_SUSPEND)
+		pr_info("early_suspend: handlers done in %lld us\n",
+			ktime_to_us(ktime_sub(ktime_get(), start)));
 	mutex_unlock(&early_suspend_lock);
 
 	if (debug_mask & DEBUG_SUSPEND)
@@ -116,8 +320,8 @@ abort:
 
 static void late_resume(struct work_struct *work)
 {
-	struct early_suspend *pos;
 	unsigned long irqflags;
+	ktime_t start;
 	int abort = 0;
 
 	mutex_lock(&early_suspend_lock);
@@ -135,16 +339,13 @@ static void late_resume(struct work_struct *work)
 	}
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: call handlers\n");
-	list_for_each_entry_reverse(pos, &early_suspend_handlers, link) {
-		if (pos->resume != NULL) {
-			if (debug_mask & DEBUG_VERBOSE)
-				pr_info("late_resume: calling %pf\n", pos->resume);
-
-			pos->resume(pos);
-		}
-	}
+	suspend_phase_mark(SUSPEND_PHASE_LATE_RESUME_START);
+	start = ktime_get();
+	run_handlers(true);
+	suspend_phase_mark(SUSPEND_PHASE_LATE_RESUME);
 	if (debug_mask & DEBUG_SUSPEND)
-		pr_info("late_resume: done\n");
+		pr_info("late_resume: done in %lld us\n",
+			ktime_to_us(ktime_sub(ktime_get(), start)));
 abort:
 	mutex_unlock(&early_suspend_lock);
 }
@@ -185,3 +386,52 @@ suspend_state_t get_suspend_state(void)
 {
 	return requested_suspend_state;
 }
+
+#ifdef CONFIG_DEBUG_FS
+static int early_suspend_stats_show(struct seq_file *m, void *unused)
+{
+	struct early_suspend *pos;
+
+	seq_puts(m, "level\tasync\tsuspend_us\tmax_suspend_us"
+		 "\tresume_us\tmax_resume_us\thandler\n");
+	mutex_lock(&early_suspend_lock);
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		seq_printf(m, "%d\t%d\t%lld\t%lld\t%lld\t%lld\t%pf\n",
+			   pos->level, !!(pos->flags & EARLY_SUSPEND_ASYNC),
+			   ktime_to_us(pos->stat.last_suspend),
+			   ktime_to_us(pos->stat.max_suspend),
+			   ktime_to_us(pos->stat.last_resume),
+			   ktime_to_us(pos->stat.max_resume),
+			   pos->suspend ? pos->suspend : pos->resume);
+	mutex_unlock(&early_suspend_lock);
+	return 0;
+}
+
+static int early_suspend_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, early_suspend_stats_show, NULL);
+}
+
+static const struct file_operations early_suspend_stats_fops = {
+	.open		= early_suspend_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init early_suspend_debug_init(void)
+{
+	struct dentry *d;
+
+	d = debugfs_create_file("early_suspend_stats", 0444, NULL, NULL,
+				&early_suspend_stats_fops);
+	if (!d) {
+		pr_err("Failed to create early_suspend_stats debug file\n");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+late_initcall(early_suspend_debug_init);
+#endif
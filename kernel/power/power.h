@@ -193,6 +193,43 @@ static inline void suspend_test_start(void) {}
 static inline void suspend_test_finish(const char *label) {}
 #endif /* !CONFIG_PM_TEST_SUSPEND */
 
+/* Suspend and resume phases, in the order they complete */
+enum suspend_phase {
+	SUSPEND_PHASE_START,
+	SUSPEND_PHASE_SYNC,
+	SUSPEND_PHASE_FREEZE,
+	SUSPEND_PHASE_DPM_SUSPEND,
+	SUSPEND_PHASE_DPM_SUSPEND_NOIRQ,
+	SUSPEND_PHASE_CPUS_DOWN,
+	SUSPEND_PHASE_SYSCORE_SUSPEND,
+	SUSPEND_PHASE_SLEEP,
+	SUSPEND_PHASE_SYSCORE_RESUME,
+	SUSPEND_PHASE_CPUS_UP,
+	SUSPEND_PHASE_DPM_RESUME_NOIRQ,
+	SUSPEND_PHASE_DPM_RESUME,
+	SUSPEND_PHASE_THAW,
+	SUSPEND_PHASE_FINISH,
+	SUSPEND_PHASE_USER_TASK,
+	SUSPEND_PHASE_LATE_RESUME_START,
+	SUSPEND_PHASE_LATE_RESUME,
+	SUSPEND_PHASE_COUNT
+};
+
+#ifdef CONFIG_SUSPEND_PHASES
+/* kernel/power/suspend_phases.c */
+extern void suspend_phase_mark(enum suspend_phase phase);
+extern void suspend_phase_begin(void);
+extern void suspend_phase_thawed(void);
+extern void suspend_phase_early_suspend(void);
+extern void suspend_phase_result(int error);
+#else /* !CONFIG_SUSPEND_PHASES */
+static inline void suspend_phase_mark(enum suspend_phase phase) {}
+static inline void suspend_phase_begin(void) {}
+static inline void suspend_phase_thawed(void) {}
+static inline void suspend_phase_early_suspend(void) {}
+static inline void suspend_phase_result(int error) {}
+#endif /* !CONFIG_SUSPEND_PHASES */
+
 #ifdef CONFIG_PM_SLEEP
 /* kernel/power/main.c */
 extern int pm_notifier_call_chain(unsigned long val);
@@ -106,8 +106,10 @@ static int suspend_prepare(void)
 		goto Finish;
 
 	error = suspend_freeze_processes();
-	if (!error)
+	if (!error) {
+		suspend_phase_mark(SUSPEND_PHASE_FREEZE);
 		return 0;
+	}
 
 	suspend_thaw_processes();
 	usermodehelper_enable();
@@ -150,6 +152,7 @@ static int suspend_enter(suspend_state_t state)
 		printk(KERN_ERR "PM: Some devices failed to power down\n");
 		goto Platform_finish;
 	}
+	suspend_phase_mark(SUSPEND_PHASE_DPM_SUSPEND_NOIRQ);
 
 	if (suspend_ops->prepare_late) {
 		error = suspend_ops->prepare_late();
@@ -161,6 +164,8 @@ static int suspend_enter(suspend_state_t state)
 		goto Platform_wake;
 
 	error = disable_nonboot_cpus();
+	if (!error)
+		suspend_phase_mark(SUSPEND_PHASE_CPUS_DOWN);
 	if (error || suspend_test(TEST_CPUS))
 		goto Enable_cpus;
 
@@ -169,11 +174,14 @@ static int suspend_enter(suspend_state_t state)
 
 	error = syscore_suspend();
 	if (!error) {
+		suspend_phase_mark(SUSPEND_PHASE_SYSCORE_SUSPEND);
 		if (!(suspend_test(TEST_CORE) || pm_wakeup_pending())) {
 			error = suspend_ops->enter(state);
 			events_check_enabled = false;
+			suspend_phase_mark(SUSPEND_PHASE_SLEEP);
 		}
 		syscore_resume();
+		suspend_phase_mark(SUSPEND_PHASE_SYSCORE_RESUME);
 	}
 
 	arch_suspend_enable_irqs();
@@ -181,12 +189,14 @@ static int suspend_enter(suspend_state_t state)
 
  Enable_cpus:
 	enable_nonboot_cpus();
+	suspend_phase_mark(SUSPEND_PHASE_CPUS_UP);
 
  Platform_wake:
 	if (suspend_ops->wake)
 		suspend_ops->wake();
 
 	dpm_resume_noirq(PMSG_RESUME);
+	suspend_phase_mark(SUSPEND_PHASE_DPM_RESUME_NOIRQ);
 
  Platform_finish:
 	if (suspend_ops->finish)
@@ -221,6 +231,7 @@ int suspend_devices_and_enter(suspend_state_t state)
 		printk(KERN_ERR "PM: Some devices failed to suspend\n");
 		goto Recover_platform;
 	}
+	suspend_phase_mark(SUSPEND_PHASE_DPM_SUSPEND);
 	suspend_test_finish("suspend devices");
 	if (suspend_test(TEST_DEVICES))
 		goto Recover_platform;
@@ -230,6 +241,7 @@ int suspend_devices_and_enter(suspend_state_t state)
  Resume_devices:
 	suspend_test_start();
 	dpm_resume_end(PMSG_RESUME);
+	suspend_phase_mark(SUSPEND_PHASE_DPM_RESUME);
 	suspend_test_finish("resume devices");
 	ftrace_start();
 	resume_console();
@@ -254,6 +266,7 @@ int suspend_devices_and_enter(suspend_state_t state)
 static void suspend_finish(void)
 {
 	suspend_thaw_processes();
+	suspend_phase_thawed();
 	usermodehelper_enable();
 	pm_notifier_call_chain(PM_POST_SUSPEND);
 	pm_restore_console();
@@ -279,9 +292,11 @@ int enter_state(suspend_state_t state)
 	if (!mutex_trylock(&pm_mutex))
 		return -EBUSY;
 
+	suspend_phase_begin();
 	printk(KERN_INFO "PM: Syncing filesystems ... ");
 	sys_sync();
 	printk("done.\n");
+	suspend_phase_mark(SUSPEND_PHASE_SYNC);
 
 	pr_debug("PM: Preparing system for %s sleep\n", pm_states[state]);
 	error = suspend_prepare();
@@ -299,7 +314,9 @@ int enter_state(suspend_state_t state)
  Finish:
 	pr_debug("PM: Finishing wakeup.\n");
 	suspend_finish();
+	suspend_phase_mark(SUSPEND_PHASE_FINISH);
  Unlock:
+	suspend_phase_result(error);
 	mutex_unlock(&pm_mutex);
 	return error;
 }
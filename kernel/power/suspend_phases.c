@@ -0,0 +1,377 @@
+/*
+ * kernel/power/suspend_phases.c - Per-phase timing of suspend/resume cycles.
+ *
+ * This file is released under the GPLv2.
+ *
+ * The suspend path marks the end of each of its phases here.  Marks are
+ * local_clock() timestamps stored in a small ring of recent cycles, so
+ * they stay valid while timekeeping is suspended and cost no more than
+ * a spinlock and a store.  The duration of every phase is also added
+ * to a log2 histogram kept across all cycles since boot, which is what
+ * tells a rare slow resume apart from a regression.
+ *
+ * Besides the phases of enter_state() two events after it are tracked:
+ * the first user task switched in after processes were thawed, and the
+ * early suspend late_resume handlers.
+ *
+ * Aborted cycles and suspend_test runs simply miss some marks; a phase
+ * is then timed from the last mark that was recorded before it.  The
+ * late_resume marks belong to the cycle entered after the matching
+ * early suspend and are dropped when there is none, so they are never
+ * timed against a mark left over from an earlier cycle.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <trace/events/sched.h>
+
+#include "power.h"
+
+/* Cycles kept in the ring */
+#define SUSPEND_PHASE_CYCLES	16
+/* Histogram buckets, bucket n counts durations below 2^n usecs */
+#define SUSPEND_PHASE_BUCKETS	32
+/* How long to wait for a user task to be scheduled after thawing */
+#define SUSPEND_PHASE_USER_TIMEOUT	(5 * HZ)
+
+struct suspend_phase_cycle {
+	unsigned long	recorded;	/* bitmask of marked phases */
+	u64		ts[SUSPEND_PHASE_COUNT];	/* ns, local_clock() */
+	int		error;
+	int		test_level;
+};
+
+static const char * const suspend_phase_names[SUSPEND_PHASE_COUNT] = {
+	[SUSPEND_PHASE_START]		= "start",
+	[SUSPEND_PHASE_SYNC]		= "sync",
+	[SUSPEND_PHASE_FREEZE]		= "freeze",
+	[SUSPEND_PHASE_DPM_SUSPEND]	= "dpm_suspend",
+	[SUSPEND_PHASE_DPM_SUSPEND_NOIRQ] = "dpm_suspend_noirq",
+	[SUSPEND_PHASE_CPUS_DOWN]	= "cpus_down",
+	[SUSPEND_PHASE_SYSCORE_SUSPEND]	= "syscore_suspend",
+	[SUSPEND_PHASE_SLEEP]		= "sleep",
+	[SUSPEND_PHASE_SYSCORE_RESUME]	= "syscore_resume",
+	[SUSPEND_PHASE_CPUS_UP]		= "cpus_up",
+	[SUSPEND_PHASE_DPM_RESUME_NOIRQ] = "dpm_resume_noirq",
+	[SUSPEND_PHASE_DPM_RESUME]	= "dpm_resume",
+	[SUSPEND_PHASE_THAW]		= "thaw",
+	[SUSPEND_PHASE_FINISH]		= "finish",
+	[SUSPEND_PHASE_USER_TASK]	= "user_task",
+	[SUSPEND_PHASE_LATE_RESUME_START] = "late_resume_start",
+	[SUSPEND_PHASE_LATE_RESUME]	= "late_resume",
+};
+
+/*
+ * Phases are timed from the preceding phase, except for the events that
+ * may overlap the end of enter_state(): the first user task can run as
+ * soon as processes are thawed, and late_resume starts whenever user
+ * space asks for it.
+ */
+static const enum suspend_phase suspend_phase_ref[SUSPEND_PHASE_COUNT] = {
+	[SUSPEND_PHASE_USER_TASK]		= SUSPEND_PHASE_THAW,
+	[SUSPEND_PHASE_LATE_RESUME_START]	= SUSPEND_PHASE_FINISH,
+	[SUSPEND_PHASE_LATE_RESUME]		= SUSPEND_PHASE_LATE_RESUME_START,
+};
+
+static struct suspend_phase_cycle suspend_phase_ring[SUSPEND_PHASE_CYCLES];
+static unsigned int suspend_phase_cur;	/* index of the current cycle */
+static unsigned int suspend_phase_cycles;	/* cycles started since boot */
+/* suspend_phase_cycles when the early suspend handlers last ran */
+static unsigned int suspend_phase_early_cycles;
+static unsigned int suspend_phase_hist[SUSPEND_PHASE_COUNT]
+				      [SUSPEND_PHASE_BUCKETS];
+static DEFINE_SPINLOCK(suspend_phase_lock);
+
+static struct task_struct *suspend_phase_task;
+static bool suspend_phase_want_user;
+static bool suspend_phase_probe_registered;
+static DEFINE_MUTEX(suspend_phase_probe_mutex);
+static void suspend_phase_user_timeout(struct work_struct *work);
+static DECLARE_DELAYED_WORK(suspend_phase_user_work,
+			    suspend_phase_user_timeout);
+
+/*
+ * Returns the mark @phase is timed from, or -1 if none was recorded in
+ * @c.  Caller must hold suspend_phase_lock.
+ */
+static int suspend_phase_from(struct suspend_phase_cycle *c,
+			      enum suspend_phase phase)
+{
+	int ref;
+
+	if (phase == SUSPEND_PHASE_START)
+		return -1;
+
+	ref = suspend_phase_ref[phase] ? suspend_phase_ref[phase] : phase - 1;
+	for (; ref >= 0; ref--)
+		if (c->recorded & (1UL << ref))
+			return ref;
+	return -1;
+}
+
+static u64 suspend_phase_usecs(struct suspend_phase_cycle *c,
+			       enum suspend_phase phase)
+{
+	int ref = suspend_phase_from(c, phase);
+
+	if (ref < 0 || c->ts[phase] < c->ts[ref])
+		return 0;
+	return div_u64(c->ts[phase] - c->ts[ref], NSEC_PER_USEC);
+}
+
+/**
+ * suspend_phase_mark - Record the end of a suspend or resume phase.
+ * @phase: Phase that just completed.
+ *
+ * May be called with interrupts disabled and while timekeeping is
+ * suspended.  SUSPEND_PHASE_START opens a new cycle in the ring.
+ */
+void suspend_phase_mark(enum suspend_phase phase)
+{
+	struct suspend_phase_cycle *c;
+	unsigned long flags;
+	u64 usecs;
+
+	spin_lock_irqsave(&suspend_phase_lock, flags);
+	if (phase == SUSPEND_PHASE_START) {
+		suspend_phase_cur = suspend_phase_cycles++ %
+				    SUSPEND_PHASE_CYCLES;
+		c = &suspend_phase_ring[suspend_phase_cur];
+		memset(c, 0, sizeof(*c));
+#ifdef CONFIG_PM_DEBUG
+		c->test_level = pm_test_level;
+#endif
+	} else if (phase >= SUSPEND_PHASE_LATE_RESUME_START &&
+		   suspend_phase_cycles == suspend_phase_early_cycles) {
+		/* late_resume without a suspend cycle since early suspend */
+		goto out;
+	}
+
+	c = &suspend_phase_ring[suspend_phase_cur];
+	if (c->recorded & (1UL << phase))
+		goto out;
+
+	c->ts[phase] = local_clock();
+	c->recorded |= 1UL << phase;
+
+	if (phase != SUSPEND_PHASE_START) {
+		usecs = suspend_phase_usecs(c, phase);
+		suspend_phase_hist[phase][min_t(int, fls64(usecs),
+					   SUSPEND_PHASE_BUCKETS - 1)]++;
+	}
+out:
+	spin_unlock_irqrestore(&suspend_phase_lock, flags);
+}
+
+/**
+ * suspend_phase_early_suspend - The early suspend handlers have run.
+ *
+ * Only a cycle started after this point owns the following late_resume.
+ */
+void suspend_phase_early_suspend(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&suspend_phase_lock, flags);
+	suspend_phase_early_cycles = suspend_phase_cycles;
+	spin_unlock_irqrestore(&suspend_phase_lock, flags);
+}
+
+/**
+ * suspend_phase_result - Record the outcome of the current cycle.
+ * @error: Return value of enter_state().
+ */
+void suspend_phase_result(int error)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&suspend_phase_lock, flags);
+	suspend_phase_ring[suspend_phase_cur].error = error;
+	spin_unlock_irqrestore(&suspend_phase_lock, flags);
+}
+
+/*
+ * The first user task scheduled after thawing is caught with a probe on
+ * the sched_switch tracepoint.  It is only attached for
+ * SUSPEND_PHASE_USER_TIMEOUT after thawing, so context switches pay
+ * nothing outside of that window.
+ */
+static void suspend_phase_probe_switch(void *ignore, struct task_struct *prev,
+				       struct task_struct *next)
+{
+	if (!suspend_phase_want_user || !next->mm ||
+	    next == suspend_phase_task)
+		return;
+
+	suspend_phase_want_user = false;
+	suspend_phase_mark(SUSPEND_PHASE_USER_TASK);
+}
+
+static void __suspend_phase_detach(void)
+{
+	mutex_lock(&suspend_phase_probe_mutex);
+	suspend_phase_want_user = false;
+	if (suspend_phase_probe_registered) {
+		unregister_trace_sched_switch(suspend_phase_probe_switch, NULL);
+		tracepoint_synchronize_unregister();
+		suspend_phase_probe_registered = false;
+	}
+	mutex_unlock(&suspend_phase_probe_mutex);
+}
+
+static void suspend_phase_user_timeout(struct work_struct *work)
+{
+	__suspend_phase_detach();
+}
+
+/*
+ * The timeout of the previous cycle must not fire into the next one and
+ * take the probe away before it saw a user task.
+ */
+static void suspend_phase_detach(void)
+{
+	cancel_delayed_work_sync(&suspend_phase_user_work);
+	__suspend_phase_detach();
+}
+
+/**
+ * suspend_phase_begin - Start a new cycle.
+ *
+ * Called from enter_state() before anything else is done.
+ */
+void suspend_phase_begin(void)
+{
+	suspend_phase_detach();
+	suspend_phase_task = current;
+	suspend_phase_mark(SUSPEND_PHASE_START);
+}
+
+/**
+ * suspend_phase_thawed - Processes were thawed, watch for a user task.
+ *
+ * Called from suspend_finish() right after thaw_processes().
+ */
+void suspend_phase_thawed(void)
+{
+	suspend_phase_mark(SUSPEND_PHASE_THAW);
+
+	mutex_lock(&suspend_phase_probe_mutex);
+	if (!suspend_phase_probe_registered &&
+	    !register_trace_sched_switch(suspend_phase_probe_switch, NULL))
+		suspend_phase_probe_registered = true;
+	if (suspend_phase_probe_registered) {
+		suspend_phase_want_user = true;
+		schedule_delayed_work(&suspend_phase_user_work,
+				      SUSPEND_PHASE_USER_TIMEOUT);
+	}
+	mutex_unlock(&suspend_phase_probe_mutex);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int suspend_phases_show(struct seq_file *m, void *unused)
+{
+	static struct suspend_phase_cycle c;
+	static DEFINE_MUTEX(show_mutex);
+	unsigned int n, i, cycles;
+	unsigned long flags;
+	int phase;
+
+	mutex_lock(&show_mutex);
+	spin_lock_irqsave(&suspend_phase_lock, flags);
+	cycles = suspend_phase_cycles;
+	spin_unlock_irqrestore(&suspend_phase_lock, flags);
+
+	seq_printf(m, "phase durations in usecs, most recent cycle first\n");
+	n = min_t(unsigned int, cycles, SUSPEND_PHASE_CYCLES);
+	for (i = 0; i < n; i++) {
+		spin_lock_irqsave(&suspend_phase_lock, flags);
+		c = suspend_phase_ring[(cycles - 1 - i) % SUSPEND_PHASE_CYCLES];
+		spin_unlock_irqrestore(&suspend_phase_lock, flags);
+
+		seq_printf(m, "cycle %u: error %d", cycles - i, c.error);
+		if (c.test_level)
+			seq_printf(m, " test %d", c.test_level);
+		seq_printf(m, "\n");
+		for (phase = SUSPEND_PHASE_START + 1;
+		     phase < SUSPEND_PHASE_COUNT; phase++) {
+			if (!(c.recorded & (1UL << phase)))
+				continue;
+			seq_printf(m, "  %-18s %10llu\n",
+				   suspend_phase_names[phase],
+				   suspend_phase_usecs(&c, phase));
+		}
+	}
+	mutex_unlock(&show_mutex);
+	return 0;
+}
+
+static int suspend_phases_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, suspend_phases_show, NULL);
+}
+
+static const struct file_operations suspend_phases_fops = {
+	.open		= suspend_phases_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int suspend_phase_hist_show(struct seq_file *m, void *unused)
+{
+	static unsigned int hist[SUSPEND_PHASE_BUCKETS];
+	static DEFINE_MUTEX(show_mutex);
+	unsigned long flags;
+	int phase, bin;
+
+	mutex_lock(&show_mutex);
+	seq_printf(m, "usecs (log2)  count\n");
+	for (phase = SUSPEND_PHASE_START + 1; phase < SUSPEND_PHASE_COUNT;
+	     phase++) {
+		spin_lock_irqsave(&suspend_phase_lock, flags);
+		memcpy(hist, suspend_phase_hist[phase], sizeof(hist));
+		spin_unlock_irqrestore(&suspend_phase_lock, flags);
+
+		seq_printf(m, "%s:\n", suspend_phase_names[phase]);
+		for (bin = 0; bin < SUSPEND_PHASE_BUCKETS; bin++) {
+			if (!hist[bin])
+				continue;
+			seq_printf(m, "  %10u - %10u %6u\n",
+				   bin ? 1U << (bin - 1) : 0, 1U << bin,
+				   hist[bin]);
+		}
+	}
+	mutex_unlock(&show_mutex);
+	return 0;
+}
+
+static int suspend_phase_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, suspend_phase_hist_show, NULL);
+}
+
+static const struct file_operations suspend_phase_hist_fops = {
+	.open		= suspend_phase_hist_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init suspend_phases_debugfs_init(void)
+{
+	debugfs_create_file("suspend_phases", S_IRUGO, NULL, NULL,
+			    &suspend_phases_fops);
+	debugfs_create_file("suspend_phase_hist", S_IRUGO, NULL, NULL,
+			    &suspend_phase_hist_fops);
+	return 0;
+}
+
+late_initcall(suspend_phases_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
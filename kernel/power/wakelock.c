@@ -43,6 +43,10 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 static DEFINE_SPINLOCK(list_lock);
 static LIST_HEAD(inactive_locks);
 static struct list_head active_wake_locks[WAKE_LOCK_TYPE_COUNT];
+/* Active locks with a timeout, ordered by expiry */
+static struct rb_root expire_queues[WAKE_LOCK_TYPE_COUNT];
+/* Number of active locks without a timeout, read without list_lock */
+static int active_nonexpiring[WAKE_LOCK_TYPE_COUNT];
 static int current_event_num;
 struct workqueue_struct *suspend_work_queue;
 struct wake_lock main_wake_lock;
@@ -55,6 +59,22 @@ static struct wake_lock suspend_backoff_lock;
 
 static unsigned suspend_short_count;
 
+#ifdef CONFIG_WAKELOCK_STAT
+/* Lock operation counters, summed over cpus in /proc/wakelock_hist */
+struct wake_lock_cpu_stats {
+	unsigned long locks;
+	unsigned long unlocks;
+	unsigned long expires;
+	unsigned long fast_checks;
+	unsigned long slow_checks;
+};
+static DEFINE_PER_CPU(struct wake_lock_cpu_stats, wake_lock_cpu_stats);
+
+#define wake_lock_stat_inc(field)	this_cpu_inc(wake_lock_cpu_stats.field)
+#else
+#define wake_lock_stat_inc(field)	do { } while (0)
+#endif
+
 #ifdef CONFIG_WAKELOCK_STAT
 static struct wake_lock deleted_wake_locks;
 static ktime_t last_sleep_time_update;
@@ -141,6 +161,79 @@ static int wakelock_stats_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static int hold_hist_bucket(ktime_t duration)
+{
+	s64 ms = ktime_to_ms(duration);
+
+	if (ms <= 0)
+		return 0;
+	if (ms >= 1LL << (WAKE_LOCK_HIST_BUCKETS - 2))
+		return WAKE_LOCK_HIST_BUCKETS - 1;
+	return fls((unsigned int)ms);
+}
+
+static ktime_t prevent_suspend_time_locked(struct wake_lock *lock)
+{
+	ktime_t prevent_suspend_time = lock->stat.prevent_suspend_time;
+	ktime_t now;
+
+	if ((lock->flags & WAKE_LOCK_ACTIVE) &&
+	    (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND)) {
+		if (!get_expired_time(lock, &now))
+			now = ktime_get();
+		prevent_suspend_time = ktime_add(prevent_suspend_time,
+				ktime_sub(now, last_sleep_time_update));
+	}
+	return prevent_suspend_time;
+}
+
+static int print_lock_hist(struct seq_file *m, struct wake_lock *lock)
+{
+	int i;
+
+	seq_printf(m, "\"%s\"\t%lld", lock->name,
+		   ktime_to_ms(prevent_suspend_time_locked(lock)));
+	for (i = 0; i < WAKE_LOCK_HIST_BUCKETS; i++)
+		seq_printf(m, "\t%u", lock->stat.hold_hist[i]);
+	return seq_putc(m, '\n');
+}
+
+static int wakelock_hist_show(struct seq_file *m, void *unused)
+{
+	unsigned long irqflags;
+	struct wake_lock *lock;
+	int type;
+	int cpu;
+	int i;
+
+	seq_puts(m, "name\tprevented_suspend_ms");
+	for (i = 0; i < WAKE_LOCK_HIST_BUCKETS - 1; i++)
+		seq_printf(m, "\t<%u", 1U << i);
+	seq_printf(m, "\t>=%u", 1U << (WAKE_LOCK_HIST_BUCKETS - 2));
+	seq_puts(m, "\n");
+
+	spin_lock_irqsave(&list_lock, irqflags);
+	list_for_each_entry(lock, &inactive_locks, link)
+		print_lock_hist(m, lock);
+	for (type = 0; type < WAKE_LOCK_TYPE_COUNT; type++) {
+		list_for_each_entry(lock, &active_wake_locks[type], link)
+			print_lock_hist(m, lock);
+	}
+	spin_unlock_irqrestore(&list_lock, irqflags);
+
+	seq_puts(m, "\ncpu\tlocks\tunlocks\texpires\tfast_checks"
+		 "\tslow_checks\n");
+	for_each_possible_cpu(cpu) {
+		struct wake_lock_cpu_stats *st =
+			&per_cpu(wake_lock_cpu_stats, cpu);
+
+		seq_printf(m, "%d\t%lu\t%lu\t%lu\t%lu\t%lu\n", cpu,
+			   st->locks, st->unlocks, st->expires,
+			   st->fast_checks, st->slow_checks);
+	}
+	return 0;
+}
+
 static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 {
 	ktime_t duration;
@@ -158,6 +251,7 @@ static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 	lock->stat.total_time = ktime_add(lock->stat.total_time, duration);
 	if (ktime_to_ns(duration) > ktime_to_ns(lock->stat.max_time))
 		lock->stat.max_time = duration;
+	lock->stat.hold_hist[hold_hist_bucket(duration)]++;
 	lock->stat.last_time = ktime_get();
 	if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
 		duration = ktime_sub(now, last_sleep_time_update);
@@ -195,11 +289,48 @@ static void update_sleep_wait_stats_locked(int done)
 #endif
 
 
+static void expire_queue_add(struct wake_lock *lock, int type)
+{
+	struct rb_node **p = &expire_queues[type].rb_node;
+	struct rb_node *parent = NULL;
+	struct wake_lock *entry;
+
+	while (*p) {
+		parent = *p;
+		entry = rb_entry(parent, struct wake_lock, expire_node);
+		if (time_before(lock->expires, entry->expires))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&lock->expire_node, parent, p);
+	rb_insert_color(&lock->expire_node, &expire_queues[type]);
+}
+
+/*
+ * Drop an active lock from the expire queue or the count of locks held
+ * without timeout.  Caller must acquire the list_lock spinlock and update
+ * lock->flags afterwards.
+ */
+static void wake_lock_dequeue_locked(struct wake_lock *lock)
+{
+	int type = lock->flags & WAKE_LOCK_TYPE_MASK;
+
+	if (!(lock->flags & WAKE_LOCK_ACTIVE))
+		return;
+	if (lock->flags & WAKE_LOCK_AUTO_EXPIRE)
+		rb_erase(&lock->expire_node, &expire_queues[type]);
+	else
+		active_nonexpiring[type]--;
+}
+
 static void expire_wake_lock(struct wake_lock *lock)
 {
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_unlock_stat_locked(lock, 1);
 #endif
+	wake_lock_stat_inc(expires);
+	wake_lock_dequeue_locked(lock);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
 	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
@@ -232,27 +363,40 @@ static void print_active_locks(int type)
 
 static long has_wake_lock_locked(int type)
 {
-	struct wake_lock *lock, *n;
-	long max_timeout = 0;
+	struct rb_node *node;
+	struct wake_lock *lock;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
-	list_for_each_entry_safe(lock, n, &active_wake_locks[type], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout <= 0)
-				expire_wake_lock(lock);
-			else if (timeout > max_timeout)
-				max_timeout = timeout;
-		} else
-			return -1;
+	if (active_nonexpiring[type])
+		return -1;
+	while ((node = rb_first(&expire_queues[type]))) {
+		lock = rb_entry(node, struct wake_lock, expire_node);
+		if ((long)(lock->expires - jiffies) > 0)
+			break;
+		expire_wake_lock(lock);
 	}
-	return max_timeout;
+	node = rb_last(&expire_queues[type]);
+	if (!node)
+		return 0;
+	lock = rb_entry(node, struct wake_lock, expire_node);
+	return lock->expires - jiffies;
 }
 
 long has_wake_lock(int type)
 {
 	long ret;
 	unsigned long irqflags;
+
+	/*
+	 * A lock held without timeout can not expire, so there is nothing
+	 * to do under list_lock unless the active locks should be printed.
+	 */
+	if (ACCESS_ONCE(active_nonexpiring[type]) &&
+	    !(type == WAKE_LOCK_SUSPEND && (debug_mask & DEBUG_WAKEUP))) {
+		wake_lock_stat_inc(fast_checks);
+		return -1;
+	}
+	wake_lock_stat_inc(slow_checks);
 	spin_lock_irqsave(&list_lock, irqflags);
 	ret = has_wake_lock_locked(type);
 	if (ret && (debug_mask & DEBUG_WAKEUP) && type == WAKE_LOCK_SUSPEND)
@@ -375,10 +519,12 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	lock->stat.prevent_suspend_time = ktime_set(0, 0);
 	lock->stat.max_time = ktime_set(0, 0);
 	lock->stat.last_time = ktime_set(0, 0);
+	memset(lock->stat.hold_hist, 0, sizeof(lock->stat.hold_hist));
 #endif
 	lock->flags = (type & WAKE_LOCK_TYPE_MASK) | WAKE_LOCK_INITIALIZED;
 
 	INIT_LIST_HEAD(&lock->link);
+	RB_CLEAR_NODE(&lock->expire_node);
 	spin_lock_irqsave(&list_lock, irqflags);
 	list_add(&lock->link, &inactive_locks);
 	spin_unlock_irqrestore(&list_lock, irqflags);
@@ -391,9 +537,13 @@ void wake_lock_destroy(struct wake_lock *lock)
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_destroy name=%s\n", lock->name);
 	spin_lock_irqsave(&list_lock, irqflags);
-	lock->flags &= ~WAKE_LOCK_INITIALIZED;
+	wake_lock_dequeue_locked(lock);
+	lock->flags &= ~(WAKE_LOCK_INITIALIZED | WAKE_LOCK_ACTIVE |
+			 WAKE_LOCK_AUTO_EXPIRE);
 #ifdef CONFIG_WAKELOCK_STAT
 	if (lock->stat.count) {
+		int i;
+
 		deleted_wake_locks.stat.count += lock->stat.count;
 		deleted_wake_locks.stat.expire_count += lock->stat.expire_count;
 		deleted_wake_locks.stat.total_time =
@@ -405,6 +555,9 @@ void wake_lock_destroy(struct wake_lock *lock)
 		deleted_wake_locks.stat.max_time =
 			ktime_add(deleted_wake_locks.stat.max_time,
 				  lock->stat.max_time);
+		for (i = 0; i < WAKE_LOCK_HIST_BUCKETS; i++)
+			deleted_wake_locks.stat.hold_hist[i] +=
+				lock->stat.hold_hist[i];
 	}
 #endif
 	list_del(&lock->link);
@@ -436,6 +589,8 @@ static void wake_lock_internal(
 		lock->stat.last_time = ktime_get();
 	}
 #endif
+	wake_lock_stat_inc(locks);
+	wake_lock_dequeue_locked(lock);
 	if (!(lock->flags & WAKE_LOCK_ACTIVE)) {
 		lock->flags |= WAKE_LOCK_ACTIVE;
 #ifdef CONFIG_WAKELOCK_STAT
@@ -451,12 +606,14 @@ static void wake_lock_internal(
 		lock->expires = jiffies + timeout;
 		lock->flags |= WAKE_LOCK_AUTO_EXPIRE;
 		list_add_tail(&lock->link, &active_wake_locks[type]);
+		expire_queue_add(lock, type);
 	} else {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d\n", lock->name, type);
 		lock->expires = LONG_MAX;
 		lock->flags &= ~WAKE_LOCK_AUTO_EXPIRE;
 		list_add(&lock->link, &active_wake_locks[type]);
+		active_nonexpiring[type]++;
 	}
 	if (type == WAKE_LOCK_SUSPEND) {
 		current_event_num++;
@@ -510,6 +667,8 @@ void wake_unlock(struct wake_lock *lock)
 #endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_unlock: %s\n", lock->name);
+	wake_lock_stat_inc(unlocks);
+	wake_lock_dequeue_locked(lock);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
 	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
@@ -559,13 +718,30 @@ static const struct file_operations wakelock_stats_fops = {
 	.release = single_release,
 };
 
+#ifdef CONFIG_WAKELOCK_STAT
+static int wakelock_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakelock_hist_show, NULL);
+}
+
+static const struct file_operations wakelock_hist_fops = {
+	.owner = THIS_MODULE,
+	.open = wakelock_hist_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+#endif
+
 static int __init wakelocks_init(void)
 {
 	int ret;
 	int i;
 
-	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++)
+	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++) {
 		INIT_LIST_HEAD(&active_wake_locks[i]);
+		expire_queues[i] = RB_ROOT;
+	}
 
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_lock_init(&deleted_wake_locks, WAKE_LOCK_SUSPEND,
@@ -596,6 +772,7 @@ static int __init wakelocks_init(void)
 
 #ifdef CONFIG_WAKELOCK_STAT
 	proc_create("wakelocks", S_IRUGO, NULL, &wakelock_stats_fops);
+	proc_create("wakelock_hist", S_IRUGO, NULL, &wakelock_hist_fops);
 #endif
 
 	return 0;
@@ -617,6 +794,7 @@ err_platform_device_register:
 static void  __exit wakelocks_exit(void)
 {
 #ifdef CONFIG_WAKELOCK_STAT
+	remove_proc_entry("wakelock_hist", NULL);
 	remove_proc_entry("wakelocks", NULL);
 #endif
 	destroy_workqueue(suspend_work_queue);
@@ -72,6 +72,7 @@
 #include <linux/ftrace.h>
 #include <linux/slab.h>
 #include <linux/cpuacct.h>
+#include <linux/prctl.h>
 
 #include <asm/tlb.h>
 #include <asm/irq_regs.h>
@@ -135,6 +136,18 @@ static inline int task_has_rt_policy(struct task_struct *p)
 	return rt_policy(p->policy);
 }
 
+static inline int dl_policy(int policy)
+{
+	if (unlikely(policy == SCHED_DEADLINE))
+		return 1;
+	return 0;
+}
+
+static inline int task_has_dl_policy(struct task_struct *p)
+{
+	return dl_policy(p->policy);
+}
+
 /*
  * This is the priority-queue data structure of the RT scheduling class:
  */
@@ -194,10 +207,32 @@ static inline int rt_bandwidth_enabled(void)
 	return sysctl_sched_rt_runtime >= 0;
 }
 
-static void start_rt_bandwidth(struct rt_bandwidth *rt_b)
+/*
+ * Start @period_timer, if it is not running yet, to fire at the next
+ * multiple of @period.  Called with the lock of the bandwidth held.
+ */
+static void start_bandwidth_timer(struct hrtimer *period_timer, ktime_t period)
 {
-	ktime_t now;
+	unsigned long delta;
+	ktime_t soft, hard, now;
+
+	for (;;) {
+		if (hrtimer_active(period_timer))
+			break;
+
+		now = hrtimer_cb_get_time(period_timer);
+		hrtimer_forward(period_timer, now, period);
 
+		soft = hrtimer_get_softexpires(period_timer);
+		hard = hrtimer_get_expires(period_timer);
+		delta = ktime_to_ns(ktime_sub(hard, soft));
+		__hrtimer_start_range_ns(period_timer, soft, delta,
+					 HRTIMER_MODE_ABS_PINNED, 0);
+	}
+}
+
+static void start_rt_bandwidth(struct rt_bandwidth *rt_b)
+{
 	if (!rt_bandwidth_enabled() || rt_b->rt_runtime == RUNTIME_INF)
 		return;
 
@@ -205,22 +240,7 @@ static void start_rt_bandwidth(struct rt_bandwidth *rt_b)
 		return;
 
 	raw_spin_lock(&rt_b->rt_runtime_lock);
-	for (;;) {
-		unsigned long delta;
-		ktime_t soft, hard;
-
-		if (hrtimer_active(&rt_b->rt_period_timer))
-			break;
-
-		now = hrtimer_cb_get_time(&rt_b->rt_period_timer);
-		hrtimer_forward(&rt_b->rt_period_timer, now, rt_b->rt_period);
-
-		soft = hrtimer_get_softexpires(&rt_b->rt_period_timer);
-		hard = hrtimer_get_expires(&rt_b->rt_period_timer);
-		delta = ktime_to_ns(ktime_sub(hard, soft));
-		__hrtimer_start_range_ns(&rt_b->rt_period_timer, soft, delta,
-				HRTIMER_MODE_ABS_PINNED, 0);
-	}
+	start_bandwidth_timer(&rt_b->rt_period_timer, rt_b->rt_period);
 	raw_spin_unlock(&rt_b->rt_runtime_lock);
 }
 
@@ -245,6 +265,24 @@ struct cfs_rq;
 
 static LIST_HEAD(task_groups);
 
+struct cfs_bandwidth {
+#ifdef CONFIG_CFS_BANDWIDTH
+	raw_spinlock_t lock;
+	ktime_t period;
+	u64 quota, runtime;
+	s64 hierarchical_quota;
+	u64 runtime_expires;
+
+	int idle, timer_active;
+	struct hrtimer period_timer, slack_timer;
+	struct list_head throttled_cfs_rq;
+
+	/* statistics */
+	int nr_periods, nr_throttled;
+	u64 throttled_time;
+#endif
+};
+
 /* task group related information */
 struct task_group {
 	struct cgroup_subsys_state css;
@@ -255,6 +293,7 @@ struct task_group {
 	/* runqueue "owned" by this group on each cpu */
 	struct cfs_rq **cfs_rq;
 	unsigned long shares;
+	int latency_nice;
 
 	atomic_t load_weight;
 #endif
@@ -276,6 +315,8 @@ struct task_group {
 #ifdef CONFIG_SCHED_AUTOGROUP
 	struct autogroup *autogroup;
 #endif
+
+	struct cfs_bandwidth cfs_bandwidth;
 };
 
 /* task_group_lock serializes the addition/removal of task groups */
@@ -309,7 +350,7 @@ struct task_group root_task_group;
 /* CFS-related fields in a runqueue */
 struct cfs_rq {
 	struct load_weight load;
-	unsigned long nr_running;
+	unsigned long nr_running, h_nr_running;
 
 	u64 exec_clock;
 	u64 min_vruntime;
@@ -329,6 +370,13 @@ struct cfs_rq {
 	 */
 	struct sched_entity *curr, *next, *last, *skip;
 
+	/*
+	 * Per-entity load tracking: the cfs_rq's own runnable and running
+	 * averages, and the sum of the load_avg of the queued entities.
+	 */
+	struct sched_avg avg;
+	unsigned long runnable_load_avg;
+
 #ifdef	CONFIG_SCHED_DEBUG
 	unsigned int nr_spread_over;
 #endif
@@ -375,9 +423,121 @@ struct cfs_rq {
 
 	unsigned long load_contribution;
 #endif
+#ifdef CONFIG_CFS_BANDWIDTH
+	int runtime_enabled;
+	u64 runtime_expires;
+	s64 runtime_remaining;
+
+	u64 throttled_timestamp;
+	int throttled, throttle_count;
+	struct list_head throttled_list;
+#endif
 #endif
 };
 
+#ifdef CONFIG_CFS_BANDWIDTH
+static inline struct cfs_bandwidth *tg_cfs_bandwidth(struct task_group *tg)
+{
+	return &tg->cfs_bandwidth;
+}
+
+/*
+ * default period for cfs group bandwidth.
+ * default: 0.1s, units: nanoseconds
+ */
+static inline u64 default_cfs_period(void)
+{
+	return 100000000ULL;
+}
+
+static int do_sched_cfs_period_timer(struct cfs_bandwidth *cfs_b, int overrun);
+static void do_sched_cfs_slack_timer(struct cfs_bandwidth *cfs_b);
+
+static enum hrtimer_restart sched_cfs_slack_timer(struct hrtimer *timer)
+{
+	struct cfs_bandwidth *cfs_b =
+		container_of(timer, struct cfs_bandwidth, slack_timer);
+	do_sched_cfs_slack_timer(cfs_b);
+
+	return HRTIMER_NORESTART;
+}
+
+static enum hrtimer_restart sched_cfs_period_timer(struct hrtimer *timer)
+{
+	struct cfs_bandwidth *cfs_b =
+		container_of(timer, struct cfs_bandwidth, period_timer);
+	ktime_t now;
+	int overrun;
+	int idle = 0;
+
+	for (;;) {
+		now = hrtimer_cb_get_time(timer);
+		overrun = hrtimer_forward(timer, now, cfs_b->period);
+
+		if (!overrun)
+			break;
+
+		idle = do_sched_cfs_period_timer(cfs_b, overrun);
+	}
+
+	return idle ? HRTIMER_NORESTART : HRTIMER_RESTART;
+}
+
+static void init_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
+{
+	raw_spin_lock_init(&cfs_b->lock);
+	cfs_b->runtime = 0;
+	cfs_b->quota = RUNTIME_INF;
+	cfs_b->period = ns_to_ktime(default_cfs_period());
+
+	INIT_LIST_HEAD(&cfs_b->throttled_cfs_rq);
+	hrtimer_init(&cfs_b->period_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	cfs_b->period_timer.function = sched_cfs_period_timer;
+	hrtimer_init(&cfs_b->slack_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	cfs_b->slack_timer.function = sched_cfs_slack_timer;
+}
+
+static void init_cfs_rq_runtime(struct cfs_rq *cfs_rq)
+{
+	cfs_rq->runtime_enabled = 0;
+	INIT_LIST_HEAD(&cfs_rq->throttled_list);
+}
+
+/* requires cfs_b->lock, may release to reprogram timer */
+static void __start_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
+{
+	/*
+	 * The timer may be active because we're trying to set a new bandwidth
+	 * period or because we're racing with the tear-down path
+	 * (timer_active==0 becomes visible before the hrtimer call-back
+	 * terminates).  In either case we ensure that it's re-programmed
+	 */
+	while (unlikely(hrtimer_active(&cfs_b->period_timer))) {
+		raw_spin_unlock(&cfs_b->lock);
+		/* ensure cfs_b->lock is available while we wait */
+		hrtimer_cancel(&cfs_b->period_timer);
+
+		raw_spin_lock(&cfs_b->lock);
+		/* if someone else restarted the timer then we're done */
+		if (cfs_b->timer_active)
+			return;
+	}
+
+	cfs_b->timer_active = 1;
+	start_bandwidth_timer(&cfs_b->period_timer, cfs_b->period);
+}
+
+static void destroy_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
+{
+	hrtimer_cancel(&cfs_b->period_timer);
+	hrtimer_cancel(&cfs_b->slack_timer);
+}
+#elif defined(CONFIG_FAIR_GROUP_SCHED)
+static inline void init_cfs_bandwidth(struct cfs_bandwidth *cfs_b) {}
+static inline void init_cfs_rq_runtime(struct cfs_rq *cfs_rq) {}
+static inline void destroy_cfs_bandwidth(struct cfs_bandwidth *cfs_b) {}
+#endif /* CONFIG_CFS_BANDWIDTH */
+
 /* Real-Time classes' related field in a runqueue: */
 struct rt_rq {
 	struct rt_prio_array active;
@@ -411,6 +571,23 @@ struct rt_rq {
 #endif
 };
 
+/* SCHED_DEADLINE related fields in a runqueue: */
+struct dl_rq {
+	/* queued tasks, by deadline, the running one included */
+	struct rb_root rb_root;
+	struct rb_node *rb_leftmost;
+
+	unsigned long dl_nr_running;
+	/* queued tasks that are throttled, thus not in rb_root */
+	struct list_head throttled_list;
+#ifdef CONFIG_SMP
+	/* deadline of the leftmost task, read locklessly by other cpus */
+	u64 earliest_dl;
+	unsigned long dl_nr_migratory;
+	int overloaded;
+#endif
+};
+
 #ifdef CONFIG_SMP
 
 /*
@@ -434,6 +611,13 @@ struct root_domain {
 	cpumask_var_t rto_mask;
 	atomic_t rto_count;
 	struct cpupri cpupri;
+
+	/*
+	 * The cpus with a queued SCHED_DEADLINE task that could run
+	 * elsewhere, while another one runs.
+	 */
+	cpumask_var_t dlo_mask;
+	atomic_t dlo_count;
 };
 
 /*
@@ -444,6 +628,24 @@ static struct root_domain def_root_domain;
 
 #endif /* CONFIG_SMP */
 
+#ifdef CONFIG_SCHEDSTATS
+/*
+ * Per-cpu histograms of the wakeup to run latency of the rt and the fair
+ * class, and of nr_running sampled at the tick.  Latency bucket 0 counts
+ * latencies below 1 << SCHED_LAT_SHIFT ns, bucket n those below
+ * 1 << (n + SCHED_LAT_SHIFT) ns, the last bucket everything longer.
+ */
+enum {
+	SCHED_LAT_RT,
+	SCHED_LAT_FAIR,
+	SCHED_LAT_CLASSES
+};
+
+#define SCHED_LAT_SHIFT			10
+#define SCHED_LAT_BUCKETS		24
+#define SCHED_NR_RUNNING_BUCKETS	17
+#endif
+
 /*
  * This is the main, per-CPU runqueue data structure.
  *
@@ -476,6 +678,7 @@ struct rq {
 
 	struct cfs_rq cfs;
 	struct rt_rq rt;
+	struct dl_rq dl;
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* list of leaf cfs_rq on this cpu: */
@@ -559,6 +762,10 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int ttwu_count;
 	unsigned int ttwu_local;
+
+	/* latency and runqueue depth histograms */
+	unsigned int lat_hist[SCHED_LAT_CLASSES][SCHED_LAT_BUCKETS];
+	unsigned int nr_running_hist[SCHED_NR_RUNNING_BUCKETS];
 #endif
 
 #ifdef CONFIG_SMP
@@ -568,6 +775,28 @@ struct rq {
 
 static DEFINE_PER_CPU_SHARED_ALIGNED(struct rq, runqueues);
 
+#ifdef CONFIG_SMP
+/*
+ * The last level cache of each cpu, see update_top_cache_domain(), and
+ * for each cache, on its first cpu, the cpu of it that went idle last.
+ * Wakeups try that cpu before they scan the cache domain for an idle one.
+ */
+static DEFINE_PER_CPU(int, sd_llc_id);
+static DEFINE_PER_CPU(int, sd_llc_size);
+static DEFINE_PER_CPU_SHARED_ALIGNED(int, llc_idle_hint);
+
+static inline void set_llc_idle_hint(int cpu)
+{
+	int *hint = &per_cpu(llc_idle_hint, per_cpu(sd_llc_id, cpu));
+
+	if (*hint != cpu)
+		*hint = cpu;
+}
+#else
+static inline void set_llc_idle_hint(int cpu)
+{
+}
+#endif
 
 static void check_preempt_curr(struct rq *rq, struct task_struct *p, int flags);
 
@@ -835,6 +1064,39 @@ static inline u64 global_rt_runtime(void)
 	return (u64)sysctl_sched_rt_runtime * NSEC_PER_USEC;
 }
 
+static unsigned long to_ratio(u64 period, u64 runtime)
+{
+	if (runtime == RUNTIME_INF)
+		return 1ULL << 20;
+
+	return div64_u64(runtime << 20, period);
+}
+
+/*
+ * The bandwidth, dl_runtime / dl_period, of all the SCHED_DEADLINE tasks
+ * together.  See sched_dl_overflow().
+ */
+struct dl_bandwidth {
+	raw_spinlock_t		lock;
+	u64			total_bw;
+};
+
+static struct dl_bandwidth def_dl_bandwidth;
+
+/*
+ * What the rt sysctls allow @cpus cpus to give to reservations.  Active
+ * cpus are counted, which a cpu stops being before it goes offline.
+ */
+static inline u64 __dl_limit(unsigned int cpus)
+{
+	return (u64)to_ratio(global_rt_period(), global_rt_runtime()) * cpus;
+}
+
+static inline u64 global_dl_limit(void)
+{
+	return __dl_limit(num_active_cpus());
+}
+
 #ifndef prepare_arch_switch
 # define prepare_arch_switch(next)	do { } while (0)
 #endif
@@ -1461,24 +1723,27 @@ static inline void dec_cpu_load(struct rq *rq, unsigned long load)
 	update_load_sub(&rq->load, load);
 }
 
-#if (defined(CONFIG_SMP) && defined(CONFIG_FAIR_GROUP_SCHED)) || defined(CONFIG_RT_GROUP_SCHED)
+#if (defined(CONFIG_SMP) && defined(CONFIG_FAIR_GROUP_SCHED)) || \
+	defined(CONFIG_RT_GROUP_SCHED) || defined(CONFIG_CFS_BANDWIDTH)
 typedef int (*tg_visitor)(struct task_group *, void *);
 
 /*
- * Iterate the full tree, calling @down when first entering a node and @up when
- * leaving it for the final time.
+ * Iterate the subtree below @from, calling @down when first entering a
+ * node and @up when leaving it for the final time.
+ *
+ * Caller must hold rcu_lock or sufficient equivalent.
  */
-static int walk_tg_tree(tg_visitor down, tg_visitor up, void *data)
+static int walk_tg_tree_from(struct task_group *from,
+			     tg_visitor down, tg_visitor up, void *data)
 {
 	struct task_group *parent, *child;
 	int ret;
 
-	rcu_read_lock();
-	parent = &root_task_group;
+	parent = from;
 down:
 	ret = (*down)(parent, data);
 	if (ret)
-		goto out_unlock;
+		goto out;
 	list_for_each_entry_rcu(child, &parent->children, siblings) {
 		parent = child;
 		goto down;
@@ -1487,14 +1752,27 @@ up:
 		continue;
 	}
 	ret = (*up)(parent, data);
-	if (ret)
-		goto out_unlock;
+	if (ret || parent == from)
+		goto out;
 
 	child = parent;
 	parent = parent->parent;
 	if (parent)
 		goto up;
-out_unlock:
+out:
+	return ret;
+}
+
+/*
+ * Iterate the full tree, calling @down when first entering a node and @up when
+ * leaving it for the final time.
+ */
+static int walk_tg_tree(tg_visitor down, tg_visitor up, void *data)
+{
+	int ret;
+
+	rcu_read_lock();
+	ret = walk_tg_tree_from(&root_task_group, down, up, data);
 	rcu_read_unlock();
 
 	return ret;
@@ -1506,11 +1784,39 @@ static int tg_nop(struct task_group *tg, void *data)
 }
 #endif
 
+/*
+ * The load of a runqueue as the load balancer sees it: with LB_LOAD_AVG
+ * the fair tasks count with their decayed runnable load instead of
+ * their full weight, so a task that mostly sleeps weighs little.
+ */
+static inline unsigned long rq_runnable_load(struct rq *rq)
+{
+	if (sched_feat(LB_LOAD_AVG))
+		return rq->load.weight - rq->cfs.load.weight +
+			rq->cfs.runnable_load_avg;
+	return rq->load.weight;
+}
+
+/* The same for a fair entity and a cfs_rq, in the same units */
+static inline unsigned long se_runnable_load(struct sched_entity *se)
+{
+	if (sched_feat(LB_LOAD_AVG))
+		return se->avg.load_avg;
+	return se->load.weight;
+}
+
+static inline unsigned long cfs_rq_runnable_load(struct cfs_rq *cfs_rq)
+{
+	if (sched_feat(LB_LOAD_AVG))
+		return cfs_rq->runnable_load_avg;
+	return cfs_rq->load.weight;
+}
+
 #ifdef CONFIG_SMP
 /* Used instead of source_load when we know the type == 0 */
 static unsigned long weighted_cpuload(const int cpu)
 {
-	return cpu_rq(cpu)->load.weight;
+	return rq_runnable_load(cpu_rq(cpu));
 }
 
 /*
@@ -1559,7 +1865,7 @@ static unsigned long cpu_avg_load_per_task(int cpu)
 	unsigned long nr_running = ACCESS_ONCE(rq->nr_running);
 
 	if (nr_running)
-		rq->avg_load_per_task = rq->load.weight / nr_running;
+		rq->avg_load_per_task = rq_runnable_load(rq) / nr_running;
 	else
 		rq->avg_load_per_task = 0;
 
@@ -1579,11 +1885,11 @@ static int tg_load_down(struct task_group *tg, void *data)
 	long cpu = (long)data;
 
 	if (!tg->parent) {
-		load = cpu_rq(cpu)->load.weight;
+		load = rq_runnable_load(cpu_rq(cpu));
 	} else {
 		load = tg->parent->cfs_rq[cpu]->h_load;
-		load *= tg->se[cpu]->load.weight;
-		load /= tg->parent->cfs_rq[cpu]->load.weight + 1;
+		load *= se_runnable_load(tg->se[cpu]);
+		load /= cfs_rq_runnable_load(tg->parent->cfs_rq[cpu]) + 1;
 	}
 
 	tg->cfs_rq[cpu]->h_load = load;
@@ -1770,6 +2076,7 @@ static inline void __set_task_cpu(struct task_struct *p, unsigned int cpu)
 }
 
 static const struct sched_class rt_sched_class;
+static const struct sched_class dl_sched_class;
 
 #define sched_class_highest (&stop_sched_class)
 #define for_each_class(class) \
@@ -1828,7 +2135,6 @@ static void activate_task(struct rq *rq, struct task_struct *p, int flags)
 		rq->nr_uninterruptible--;
 
 	enqueue_task(rq, p, flags);
-	inc_nr_running(rq);
 }
 
 /*
@@ -1840,7 +2146,6 @@ static void deactivate_task(struct rq *rq, struct task_struct *p, int flags)
 		rq->nr_uninterruptible++;
 
 	dequeue_task(rq, p, flags);
-	dec_nr_running(rq);
 }
 
 #ifdef CONFIG_IRQ_TIME_ACCOUNTING
@@ -2027,6 +2332,7 @@ static void update_rq_clock_task(struct rq *rq, s64 delta)
 #include "sched_idletask.c"
 #include "sched_fair.c"
 #include "sched_rt.c"
+#include "sched_dl.c"
 #include "sched_autogroup.c"
 #include "sched_stoptask.c"
 #ifdef CONFIG_SCHED_DEBUG
@@ -2082,7 +2388,9 @@ static inline int normal_prio(struct task_struct *p)
 {
 	int prio;
 
-	if (task_has_rt_policy(p))
+	if (task_has_dl_policy(p))
+		prio = MAX_DL_PRIO-1;
+	else if (task_has_rt_policy(p))
 		prio = MAX_RT_PRIO-1 - p->rt_priority;
 	else
 		prio = __normal_prio(p);
@@ -2505,6 +2813,7 @@ static void ttwu_activate(struct rq *rq, struct task_struct *p, int en_flags)
 {
 	activate_task(rq, p, en_flags);
 	p->on_rq = 1;
+	schedstat_set(p->se.statistics.wakeup_start, rq->clock);
 
 	/* if a worker is waking up, notify workqueue */
 	if (p->flags & PF_WQ_WORKER)
@@ -2839,12 +3148,31 @@ static void __sched_fork(struct task_struct *p)
 	p->se.vruntime			= 0;
 	INIT_LIST_HEAD(&p->se.group_node);
 
+#ifdef CONFIG_SMP
+	p->last_wakee			= NULL;
+	p->wakee_flips			= 0;
+	p->wakee_flip_decay_ts		= jiffies;
+#endif
+
+	/*
+	 * A new task starts out with one period of being runnable behind
+	 * it, that it loses quickly if it does not keep it up.
+	 */
+	memset(&p->se.avg, 0, sizeof(p->se.avg));
+	p->se.avg.runnable_sum		= 1024;
+	p->se.avg.period_sum		= 1024;
+
 #ifdef CONFIG_SCHEDSTATS
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
 #endif
 
 	INIT_LIST_HEAD(&p->rt.run_list);
 
+	RB_CLEAR_NODE(&p->dl.rb_node);
+	INIT_LIST_HEAD(&p->dl.throttled_node);
+	p->dl.dl_throttled = 0;
+	init_dl_task_timer(&p->dl);
+
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	INIT_HLIST_HEAD(&p->preempt_notifiers);
 #endif
@@ -2881,6 +3209,9 @@ void sched_fork(struct task_struct *p)
 			set_load_weight(p);
 		}
 
+		if (p->se.latency_nice < 0)
+			p->se.latency_nice = 0;
+
 		/*
 		 * We don't need the reset flag anymore after the fork. It has
 		 * fulfilled its duty:
@@ -2893,6 +3224,15 @@ void sched_fork(struct task_struct *p)
 	 */
 	p->prio = current->normal_prio;
 
+	/*
+	 * Reservations are not inherited: the child of a SCHED_DEADLINE
+	 * task has to ask for bandwidth of its own.
+	 */
+	if (unlikely(task_has_dl_policy(p))) {
+		p->policy = SCHED_NORMAL;
+		p->prio = p->normal_prio = p->static_prio;
+	}
+
 	if (!rt_prio(p->prio))
 		p->sched_class = &fair_sched_class;
 
@@ -3038,6 +3378,7 @@ prepare_task_switch(struct rq *rq, struct task_struct *prev,
 		    struct task_struct *next)
 {
 	sched_info_switch(prev, next);
+	sched_lat_arrive(rq, next);
 	perf_event_task_sched_out(prev, next);
 	fire_sched_out_preempt_notifiers(prev, next);
 	prepare_lock_switch(rq, next);
@@ -3099,6 +3440,8 @@ static void finish_task_switch(struct rq *rq, struct task_struct *prev)
 		 * task and put them back on the free list.
 		 */
 		kprobe_flush_task(prev);
+		if (prev->sched_class->task_dead)
+			prev->sched_class->task_dead(prev);
 		put_task_struct(prev);
 	}
 }
@@ -3612,7 +3955,7 @@ decay_load_missed(unsigned long load, unsigned long missed_updates, int idx)
  */
 static void update_cpu_load(struct rq *this_rq)
 {
-	unsigned long this_load = this_rq->load.weight;
+	unsigned long this_load = rq_runnable_load(this_rq);
 	unsigned long curr_jiffies = jiffies;
 	unsigned long pending_updates;
 	int i, scale;
@@ -4104,6 +4447,7 @@ void scheduler_tick(void)
 	update_rq_clock(rq);
 	update_cpu_load_active(rq);
 	curr->sched_class->task_tick(rq, curr, 0);
+	sched_nr_running_sample(rq);
 	raw_spin_unlock(&rq->lock);
 
 	perf_event_task_tick();
@@ -4232,7 +4576,7 @@ pick_next_task(struct rq *rq)
 	 * Optimization: we know that if all tasks are in
 	 * the fair class we can call that function directly:
 	 */
-	if (likely(rq->nr_running == rq->cfs.nr_running)) {
+	if (likely(rq->nr_running == rq->cfs.h_nr_running)) {
 		p = fair_sched_class.pick_next_task(rq);
 		if (likely(p))
 			return p;
@@ -4861,7 +5205,7 @@ void rt_mutex_setprio(struct task_struct *p, int prio)
 	struct rq *rq;
 	const struct sched_class *prev_class;
 
-	BUG_ON(prio < 0 || prio > MAX_PRIO);
+	BUG_ON(prio < MAX_DL_PRIO-1 || prio > MAX_PRIO);
 
 	rq = __task_rq_lock(p);
 
@@ -4875,7 +5219,9 @@ void rt_mutex_setprio(struct task_struct *p, int prio)
 	if (running)
 		p->sched_class->put_prev_task(rq, p);
 
-	if (rt_prio(prio))
+	if (dl_prio(prio))
+		p->sched_class = &dl_sched_class;
+	else if (rt_prio(prio))
 		p->sched_class = &rt_sched_class;
 	else
 		p->sched_class = &fair_sched_class;
@@ -5046,16 +5392,89 @@ static struct task_struct *find_process_by_pid(pid_t pid)
 	return pid ? find_task_by_vpid(pid) : current;
 }
 
+/*
+ * A reservation has to give its task some runtime, at least 1us, so that
+ * it is not all eaten by the switches, and fit in its deadline, the
+ * deadline in its period.  The runtime is kept below 2^44ns, for
+ * to_ratio().
+ */
+static bool __checkparam_dl(const struct sched_dl_param *dl)
+{
+	u64 period = dl->sched_period ?: dl->sched_deadline;
+
+	return dl->sched_runtime >= (1ULL << 10) &&
+	       dl->sched_runtime < (1ULL << 44) &&
+	       dl->sched_deadline >= dl->sched_runtime &&
+	       period >= dl->sched_deadline &&
+	       (s64)period > 0;
+}
+
+static void
+__setparam_dl(struct task_struct *p, const struct sched_dl_param *dl)
+{
+	struct sched_dl_entity *dl_se = &p->dl;
+
+	dl_se->dl_runtime = dl->sched_runtime;
+	dl_se->dl_deadline = dl->sched_deadline;
+	dl_se->dl_period = dl->sched_period ?: dl->sched_deadline;
+	dl_se->dl_bw = to_ratio(dl_se->dl_period, dl_se->dl_runtime);
+	/* the new parameters take effect at the next enqueue */
+	dl_se->dl_new = 1;
+	dl_se->dl_throttled = 0;
+	dl_se->dl_yielded = 0;
+}
+
+/*
+ * Admission control for SCHED_DEADLINE: account the bandwidth of @p when
+ * it gets a reservation or a different one, give it back when @p leaves
+ * the class.  The total must stay within global_dl_limit(): EDF cannot
+ * meet the deadlines of tasks that need more cpu than there is, so a
+ * reservation that would overcommit the cpus is refused rather than
+ * letting all of them miss.  Called with the rq lock of @p held.
+ */
+static int sched_dl_overflow(struct task_struct *p, int policy,
+			     const struct sched_dl_param *dl)
+{
+	u64 old_bw = task_has_dl_policy(p) ? p->dl.dl_bw : 0;
+	u64 new_bw = 0;
+	int err = 0;
+
+	if (dl_policy(policy)) {
+		/* a dying task would never give it back */
+		if (p->flags & PF_EXITING)
+			return -ESRCH;
+		new_bw = to_ratio(dl->sched_period ?: dl->sched_deadline,
+				  dl->sched_runtime);
+	}
+	if (new_bw == old_bw)
+		return 0;
+
+	raw_spin_lock(&def_dl_bandwidth.lock);
+	if (new_bw > old_bw &&
+	    def_dl_bandwidth.total_bw - old_bw + new_bw > global_dl_limit())
+		err = -EBUSY;
+	else
+		def_dl_bandwidth.total_bw += new_bw - old_bw;
+	raw_spin_unlock(&def_dl_bandwidth.lock);
+
+	return err;
+}
+
 /* Actually do priority change: must hold rq lock. */
 static void
-__setscheduler(struct rq *rq, struct task_struct *p, int policy, int prio)
+__setscheduler(struct rq *rq, struct task_struct *p, int policy, int prio,
+	       const struct sched_dl_param *dl)
 {
 	p->policy = policy;
 	p->rt_priority = prio;
+	if (dl_policy(policy))
+		__setparam_dl(p, dl);
 	p->normal_prio = normal_prio(p);
 	/* we are holding p->pi_lock already */
 	p->prio = rt_mutex_getprio(p);
-	if (rt_prio(p->prio))
+	if (dl_prio(p->prio))
+		p->sched_class = &dl_sched_class;
+	else if (rt_prio(p->prio))
 		p->sched_class = &rt_sched_class;
 	else
 		p->sched_class = &fair_sched_class;
@@ -5082,7 +5501,8 @@ static bool check_same_owner(struct task_struct *p)
 }
 
 static int __sched_setscheduler(struct task_struct *p, int policy,
-				const struct sched_param *param, bool user)
+				const struct sched_param *param, bool user,
+				const struct sched_dl_param *dl)
 {
 	int retval, oldprio, oldpolicy = -1, on_rq, running;
 	unsigned long flags;
@@ -5103,7 +5523,12 @@ recheck:
 
 		if (policy != SCHED_FIFO && policy != SCHED_RR &&
 				policy != SCHED_NORMAL && policy != SCHED_BATCH &&
-				policy != SCHED_IDLE)
+				policy != SCHED_IDLE && policy != SCHED_DEADLINE)
+			return -EINVAL;
+
+		/* a reservation only comes with its parameters */
+		if (dl_policy(policy) != !!dl ||
+		    (dl && !__checkparam_dl(dl)))
 			return -EINVAL;
 	}
 
@@ -5123,6 +5548,10 @@ recheck:
 	 * Allow unprivileged RT tasks to decrease priority:
 	 */
 	if (user && !capable(CAP_SYS_NICE)) {
+		/* a reservation takes cpu from everybody else */
+		if (dl_policy(policy))
+			return -EPERM;
+
 		if (rt_policy(policy)) {
 			unsigned long rlim_rtprio =
 					task_rlimit(p, RLIMIT_RTPRIO);
@@ -5181,7 +5610,7 @@ recheck:
 	/*
 	 * If not changing anything there's no need to proceed further:
 	 */
-	if (unlikely(policy == p->policy && (!rt_policy(policy) ||
+	if (unlikely(policy == p->policy && !dl && (!rt_policy(policy) ||
 			param->sched_priority == p->rt_priority))) {
 
 		__task_rq_unlock(rq);
@@ -5210,6 +5639,15 @@ recheck:
 		task_rq_unlock(rq, p, &flags);
 		goto recheck;
 	}
+
+	if ((dl_policy(policy) || task_has_dl_policy(p))) {
+		retval = sched_dl_overflow(p, policy, dl);
+		if (retval) {
+			task_rq_unlock(rq, p, &flags);
+			return retval;
+		}
+	}
+
 	on_rq = p->on_rq;
 	running = task_current(rq, p);
 	if (on_rq)
@@ -5221,7 +5659,7 @@ recheck:
 
 	oldprio = p->prio;
 	prev_class = p->sched_class;
-	__setscheduler(rq, p, policy, param->sched_priority);
+	__setscheduler(rq, p, policy, param->sched_priority, dl);
 
 	if (running)
 		p->sched_class->set_curr_task(rq);
@@ -5247,7 +5685,7 @@ recheck:
 int sched_setscheduler(struct task_struct *p, int policy,
 		       const struct sched_param *param)
 {
-	return __sched_setscheduler(p, policy, param, true);
+	return __sched_setscheduler(p, policy, param, true, NULL);
 }
 EXPORT_SYMBOL_GPL(sched_setscheduler);
 
@@ -5265,7 +5703,7 @@ EXPORT_SYMBOL_GPL(sched_setscheduler);
 int sched_setscheduler_nocheck(struct task_struct *p, int policy,
 			       const struct sched_param *param)
 {
-	return __sched_setscheduler(p, policy, param, false);
+	return __sched_setscheduler(p, policy, param, false, NULL);
 }
 
 static int
@@ -5380,46 +5818,191 @@ out_unlock:
 	return retval;
 }
 
-long sched_setaffinity(pid_t pid, const struct cpumask *in_mask)
+/**
+ * sched_set_latency_nice - set the latency nice value of a task
+ * @pid: the pid in question, 0 for the current task
+ * @latency_nice: the new value, MIN_LATENCY_NICE to MAX_LATENCY_NICE
+ *
+ * Lowering the value takes the same RLIMIT_NICE or CAP_SYS_NICE that
+ * lowering the nice value does.
+ */
+int sched_set_latency_nice(pid_t pid, int latency_nice)
 {
-	cpumask_var_t cpus_allowed, new_mask;
 	struct task_struct *p;
+	unsigned long flags;
+	struct rq *rq;
 	int retval;
 
-	get_online_cpus();
-	rcu_read_lock();
+	if (pid < 0 || latency_nice < MIN_LATENCY_NICE ||
+	    latency_nice > MAX_LATENCY_NICE)
+		return -EINVAL;
 
+	rcu_read_lock();
 	p = find_process_by_pid(pid);
 	if (!p) {
 		rcu_read_unlock();
-		put_online_cpus();
 		return -ESRCH;
 	}
-
-	/* Prevent p going away */
 	get_task_struct(p);
 	rcu_read_unlock();
 
-	if (!alloc_cpumask_var(&cpus_allowed, GFP_KERNEL)) {
-		retval = -ENOMEM;
-		goto out_put_task;
-	}
-	if (!alloc_cpumask_var(&new_mask, GFP_KERNEL)) {
-		retval = -ENOMEM;
-		goto out_free_cpus_allowed;
-	}
 	retval = -EPERM;
-	if (!check_same_owner(p) && !task_ns_capable(p, CAP_SYS_NICE))
-		goto out_unlock;
-
+	if (!check_same_owner(p) && !capable(CAP_SYS_NICE))
+		goto out;
+	if (latency_nice < p->se.latency_nice && !can_nice(p, latency_nice))
+		goto out;
 	retval = security_task_setscheduler(p);
 	if (retval)
-		goto out_unlock;
-
-	cpuset_cpus_allowed(p, cpus_allowed);
-	cpumask_and(new_mask, in_mask, cpus_allowed);
-again:
-	retval = set_cpus_allowed_ptr(p, new_mask);
+		goto out;
+
+	rq = task_rq_lock(p, &flags);
+	p->se.latency_nice = latency_nice;
+	task_rq_unlock(rq, p, &flags);
+out:
+	put_task_struct(p);
+	return retval;
+}
+
+/**
+ * sched_get_latency_nice - get the latency nice value of a task
+ * @pid: the pid in question, 0 for the current task
+ * @latency_nice: where to store the value
+ */
+int sched_get_latency_nice(pid_t pid, int *latency_nice)
+{
+	struct task_struct *p;
+	int retval;
+
+	if (pid < 0)
+		return -EINVAL;
+
+	rcu_read_lock();
+	p = find_process_by_pid(pid);
+	retval = -ESRCH;
+	if (!p)
+		goto out_unlock;
+
+	retval = security_task_getscheduler(p);
+	if (!retval)
+		*latency_nice = p->se.latency_nice;
+
+out_unlock:
+	rcu_read_unlock();
+	return retval;
+}
+
+/**
+ * sched_set_deadline - make a task SCHED_DEADLINE
+ * @pid: the pid in question, 0 for the current task
+ * @param: runtime, deadline and period of the reservation, in ns
+ *
+ * Needs CAP_SYS_NICE.  Fails with -EBUSY when the reservation does not
+ * fit in what is left of the bandwidth, see sched_dl_overflow().
+ */
+int sched_set_deadline(pid_t pid, const struct sched_dl_param *param)
+{
+	struct sched_param lparam = { .sched_priority = 0 };
+	struct task_struct *p;
+	int retval;
+
+	if (pid < 0)
+		return -EINVAL;
+
+	rcu_read_lock();
+	p = find_process_by_pid(pid);
+	if (!p) {
+		rcu_read_unlock();
+		return -ESRCH;
+	}
+	get_task_struct(p);
+	rcu_read_unlock();
+
+	retval = __sched_setscheduler(p, SCHED_DEADLINE, &lparam, true, param);
+	put_task_struct(p);
+	return retval;
+}
+
+/**
+ * sched_get_deadline - get the reservation of a SCHED_DEADLINE task
+ * @pid: the pid in question, 0 for the current task
+ * @param: where to store runtime, deadline and period
+ *
+ * Fails with -EINVAL if the task is not SCHED_DEADLINE.
+ */
+int sched_get_deadline(pid_t pid, struct sched_dl_param *param)
+{
+	struct task_struct *p;
+	unsigned long flags;
+	struct rq *rq;
+	int retval;
+
+	if (pid < 0)
+		return -EINVAL;
+
+	rcu_read_lock();
+	p = find_process_by_pid(pid);
+	retval = -ESRCH;
+	if (!p)
+		goto out_unlock;
+
+	retval = security_task_getscheduler(p);
+	if (retval)
+		goto out_unlock;
+
+	rq = task_rq_lock(p, &flags);
+	if (task_has_dl_policy(p)) {
+		param->sched_runtime = p->dl.dl_runtime;
+		param->sched_deadline = p->dl.dl_deadline;
+		param->sched_period = p->dl.dl_period;
+	} else
+		retval = -EINVAL;
+	task_rq_unlock(rq, p, &flags);
+
+out_unlock:
+	rcu_read_unlock();
+	return retval;
+}
+
+long sched_setaffinity(pid_t pid, const struct cpumask *in_mask)
+{
+	cpumask_var_t cpus_allowed, new_mask;
+	struct task_struct *p;
+	int retval;
+
+	get_online_cpus();
+	rcu_read_lock();
+
+	p = find_process_by_pid(pid);
+	if (!p) {
+		rcu_read_unlock();
+		put_online_cpus();
+		return -ESRCH;
+	}
+
+	/* Prevent p going away */
+	get_task_struct(p);
+	rcu_read_unlock();
+
+	if (!alloc_cpumask_var(&cpus_allowed, GFP_KERNEL)) {
+		retval = -ENOMEM;
+		goto out_put_task;
+	}
+	if (!alloc_cpumask_var(&new_mask, GFP_KERNEL)) {
+		retval = -ENOMEM;
+		goto out_free_cpus_allowed;
+	}
+	retval = -EPERM;
+	if (!check_same_owner(p) && !task_ns_capable(p, CAP_SYS_NICE))
+		goto out_unlock;
+
+	retval = security_task_setscheduler(p);
+	if (retval)
+		goto out_unlock;
+
+	cpuset_cpus_allowed(p, cpus_allowed);
+	cpumask_and(new_mask, in_mask, cpus_allowed);
+again:
+	retval = set_cpus_allowed_ptr(p, new_mask);
 
 	if (!retval) {
 		cpuset_cpus_allowed(p, cpus_allowed);
@@ -5758,6 +6341,7 @@ SYSCALL_DEFINE1(sched_get_priority_max, int, policy)
 	case SCHED_NORMAL:
 	case SCHED_BATCH:
 	case SCHED_IDLE:
+	case SCHED_DEADLINE:
 		ret = 0;
 		break;
 	}
@@ -5783,6 +6367,7 @@ SYSCALL_DEFINE1(sched_get_priority_min, int, policy)
 	case SCHED_NORMAL:
 	case SCHED_BATCH:
 	case SCHED_IDLE:
+	case SCHED_DEADLINE:
 		ret = 0;
 	}
 	return ret;
@@ -6222,6 +6807,10 @@ static void migrate_tasks(unsigned int dead_cpu)
 	 */
 	rq->stop = NULL;
 
+	/* Throttled tasks are not queued, let them go with the rest */
+	unthrottle_offline_cfs_rqs(rq);
+	unthrottle_offline_dl_tasks(rq);
+
 	for ( ; ; ) {
 		/*
 		 * There's this thread running, bail when that's the only
@@ -6519,13 +7108,27 @@ static int __cpuinit sched_cpu_active(struct notifier_block *nfb,
 	}
 }
 
+/*
+ * The reservations were admitted against the active cpus, so a cpu may
+ * only go down if they still fit without it.  Suspend takes the cpus
+ * down regardless, the tasks are frozen then.
+ */
 static int __cpuinit sched_cpu_inactive(struct notifier_block *nfb,
 					unsigned long action, void *hcpu)
 {
+	unsigned long flags;
+	int err = 0;
+
 	switch (action & ~CPU_TASKS_FROZEN) {
 	case CPU_DOWN_PREPARE:
-		set_cpu_active((long)hcpu, false);
-		return NOTIFY_OK;
+		raw_spin_lock_irqsave(&def_dl_bandwidth.lock, flags);
+		if (!(action & CPU_TASKS_FROZEN) &&
+		    def_dl_bandwidth.total_bw > __dl_limit(num_active_cpus() - 1))
+			err = -EBUSY;
+		else
+			set_cpu_active((long)hcpu, false);
+		raw_spin_unlock_irqrestore(&def_dl_bandwidth.lock, flags);
+		return notifier_from_errno(err);
 	default:
 		return NOTIFY_DONE;
 	}
@@ -6731,6 +7334,7 @@ static void free_rootdomain(struct rcu_head *rcu)
 	struct root_domain *rd = container_of(rcu, struct root_domain, rcu);
 
 	cpupri_cleanup(&rd->cpupri);
+	free_cpumask_var(rd->dlo_mask);
 	free_cpumask_var(rd->rto_mask);
 	free_cpumask_var(rd->online);
 	free_cpumask_var(rd->span);
@@ -6784,11 +7388,15 @@ static int init_rootdomain(struct root_domain *rd)
 		goto free_span;
 	if (!alloc_cpumask_var(&rd->rto_mask, GFP_KERNEL))
 		goto free_online;
+	if (!alloc_cpumask_var(&rd->dlo_mask, GFP_KERNEL))
+		goto free_rto_mask;
 
 	if (cpupri_init(&rd->cpupri) != 0)
-		goto free_rto_mask;
+		goto free_dlo_mask;
 	return 0;
 
+free_dlo_mask:
+	free_cpumask_var(rd->dlo_mask);
 free_rto_mask:
 	free_cpumask_var(rd->rto_mask);
 free_online:
@@ -6869,6 +7477,30 @@ static void destroy_sched_domains(struct sched_domain *sd, int cpu)
 		destroy_sched_domain(sd, cpu);
 }
 
+/*
+ * The last level cache of a cpu is its largest domain of cpus that share
+ * package resources, identified by the first cpu in it.
+ */
+static void update_top_cache_domain(int cpu)
+{
+	struct sched_domain *sd, *llc = NULL;
+	int id = cpu, size = 1;
+
+	for_each_domain(cpu, sd) {
+		if (!(sd->flags & SD_SHARE_PKG_RESOURCES))
+			break;
+		llc = sd;
+	}
+	if (llc) {
+		id = cpumask_first(sched_domain_span(llc));
+		size = llc->span_weight;
+	}
+
+	per_cpu(sd_llc_id, cpu) = id;
+	per_cpu(sd_llc_size, cpu) = size;
+	per_cpu(llc_idle_hint, cpu) = -1;
+}
+
 /*
  * Attach the domain 'sd' to 'cpu' as its base domain. Callers must
  * hold the hotplug lock.
@@ -6908,6 +7540,8 @@ cpu_attach_domain(struct sched_domain *sd, struct root_domain *rd, int cpu)
 	tmp = rq->sd;
 	rcu_assign_pointer(rq->sd, sd);
 	destroy_sched_domains(tmp, cpu);
+
+	update_top_cache_domain(cpu);
 }
 
 /* cpus with isolated domains */
@@ -7997,6 +8631,19 @@ static void init_rt_rq(struct rt_rq *rt_rq, struct rq *rq)
 #endif
 }
 
+static void init_dl_rq(struct dl_rq *dl_rq, struct rq *rq)
+{
+	dl_rq->rb_root = RB_ROOT;
+	dl_rq->rb_leftmost = NULL;
+	dl_rq->dl_nr_running = 0;
+	INIT_LIST_HEAD(&dl_rq->throttled_list);
+#ifdef CONFIG_SMP
+	dl_rq->earliest_dl = 0;
+	dl_rq->dl_nr_migratory = 0;
+	dl_rq->overloaded = 0;
+#endif
+}
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 static void init_tg_cfs_entry(struct task_group *tg, struct cfs_rq *cfs_rq,
 				struct sched_entity *se, int cpu,
@@ -8006,6 +8653,7 @@ static void init_tg_cfs_entry(struct task_group *tg, struct cfs_rq *cfs_rq,
 	tg->cfs_rq[cpu] = cfs_rq;
 	init_cfs_rq(cfs_rq, rq);
 	cfs_rq->tg = tg;
+	init_cfs_rq_runtime(cfs_rq);
 
 	tg->se[cpu] = se;
 	/* se could be NULL for root_task_group */
@@ -8097,12 +8745,17 @@ void __init sched_init(void)
 
 	init_rt_bandwidth(&def_rt_bandwidth,
 			global_rt_period(), global_rt_runtime());
+	raw_spin_lock_init(&def_dl_bandwidth.lock);
 
 #ifdef CONFIG_RT_GROUP_SCHED
 	init_rt_bandwidth(&root_task_group.rt_bandwidth,
 			global_rt_period(), global_rt_runtime());
 #endif /* CONFIG_RT_GROUP_SCHED */
 
+#ifdef CONFIG_FAIR_GROUP_SCHED
+	init_cfs_bandwidth(&root_task_group.cfs_bandwidth);
+#endif
+
 #ifdef CONFIG_CGROUP_SCHED
 	list_add(&root_task_group.list, &task_groups);
 	INIT_LIST_HEAD(&root_task_group.children);
@@ -8119,6 +8772,7 @@ void __init sched_init(void)
 		rq->calc_load_update = jiffies + LOAD_FREQ;
 		init_cfs_rq(&rq->cfs, rq);
 		init_rt_rq(&rq->rt, rq);
+		init_dl_rq(&rq->dl, rq);
 #ifdef CONFIG_FAIR_GROUP_SCHED
 		root_task_group.shares = root_task_group_load;
 		INIT_LIST_HEAD(&rq->leaf_cfs_rq_list);
@@ -8289,7 +8943,8 @@ static void normalize_task(struct rq *rq, struct task_struct *p)
 	on_rq = p->on_rq;
 	if (on_rq)
 		deactivate_task(rq, p, 0);
-	__setscheduler(rq, p, SCHED_NORMAL, 0);
+	sched_dl_overflow(p, SCHED_NORMAL, NULL);
+	__setscheduler(rq, p, SCHED_NORMAL, 0, NULL);
 	if (on_rq) {
 		activate_task(rq, p, 0);
 		resched_task(rq->curr);
@@ -8395,6 +9050,8 @@ static void free_fair_sched_group(struct task_group *tg)
 {
 	int i;
 
+	destroy_cfs_bandwidth(&tg->cfs_bandwidth);
+
 	for_each_possible_cpu(i) {
 		if (tg->cfs_rq)
 			kfree(tg->cfs_rq[i]);
@@ -8413,6 +9070,8 @@ int alloc_fair_sched_group(struct task_group *tg, struct task_group *parent)
 	struct sched_entity *se;
 	int i;
 
+	init_cfs_bandwidth(&tg->cfs_bandwidth);
+
 	tg->cfs_rq = kzalloc(sizeof(cfs_rq) * nr_cpu_ids, GFP_KERNEL);
 	if (!tg->cfs_rq)
 		goto err;
@@ -8698,6 +9357,33 @@ unsigned long sched_group_shares(struct task_group *tg)
 {
 	return tg->shares;
 }
+
+int sched_group_set_latency_nice(struct task_group *tg, int latency_nice)
+{
+	unsigned long flags;
+	int i;
+
+	/*
+	 * The root cgroup has no entities of its own.
+	 */
+	if (!tg->se[0])
+		return -EINVAL;
+
+	if (latency_nice < MIN_LATENCY_NICE || latency_nice > MAX_LATENCY_NICE)
+		return -EINVAL;
+
+	mutex_lock(&shares_mutex);
+	tg->latency_nice = latency_nice;
+	for_each_possible_cpu(i) {
+		struct rq *rq = cpu_rq(i);
+
+		raw_spin_lock_irqsave(&rq->lock, flags);
+		tg->se[i]->latency_nice = latency_nice;
+		raw_spin_unlock_irqrestore(&rq->lock, flags);
+	}
+	mutex_unlock(&shares_mutex);
+	return 0;
+}
 #endif
 
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -8706,14 +9392,6 @@ unsigned long sched_group_shares(struct task_group *tg)
  */
 static DEFINE_MUTEX(rt_constraints_mutex);
 
-static unsigned long to_ratio(u64 period, u64 runtime)
-{
-	if (runtime == RUNTIME_INF)
-		return 1ULL << 20;
-
-	return div64_u64(runtime << 20, period);
-}
-
 /* Must be called with tasklist_lock held */
 static inline int tg_has_rt_tasks(struct task_group *tg)
 {
@@ -8941,6 +9619,23 @@ static int sched_rt_global_constraints(void)
 }
 #endif /* CONFIG_RT_GROUP_SCHED */
 
+/*
+ * The rt sysctls also bound the bandwidth of the SCHED_DEADLINE tasks,
+ * which must not shrink below what has been given out already.
+ */
+static int sched_dl_global_constraints(void)
+{
+	unsigned long flags;
+	int ret = 0;
+
+	raw_spin_lock_irqsave(&def_dl_bandwidth.lock, flags);
+	if (def_dl_bandwidth.total_bw > global_dl_limit())
+		ret = -EBUSY;
+	raw_spin_unlock_irqrestore(&def_dl_bandwidth.lock, flags);
+
+	return ret;
+}
+
 int sched_rt_handler(struct ctl_table *table, int write,
 		void __user *buffer, size_t *lenp,
 		loff_t *ppos)
@@ -8956,7 +9651,9 @@ int sched_rt_handler(struct ctl_table *table, int write,
 	ret = proc_dointvec(table, write, buffer, lenp, ppos);
 
 	if (!ret && write) {
-		ret = sched_rt_global_constraints();
+		ret = sched_dl_global_constraints();
+		if (!ret)
+			ret = sched_rt_global_constraints();
 		if (ret) {
 			sysctl_sched_rt_period = old_period;
 			sysctl_sched_rt_runtime = old_runtime;
@@ -9068,8 +9765,255 @@ static u64 cpu_shares_read_u64(struct cgroup *cgrp, struct cftype *cft)
 
 	return (u64) scale_load_down(tg->shares);
 }
+
+static int cpu_latency_nice_write_s64(struct cgroup *cgrp, struct cftype *cft,
+				      s64 val)
+{
+	if (val < MIN_LATENCY_NICE || val > MAX_LATENCY_NICE)
+		return -EINVAL;
+
+	return sched_group_set_latency_nice(cgroup_tg(cgrp), val);
+}
+
+static s64 cpu_latency_nice_read_s64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return cgroup_tg(cgrp)->latency_nice;
+}
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 
+#ifdef CONFIG_CFS_BANDWIDTH
+static DEFINE_MUTEX(cfs_constraints_mutex);
+
+static const u64 max_cfs_quota_period = 1 * NSEC_PER_SEC; /* 1s */
+static const u64 min_cfs_quota_period = 1 * NSEC_PER_MSEC; /* 1ms */
+
+static int __cfs_schedulable(struct task_group *tg, u64 period, u64 runtime);
+
+static int tg_set_cfs_bandwidth(struct task_group *tg, u64 period, u64 quota)
+{
+	int i, ret = 0, runtime_enabled, runtime_was_enabled;
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(tg);
+
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	/*
+	 * Ensure we have at some amount of bandwidth every period.  This is
+	 * to prevent reaching a state of large arrears when throttled via
+	 * entity_tick() resulting in prolonged exit starvation.
+	 */
+	if (quota < min_cfs_quota_period || period < min_cfs_quota_period)
+		return -EINVAL;
+
+	/*
+	 * Likewise, bound things on the otherside by preventing insane quota
+	 * periods.  This also allows us to normalize in computing quota
+	 * feasibility.
+	 */
+	if (period > max_cfs_quota_period)
+		return -EINVAL;
+
+	mutex_lock(&cfs_constraints_mutex);
+	ret = __cfs_schedulable(tg, period, quota);
+	if (ret)
+		goto out_unlock;
+
+	runtime_enabled = quota != RUNTIME_INF;
+	runtime_was_enabled = cfs_b->quota != RUNTIME_INF;
+	account_cfs_bandwidth_used(runtime_enabled, runtime_was_enabled);
+
+	raw_spin_lock_irq(&cfs_b->lock);
+	cfs_b->period = ns_to_ktime(period);
+	cfs_b->quota = quota;
+
+	__refill_cfs_bandwidth_runtime(cfs_b);
+	/* restart the period timer (if active) to handle new period expiry */
+	if (runtime_enabled && cfs_b->timer_active) {
+		/* force a reprogram */
+		cfs_b->timer_active = 0;
+		__start_cfs_bandwidth(cfs_b);
+	}
+	raw_spin_unlock_irq(&cfs_b->lock);
+
+	for_each_possible_cpu(i) {
+		struct cfs_rq *cfs_rq = tg->cfs_rq[i];
+		struct rq *rq = cfs_rq->rq;
+
+		raw_spin_lock_irq(&rq->lock);
+		cfs_rq->runtime_enabled = runtime_enabled;
+		cfs_rq->runtime_remaining = 0;
+
+		if (cfs_rq_throttled(cfs_rq))
+			unthrottle_cfs_rq(cfs_rq);
+		raw_spin_unlock_irq(&rq->lock);
+	}
+out_unlock:
+	mutex_unlock(&cfs_constraints_mutex);
+
+	return ret;
+}
+
+static int tg_set_cfs_quota(struct task_group *tg, long cfs_quota_us)
+{
+	u64 quota, period;
+
+	period = ktime_to_ns(tg_cfs_bandwidth(tg)->period);
+	if (cfs_quota_us < 0)
+		quota = RUNTIME_INF;
+	else
+		quota = (u64)cfs_quota_us * NSEC_PER_USEC;
+
+	return tg_set_cfs_bandwidth(tg, period, quota);
+}
+
+static long tg_get_cfs_quota(struct task_group *tg)
+{
+	u64 quota_us;
+
+	if (tg_cfs_bandwidth(tg)->quota == RUNTIME_INF)
+		return -1;
+
+	quota_us = tg_cfs_bandwidth(tg)->quota;
+	do_div(quota_us, NSEC_PER_USEC);
+
+	return quota_us;
+}
+
+static int tg_set_cfs_period(struct task_group *tg, long cfs_period_us)
+{
+	u64 quota, period;
+
+	if (cfs_period_us <= 0)
+		return -EINVAL;
+
+	period = (u64)cfs_period_us * NSEC_PER_USEC;
+	quota = tg_cfs_bandwidth(tg)->quota;
+
+	return tg_set_cfs_bandwidth(tg, period, quota);
+}
+
+static long tg_get_cfs_period(struct task_group *tg)
+{
+	u64 cfs_period_us;
+
+	cfs_period_us = ktime_to_ns(tg_cfs_bandwidth(tg)->period);
+	do_div(cfs_period_us, NSEC_PER_USEC);
+
+	return cfs_period_us;
+}
+
+static s64 cpu_cfs_quota_read_s64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return tg_get_cfs_quota(cgroup_tg(cgrp));
+}
+
+static int cpu_cfs_quota_write_s64(struct cgroup *cgrp, struct cftype *cftype,
+				s64 cfs_quota_us)
+{
+	return tg_set_cfs_quota(cgroup_tg(cgrp), cfs_quota_us);
+}
+
+static u64 cpu_cfs_period_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return tg_get_cfs_period(cgroup_tg(cgrp));
+}
+
+static int cpu_cfs_period_write_u64(struct cgroup *cgrp, struct cftype *cftype,
+				u64 cfs_period_us)
+{
+	if (cfs_period_us > max_cfs_quota_period / NSEC_PER_USEC)
+		return -EINVAL;
+
+	return tg_set_cfs_period(cgroup_tg(cgrp), cfs_period_us);
+}
+
+struct cfs_schedulable_data {
+	struct task_group *tg;
+	u64 period, quota;
+};
+
+/*
+ * normalize group quota/period to be quota/max_period
+ * note: units are usecs
+ */
+static u64 normalize_cfs_quota(struct task_group *tg,
+			       struct cfs_schedulable_data *d)
+{
+	u64 quota, period;
+
+	if (tg == d->tg) {
+		period = d->period;
+		quota = d->quota;
+	} else {
+		period = tg_get_cfs_period(tg);
+		quota = tg_get_cfs_quota(tg);
+	}
+
+	/* note: these should typically be equivalent */
+	if (quota == RUNTIME_INF || quota == -1)
+		return RUNTIME_INF;
+
+	return to_ratio(period, quota);
+}
+
+static int tg_cfs_schedulable_down(struct task_group *tg, void *data)
+{
+	struct cfs_schedulable_data *d = data;
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(tg);
+	s64 quota = 0, parent_quota = -1;
+
+	if (!tg->parent) {
+		quota = RUNTIME_INF;
+	} else {
+		struct cfs_bandwidth *parent_b = tg_cfs_bandwidth(tg->parent);
+
+		quota = normalize_cfs_quota(tg, d);
+		parent_quota = parent_b->hierarchical_quota;
+
+		/*
+		 * ensure max(child_quota) <= parent_quota, inherit when no
+		 * limit is set
+		 */
+		if (quota == RUNTIME_INF)
+			quota = parent_quota;
+		else if (parent_quota != RUNTIME_INF && quota > parent_quota)
+			return -EINVAL;
+	}
+	cfs_b->hierarchical_quota = quota;
+
+	return 0;
+}
+
+static int __cfs_schedulable(struct task_group *tg, u64 period, u64 quota)
+{
+	struct cfs_schedulable_data data = {
+		.tg = tg,
+		.period = period,
+		.quota = quota,
+	};
+
+	if (quota != RUNTIME_INF) {
+		do_div(data.period, NSEC_PER_USEC);
+		do_div(data.quota, NSEC_PER_USEC);
+	}
+
+	return walk_tg_tree(tg_cfs_schedulable_down, tg_nop, &data);
+}
+
+static int cpu_stats_show(struct cgroup *cgrp, struct cftype *cft,
+		struct cgroup_map_cb *cb)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(tg);
+
+	cb->fill(cb, "nr_periods", cfs_b->nr_periods);
+	cb->fill(cb, "nr_throttled", cfs_b->nr_throttled);
+	cb->fill(cb, "throttled_time", cfs_b->throttled_time);
+
+	return 0;
+}
+#endif /* CONFIG_CFS_BANDWIDTH */
+
 #ifdef CONFIG_RT_GROUP_SCHED
 static int cpu_rt_runtime_write(struct cgroup *cgrp, struct cftype *cft,
 				s64 val)
@@ -9101,6 +10045,27 @@ static struct cftype cpu_files[] = {
 		.read_u64 = cpu_shares_read_u64,
 		.write_u64 = cpu_shares_write_u64,
 	},
+	{
+		.name = "latency_nice",
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
+#endif
+#ifdef CONFIG_CFS_BANDWIDTH
+	{
+		.name = "cfs_quota_us",
+		.read_s64 = cpu_cfs_quota_read_s64,
+		.write_s64 = cpu_cfs_quota_write_s64,
+	},
+	{
+		.name = "cfs_period_us",
+		.read_u64 = cpu_cfs_period_read_u64,
+		.write_u64 = cpu_cfs_period_write_u64,
+	},
+	{
+		.name = "stat",
+		.read_map = cpu_stats_show,
+	},
 #endif
 #ifdef CONFIG_RT_GROUP_SCHED
 	{
@@ -0,0 +1,1023 @@
+/*
+ * Deadline Scheduling Class (SCHED_DEADLINE)
+ *
+ * Earliest Deadline First dispatch of tasks that hold a reservation: up
+ * to dl_runtime of cpu time in every dl_period, to be had within
+ * dl_deadline of the start of the period.  The class sits between the
+ * stop and the rt class, so that neither rt nor fair tasks can make a
+ * reservation miss; admission control, see sched_dl_overflow(), keeps
+ * the reservations together within what the rt sysctls allow, so that
+ * they cannot starve the others either.
+ *
+ * Every task is its own Constant Bandwidth Server: a task that uses up
+ * its runtime is throttled until its next period, one that wakes up
+ * with more runtime left than it could use at its bandwidth before its
+ * deadline gets a new deadline and full runtime.  A task can thus never
+ * take more than its bandwidth, however it behaves, and tasks that stay
+ * within theirs meet their deadlines as long as the cpus are not
+ * overcommitted.
+ *
+ * On SMP the earliest deadlines should run on as many cpus: a waking
+ * task goes to a cpu where it runs right away, queued tasks that could
+ * run elsewhere are pushed there after a preemption, and a cpu pulls the
+ * earliest queued task from the others when its own deadlines get later.
+ */
+
+static inline struct task_struct *dl_task_of(struct sched_dl_entity *dl_se)
+{
+	return container_of(dl_se, struct task_struct, dl);
+}
+
+static inline struct rq *rq_of_dl_rq(struct dl_rq *dl_rq)
+{
+	return container_of(dl_rq, struct rq, dl);
+}
+
+static inline struct dl_rq *dl_rq_of_se(struct sched_dl_entity *dl_se)
+{
+	return &task_rq(dl_task_of(dl_se))->dl;
+}
+
+static inline int on_dl_rq(struct sched_dl_entity *dl_se)
+{
+	return !RB_EMPTY_NODE(&dl_se->rb_node);
+}
+
+static inline int dl_time_before(u64 a, u64 b)
+{
+	return (s64)(a - b) < 0;
+}
+
+static inline int is_leftmost(struct task_struct *p, struct dl_rq *dl_rq)
+{
+	return dl_rq->rb_leftmost == &p->dl.rb_node;
+}
+
+#ifdef CONFIG_SMP
+
+static inline void dl_set_overload(struct rq *rq)
+{
+	if (!rq->online)
+		return;
+
+	cpumask_set_cpu(rq->cpu, rq->rd->dlo_mask);
+	/*
+	 * Make sure the mask is visible before the count that says it is
+	 * worth looking at, as in rt_set_overload().
+	 */
+	wmb();
+	atomic_inc(&rq->rd->dlo_count);
+}
+
+static inline void dl_clear_overload(struct rq *rq)
+{
+	if (!rq->online)
+		return;
+
+	atomic_dec(&rq->rd->dlo_count);
+	cpumask_clear_cpu(rq->cpu, rq->rd->dlo_mask);
+}
+
+static void update_dl_migration(struct dl_rq *dl_rq)
+{
+	if (dl_rq->dl_nr_migratory && dl_rq->dl_nr_running > 1) {
+		if (!dl_rq->overloaded) {
+			dl_set_overload(rq_of_dl_rq(dl_rq));
+			dl_rq->overloaded = 1;
+		}
+	} else if (dl_rq->overloaded) {
+		dl_clear_overload(rq_of_dl_rq(dl_rq));
+		dl_rq->overloaded = 0;
+	}
+}
+
+static void
+inc_dl_migration(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
+{
+	if (dl_task_of(dl_se)->rt.nr_cpus_allowed > 1)
+		dl_rq->dl_nr_migratory++;
+	update_dl_migration(dl_rq);
+}
+
+static void
+dec_dl_migration(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
+{
+	if (dl_task_of(dl_se)->rt.nr_cpus_allowed > 1)
+		dl_rq->dl_nr_migratory--;
+	update_dl_migration(dl_rq);
+}
+
+static void update_earliest_dl(struct dl_rq *dl_rq)
+{
+	struct sched_dl_entity *leftmost;
+
+	if (!dl_rq->rb_leftmost) {
+		dl_rq->earliest_dl = 0;
+		return;
+	}
+	leftmost = rb_entry(dl_rq->rb_leftmost, struct sched_dl_entity,
+			    rb_node);
+	dl_rq->earliest_dl = leftmost->deadline;
+}
+
+#else
+
+static inline
+void inc_dl_migration(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq) {}
+static inline
+void dec_dl_migration(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq) {}
+static inline void update_earliest_dl(struct dl_rq *dl_rq) {}
+
+#endif /* CONFIG_SMP */
+
+/*
+ * A new instance: all of dl_runtime, to be used within dl_deadline.
+ */
+static void setup_new_dl_entity(struct sched_dl_entity *dl_se, struct rq *rq)
+{
+	dl_se->deadline = rq->clock + dl_se->dl_deadline;
+	dl_se->runtime = dl_se->dl_runtime;
+	dl_se->dl_new = 0;
+}
+
+/*
+ * The runtime ran out: move the deadline on by periods, adding one
+ * dl_runtime for each, until there is runtime again.  A task that got so
+ * far behind that its deadline is still in the past starts over.
+ */
+static void replenish_dl_entity(struct sched_dl_entity *dl_se, struct rq *rq)
+{
+	while (dl_se->runtime <= 0) {
+		dl_se->deadline += dl_se->dl_period;
+		dl_se->runtime += dl_se->dl_runtime;
+	}
+
+	if (dl_time_before(dl_se->deadline, rq->clock))
+		setup_new_dl_entity(dl_se, rq);
+
+	dl_se->dl_yielded = 0;
+}
+
+/*
+ * Would the runtime that is left, used from @t on, take the task above
+ * its bandwidth before its deadline?  That is
+ *
+ *	runtime / (deadline - t) > dl_runtime / dl_period
+ *
+ * with the times shifted down by 10 bits, so that the products cannot
+ * overflow for runtimes and periods below about 4 hours.
+ */
+static bool dl_entity_overflow(struct sched_dl_entity *dl_se, u64 t)
+{
+	u64 left, right;
+
+	left = (dl_se->dl_period >> 10) * (dl_se->runtime >> 10);
+	right = ((dl_se->deadline - t) >> 10) * (dl_se->dl_runtime >> 10);
+
+	return dl_time_before(right, left);
+}
+
+/*
+ * The CBS wakeup rule: a task that wakes up keeps its deadline and
+ * runtime only if it cannot use them to go above its bandwidth, and
+ * otherwise gets a new instance.
+ */
+static void update_dl_entity(struct sched_dl_entity *dl_se, struct rq *rq)
+{
+	if (dl_se->dl_new) {
+		setup_new_dl_entity(dl_se, rq);
+		return;
+	}
+
+	if (dl_time_before(dl_se->deadline, rq->clock) ||
+	    dl_entity_overflow(dl_se, rq->clock)) {
+		dl_se->deadline = rq->clock + dl_se->dl_deadline;
+		dl_se->runtime = dl_se->dl_runtime;
+	}
+}
+
+/*
+ * Arm the timer that gives a throttled task its runtime back, at the
+ * start of its next period.  rq->clock and the hrtimer base do not run
+ * in step, so the expiry is translated by their current difference.
+ * Returns 0 if that time has already passed.
+ *
+ * A queued timer holds a reference on its task: the task may leave the
+ * class and exit before the timer fires.
+ */
+static int start_dl_timer(struct sched_dl_entity *dl_se, struct rq *rq)
+{
+	struct hrtimer *timer = &dl_se->dl_timer;
+	ktime_t now, act;
+	s64 delta;
+
+	act = ns_to_ktime(dl_se->deadline - dl_se->dl_deadline +
+			  dl_se->dl_period);
+	now = hrtimer_cb_get_time(timer);
+	delta = ktime_to_ns(now) - rq->clock;
+	act = ktime_add_ns(act, delta);
+
+	if (ktime_us_delta(act, now) < 0)
+		return 0;
+
+	if (!hrtimer_is_queued(timer))
+		get_task_struct(dl_task_of(dl_se));
+	/* no softirq wakeup, the rq lock is held */
+	__hrtimer_start_range_ns(timer, act, 0, HRTIMER_MODE_ABS, 0);
+
+	return hrtimer_active(timer);
+}
+
+static void enqueue_task_dl(struct rq *rq, struct task_struct *p, int flags);
+static void check_preempt_curr_dl(struct rq *rq, struct task_struct *p,
+				  int flags);
+
+static enum hrtimer_restart dl_task_timer(struct hrtimer *timer)
+{
+	struct sched_dl_entity *dl_se = container_of(timer,
+						     struct sched_dl_entity,
+						     dl_timer);
+	struct task_struct *p = dl_task_of(dl_se);
+	unsigned long flags;
+	struct rq *rq;
+
+	rq = task_rq_lock(p, &flags);
+
+	/*
+	 * The task may have left the class, or got new parameters, since
+	 * the timer was armed.
+	 */
+	if (!dl_task(p) || !dl_se->dl_throttled)
+		goto unlock;
+
+	dl_se->dl_throttled = 0;
+	list_del_init(&dl_se->throttled_node);
+	if (p->on_rq) {
+		update_rq_clock(rq);
+		enqueue_task_dl(rq, p, ENQUEUE_REPLENISH);
+		if (dl_task(rq->curr))
+			check_preempt_curr_dl(rq, p, 0);
+		else
+			resched_task(rq->curr);
+	}
+unlock:
+	task_rq_unlock(rq, p, &flags);
+	put_task_struct(p);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Called with the rq lock held, which the timer takes, so the timer is
+ * only taken off if it is not running already.  The timer does nothing
+ * then once it gets the lock, as the task is not throttled any more.
+ */
+static void try_cancel_dl_timer(struct task_struct *p)
+{
+	if (hrtimer_try_to_cancel(&p->dl.dl_timer) == 1)
+		put_task_struct(p);
+}
+
+static void init_dl_task_timer(struct sched_dl_entity *dl_se)
+{
+	hrtimer_init(&dl_se->dl_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dl_se->dl_timer.function = dl_task_timer;
+}
+
+/*
+ * The runtime is used up, or the task is still running at its deadline,
+ * which is a miss.  A task that gave up its runtime does not count as
+ * throttled.
+ */
+static int dl_runtime_exceeded(struct rq *rq, struct sched_dl_entity *dl_se)
+{
+	int dmiss = dl_time_before(dl_se->deadline, rq->clock);
+
+	if (dl_se->runtime > 0 && !dmiss)
+		return 0;
+
+	if (dmiss) {
+		schedstat_inc(dl_task_of(dl_se), se.statistics.nr_dl_misses);
+		if (dl_se->runtime > 0)
+			dl_se->runtime = 0;
+	} else if (!dl_se->dl_yielded)
+		schedstat_inc(dl_task_of(dl_se), se.statistics.nr_dl_throttled);
+
+	return 1;
+}
+
+static void __enqueue_dl_entity(struct sched_dl_entity *dl_se);
+static void __dequeue_dl_entity(struct sched_dl_entity *dl_se);
+
+/*
+ * Update the current task's runtime statistics and charge the time it ran
+ * to its runtime.  Skip current tasks that are not in our scheduling
+ * class, or throttled already.
+ */
+static void update_curr_dl(struct rq *rq)
+{
+	struct task_struct *curr = rq->curr;
+	struct sched_dl_entity *dl_se = &curr->dl;
+	u64 delta_exec;
+
+	if (!dl_task(curr) || !on_dl_rq(dl_se))
+		return;
+
+	delta_exec = rq->clock_task - curr->se.exec_start;
+	if (unlikely((s64)delta_exec < 0))
+		delta_exec = 0;
+
+	schedstat_set(curr->se.statistics.exec_max,
+		      max(curr->se.statistics.exec_max, delta_exec));
+
+	curr->se.sum_exec_runtime += delta_exec;
+	account_group_exec_runtime(curr, delta_exec);
+
+	curr->se.exec_start = rq->clock_task;
+	cpuacct_charge(curr, delta_exec);
+
+	sched_rt_avg_update(rq, delta_exec);
+
+	dl_se->runtime -= delta_exec;
+	if (dl_runtime_exceeded(rq, dl_se)) {
+		__dequeue_dl_entity(dl_se);
+		if (likely(start_dl_timer(dl_se, rq))) {
+			dl_se->dl_throttled = 1;
+			list_add(&dl_se->throttled_node,
+				 &rq->dl.throttled_list);
+		} else {
+			/* the next period has begun already */
+			replenish_dl_entity(dl_se, rq);
+			__enqueue_dl_entity(dl_se);
+		}
+
+		if (!is_leftmost(curr, &rq->dl))
+			resched_task(curr);
+	}
+}
+
+static void inc_dl_tasks(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
+{
+	dl_rq->dl_nr_running++;
+	inc_nr_running(rq_of_dl_rq(dl_rq));
+
+	update_earliest_dl(dl_rq);
+	inc_dl_migration(dl_se, dl_rq);
+}
+
+static void dec_dl_tasks(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
+{
+	WARN_ON(!dl_rq->dl_nr_running);
+	dl_rq->dl_nr_running--;
+	dec_nr_running(rq_of_dl_rq(dl_rq));
+
+	update_earliest_dl(dl_rq);
+	dec_dl_migration(dl_se, dl_rq);
+}
+
+static void __enqueue_dl_entity(struct sched_dl_entity *dl_se)
+{
+	struct dl_rq *dl_rq = dl_rq_of_se(dl_se);
+	struct rb_node **link = &dl_rq->rb_root.rb_node;
+	struct rb_node *parent = NULL;
+	struct sched_dl_entity *entry;
+	int leftmost = 1;
+
+	BUG_ON(on_dl_rq(dl_se));
+
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct sched_dl_entity, rb_node);
+		if (dl_time_before(dl_se->deadline, entry->deadline))
+			link = &parent->rb_left;
+		else {
+			link = &parent->rb_right;
+			leftmost = 0;
+		}
+	}
+
+	if (leftmost)
+		dl_rq->rb_leftmost = &dl_se->rb_node;
+
+	rb_link_node(&dl_se->rb_node, parent, link);
+	rb_insert_color(&dl_se->rb_node, &dl_rq->rb_root);
+
+	inc_dl_tasks(dl_se, dl_rq);
+}
+
+static void __dequeue_dl_entity(struct sched_dl_entity *dl_se)
+{
+	struct dl_rq *dl_rq = dl_rq_of_se(dl_se);
+
+	if (!on_dl_rq(dl_se))
+		return;
+
+	if (dl_rq->rb_leftmost == &dl_se->rb_node)
+		dl_rq->rb_leftmost = rb_next(&dl_se->rb_node);
+
+	rb_erase(&dl_se->rb_node, &dl_rq->rb_root);
+	RB_CLEAR_NODE(&dl_se->rb_node);
+
+	dec_dl_tasks(dl_se, dl_rq);
+}
+
+static void enqueue_task_dl(struct rq *rq, struct task_struct *p, int flags)
+{
+	struct sched_dl_entity *dl_se = &p->dl;
+
+	/*
+	 * A throttled task stays off the runqueue until its timer gives
+	 * it new runtime, even when it wakes up before.
+	 */
+	if (dl_se->dl_throttled && !(flags & ENQUEUE_REPLENISH)) {
+		list_add(&dl_se->throttled_node, &rq->dl.throttled_list);
+		return;
+	}
+
+	if (dl_se->dl_new || (flags & ENQUEUE_WAKEUP))
+		update_dl_entity(dl_se, rq);
+	else if (flags & ENQUEUE_REPLENISH)
+		replenish_dl_entity(dl_se, rq);
+
+	__enqueue_dl_entity(dl_se);
+}
+
+static void dequeue_task_dl(struct rq *rq, struct task_struct *p, int flags)
+{
+	update_curr_dl(rq);
+	__dequeue_dl_entity(&p->dl);
+	list_del_init(&p->dl.throttled_node);
+}
+
+/*
+ * Yielding ends the current instance: the task gives up what is left of
+ * its runtime and sleeps until its next period.  Periodic tasks can
+ * yield at the end of each job, rather than sleep until the start of
+ * the next one, and the CBS wakeup rule does not get in the way.
+ */
+static void yield_task_dl(struct rq *rq)
+{
+	struct task_struct *p = rq->curr;
+
+	if (p->dl.runtime > 0) {
+		p->dl.dl_yielded = 1;
+		p->dl.runtime = 0;
+	}
+	update_curr_dl(rq);
+}
+
+static void check_preempt_curr_dl(struct rq *rq, struct task_struct *p,
+				  int flags)
+{
+	if (dl_time_before(p->dl.deadline, rq->curr->dl.deadline))
+		resched_task(rq->curr);
+}
+
+#ifdef CONFIG_SCHED_HRTICK
+/* Stop the task when its runtime is used up, rather than at the tick */
+static void start_hrtick_dl(struct rq *rq, struct task_struct *p)
+{
+	s64 delta = p->dl.runtime;
+
+	if (delta > 10000)
+		hrtick_start(rq, delta);
+}
+#else
+static inline void start_hrtick_dl(struct rq *rq, struct task_struct *p)
+{
+}
+#endif
+
+static struct task_struct *pick_next_task_dl(struct rq *rq)
+{
+	struct sched_dl_entity *dl_se;
+	struct task_struct *p;
+
+	if (!rq->dl.dl_nr_running)
+		return NULL;
+
+	dl_se = rb_entry(rq->dl.rb_leftmost, struct sched_dl_entity, rb_node);
+	p = dl_task_of(dl_se);
+	p->se.exec_start = rq->clock_task;
+
+#ifdef CONFIG_SMP
+	/* push the ones left behind to other cpus, if they can go */
+	rq->post_schedule = rq->dl.overloaded;
+#endif
+#ifdef CONFIG_SCHED_HRTICK
+	if (hrtick_enabled(rq))
+		start_hrtick_dl(rq, p);
+#endif
+
+	return p;
+}
+
+static void put_prev_task_dl(struct rq *rq, struct task_struct *p)
+{
+	update_curr_dl(rq);
+}
+
+#ifdef CONFIG_SMP
+
+/* Only try this many cpus to push a task to */
+#define DL_MAX_TRIES 3
+
+/*
+ * Find a cpu @task may run on where it would run right away: preferably
+ * one without SCHED_DEADLINE tasks, its own or an idle one first, or else
+ * the one whose earliest deadline is the latest of those later than that
+ * of @task.  The deadlines of other cpus are read without their locks,
+ * the caller has to check again.  Returns -1 if there is no such cpu.
+ */
+static int find_later_rq(struct task_struct *task)
+{
+	u64 latest = task->dl.deadline;
+	int cpu, best_cpu = -1, free_cpu = -1;
+
+	for_each_cpu_and(cpu, &task->cpus_allowed, cpu_active_mask) {
+		struct dl_rq *dl_rq = &cpu_rq(cpu)->dl;
+
+		if (!dl_rq->dl_nr_running) {
+			if (cpu == task_cpu(task))
+				return cpu;
+			if (free_cpu == -1 ||
+			    (idle_cpu(cpu) && !idle_cpu(free_cpu)))
+				free_cpu = cpu;
+			continue;
+		}
+
+		if (dl_time_before(latest, dl_rq->earliest_dl)) {
+			latest = dl_rq->earliest_dl;
+			best_cpu = cpu;
+		}
+	}
+
+	return free_cpu != -1 ? free_cpu : best_cpu;
+}
+
+static int
+select_task_rq_dl(struct task_struct *p, int sd_flag, int flags)
+{
+	struct task_struct *curr;
+	struct rq *rq;
+	int cpu;
+
+	if (sd_flag != SD_BALANCE_WAKE)
+		return smp_processor_id();
+
+	cpu = task_cpu(p);
+	rq = cpu_rq(cpu);
+
+	rcu_read_lock();
+	curr = ACCESS_ONCE(rq->curr); /* unlocked access */
+
+	/*
+	 * If the cpu of @p runs a deadline task that @p would not preempt,
+	 * or that cannot go anywhere else, look for a cpu where @p runs
+	 * right away.  As with rt, this is optimistic: if it is wrong, the
+	 * push and pull below sort it out.
+	 */
+	if (curr && unlikely(dl_task(curr)) &&
+	    (curr->rt.nr_cpus_allowed < 2 ||
+	     !dl_time_before(p->dl.deadline, curr->dl.deadline)) &&
+	    (p->rt.nr_cpus_allowed > 1)) {
+		int target = find_later_rq(p);
+
+		if (target != -1)
+			cpu = target;
+	}
+	rcu_read_unlock();
+
+	return cpu;
+}
+
+/* The earliest queued task of @rq that is not running and may go to @cpu */
+static struct task_struct *pick_next_movable_dl_task(struct rq *rq, int cpu)
+{
+	struct rb_node *node;
+
+	for (node = rq->dl.rb_leftmost; node; node = rb_next(node)) {
+		struct task_struct *p = rb_entry(node, struct task_struct,
+						 dl.rb_node);
+
+		if (task_running(rq, p) || p->rt.nr_cpus_allowed < 2)
+			continue;
+		if (cpu == -1 || cpumask_test_cpu(cpu, &p->cpus_allowed))
+			return p;
+	}
+
+	return NULL;
+}
+
+/* Will lock the rq it finds */
+static struct rq *find_lock_later_rq(struct task_struct *task, struct rq *rq)
+{
+	struct rq *later_rq = NULL;
+	int tries;
+	int cpu;
+
+	for (tries = 0; tries < DL_MAX_TRIES; tries++) {
+		cpu = find_later_rq(task);
+
+		if ((cpu == -1) || (cpu == rq->cpu))
+			break;
+
+		later_rq = cpu_rq(cpu);
+
+		if (double_lock_balance(rq, later_rq)) {
+			/*
+			 * The rq lock was dropped: the task may have run,
+			 * moved, slept or changed its affinity meanwhile.
+			 */
+			if (unlikely(task_rq(task) != rq ||
+				     !cpumask_test_cpu(later_rq->cpu,
+						       &task->cpus_allowed) ||
+				     task_running(rq, task) ||
+				     !on_dl_rq(&task->dl))) {
+				raw_spin_unlock(&later_rq->lock);
+				later_rq = NULL;
+				break;
+			}
+		}
+
+		/* If this rq is still suitable use it. */
+		if (!later_rq->dl.dl_nr_running ||
+		    dl_time_before(task->dl.deadline, later_rq->dl.earliest_dl))
+			break;
+
+		/* try again */
+		double_unlock_balance(rq, later_rq);
+		later_rq = NULL;
+	}
+
+	return later_rq;
+}
+
+/*
+ * If the current cpu has a queued deadline task that could run now on
+ * another cpu, move it there.  Returns 1 if a task was moved.
+ */
+static int push_dl_task(struct rq *rq)
+{
+	struct task_struct *next_task;
+	struct rq *later_rq;
+	int ret = 0;
+
+	if (!rq->dl.overloaded)
+		return 0;
+
+	next_task = pick_next_movable_dl_task(rq, -1);
+	if (!next_task)
+		return 0;
+
+retry:
+	if (unlikely(next_task == rq->curr)) {
+		WARN_ON(1);
+		return 0;
+	}
+
+	/*
+	 * If next_task got ahead of the running task, just preempt that,
+	 * it will be pushed in turn.
+	 */
+	if (dl_task(rq->curr) &&
+	    dl_time_before(next_task->dl.deadline, rq->curr->dl.deadline) &&
+	    rq->curr->rt.nr_cpus_allowed > 1) {
+		resched_task(rq->curr);
+		return 0;
+	}
+
+	/* We might release rq lock */
+	get_task_struct(next_task);
+
+	/* find_lock_later_rq locks the rq if found */
+	later_rq = find_lock_later_rq(next_task, rq);
+	if (!later_rq) {
+		struct task_struct *task;
+
+		/*
+		 * The rq lock may have been dropped: if the task to push
+		 * changed, try with the new one, otherwise there is no
+		 * cpu for it and the others will pull it when they can.
+		 */
+		task = pick_next_movable_dl_task(rq, -1);
+		if (!task || (task_cpu(next_task) == rq->cpu &&
+			      task == next_task))
+			goto out;
+
+		put_task_struct(next_task);
+		next_task = task;
+		goto retry;
+	}
+
+	deactivate_task(rq, next_task, 0);
+	set_task_cpu(next_task, later_rq->cpu);
+	activate_task(later_rq, next_task, 0);
+	ret = 1;
+
+	resched_task(later_rq->curr);
+
+	double_unlock_balance(rq, later_rq);
+
+out:
+	put_task_struct(next_task);
+
+	return ret;
+}
+
+static void push_dl_tasks(struct rq *rq)
+{
+	/* push_dl_task will return true if it moved a task */
+	while (push_dl_task(rq))
+		;
+}
+
+/*
+ * Pull the queued deadline tasks of other cpus that would run here before
+ * what this cpu has.
+ */
+static int pull_dl_task(struct rq *this_rq)
+{
+	int this_cpu = this_rq->cpu, ret = 0, cpu;
+	struct task_struct *p;
+	struct rq *src_rq;
+
+	if (likely(!atomic_read(&this_rq->rd->dlo_count)))
+		return 0;
+
+	for_each_cpu(cpu, this_rq->rd->dlo_mask) {
+		if (this_cpu == cpu)
+			continue;
+
+		src_rq = cpu_rq(cpu);
+
+		/*
+		 * Nothing queued there can be earlier than its earliest
+		 * deadline; skip it without the lock if that is no earlier
+		 * than ours.
+		 */
+		if (this_rq->dl.dl_nr_running &&
+		    !dl_time_before(src_rq->dl.earliest_dl,
+				    this_rq->dl.earliest_dl))
+			continue;
+
+		double_lock_balance(this_rq, src_rq);
+
+		if (src_rq->dl.dl_nr_running <= 1)
+			goto skip;
+
+		p = pick_next_movable_dl_task(src_rq, this_cpu);
+
+		/*
+		 * Only pull a task that would run here right away, and that
+		 * does not preempt the running task of its own cpu: then it
+		 * is going to run there soon anyway.
+		 */
+		if (p && (!this_rq->dl.dl_nr_running ||
+			  dl_time_before(p->dl.deadline,
+					 this_rq->dl.earliest_dl))) {
+			WARN_ON(p == src_rq->curr);
+			WARN_ON(!p->on_rq);
+
+			if (dl_task(src_rq->curr) &&
+			    dl_time_before(p->dl.deadline,
+					   src_rq->curr->dl.deadline))
+				goto skip;
+
+			ret = 1;
+
+			deactivate_task(src_rq, p, 0);
+			set_task_cpu(p, this_cpu);
+			activate_task(this_rq, p, 0);
+			/*
+			 * Keep going, a later cpu may have an even earlier
+			 * task, which then replaces this one as the earliest.
+			 */
+		}
+skip:
+		double_unlock_balance(this_rq, src_rq);
+	}
+
+	return ret;
+}
+
+static void pre_schedule_dl(struct rq *rq, struct task_struct *prev)
+{
+	/* Pull if this cpu's earliest deadline is going to get later */
+	if (dl_task(prev) && (!rq->dl.dl_nr_running ||
+	    dl_time_before(prev->dl.deadline, rq->dl.earliest_dl)))
+		pull_dl_task(rq);
+}
+
+static void post_schedule_dl(struct rq *rq)
+{
+	push_dl_tasks(rq);
+}
+
+/*
+ * If we are not running and we are not going to reschedule soon, we should
+ * try to push tasks away now
+ */
+static void task_woken_dl(struct rq *rq, struct task_struct *p)
+{
+	if (!task_running(rq, p) &&
+	    !test_tsk_need_resched(rq->curr) &&
+	    rq->dl.overloaded &&
+	    p->rt.nr_cpus_allowed > 1 &&
+	    dl_task(rq->curr) &&
+	    (rq->curr->rt.nr_cpus_allowed < 2 ||
+	     !dl_time_before(p->dl.deadline, rq->curr->dl.deadline)))
+		push_dl_tasks(rq);
+}
+
+static void set_cpus_allowed_dl(struct task_struct *p,
+				const struct cpumask *new_mask)
+{
+	int weight = cpumask_weight(new_mask);
+
+	BUG_ON(!dl_task(p));
+
+	/*
+	 * Update the migration status of the rq if the task is queued and
+	 * becomes movable or stops being so.
+	 */
+	if (on_dl_rq(&p->dl) && (weight > 1) != (p->rt.nr_cpus_allowed > 1)) {
+		struct dl_rq *dl_rq = &task_rq(p)->dl;
+
+		if (weight > 1)
+			dl_rq->dl_nr_migratory++;
+		else
+			dl_rq->dl_nr_migratory--;
+		update_dl_migration(dl_rq);
+	}
+
+	cpumask_copy(&p->cpus_allowed, new_mask);
+	p->rt.nr_cpus_allowed = weight;
+}
+
+/* Assumes rq->lock is held */
+static void rq_online_dl(struct rq *rq)
+{
+	if (rq->dl.overloaded)
+		dl_set_overload(rq);
+}
+
+/* Assumes rq->lock is held */
+static void rq_offline_dl(struct rq *rq)
+{
+	if (rq->dl.overloaded)
+		dl_clear_overload(rq);
+}
+
+#ifdef CONFIG_HOTPLUG_CPU
+/*
+ * A cpu going down has its tasks pushed away, but throttled ones are not
+ * in the rb-tree where migrate_tasks() can find them: give them their
+ * next period now.  Their timers find them unthrottled and do nothing.
+ */
+static void unthrottle_offline_dl_tasks(struct rq *rq)
+{
+	struct sched_dl_entity *dl_se, *tmp;
+
+	list_for_each_entry_safe(dl_se, tmp, &rq->dl.throttled_list,
+				 throttled_node) {
+		list_del_init(&dl_se->throttled_node);
+		dl_se->dl_throttled = 0;
+		enqueue_task_dl(rq, dl_task_of(dl_se), ENQUEUE_REPLENISH);
+	}
+}
+#endif
+
+#endif /* CONFIG_SMP */
+
+static void task_tick_dl(struct rq *rq, struct task_struct *p, int queued)
+{
+	update_curr_dl(rq);
+
+#ifdef CONFIG_SCHED_HRTICK
+	if (hrtick_enabled(rq) && queued && p->dl.runtime > 0 &&
+	    is_leftmost(p, &rq->dl))
+		start_hrtick_dl(rq, p);
+#endif
+}
+
+/*
+ * The task exits: give its bandwidth back.  Its timer can only be pending
+ * if it was throttled, and the rq lock is no longer held here.
+ */
+static void task_dead_dl(struct task_struct *p)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&def_dl_bandwidth.lock, flags);
+	def_dl_bandwidth.total_bw -= p->dl.dl_bw;
+	p->dl.dl_bw = 0;
+	raw_spin_unlock_irqrestore(&def_dl_bandwidth.lock, flags);
+
+	if (hrtimer_cancel(&p->dl.dl_timer))
+		put_task_struct(p);
+}
+
+static void set_curr_task_dl(struct rq *rq)
+{
+	struct task_struct *p = rq->curr;
+
+	p->se.exec_start = rq->clock_task;
+}
+
+static void switched_from_dl(struct rq *rq, struct task_struct *p)
+{
+	/* a timer that is running already sees the task left the class */
+	p->dl.dl_throttled = 0;
+	list_del_init(&p->dl.throttled_node);
+	try_cancel_dl_timer(p);
+
+#ifdef CONFIG_SMP
+	/*
+	 * If this was the last deadline task of the cpu, tasks queued
+	 * elsewhere may run here now.
+	 */
+	if (p->on_rq && !rq->dl.dl_nr_running)
+		pull_dl_task(rq);
+#endif
+}
+
+static void switched_to_dl(struct rq *rq, struct task_struct *p)
+{
+	int check_resched = 1;
+
+	if (!p->on_rq || rq->curr == p)
+		return;
+
+#ifdef CONFIG_SMP
+	if (rq->dl.overloaded && push_dl_task(rq) && rq != task_rq(p))
+		/* Don't resched if we changed runqueues */
+		check_resched = 0;
+#endif
+	if (check_resched) {
+		if (dl_task(rq->curr))
+			check_preempt_curr_dl(rq, p, 0);
+		else
+			resched_task(rq->curr);
+	}
+}
+
+/*
+ * The priority of a deadline task never changes, this is called when it
+ * gets a new reservation, and thus a new deadline.
+ */
+static void
+prio_changed_dl(struct rq *rq, struct task_struct *p, int oldprio)
+{
+	if (!p->on_rq)
+		return;
+
+	if (rq->curr == p) {
+#ifdef CONFIG_SMP
+		/* its deadline may have got later */
+		pull_dl_task(rq);
+#endif
+		if (rq->curr == p && !is_leftmost(p, &rq->dl))
+			resched_task(p);
+	} else if (!dl_task(rq->curr) ||
+		   dl_time_before(p->dl.deadline, rq->curr->dl.deadline))
+		resched_task(rq->curr);
+}
+
+static unsigned int get_rr_interval_dl(struct rq *rq, struct task_struct *task)
+{
+	return 0;
+}
+
+static const struct sched_class dl_sched_class = {
+	.next			= &rt_sched_class,
+	.enqueue_task		= enqueue_task_dl,
+	.dequeue_task		= dequeue_task_dl,
+	.yield_task		= yield_task_dl,
+
+	.check_preempt_curr	= check_preempt_curr_dl,
+
+	.pick_next_task		= pick_next_task_dl,
+	.put_prev_task		= put_prev_task_dl,
+
+#ifdef CONFIG_SMP
+	.select_task_rq		= select_task_rq_dl,
+
+	.set_cpus_allowed       = set_cpus_allowed_dl,
+	.rq_online              = rq_online_dl,
+	.rq_offline             = rq_offline_dl,
+	.pre_schedule		= pre_schedule_dl,
+	.post_schedule		= post_schedule_dl,
+	.task_woken		= task_woken_dl,
+#endif
+
+	.set_curr_task          = set_curr_task_dl,
+	.task_tick		= task_tick_dl,
+	.task_dead		= task_dead_dl,
+
+	.get_rr_interval	= get_rr_interval_dl,
+
+	.prio_changed		= prio_changed_dl,
+	.switched_from		= switched_from_dl,
+	.switched_to		= switched_to_dl,
+};
@@ -72,3 +72,21 @@ SCHED_FEAT(NONIRQ_POWER, 1)
 SCHED_FEAT(TTWU_QUEUE, 1)
 
 SCHED_FEAT(FORCE_SD_OVERLAP, 0)
+
+/*
+ * Balance load, and distribute group shares, by the decayed runnable
+ * load of the fair entities instead of their queued weight.
+ */
+SCHED_FEAT(LB_LOAD_AVG, 1)
+
+/*
+ * Keep a sync wakee on the cpu of a waker it ping-pongs with, rather
+ * than on an idle sibling, see wake_pair().
+ */
+SCHED_FEAT(WAKE_PAIR, 1)
+
+/*
+ * Try the cpu of the cache that went idle last before scanning the cache
+ * domain for an idle cpu on wakeup.
+ */
+SCHED_FEAT(LLC_IDLE_HINT, 1)
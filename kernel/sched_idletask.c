@@ -24,6 +24,7 @@ static struct task_struct *pick_next_task_idle(struct rq *rq)
 {
 	schedstat_inc(rq, sched_goidle);
 	calc_load_account_idle(rq);
+	set_llc_idle_hint(cpu_of(rq));
 	return rq->idle;
 }
 
@@ -4,7 +4,16 @@
  * bump this up when changing the output format or the meaning of an existing
  * format, so that tools can adapt (or abort)
  */
-#define SCHEDSTAT_VERSION 15
+#define SCHEDSTAT_VERSION 16
+
+static void show_hist(struct seq_file *seq, unsigned int *hist, int buckets)
+{
+	int i;
+
+	for (i = 0; i < buckets; i++)
+		seq_printf(seq, " %u", hist[i]);
+	seq_printf(seq, "\n");
+}
 
 static int show_schedstat(struct seq_file *seq, void *v)
 {
@@ -35,6 +44,14 @@ static int show_schedstat(struct seq_file *seq, void *v)
 
 		seq_printf(seq, "\n");
 
+		/* histograms */
+		seq_printf(seq, "lat_rt");
+		show_hist(seq, rq->lat_hist[SCHED_LAT_RT], SCHED_LAT_BUCKETS);
+		seq_printf(seq, "lat_fair");
+		show_hist(seq, rq->lat_hist[SCHED_LAT_FAIR], SCHED_LAT_BUCKETS);
+		seq_printf(seq, "nr_running");
+		show_hist(seq, rq->nr_running_hist, SCHED_NR_RUNNING_BUCKETS);
+
 #ifdef CONFIG_SMP
 		/* domain-specific stats */
 		rcu_read_lock();
@@ -73,7 +90,7 @@ static int show_schedstat(struct seq_file *seq, void *v)
 
 static int schedstat_open(struct inode *inode, struct file *file)
 {
-	unsigned int size = PAGE_SIZE * (1 + num_online_cpus() / 32);
+	unsigned int size = PAGE_SIZE * (1 + num_online_cpus() / 8);
 	char *buf = kmalloc(size, GFP_KERNEL);
 	struct seq_file *m;
 	int res;
@@ -90,16 +107,38 @@ static int schedstat_open(struct inode *inode, struct file *file)
 	return res;
 }
 
+/*
+ * Any write clears the histograms of all cpus, the counters keep going.
+ */
+static ssize_t schedstat_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+
+		raw_spin_lock_irqsave(&rq->lock, flags);
+		memset(rq->lat_hist, 0, sizeof(rq->lat_hist));
+		memset(rq->nr_running_hist, 0, sizeof(rq->nr_running_hist));
+		raw_spin_unlock_irqrestore(&rq->lock, flags);
+	}
+	return count;
+}
+
 static const struct file_operations proc_schedstat_operations = {
 	.open    = schedstat_open,
 	.read    = seq_read,
+	.write   = schedstat_write,
 	.llseek  = seq_lseek,
 	.release = single_release,
 };
 
 static int __init proc_schedstat_init(void)
 {
-	proc_create("schedstat", 0, NULL, &proc_schedstat_operations);
+	proc_create("schedstat", S_IRUGO | S_IWUSR, NULL,
+		    &proc_schedstat_operations);
 	return 0;
 }
 module_init(proc_schedstat_init);
@@ -132,6 +171,40 @@ rq_sched_info_dequeued(struct rq *rq, unsigned long long delta)
 	if (rq)
 		rq->rq_sched_info.run_delay += delta;
 }
+
+/*
+ * Called with the runqueue lock held when @next is about to run: if it
+ * was woken up since it last ran, account how long it took to get here.
+ */
+static inline void sched_lat_arrive(struct rq *rq, struct task_struct *next)
+{
+	s64 delta;
+	int bucket;
+
+	if (!next->se.statistics.wakeup_start)
+		return;
+
+	/* may have been woken up on another cpu, by another clock */
+	delta = rq->clock - next->se.statistics.wakeup_start;
+	next->se.statistics.wakeup_start = 0;
+	if (delta < 0)
+		delta = 0;
+
+	bucket = min(fls64(delta >> SCHED_LAT_SHIFT), SCHED_LAT_BUCKETS - 1);
+	if (task_has_rt_policy(next) || task_has_dl_policy(next))
+		rq->lat_hist[SCHED_LAT_RT][bucket]++;
+	else
+		rq->lat_hist[SCHED_LAT_FAIR][bucket]++;
+}
+
+/*
+ * Called at the tick with the runqueue lock held.
+ */
+static inline void sched_nr_running_sample(struct rq *rq)
+{
+	rq->nr_running_hist[min_t(unsigned long, rq->nr_running,
+				  SCHED_NR_RUNNING_BUCKETS - 1)]++;
+}
 # define schedstat_inc(rq, field)	do { (rq)->field++; } while (0)
 # define schedstat_add(rq, field, amt)	do { (rq)->field += (amt); } while (0)
 # define schedstat_set(var, val)	do { var = (val); } while (0)
@@ -145,6 +218,10 @@ rq_sched_info_dequeued(struct rq *rq, unsigned long long delta)
 static inline void
 rq_sched_info_depart(struct rq *rq, unsigned long long delta)
 {}
+static inline void sched_lat_arrive(struct rq *rq, struct task_struct *next)
+{}
+static inline void sched_nr_running_sample(struct rq *rq)
+{}
 # define schedstat_inc(rq, field)	do { } while (0)
 # define schedstat_add(rq, field, amt)	do { } while (0)
 # define schedstat_set(var, val)	do { } while (0)
@@ -1804,6 +1804,44 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 			else
 				error = PR_MCE_KILL_DEFAULT;
 			break;
+		case PR_SET_LATENCY_NICE:
+			if (arg4 | arg5)
+				return -EINVAL;
+			error = sched_set_latency_nice((pid_t)arg3, (int)arg2);
+			break;
+		case PR_GET_LATENCY_NICE: {
+			int latency_nice;
+
+			if (arg4 | arg5)
+				return -EINVAL;
+			error = sched_get_latency_nice((pid_t)arg3,
+						       &latency_nice);
+			if (!error)
+				error = put_user(latency_nice, (int __user *)arg2);
+			break;
+		}
+		case PR_SET_DEADLINE: {
+			struct sched_dl_param param;
+
+			if (arg4 | arg5)
+				return -EINVAL;
+			if (copy_from_user(&param, (void __user *)arg2,
+					   sizeof(param)))
+				return -EFAULT;
+			error = sched_set_deadline((pid_t)arg3, &param);
+			break;
+		}
+		case PR_GET_DEADLINE: {
+			struct sched_dl_param param;
+
+			if (arg4 | arg5)
+				return -EINVAL;
+			error = sched_get_deadline((pid_t)arg3, &param);
+			if (!error && copy_to_user((void __user *)arg2, &param,
+						   sizeof(param)))
+				error = -EFAULT;
+			break;
+		}
 		default:
 			error = -EINVAL;
 			break;
@@ -41,6 +41,10 @@
 #include <linux/debug_locks.h>
 #include <linux/lockdep.h>
 #include <linux/idr.h>
+#include <linux/hash.h>
+#include <linux/vmalloc.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "workqueue_sched.h"
 
@@ -167,6 +171,15 @@ struct global_cwq {
 	unsigned int		trustee_state;	/* L: trustee state */
 	wait_queue_head_t	trustee_wait;	/* trustee wait */
 	struct worker		*first_idle;	/* L: first idle worker */
+
+#ifdef CONFIG_WORKQUEUE_STATS
+	/* concurrency management, counted since boot */
+	unsigned long		nr_created;	/* L: workers started */
+	unsigned long		nr_destroyed;	/* L: workers destroyed */
+	unsigned long		nr_cm_wakeups;	/* X: wakeups for sleepers */
+	unsigned long		nr_mayday;	/* L: rescuers summoned */
+	unsigned long		nr_rescued;	/* L: works run by rescuers */
+#endif
 } ____cacheline_aligned_in_smp;
 
 /*
@@ -569,6 +582,206 @@ static struct global_cwq *get_work_gcwq(struct work_struct *work)
 	return get_gcwq(cpu);
 }
 
+#ifdef CONFIG_WORKQUEUE_STATS
+/*
+ * Per work function statistics.
+ *
+ * While enabled through debugfs, every work item is timed from being
+ * queued (or, for delayed works, from the timer queueing it) to a
+ * worker claiming it, and while its function runs.  The times are
+ * accounted to the pair of the work function and the workqueue, in a
+ * table allocated on first use and never shrunk.  Entries are added
+ * under wq_stats_lock and found without it, the counters are atomic:
+ * works of the same function run on several cpus at once.
+ *
+ * Histogram bucket 0 counts times below 1 << WQ_STATS_LAT_SHIFT ns,
+ * bucket n those below 1 << (n + WQ_STATS_LAT_SHIFT) ns, the last
+ * bucket everything longer.
+ */
+#define WQ_STATS_BITS		9
+#define WQ_STATS_SIZE		(1 << WQ_STATS_BITS)
+#define WQ_STATS_NAME_LEN	24
+#define WQ_STATS_LAT_SHIFT	10
+#define WQ_STATS_LAT_BUCKETS	24
+
+struct wq_func_stats {
+	work_func_t		func;		/* NULL while unused */
+	struct workqueue_struct	*wq;		/* NULL once destroyed */
+	char			name[WQ_STATS_NAME_LEN];
+	atomic_long_t		queued;
+	atomic_long_t		executed;
+	atomic_long_t		rescued;
+	atomic64_t		lat_sum, lat_max;	/* ns */
+	atomic64_t		exec_sum, exec_max;	/* ns */
+	atomic_t		lat_hist[WQ_STATS_LAT_BUCKETS];
+	atomic_t		exec_hist[WQ_STATS_LAT_BUCKETS];
+};
+
+static int wq_stats_active __read_mostly;
+static u64 wq_stats_since;		/* local_clock() when enabled */
+static struct wq_func_stats *wq_stats_table;
+static atomic_long_t wq_stats_dropped;	/* no room left in the table */
+static DEFINE_SPINLOCK(wq_stats_lock);
+static DEFINE_MUTEX(wq_stats_mutex);	/* enabling and disabling */
+
+/*
+ * Returns the table while enabled, or NULL.  The table is never freed
+ * once allocated, but the first enable publishes it concurrently.
+ */
+static struct wq_func_stats *wq_stats_enabled(void)
+{
+	if (likely(!ACCESS_ONCE(wq_stats_active)))
+		return NULL;
+	smp_rmb();	/* paired with smp_wmb() in wq_stats_enable_write() */
+	return ACCESS_ONCE(wq_stats_table);
+}
+
+static struct wq_func_stats *wq_stats_get(struct wq_func_stats *table,
+					  struct workqueue_struct *wq,
+					  work_func_t func)
+{
+	unsigned int i, h = hash_long((unsigned long)func ^
+				      (unsigned long)wq, WQ_STATS_BITS);
+	struct wq_func_stats *st = NULL;
+	unsigned long flags;
+
+	for (i = 0; i < WQ_STATS_SIZE; i++) {
+		st = &table[(h + i) & (WQ_STATS_SIZE - 1)];
+		if (!ACCESS_ONCE(st->func))
+			break;
+		smp_rmb();	/* paired with smp_wmb() below */
+		if (st->func == func && st->wq == wq)
+			return st;
+	}
+
+	/* not there yet, take the free entry unless someone beat us */
+	spin_lock_irqsave(&wq_stats_lock, flags);
+	for (; i < WQ_STATS_SIZE; i++) {
+		st = &table[(h + i) & (WQ_STATS_SIZE - 1)];
+		if (!st->func) {
+			st->wq = wq;
+			strlcpy(st->name, wq->name, sizeof(st->name));
+			smp_wmb();
+			st->func = func;
+			goto out;
+		}
+		if (st->func == func && st->wq == wq)
+			goto out;
+	}
+	st = NULL;
+	atomic_long_inc(&wq_stats_dropped);
+out:
+	spin_unlock_irqrestore(&wq_stats_lock, flags);
+	return st;
+}
+
+static void wq_stats_add(atomic64_t *sum, atomic64_t *max, atomic_t *hist,
+			 u64 ns)
+{
+	int bucket = fls64(ns >> WQ_STATS_LAT_SHIFT);
+	u64 old;
+
+	atomic64_add(ns, sum);
+	while (ns > (old = atomic64_read(max)))
+		if (atomic64_cmpxchg(max, old, ns) == old)
+			break;
+	atomic_inc(&hist[min(bucket, WQ_STATS_LAT_BUCKETS - 1)]);
+}
+
+/* @work is being queued on @cwq, called with gcwq->lock held */
+static void wq_stats_queue(struct cpu_workqueue_struct *cwq,
+			   struct work_struct *work)
+{
+	struct wq_func_stats *table = wq_stats_enabled();
+	struct wq_func_stats *st;
+
+	if (!table)
+		return;
+	work->queued_at = local_clock();
+	st = wq_stats_get(table, cwq->wq, work->func);
+	if (st)
+		atomic_long_inc(&st->queued);
+}
+
+/*
+ * A worker claims @work, with gcwq->lock held and PENDING still set,
+ * so that it cannot be queued again and queued_at is still ours.
+ * Returns the entry to account the execution to, or NULL.
+ */
+static struct wq_func_stats *wq_stats_claim(struct cpu_workqueue_struct *cwq,
+					    struct work_struct *work)
+{
+	struct wq_func_stats *table = wq_stats_enabled();
+	struct wq_func_stats *st;
+	u64 now, queued_at = work->queued_at;
+
+	work->queued_at = 0;
+	if (!table)
+		return NULL;
+	st = wq_stats_get(table, cwq->wq, work->func);
+	if (!st)
+		return NULL;
+	now = local_clock();
+	/* not queued while enabled, or on a cpu whose clock is ahead */
+	if (queued_at >= wq_stats_since && queued_at <= now)
+		wq_stats_add(&st->lat_sum, &st->lat_max, st->lat_hist,
+			     now - queued_at);
+	return st;
+}
+
+static void wq_stats_exec(struct wq_func_stats *st, u64 ns)
+{
+	atomic_long_inc(&st->executed);
+	wq_stats_add(&st->exec_sum, &st->exec_max, st->exec_hist, ns);
+}
+
+/* a rescuer takes @work over, with gcwq->lock held */
+static void wq_stats_rescue(struct cpu_workqueue_struct *cwq,
+			    struct work_struct *work)
+{
+	struct wq_func_stats *table = wq_stats_enabled();
+	struct wq_func_stats *st;
+
+	cwq->gcwq->nr_rescued++;
+	if (!table)
+		return;
+	st = wq_stats_get(table, cwq->wq, work->func);
+	if (st)
+		atomic_long_inc(&st->rescued);
+}
+
+/* @wq is going away, its address may come back for another one */
+static void wq_stats_forget(struct workqueue_struct *wq)
+{
+	int i;
+
+	mutex_lock(&wq_stats_mutex);
+	spin_lock_irq(&wq_stats_lock);
+	for (i = 0; wq_stats_table && i < WQ_STATS_SIZE; i++)
+		if (wq_stats_table[i].wq == wq)
+			wq_stats_table[i].wq = NULL;
+	spin_unlock_irq(&wq_stats_lock);
+	mutex_unlock(&wq_stats_mutex);
+}
+
+#define wq_stats_inc(gcwq, field)	((gcwq)->field++)
+#else
+struct wq_func_stats;
+
+static inline void wq_stats_queue(struct cpu_workqueue_struct *cwq,
+				  struct work_struct *work) { }
+static inline struct wq_func_stats *
+wq_stats_claim(struct cpu_workqueue_struct *cwq, struct work_struct *work)
+{
+	return NULL;
+}
+static inline void wq_stats_exec(struct wq_func_stats *st, u64 ns) { }
+static inline void wq_stats_rescue(struct cpu_workqueue_struct *cwq,
+				   struct work_struct *work) { }
+static inline void wq_stats_forget(struct workqueue_struct *wq) { }
+#define wq_stats_inc(gcwq, field)	do { } while (0)
+#endif
+
 /*
  * Policy functions.  These define the policies on how the global
  * worker pool is managed.  Unless noted otherwise, these functions
@@ -718,6 +931,8 @@ struct task_struct *wq_worker_sleeping(struct task_struct *task,
 	 */
 	if (atomic_dec_and_test(nr_running) && !list_empty(&gcwq->worklist))
 		to_wakeup = first_worker(gcwq);
+	if (to_wakeup)
+		wq_stats_inc(gcwq, nr_cm_wakeups);
 	return to_wakeup ? to_wakeup->task : NULL;
 }
 
@@ -1035,6 +1250,7 @@ static void __queue_work(unsigned int cpu, struct workqueue_struct *wq,
 	/* gcwq determined, get cwq and queue */
 	cwq = get_cwq(gcwq->cpu, wq);
 	trace_workqueue_queue_work(cpu, cwq, work);
+	wq_stats_queue(cwq, work);
 
 	BUG_ON(!list_empty(&work->entry));
 
@@ -1426,6 +1642,9 @@ static void start_worker(struct worker *worker)
 {
 	worker->flags |= WORKER_STARTED;
 	worker->gcwq->nr_workers++;
+	wq_stats_inc(worker->gcwq, nr_created);
+	trace_workqueue_worker_create(worker->gcwq->cpu, worker->id,
+				      worker->gcwq->nr_workers);
 	worker_enter_idle(worker);
 	wake_up_process(worker->task);
 }
@@ -1452,6 +1671,8 @@ static void destroy_worker(struct worker *worker)
 		gcwq->nr_workers--;
 	if (worker->flags & WORKER_IDLE)
 		gcwq->nr_idle--;
+	wq_stats_inc(gcwq, nr_destroyed);
+	trace_workqueue_worker_destroy(gcwq->cpu, id, gcwq->nr_workers);
 
 	list_del_init(&worker->entry);
 	worker->flags |= WORKER_DIE;
@@ -1505,8 +1726,11 @@ static bool send_mayday(struct work_struct *work)
 	/* WORK_CPU_UNBOUND can't be set in cpumask, use cpu 0 instead */
 	if (cpu == WORK_CPU_UNBOUND)
 		cpu = 0;
-	if (!mayday_test_and_set_cpu(cpu, wq->mayday_mask))
+	if (!mayday_test_and_set_cpu(cpu, wq->mayday_mask)) {
+		trace_workqueue_mayday(cwq, work);
+		wq_stats_inc(cwq->gcwq, nr_mayday);
 		wake_up_process(wq->rescuer->task);
+	}
 	return true;
 }
 
@@ -1811,6 +2035,8 @@ __acquires(&gcwq->lock)
 	work_func_t f = work->func;
 	int work_color;
 	struct worker *collision;
+	struct wq_func_stats *stats;
+	u64 exec_start = 0;
 #ifdef CONFIG_LOCKDEP
 	/*
 	 * It is permissible to free the struct work_struct from
@@ -1843,6 +2069,7 @@ __acquires(&gcwq->lock)
 	/* record the current cpu number in the work data and dequeue */
 	set_work_cpu(work, gcwq->cpu);
 	list_del_init(&work->entry);
+	stats = wq_stats_claim(cwq, work);
 
 	/*
 	 * If HIGHPRI_PENDING, check the next work, and, if HIGHPRI,
@@ -1874,7 +2101,11 @@ __acquires(&gcwq->lock)
 	lock_map_acquire_read(&cwq->wq->lockdep_map);
 	lock_map_acquire(&lockdep_map);
 	trace_workqueue_execute_start(work);
+	if (stats)
+		exec_start = local_clock();
 	f(work);
+	if (stats)
+		wq_stats_exec(stats, local_clock() - exec_start);
 	/*
 	 * While we must be careful to not use "work" after this, the trace
 	 * point will only record its address.
@@ -2072,8 +2303,11 @@ repeat:
 		 */
 		BUG_ON(!list_empty(&rescuer->scheduled));
 		list_for_each_entry_safe(work, n, &gcwq->worklist, entry)
-			if (get_work_cwq(work) == cwq)
+			if (get_work_cwq(work) == cwq) {
+				trace_workqueue_rescue_work(cwq, work);
+				wq_stats_rescue(cwq, work);
 				move_linked_works(work, scheduled, &n);
+			}
 
 		process_scheduled_works(rescuer);
 
@@ -3079,6 +3313,7 @@ reflush:
 		kfree(wq->rescuer);
 	}
 
+	wq_stats_forget(wq);
 	free_cwqs(wq);
 	kfree(wq);
 }
@@ -3845,3 +4080,244 @@ static int __init init_workqueues(void)
 	return 0;
 }
 early_initcall(init_workqueues);
+
+#ifdef CONFIG_WORKQUEUE_STATS
+/*
+ * debugfs interface: workqueue/enable starts and stops the timing of
+ * work items, workqueue/functions and workqueue/histograms show it,
+ * per work function and workqueue, and workqueue/pools shows the
+ * concurrency management counters of each gcwq.
+ */
+static int wq_stats_enable_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "%d\n", wq_stats_active);
+	return 0;
+}
+
+static int wq_stats_enable_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_stats_enable_show, NULL);
+}
+
+static ssize_t wq_stats_enable_write(struct file *file,
+				     const char __user *ubuf,
+				     size_t count, loff_t *ppos)
+{
+	char buf[8];
+	bool on;
+	int ret = count;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+	if (strtobool(buf, &on))
+		return -EINVAL;
+
+	mutex_lock(&wq_stats_mutex);
+	if (on && !wq_stats_table) {
+		wq_stats_table = vzalloc(WQ_STATS_SIZE *
+					 sizeof(*wq_stats_table));
+		if (!wq_stats_table)
+			ret = -ENOMEM;
+	}
+	if (ret > 0 && on != wq_stats_active) {
+		wq_stats_since = local_clock();
+		smp_wmb();	/* the table and since before active */
+		wq_stats_active = on;
+	}
+	mutex_unlock(&wq_stats_mutex);
+	return ret;
+}
+
+static const struct file_operations wq_stats_enable_fops = {
+	.open		= wq_stats_enable_open,
+	.read		= seq_read,
+	.write		= wq_stats_enable_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static u64 wq_stats_avg_us(atomic64_t *sum, long nr)
+{
+	return nr ? div_u64(atomic64_read(sum), nr * NSEC_PER_USEC) : 0;
+}
+
+static int wq_stats_functions_show(struct seq_file *m, void *v)
+{
+	struct wq_func_stats *st;
+	long executed;
+	int i;
+
+	seq_printf(m, "# %-14s %-40s %8s %8s %7s %8s %8s %8s %8s\n",
+		   "workqueue", "function", "queued", "executed", "rescued",
+		   "lat_avg", "lat_max", "exec_avg", "exec_max");
+	mutex_lock(&wq_stats_mutex);
+	for (i = 0; wq_stats_table && i < WQ_STATS_SIZE; i++) {
+		st = &wq_stats_table[i];
+		if (!st->func)
+			continue;
+		executed = atomic_long_read(&st->executed);
+		seq_printf(m, "%-16s %-40pf %8ld %8ld %7ld %8llu %8llu %8llu "
+			   "%8llu\n", st->name, st->func,
+			   atomic_long_read(&st->queued), executed,
+			   atomic_long_read(&st->rescued),
+			   wq_stats_avg_us(&st->lat_sum, executed),
+			   div_u64(atomic64_read(&st->lat_max), NSEC_PER_USEC),
+			   wq_stats_avg_us(&st->exec_sum, executed),
+			   div_u64(atomic64_read(&st->exec_max),
+				   NSEC_PER_USEC));
+	}
+	mutex_unlock(&wq_stats_mutex);
+	seq_printf(m, "# times in usecs, %ld works not accounted for lack "
+		   "of room\n", atomic_long_read(&wq_stats_dropped));
+	return 0;
+}
+
+static int wq_stats_functions_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_stats_functions_show, NULL);
+}
+
+/* writing "reset" clears the counters, the entries stay */
+static ssize_t wq_stats_functions_write(struct file *file,
+					const char __user *ubuf,
+					size_t count, loff_t *ppos)
+{
+	struct wq_func_stats *st;
+	char buf[8];
+	int i, j;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+	if (strcmp(strim(buf), "reset"))
+		return -EINVAL;
+
+	mutex_lock(&wq_stats_mutex);
+	for (i = 0; wq_stats_table && i < WQ_STATS_SIZE; i++) {
+		st = &wq_stats_table[i];
+		atomic_long_set(&st->queued, 0);
+		atomic_long_set(&st->executed, 0);
+		atomic_long_set(&st->rescued, 0);
+		atomic64_set(&st->lat_sum, 0);
+		atomic64_set(&st->lat_max, 0);
+		atomic64_set(&st->exec_sum, 0);
+		atomic64_set(&st->exec_max, 0);
+		for (j = 0; j < WQ_STATS_LAT_BUCKETS; j++) {
+			atomic_set(&st->lat_hist[j], 0);
+			atomic_set(&st->exec_hist[j], 0);
+		}
+	}
+	atomic_long_set(&wq_stats_dropped, 0);
+	/* works queued before the reset have no latency to count */
+	wq_stats_since = local_clock();
+	mutex_unlock(&wq_stats_mutex);
+	return count;
+}
+
+static const struct file_operations wq_stats_functions_fops = {
+	.open		= wq_stats_functions_open,
+	.read		= seq_read,
+	.write		= wq_stats_functions_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void wq_stats_show_hist(struct seq_file *m, struct wq_func_stats *st,
+			       const char *what, atomic_t *hist)
+{
+	int i;
+
+	seq_printf(m, "%s %pf %s", st->name, st->func, what);
+	for (i = 0; i < WQ_STATS_LAT_BUCKETS; i++)
+		seq_printf(m, " %u", atomic_read(&hist[i]));
+	seq_putc(m, '\n');
+}
+
+static int wq_stats_histograms_show(struct seq_file *m, void *v)
+{
+	struct wq_func_stats *st;
+	int i;
+
+	mutex_lock(&wq_stats_mutex);
+	for (i = 0; wq_stats_table && i < WQ_STATS_SIZE; i++) {
+		st = &wq_stats_table[i];
+		if (!st->func)
+			continue;
+		wq_stats_show_hist(m, st, "lat", st->lat_hist);
+		wq_stats_show_hist(m, st, "exec", st->exec_hist);
+	}
+	mutex_unlock(&wq_stats_mutex);
+	return 0;
+}
+
+static int wq_stats_histograms_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_stats_histograms_show, NULL);
+}
+
+static const struct file_operations wq_stats_histograms_fops = {
+	.open		= wq_stats_histograms_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int wq_stats_pools_show(struct seq_file *m, void *v)
+{
+	unsigned int cpu;
+
+	seq_printf(m, "# cpu workers idle  created destroyed cm_wakeups "
+		   "  mayday  rescued\n");
+	for_each_gcwq_cpu(cpu) {
+		struct global_cwq *gcwq = get_gcwq(cpu);
+
+		if (cpu == WORK_CPU_UNBOUND)
+			seq_printf(m, "%5s", "u");
+		else
+			seq_printf(m, "%5u", cpu);
+		spin_lock_irq(&gcwq->lock);
+		seq_printf(m, " %7d %4d %8lu %9lu %10lu %8lu %8lu\n",
+			   gcwq->nr_workers, gcwq->nr_idle, gcwq->nr_created,
+			   gcwq->nr_destroyed, gcwq->nr_cm_wakeups,
+			   gcwq->nr_mayday, gcwq->nr_rescued);
+		spin_unlock_irq(&gcwq->lock);
+	}
+	return 0;
+}
+
+static int wq_stats_pools_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_stats_pools_show, NULL);
+}
+
+static const struct file_operations wq_stats_pools_fops = {
+	.open		= wq_stats_pools_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init wq_stats_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("workqueue", NULL);
+	if (!dir)
+		return -ENOMEM;
+	debugfs_create_file("enable", S_IRUGO | S_IWUSR, dir, NULL,
+			    &wq_stats_enable_fops);
+	debugfs_create_file("functions", S_IRUGO | S_IWUSR, dir, NULL,
+			    &wq_stats_functions_fops);
+	debugfs_create_file("histograms", S_IRUGO, dir, NULL,
+			    &wq_stats_histograms_fops);
+	debugfs_create_file("pools", S_IRUGO, dir, NULL,
+			    &wq_stats_pools_fops);
+	return 0;
+}
+late_initcall(wq_stats_init);
+#endif
@@ -0,0 +1,154 @@
+/*
+ * Test of the per-entity load tracking of the fair scheduling class
+ *
+ * Runs a kernel thread bound to one cpu through cycles of spinning and
+ * sleeping with a known duty cycle, for 10% to 90% of each period.  Once
+ * the averages had time to settle, the utilization the scheduler tracks
+ * for the thread, sched_task_util(), is sampled at the start and the end
+ * of each busy phase and compared with the fraction of the time the
+ * thread actually ran.
+ *
+ * Results go to the kernel log when the module is loaded, and loading
+ * fails with -EINVAL if a utilization is off by more than tolerance
+ * percent.  The cpu should be otherwise idle; a warning is printed when
+ * the thread got noticeably less than its duty cycle.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/sched.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/delay.h>
+#include <linux/cpu.h>
+#include <linux/math64.h>
+
+static int cpu;
+module_param(cpu, int, 0444);
+MODULE_PARM_DESC(cpu, "Cpu to run the test on");
+
+static int period_ms = 10;
+module_param(period_ms, int, 0444);
+MODULE_PARM_DESC(period_ms, "Length of one busy and idle cycle");
+
+static int settle_ms = 1000;
+module_param(settle_ms, int, 0444);
+MODULE_PARM_DESC(settle_ms, "Time to run before sampling");
+
+static int sample_periods = 100;
+module_param(sample_periods, int, 0444);
+MODULE_PARM_DESC(sample_periods, "Periods to sample the utilization over");
+
+static int tolerance = 10;
+module_param(tolerance, int, 0444);
+MODULE_PARM_DESC(tolerance, "Allowed error, in percent of full utilization");
+
+static const int test_duty[] = { 10, 25, 50, 75, 90 };
+
+struct duty_test {
+	int duty;		/* percent of the period spent busy */
+	unsigned long util;	/* mean sched_task_util() */
+	unsigned long ran;	/* fraction of the time run, same scale */
+	struct completion done;
+};
+
+static void spin_ns(u64 ns)
+{
+	u64 end = local_clock() + ns;
+
+	while (local_clock() < end)
+		cpu_relax();
+}
+
+static int duty_thread(void *data)
+{
+	struct duty_test *t = data;
+	u64 period = (u64)period_ms * NSEC_PER_MSEC;
+	u64 busy = div_u64(period * t->duty, 100);
+	unsigned long idle_us = div_u64(period - busy, NSEC_PER_USEC);
+	int settle = settle_ms / period_ms;
+	u64 start = 0, exec = 0, sum = 0;
+	int i;
+
+	for (i = 0; i < settle + sample_periods; i++) {
+		if (i == settle) {
+			start = local_clock();
+			exec = current->se.sum_exec_runtime;
+		}
+		if (i >= settle)
+			sum += sched_task_util(current);
+		spin_ns(busy);
+		if (i >= settle)
+			sum += sched_task_util(current);
+		usleep_range(idle_us, idle_us);
+	}
+
+	exec = current->se.sum_exec_runtime - exec;
+	t->ran = div64_u64(exec << SCHED_LOAD_SHIFT, local_clock() - start);
+	t->util = div_u64(sum, 2 * sample_periods);
+	complete(&t->done);
+	return 0;
+}
+
+static int run_duty(int duty)
+{
+	struct duty_test t = { .duty = duty };
+	unsigned long nominal = duty * SCHED_LOAD_SCALE / 100;
+	unsigned long slack = tolerance * SCHED_LOAD_SCALE / 100;
+	struct task_struct *task;
+	bool ok;
+
+	init_completion(&t.done);
+	task = kthread_create(duty_thread, &t, "sched_avg_test/%d", cpu);
+	if (IS_ERR(task))
+		return PTR_ERR(task);
+	kthread_bind(task, cpu);
+	wake_up_process(task);
+	wait_for_completion(&t.done);
+
+	ok = abs((long)t.util - (long)t.ran) <= slack;
+	printk(KERN_INFO "sched_avg_test: duty %2d%%: ran %4lu util_avg %4lu "
+	       "of %ld: %s\n", duty, t.ran, t.util, SCHED_LOAD_SCALE,
+	       ok ? "ok" : "FAILED");
+	if (t.ran + slack < nominal)
+		printk(KERN_WARNING "sched_avg_test: cpu %d is not idle, "
+		       "expected to run %lu\n", cpu, nominal);
+	return ok ? 0 : -EINVAL;
+}
+
+static int __init sched_avg_test_init(void)
+{
+	int i, ret, err = 0;
+
+	if (period_ms <= 0 || settle_ms < 0 || sample_periods <= 0 ||
+	    tolerance < 0)
+		return -EINVAL;
+
+	get_online_cpus();
+	if (cpu < 0 || cpu >= nr_cpu_ids || !cpu_online(cpu)) {
+		put_online_cpus();
+		return -EINVAL;
+	}
+	for (i = 0; i < ARRAY_SIZE(test_duty); i++) {
+		ret = run_duty(test_duty[i]);
+		if (ret)
+			err = ret;
+		/* Go on after a mismatch, but not without a thread */
+		if (ret && ret != -EINVAL)
+			break;
+	}
+	put_online_cpus();
+	return err;
+}
+
+static void __exit sched_avg_test_exit(void)
+{
+}
+
+module_init(sched_avg_test_init);
+module_exit(sched_avg_test_exit);
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Test of the scheduler's per-entity load tracking");
@@ -0,0 +1,218 @@
+/*
+ * Slab allocator microbenchmark
+ *
+ * Measures the time spent in kmalloc() and kfree() for a range of
+ * object sizes, in ns per call:
+ *
+ *  - one cpu allocating a batch of objects, then freeing them all,
+ *  - one cpu allocating and immediately freeing an object,
+ *  - 2, 4, ... up to all online cpus doing the first test at once,
+ *  - the same, but each cpu freeing the objects of its neighbour, which
+ *    is the pattern of objects handed over between cpus, as skbuffs are.
+ *
+ * Results go to the kernel log when the module is loaded. With
+ * CONFIG_SLUB_STATS, /sys/kernel/slab/kmalloc-<size>/ tells where the
+ * time went.
+ *
+ * Times are taken with local_clock(): get_cycles() is 0 on ARM. Each
+ * result is averaged over a whole batch, so a coarse sched_clock only
+ * costs precision on small batches.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+
+static int nr_objs = 10000;
+module_param(nr_objs, int, 0444);
+MODULE_PARM_DESC(nr_objs, "Objects allocated per cpu and test");
+
+/* Keep the largest sizes from eating all memory on big machines */
+#define BENCH_MAX_BYTES		(16 << 20)
+
+static const int bench_sizes[] = {
+	8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384
+};
+
+struct bench_thread {
+	struct task_struct *task;
+	void **objs;
+	void **free_objs;
+	u64 alloc_ns;
+	u64 free_ns;
+	struct completion done;
+};
+
+static struct bench_thread *bench_threads;
+static int bench_size;
+static int bench_nr;
+static int bench_nr_threads;
+static bool bench_remote;
+static atomic_t bench_start;
+static atomic_t bench_swap;
+
+/* Spin until all threads of the test got here */
+static void bench_sync(atomic_t *count)
+{
+	atomic_inc(count);
+	while (atomic_read(count) < bench_nr_threads)
+		cpu_relax();
+}
+
+static int bench_thread_fn(void *data)
+{
+	struct bench_thread *t = data;
+	u64 start;
+	int i;
+
+	bench_sync(&bench_start);
+
+	start = local_clock();
+	for (i = 0; i < bench_nr; i++)
+		t->objs[i] = kmalloc(bench_size, GFP_KERNEL);
+	t->alloc_ns = local_clock() - start;
+
+	/* Everybody has to be done allocating before objects change hands */
+	if (bench_remote)
+		bench_sync(&bench_swap);
+
+	start = local_clock();
+	for (i = 0; i < bench_nr; i++)
+		kfree(t->free_objs[i]);
+	t->free_ns = local_clock() - start;
+
+	complete(&t->done);
+	return 0;
+}
+
+static void bench_cpus(int nr_threads, bool remote)
+{
+	struct bench_thread *t;
+	u64 alloc = 0, free = 0;
+	int i, cpu, err = 0;
+
+	bench_nr_threads = nr_threads;
+	bench_remote = remote;
+	atomic_set(&bench_start, 0);
+	atomic_set(&bench_swap, 0);
+
+	i = 0;
+	for_each_online_cpu(cpu) {
+		if (i == nr_threads)
+			break;
+		t = &bench_threads[i];
+		t->free_objs = remote ?
+			bench_threads[(i + 1) % nr_threads].objs : t->objs;
+		init_completion(&t->done);
+		t->task = kthread_create(bench_thread_fn, t, "slab_bench/%d",
+					 cpu);
+		if (IS_ERR(t->task)) {
+			err = PTR_ERR(t->task);
+			break;
+		}
+		kthread_bind(t->task, cpu);
+		i++;
+	}
+
+	if (err) {
+		/* Threads stopped before they ran never call the function */
+		while (i--)
+			kthread_stop(bench_threads[i].task);
+		printk(KERN_ERR "slab_bench: cannot create threads: %d\n", err);
+		return;
+	}
+
+	for (i = 0; i < nr_threads; i++)
+		wake_up_process(bench_threads[i].task);
+	for (i = 0; i < nr_threads; i++) {
+		t = &bench_threads[i];
+		wait_for_completion(&t->done);
+		alloc += t->alloc_ns;
+		free += t->free_ns;
+	}
+
+	printk(KERN_INFO "slab_bench: %5d bytes x %5d, %3d cpus%s: "
+	       "alloc %6llu free %6llu ns\n", bench_size, bench_nr,
+	       nr_threads, remote ? " remote free" : "",
+	       div_u64(alloc, bench_nr * nr_threads),
+	       div_u64(free, bench_nr * nr_threads));
+}
+
+static void bench_pairs(void)
+{
+	u64 start;
+	int i;
+
+	start = local_clock();
+	for (i = 0; i < bench_nr; i++)
+		kfree(kmalloc(bench_size, GFP_KERNEL));
+	printk(KERN_INFO "slab_bench: %5d bytes x %5d,   1 cpu : "
+	       "alloc/free %6llu ns\n", bench_size, bench_nr,
+	       div_u64(local_clock() - start, bench_nr));
+}
+
+static int __init slab_bench_init(void)
+{
+	int nr_cpus, i, n, err = 0;
+
+	if (nr_objs <= 0 || nr_objs > INT_MAX / sizeof(void *))
+		return -EINVAL;
+
+	/* The threads of a test wait for each other on all online cpus */
+	get_online_cpus();
+	nr_cpus = num_online_cpus();
+
+	bench_threads = kcalloc(nr_cpus, sizeof(*bench_threads), GFP_KERNEL);
+	if (!bench_threads) {
+		put_online_cpus();
+		return -ENOMEM;
+	}
+	for (i = 0; i < nr_cpus; i++) {
+		bench_threads[i].objs = vmalloc(nr_objs * sizeof(void *));
+		if (!bench_threads[i].objs) {
+			err = -ENOMEM;
+			goto out;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+		bench_size = bench_sizes[i];
+		bench_nr = min(nr_objs, BENCH_MAX_BYTES / bench_size);
+
+		bench_cpus(1, false);
+		bench_pairs();
+		for (n = 2; n < nr_cpus; n *= 2) {
+			bench_cpus(n, false);
+			bench_cpus(n, true);
+		}
+		if (nr_cpus > 1) {
+			bench_cpus(nr_cpus, false);
+			bench_cpus(nr_cpus, true);
+		}
+	}
+out:
+	put_online_cpus();
+	for (i = 0; i < nr_cpus; i++)
+		vfree(bench_threads[i].objs);
+	kfree(bench_threads);
+	return err;
+}
+
+static void __exit slab_bench_exit(void)
+{
+}
+
+module_init(slab_bench_init);
+module_exit(slab_bench_exit);
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Slab allocator microbenchmark");
@@ -0,0 +1,308 @@
+/*
+ * mm/cma.c - Contiguous Memory Allocator
+ *
+ * This file is released under the GPLv2.
+ *
+ * Large physically contiguous buffers for devices without an IOMMU are
+ * usually served from carveouts removed from the kernel's memory at
+ * boot, which sit idle whenever the device is not running.  A CMA area
+ * is reserved at boot just the same, but its pageblocks are then given
+ * to the page allocator as MIGRATE_CMA.  The allocator only falls back
+ * to them for movable allocations, so whatever the system puts there in
+ * the meantime is page cache or anonymous memory that can be migrated
+ * away again.  cma_alloc() picks a free range of the area in its bitmap
+ * and has alloc_contig_range() isolate it and migrate the pages in use
+ * out of it.
+ */
+
+#include <linux/mm.h>
+#include <linux/memblock.h>
+#include <linux/bitmap.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/cma.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/module.h>
+#include <linux/init.h>
+
+struct cma {
+	unsigned long	base_pfn;
+	unsigned long	count;		/* in pages */
+	unsigned long	*bitmap;	/* one bit per page */
+	struct mutex	lock;		/* protects bitmap and statistics */
+	const char	*name;
+
+	unsigned long	used;		/* pages allocated */
+	unsigned long	allocs;
+	unsigned long	fails;
+	u64		total_us;	/* time spent in cma_alloc() */
+	u64		max_us;
+};
+
+static struct cma cma_areas[MAX_CMA_AREAS];
+static unsigned cma_area_count;
+
+/* Isolation of overlapping pageblock ranges does not nest */
+static DEFINE_MUTEX(cma_mutex);
+
+void __weak __init cma_early_fixup(phys_addr_t base, unsigned long size)
+{
+}
+
+phys_addr_t cma_get_base(struct cma *cma)
+{
+	return PFN_PHYS(cma->base_pfn);
+}
+
+unsigned long cma_get_size(struct cma *cma)
+{
+	return cma->count << PAGE_SHIFT;
+}
+
+/**
+ * cma_declare_contiguous - reserve a contiguous memory area
+ * @size: size of the area
+ * @base: physical base address of the area, or 0 for any
+ * @limit: end address the area must lie below, or 0 for no limit
+ * @name: name of the area for the statistics
+ * @res_cma: returns the area
+ *
+ * Called from the board reserve callbacks, while memblock is still in
+ * charge of memory.  @base and @size are aligned to the largest of the
+ * pageblock and buddy allocator orders, as the area is handed out in
+ * whole pageblocks.  The area becomes usable at core_initcall time.
+ */
+int __init cma_declare_contiguous(phys_addr_t size, phys_addr_t base,
+				  phys_addr_t limit, const char *name,
+				  struct cma **res_cma)
+{
+	struct cma *cma = &cma_areas[cma_area_count];
+	phys_addr_t alignment;
+
+	if (cma_area_count == ARRAY_SIZE(cma_areas)) {
+		pr_err("cma: not enough areas for %s\n", name);
+		return -ENOSPC;
+	}
+	if (!size)
+		return -EINVAL;
+
+	alignment = PAGE_SIZE << max_t(unsigned long, MAX_ORDER - 1,
+				       pageblock_order);
+	base = ALIGN(base, alignment);
+	size = ALIGN(size, alignment);
+	/* Allocate from memory the kernel already has mapped */
+	if (!limit || limit > memblock.current_limit)
+		limit = memblock.current_limit;
+	limit &= ~(alignment - 1);
+
+	if (base) {
+		if (memblock_is_region_reserved(base, size) ||
+		    memblock_reserve(base, size) < 0)
+			return -EBUSY;
+	} else {
+		base = __memblock_alloc_base(size, alignment, limit);
+		if (!base)
+			return -ENOMEM;
+	}
+
+	cma->base_pfn = PFN_DOWN(base);
+	cma->count = size >> PAGE_SHIFT;
+	cma->name = name;
+	mutex_init(&cma->lock);
+	*res_cma = cma;
+	cma_area_count++;
+	cma_early_fixup(base, size);
+
+	pr_info("cma: reserved %lu MiB at %08lx for %s\n",
+		(unsigned long)size >> 20, (unsigned long)base, name);
+	return 0;
+}
+
+static int __init cma_activate_area(struct cma *cma)
+{
+	unsigned long pfn, end_pfn = cma->base_pfn + cma->count;
+	struct zone *zone;
+
+	/* The whole area must lie within one zone for alloc_contig_range */
+	if (!pfn_valid(cma->base_pfn))
+		goto bad;
+	zone = page_zone(pfn_to_page(cma->base_pfn));
+	for (pfn = cma->base_pfn; pfn < end_pfn; pfn++)
+		if (!pfn_valid(pfn) || page_zone(pfn_to_page(pfn)) != zone)
+			goto bad;
+
+	cma->bitmap = kzalloc(BITS_TO_LONGS(cma->count) * sizeof(long),
+			      GFP_KERNEL);
+	if (!cma->bitmap)
+		goto bad;
+
+	for (pfn = cma->base_pfn; pfn < end_pfn; pfn += pageblock_nr_pages)
+		init_cma_reserved_pageblock(pfn_to_page(pfn));
+	return 0;
+
+bad:
+	pr_err("cma: area %s is unusable\n", cma->name);
+	cma->count = 0;
+	return -EINVAL;
+}
+
+static int __init cma_init_reserved_areas(void)
+{
+	unsigned i;
+
+	for (i = 0; i < cma_area_count; i++)
+		cma_activate_area(&cma_areas[i]);
+	return 0;
+}
+core_initcall(cma_init_reserved_areas);
+
+static void cma_clear_bitmap(struct cma *cma, unsigned long start,
+			     unsigned long count)
+{
+	mutex_lock(&cma->lock);
+	bitmap_clear(cma->bitmap, start, count);
+	mutex_unlock(&cma->lock);
+}
+
+/**
+ * cma_alloc - allocate pages from a contiguous memory area
+ * @cma: area to allocate from
+ * @count: number of pages
+ * @align: the buffer is aligned to 1 << @align pages
+ *
+ * Migrates the pages in use out of a free range of @cma and returns the
+ * first page of the range, or NULL.  Might sleep for a long time.
+ */
+struct page *cma_alloc(struct cma *cma, unsigned long count,
+		       unsigned int align)
+{
+	unsigned long mask = (1UL << align) - 1;
+	unsigned long start = 0, pfn;
+	struct page *page = NULL;
+	ktime_t starttime;
+	u64 usecs;
+	int ret;
+
+	if (!cma || !cma->count || !count)
+		return NULL;
+
+	starttime = ktime_get();
+	for (;;) {
+		mutex_lock(&cma->lock);
+		start = bitmap_find_next_zero_area(cma->bitmap, cma->count,
+						   start, count, mask);
+		if (start >= cma->count) {
+			mutex_unlock(&cma->lock);
+			break;
+		}
+		bitmap_set(cma->bitmap, start, count);
+		mutex_unlock(&cma->lock);
+
+		pfn = cma->base_pfn + start;
+		mutex_lock(&cma_mutex);
+		ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA);
+		mutex_unlock(&cma_mutex);
+		if (!ret) {
+			page = pfn_to_page(pfn);
+			break;
+		}
+		cma_clear_bitmap(cma, start, count);
+		if (ret != -EBUSY)
+			break;
+
+		/* Some page could not be migrated, try the next range */
+		start += mask + 1;
+	}
+	usecs = ktime_to_us(ktime_sub(ktime_get(), starttime));
+
+	mutex_lock(&cma->lock);
+	if (page) {
+		cma->used += count;
+		cma->allocs++;
+	} else
+		cma->fails++;
+	cma->total_us += usecs;
+	cma->max_us = max(cma->max_us, usecs);
+	mutex_unlock(&cma->lock);
+
+	return page;
+}
+EXPORT_SYMBOL_GPL(cma_alloc);
+
+/**
+ * cma_release - free pages allocated with cma_alloc()
+ * @cma: area the pages were allocated from
+ * @pages: first page of the buffer
+ * @count: number of pages
+ *
+ * Returns %false if @pages does not belong to @cma.
+ */
+bool cma_release(struct cma *cma, struct page *pages, unsigned long count)
+{
+	unsigned long pfn;
+
+	if (!cma || !pages)
+		return false;
+
+	pfn = page_to_pfn(pages);
+	if (pfn < cma->base_pfn || pfn >= cma->base_pfn + cma->count)
+		return false;
+	VM_BUG_ON(pfn + count > cma->base_pfn + cma->count);
+
+	free_contig_range(pfn, count);
+
+	mutex_lock(&cma->lock);
+	bitmap_clear(cma->bitmap, pfn - cma->base_pfn, count);
+	cma->used -= count;
+	mutex_unlock(&cma->lock);
+	return true;
+}
+EXPORT_SYMBOL_GPL(cma_release);
+
+#ifdef CONFIG_DEBUG_FS
+static int cma_stats_show(struct seq_file *m, void *unused)
+{
+	struct cma *cma;
+	unsigned i;
+
+	seq_printf(m, "%-16s %10s %8s %8s %8s %8s %10s %10s\n", "area",
+		   "base", "pages", "used", "allocs", "fails", "avg_us",
+		   "max_us");
+	for (i = 0; i < cma_area_count; i++) {
+		cma = &cma_areas[i];
+		mutex_lock(&cma->lock);
+		seq_printf(m, "%-16s 0x%08lx %8lu %8lu %8lu %8lu %10llu %10llu\n",
+			   cma->name, (unsigned long)cma_get_base(cma),
+			   cma->count, cma->used, cma->allocs, cma->fails,
+			   cma->allocs + cma->fails ?
+			   div_u64(cma->total_us, cma->allocs + cma->fails) : 0,
+			   cma->max_us);
+		mutex_unlock(&cma->lock);
+	}
+	return 0;
+}
+
+static int cma_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cma_stats_show, NULL);
+}
+
+static const struct file_operations cma_stats_fops = {
+	.open		= cma_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init cma_debugfs_init(void)
+{
+	if (cma_area_count)
+		debugfs_create_file("cma", S_IRUGO, NULL, NULL,
+				    &cma_stats_fops);
+	return 0;
+}
+late_initcall(cma_debugfs_init);
+#endif
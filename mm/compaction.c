@@ -14,6 +14,8 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -34,12 +36,19 @@ struct compact_control {
 	unsigned long free_pfn;		/* isolate_freepages search base */
 	unsigned long migrate_pfn;	/* isolate_migratepages search base */
 	bool sync;			/* Synchronous migration */
+	bool proactive;			/* kcompactd lowering fragmentation */
 
 	unsigned int order;		/* order a direct compactor needs */
 	int migratetype;		/* MOVABLE, RECLAIMABLE etc */
 	struct zone *zone;
 };
 
+/* Blocks holding only movable pages, scanned by async compaction too */
+static inline bool migrate_async_suitable(int migratetype)
+{
+	return is_migrate_cma(migratetype) || migratetype == MIGRATE_MOVABLE;
+}
+
 static unsigned long release_freepages(struct list_head *freelist)
 {
 	struct page *page, *next;
@@ -119,8 +128,8 @@ static bool suitable_migration_target(struct page *page)
 	if (PageBuddy(page) && page_order(page) >= pageblock_order)
 		return true;
 
-	/* If the block is MIGRATE_MOVABLE, allow migration */
-	if (migratetype == MIGRATE_MOVABLE)
+	/* If the block is MIGRATE_MOVABLE or MIGRATE_CMA, allow migration */
+	if (migrate_async_suitable(migratetype))
 		return true;
 
 	/* Otherwise skip the block */
@@ -351,7 +360,7 @@ static isolate_migrate_t isolate_migratepages(struct zone *zone,
 		 */
 		pageblock_nr = low_pfn >> pageblock_order;
 		if (!cc->sync && last_pageblock_nr != pageblock_nr &&
-				get_pageblock_migratetype(page) != MIGRATE_MOVABLE) {
+				!migrate_async_suitable(get_pageblock_migratetype(page))) {
 			low_pfn += pageblock_nr_pages;
 			low_pfn = ALIGN(low_pfn, pageblock_nr_pages) - 1;
 			last_pageblock_nr = pageblock_nr;
@@ -447,6 +456,9 @@ static void update_nr_listpages(struct compact_control *cc)
 	cc->nr_freepages = nr_freepages;
 }
 
+static bool kcompactd_cpu_busy(pg_data_t *pgdat);
+static bool fragmentation_score_zone_ok(struct zone *zone);
+
 static int compact_finished(struct zone *zone,
 			    struct compact_control *cc)
 {
@@ -460,6 +472,17 @@ static int compact_finished(struct zone *zone,
 	if (cc->free_pfn <= cc->migrate_pfn)
 		return COMPACT_COMPLETE;
 
+	/*
+	 * Proactive compaction stops once the zone is defragmented enough,
+	 * or as soon as the CPU is wanted for something else.
+	 */
+	if (cc->proactive) {
+		if (fragmentation_score_zone_ok(zone) ||
+		    kcompactd_cpu_busy(zone->zone_pgdat))
+			return COMPACT_PARTIAL;
+		return COMPACT_CONTINUE;
+	}
+
 	/*
 	 * order == -1 is expected when compacting via
 	 * /proc/sys/vm/compact_memory
@@ -743,6 +766,239 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+/*
+ * Proactive compaction
+ *
+ * A kcompactd thread per node wakes up every KCOMPACTD_INTERVAL_MSEC and
+ * computes a fragmentation score for each zone.  The score is the
+ * percentage of free memory in blocks smaller than
+ * sysctl_compaction_proactive_order, so it is high when most free memory
+ * cannot serve allocations of that order.  The node score is the sum of
+ * the zone scores weighted by zone size.  When the node score rises above
+ * the high watermark derived from sysctl_compaction_proactiveness, the
+ * zones above the low watermark are compacted with asynchronous
+ * migration until they drop below it.  The thread runs at the lowest
+ * priority and backs off whenever no other CPU of the node is idle, so
+ * it only uses time nobody else wants.
+ *
+ * High-order allocations that later succeed without entering the slow
+ * path use up the free blocks proactive compaction made, and are counted
+ * as compaction stalls avoided.
+ */
+#define KCOMPACTD_INTERVAL_MSEC		500
+
+int sysctl_compaction_proactiveness = 20;
+int sysctl_compaction_proactive_order = PAGE_ALLOC_COSTLY_ORDER + 1;
+
+/* Percentage of free memory unusable for the proactive order */
+static unsigned int fragmentation_score_zone(struct zone *zone)
+{
+	return extfrag_for_order(zone, sysctl_compaction_proactive_order);
+}
+
+static unsigned int fragmentation_score_node(pg_data_t *pgdat)
+{
+	unsigned long score = 0;
+	int zoneid;
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+		score += fragmentation_score_zone(zone) * zone->present_pages;
+	}
+
+	return div_u64(score, pgdat->node_present_pages + 1);
+}
+
+static unsigned int fragmentation_score_wmark(bool low)
+{
+	unsigned int wmark_low;
+
+	wmark_low = max(100 - sysctl_compaction_proactiveness, 5);
+	return low ? wmark_low : min(wmark_low + 10, 100U);
+}
+
+static bool fragmentation_score_zone_ok(struct zone *zone)
+{
+	return fragmentation_score_zone(zone) <= fragmentation_score_wmark(true);
+}
+
+/*
+ * Proactive compaction only uses otherwise idle CPU time: back off when
+ * something else wants to run here and no other CPU of the node is idle.
+ */
+static bool kcompactd_cpu_busy(pg_data_t *pgdat)
+{
+	int this_cpu = raw_smp_processor_id();
+	int cpu;
+
+	if (need_resched())
+		return true;
+
+	for_each_cpu_and(cpu, cpumask_of_node(pgdat->node_id),
+			 cpu_online_mask)
+		if (cpu != this_cpu && idle_cpu(cpu))
+			return false;
+
+	return nr_running() > 1;
+}
+
+/* Free pages in blocks large enough for the proactive order */
+static unsigned long compaction_free_suitable(struct zone *zone)
+{
+	unsigned long pages = 0;
+	unsigned int order;
+
+	for (order = sysctl_compaction_proactive_order; order < MAX_ORDER;
+	     order++)
+		pages += zone->free_area[order].nr_free << order;
+
+	return pages;
+}
+
+void __count_compact_stall_avoided(struct zone *zone, int order)
+{
+	long credit = atomic_long_read(&zone->compact_proactive_pages);
+
+	if (credit <= 0)
+		return;
+
+	atomic_long_sub(min_t(long, credit, 1L << order),
+			&zone->compact_proactive_pages);
+	count_vm_event(COMPACTSTALL_AVOIDED);
+}
+
+static void kcompactd_do_work(pg_data_t *pgdat)
+{
+	unsigned long before, after;
+	struct zone *zone;
+	int zoneid;
+
+	count_vm_event(KCOMPACTD_WAKE);
+	lru_add_drain();
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.order = -1,
+			.sync = false,
+			.proactive = true,
+		};
+
+		zone = &pgdat->node_zones[zoneid];
+		if (!populated_zone(zone))
+			continue;
+
+		if (fragmentation_score_zone_ok(zone))
+			continue;
+
+		/* Migration needs free pages to copy into */
+		if (!zone_watermark_ok(zone, 0, low_wmark_pages(zone) +
+			(2UL << sysctl_compaction_proactive_order), 0, 0))
+			continue;
+
+		cc.zone = zone;
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		before = compaction_free_suitable(zone);
+		compact_zone(zone, &cc);
+		after = compaction_free_suitable(zone);
+		if (after > before)
+			atomic_long_add(after - before,
+					&zone->compact_proactive_pages);
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+
+		if (kcompactd_cpu_busy(pgdat))
+			break;
+	}
+}
+
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = p;
+	unsigned int defer = 0;
+	unsigned int score;
+
+	set_freezable();
+	set_user_nice(current, 19);
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable_timeout(pgdat->kcompactd_wait,
+				kthread_should_stop(),
+				msecs_to_jiffies(KCOMPACTD_INTERVAL_MSEC));
+
+		if (!sysctl_compaction_proactiveness ||
+		    kcompactd_cpu_busy(pgdat))
+			continue;
+
+		/* Back off for a while if the last run did not help */
+		if (defer) {
+			defer--;
+			continue;
+		}
+
+		score = fragmentation_score_node(pgdat);
+		if (score <= fragmentation_score_wmark(false))
+			continue;
+
+		kcompactd_do_work(pgdat);
+
+		if (fragmentation_score_node(pgdat) >= score)
+			defer = 1 << COMPACT_MAX_DEFER_SHIFT;
+	}
+
+	return 0;
+}
+
+/*
+ * This kcompactd start function will be called by init and node-hot-add.
+ */
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		printk(KERN_ERR "Failed to start kcompactd on node %d\n", nid);
+		pgdat->kcompactd = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Called by memory hotplug when all memory in a node is offlined.  Caller must
+ * hold lock_memory_hotplug().
+ */
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		kcompactd_run(nid);
+	return 0;
+}
+module_init(kcompactd_init)
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 ssize_t sysfs_compact_node(struct sys_device *dev,
 			struct sysdev_attribute *attr,
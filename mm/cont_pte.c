@@ -0,0 +1,778 @@
+/*
+ * mm/cont_pte.c - anonymous memory in blocks of contiguous ptes
+ *
+ * This file is released under the GPLv2.
+ *
+ * Some architectures can map a naturally aligned block of CONT_PTES
+ * physically contiguous pages with a single TLB entry while the block
+ * is still made of one pte per page, like the 64K large pages of ARMv7.
+ * That takes the TLB reach of large anonymous heaps up by the same
+ * factor, without the pmd level mappings of transparent huge pages.
+ *
+ * Write faults in private anonymous memory allocate and map a whole
+ * block when all of its ptes are none or map the zero page.  Any later
+ * change to one of the ptes of a block other than reclaim aging its
+ * pages, from mprotect() to unmapping one of them, splits the whole
+ * block back into small pages in the architecture code, so the rest of
+ * the mm only ever deals with small ptes and order-0 pages.
+ *
+ * kcontpted brings blocks back.  It scans the mms that had to fall back
+ * to small pages, and maps a block of exclusively owned anonymous pages
+ * as a block again, in place if the pages are still contiguous and
+ * copied into a new block otherwise.
+ */
+
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/highmem.h>
+#include <linux/rmap.h>
+#include <linux/swap.h>
+#include <linux/ksm.h>
+#include <linux/memcontrol.h>
+#include <linux/mmu_notifier.h>
+#include <linux/cont_pte.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/hash.h>
+#include <linux/slab.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/init.h>
+#include <asm/tlbflush.h>
+#include "internal.h"
+
+#define CONT_PTE_ORDER		(CONT_PTE_SHIFT - PAGE_SHIFT)
+
+/* kcontpted may compact for its blocks, page faults never wait for one */
+#define GFP_CONT_PTE	(GFP_HIGHUSER_MOVABLE | __GFP_NOMEMALLOC | \
+			 __GFP_NORETRY | __GFP_NOWARN | __GFP_NO_KSWAPD)
+
+static bool cont_pte_enabled __read_mostly = true;
+
+/* default scan 4096 ptes every 10 seconds */
+static unsigned int cont_pte_pages_to_scan __read_mostly = 4096;
+static unsigned int cont_pte_scan_sleep_millisecs __read_mostly = 10000;
+/* collapse blocks that are at least half populated */
+static unsigned int cont_pte_max_ptes_none __read_mostly = CONT_PTES / 2;
+static unsigned long cont_pte_pages_collapsed;
+static unsigned long cont_pte_full_scans;
+
+#define CONT_PTE_SLOTS_HASH_BITS	8
+
+/**
+ * struct cont_pte_mm_slot - an mm kcontpted scans
+ * @hash: link in cont_pte_slots_hash
+ * @mm_list: link in cont_pte_scan.mm_head
+ * @mm: the mm, pinned by a reference on mm_count
+ */
+struct cont_pte_mm_slot {
+	struct hlist_node hash;
+	struct list_head mm_list;
+	struct mm_struct *mm;
+};
+
+/* The scan cursor of kcontpted, protected by cont_pte_mm_lock */
+static struct {
+	struct list_head mm_head;
+	struct cont_pte_mm_slot *slot;
+	unsigned long address;
+} cont_pte_scan = {
+	.mm_head = LIST_HEAD_INIT(cont_pte_scan.mm_head),
+};
+
+static struct hlist_head cont_pte_slots_hash[1 << CONT_PTE_SLOTS_HASH_BITS];
+static DEFINE_SPINLOCK(cont_pte_mm_lock);
+static DECLARE_WAIT_QUEUE_HEAD(cont_pte_wait);
+static struct kmem_cache *cont_pte_slot_cache __read_mostly;
+
+enum {
+	CONT_PTE_SKIP,		/* leave the ptes alone */
+	CONT_PTE_INPLACE,	/* the pages are a block already */
+	CONT_PTE_COPY,		/* copy the pages into a new block */
+};
+
+static inline int cont_pte_test_exit(struct mm_struct *mm)
+{
+	return atomic_read(&mm->mm_users) == 0;
+}
+
+static struct cont_pte_mm_slot *get_cont_pte_slot(struct mm_struct *mm)
+{
+	struct cont_pte_mm_slot *slot;
+	struct hlist_head *bucket;
+	struct hlist_node *node;
+
+	bucket = &cont_pte_slots_hash[hash_ptr(mm, CONT_PTE_SLOTS_HASH_BITS)];
+	hlist_for_each_entry(slot, node, bucket, hash)
+		if (slot->mm == mm)
+			return slot;
+	return NULL;
+}
+
+/* Have kcontpted look at @mm, which fell back to small pages */
+static void cont_pte_enter(struct mm_struct *mm)
+{
+	struct cont_pte_mm_slot *slot;
+	bool wakeup;
+
+	if (test_bit(MMF_CONT_PTE, &mm->flags) || !cont_pte_slot_cache)
+		return;
+
+	slot = kmem_cache_zalloc(cont_pte_slot_cache, GFP_KERNEL);
+	if (!slot)
+		return;
+	if (test_and_set_bit(MMF_CONT_PTE, &mm->flags)) {
+		kmem_cache_free(cont_pte_slot_cache, slot);
+		return;
+	}
+	slot->mm = mm;
+
+	spin_lock(&cont_pte_mm_lock);
+	hlist_add_head(&slot->hash, &cont_pte_slots_hash[hash_ptr(mm,
+						CONT_PTE_SLOTS_HASH_BITS)]);
+	wakeup = list_empty(&cont_pte_scan.mm_head);
+	list_add_tail(&slot->mm_list, &cont_pte_scan.mm_head);
+	spin_unlock(&cont_pte_mm_lock);
+
+	atomic_inc(&mm->mm_count);
+	if (wakeup)
+		wake_up_interruptible(&cont_pte_wait);
+}
+
+static void free_cont_pte_slot(struct cont_pte_mm_slot *slot)
+{
+	hlist_del(&slot->hash);
+	list_del(&slot->mm_list);
+	clear_bit(MMF_CONT_PTE, &slot->mm->flags);
+	mmdrop(slot->mm);
+	kmem_cache_free(cont_pte_slot_cache, slot);
+}
+
+void __cont_pte_exit(struct mm_struct *mm)
+{
+	struct cont_pte_mm_slot *slot;
+
+	spin_lock(&cont_pte_mm_lock);
+	slot = get_cont_pte_slot(mm);
+	if (slot && cont_pte_scan.slot != slot) {
+		free_cont_pte_slot(slot);
+		spin_unlock(&cont_pte_mm_lock);
+	} else if (slot) {
+		spin_unlock(&cont_pte_mm_lock);
+		/*
+		 * kcontpted is scanning this mm and will free the slot.
+		 * It holds mmap_sem for read while it looks at the page
+		 * tables, which are about to go away.
+		 */
+		down_write(&mm->mmap_sem);
+		up_write(&mm->mmap_sem);
+	} else
+		spin_unlock(&cont_pte_mm_lock);
+}
+
+/* Private anonymous memory only, everything else has its own pages */
+static bool cont_pte_vma_suitable(struct vm_area_struct *vma)
+{
+	return !vma->vm_ops && !(vma->vm_flags & (VM_SHARED | VM_NOHUGEPAGE));
+}
+
+static struct page *cont_pte_alloc(struct mm_struct *mm,
+				   struct vm_area_struct *vma,
+				   unsigned long haddr, gfp_t gfp)
+{
+	struct page *page;
+	int i, j;
+
+	page = alloc_pages_vma(gfp, CONT_PTE_ORDER, vma, haddr,
+			       numa_node_id());
+	if (!page)
+		return NULL;
+	split_page(page, CONT_PTE_ORDER);
+
+	for (i = 0; i < CONT_PTES; i++) {
+		if (mem_cgroup_newpage_charge(page + i, mm, GFP_KERNEL)) {
+			for (j = 0; j < i; j++)
+				mem_cgroup_uncharge_page(page + j);
+			for (j = 0; j < CONT_PTES; j++)
+				__free_page(page + j);
+			return NULL;
+		}
+	}
+	return page;
+}
+
+static void cont_pte_free(struct page *page)
+{
+	int i;
+
+	for (i = 0; i < CONT_PTES; i++) {
+		mem_cgroup_uncharge_page(page + i);
+		__free_page(page + i);
+	}
+}
+
+/* Break before make: no TLB may hold a small page of the block */
+static void cont_pte_clear(struct mm_struct *mm, struct vm_area_struct *vma,
+			   unsigned long haddr, pte_t *pte)
+{
+	int i;
+
+	for (i = 0; i < CONT_PTES; i++)
+		pte_clear(mm, haddr + i * PAGE_SIZE, pte + i);
+	flush_tlb_range(vma, haddr, haddr + CONT_PTE_SIZE);
+}
+
+/* Maps the new pages at @haddr as a block, over ptes that are none */
+static void cont_pte_install(struct mm_struct *mm, struct vm_area_struct *vma,
+			     unsigned long haddr, pte_t *pte, struct page *page)
+{
+	pte_t entry;
+	int i;
+
+	entry = pte_mkyoung(mk_pte(page, vma->vm_page_prot));
+	if (vma->vm_flags & VM_WRITE)
+		entry = pte_mkwrite(pte_mkdirty(entry));
+
+	for (i = 0; i < CONT_PTES; i++)
+		page_add_new_anon_rmap(page + i, vma, haddr + i * PAGE_SIZE);
+	set_cont_ptes(mm, haddr, pte, entry);
+
+	for (i = 0; i < CONT_PTES; i++)
+		update_mmu_cache(vma, haddr + i * PAGE_SIZE, pte + i);
+}
+
+/*
+ * Returns how many ptes of the block map the zero page if the others
+ * are all none, or -1.
+ */
+static int cont_pte_empty(pte_t *pte)
+{
+	int i, zero = 0;
+
+	for (i = 0; i < CONT_PTES; i++) {
+		if (pte_none(pte[i]))
+			continue;
+		if (!pte_present(pte[i]) || !is_zero_pfn(pte_pfn(pte[i])))
+			return -1;
+		zero++;
+	}
+	return zero;
+}
+
+/**
+ * cont_pte_fault - fault in a whole block of anonymous memory
+ * @mm: the faulting mm
+ * @vma: the private anonymous vma of the fault
+ * @address: the faulting address
+ * @pmd: the pmd of the address, with a pte table
+ *
+ * Called for write faults on ptes that are none or map the zero page,
+ * with mmap_sem held for read and no pte mapped.  Returns %false when
+ * the caller has to fault in a single page after all.
+ */
+bool cont_pte_fault(struct mm_struct *mm, struct vm_area_struct *vma,
+		    unsigned long address, pmd_t *pmd)
+{
+	unsigned long haddr = address & CONT_PTE_MASK;
+	struct page *page;
+	spinlock_t *ptl;
+	pte_t *pte;
+	int i, zero;
+
+	if (!cont_pte_enabled || !cont_pte_vma_suitable(vma) ||
+	    haddr < vma->vm_start || haddr + CONT_PTE_SIZE > vma->vm_end)
+		return false;
+
+	/* Partly populated blocks are left to kcontpted */
+	pte = pte_offset_map(pmd, haddr);
+	zero = cont_pte_empty(pte);
+	pte_unmap(pte);
+	if (zero < 0)
+		goto fallback;
+
+	if (unlikely(anon_vma_prepare(vma)))
+		return false;
+	page = cont_pte_alloc(mm, vma, haddr, GFP_CONT_PTE & ~__GFP_WAIT);
+	if (!page) {
+		count_vm_event(CONT_PTE_FAULT_FALLBACK);
+		goto fallback;
+	}
+	for (i = 0; i < CONT_PTES; i++) {
+		clear_user_highpage(page + i, haddr + i * PAGE_SIZE);
+		__SetPageUptodate(page + i);
+	}
+
+	/* The zero page ptes of the block go away */
+	mmu_notifier_invalidate_range_start(mm, haddr, haddr + CONT_PTE_SIZE);
+	pte = pte_offset_map_lock(mm, pmd, haddr, &ptl);
+	zero = cont_pte_empty(pte);
+	if (zero < 0) {
+		pte_unmap_unlock(pte, ptl);
+		mmu_notifier_invalidate_range_end(mm, haddr,
+						  haddr + CONT_PTE_SIZE);
+		cont_pte_free(page);
+		goto fallback;
+	}
+	if (zero)
+		cont_pte_clear(mm, vma, haddr, pte);
+	add_mm_counter(mm, MM_ANONPAGES, CONT_PTES);
+	cont_pte_install(mm, vma, haddr, pte, page);
+	pte_unmap_unlock(pte, ptl);
+	mmu_notifier_invalidate_range_end(mm, haddr, haddr + CONT_PTE_SIZE);
+
+	count_vm_event(CONT_PTE_FAULT_ALLOC);
+	return true;
+
+fallback:
+	cont_pte_enter(mm);
+	return false;
+}
+
+/*
+ * What can be done about the small ptes of the block at @haddr.  This
+ * is only a hint unless the caller holds the page table lock.
+ */
+static int cont_pte_check(struct vm_area_struct *vma, unsigned long haddr,
+			  pte_t *pte)
+{
+	unsigned int none = 0;
+	bool contig = true;
+	struct page *page;
+	pte_t entry;
+	int i;
+
+	for (i = 0; i < CONT_PTES; i++) {
+		entry = pte[i];
+		if (pte_none(entry) ||
+		    (pte_present(entry) && is_zero_pfn(pte_pfn(entry)))) {
+			if (++none > cont_pte_max_ptes_none)
+				return CONT_PTE_SKIP;
+			contig = false;
+			continue;
+		}
+		if (!pte_present(entry) || pte_cont(entry))
+			return CONT_PTE_SKIP;
+
+		/* Pages anybody else might see are not ours to move */
+		page = vm_normal_page(vma, haddr + i * PAGE_SIZE, entry);
+		if (!page || !PageAnon(page) || PageKsm(page) ||
+		    PageSwapCache(page) || PageCompound(page) ||
+		    page_mapcount(page) != 1)
+			return CONT_PTE_SKIP;
+		if (pte_pfn(entry) != pte_pfn(pte[0]) + i)
+			contig = false;
+	}
+	if (contig && !(pte_pfn(pte[0]) & (CONT_PTES - 1)))
+		return CONT_PTE_INPLACE;
+	return CONT_PTE_COPY;
+}
+
+/* The pages are a block already, only the mapping has to change */
+static void cont_pte_promote(struct mm_struct *mm, struct vm_area_struct *vma,
+			     unsigned long haddr, pmd_t *pmd)
+{
+	spinlock_t *ptl;
+	pte_t *pte, entry;
+	int i;
+
+	mmu_notifier_invalidate_range_start(mm, haddr, haddr + CONT_PTE_SIZE);
+	pte = pte_offset_map_lock(mm, pmd, haddr, &ptl);
+	if (cont_pte_check(vma, haddr, pte) != CONT_PTE_INPLACE)
+		goto out;
+
+	entry = pte_mkyoung(pfn_pte(pte_pfn(pte[0]), vma->vm_page_prot));
+	if (vma->vm_flags & VM_WRITE)
+		entry = pte_mkwrite(pte_mkdirty(entry));
+	for (i = 0; i < CONT_PTES; i++)
+		if (pte_dirty(pte[i]))
+			entry = pte_mkdirty(entry);
+
+	cont_pte_clear(mm, vma, haddr, pte);
+	set_cont_ptes(mm, haddr, pte, entry);
+	count_vm_event(CONT_PTE_PROMOTE);
+	cont_pte_pages_collapsed += CONT_PTES;
+out:
+	pte_unmap_unlock(pte, ptl);
+	mmu_notifier_invalidate_range_end(mm, haddr, haddr + CONT_PTE_SIZE);
+}
+
+/*
+ * Copies the pages of the block at @haddr into a new block.  Returns
+ * %false if no block could be allocated.
+ */
+static bool cont_pte_copy(struct mm_struct *mm, struct vm_area_struct *vma,
+			  unsigned long haddr, pmd_t *pmd)
+{
+	struct page *new, *page, *old[CONT_PTES];
+	unsigned long addr;
+	int i, nr_none = 0;
+	spinlock_t *ptl;
+	pte_t *pte;
+
+	if (unlikely(anon_vma_prepare(vma)))
+		return false;
+	new = cont_pte_alloc(mm, vma, haddr, GFP_CONT_PTE);
+	if (!new) {
+		count_vm_event(CONT_PTE_COLLAPSE_ALLOC_FAILED);
+		return false;
+	}
+
+	mmu_notifier_invalidate_range_start(mm, haddr, haddr + CONT_PTE_SIZE);
+	pte = pte_offset_map_lock(mm, pmd, haddr, &ptl);
+	memset(old, 0, sizeof(old));
+	if (cont_pte_check(vma, haddr, pte) != CONT_PTE_COPY)
+		goto out_unlock;
+
+	/* No gup pin, isolation or lock holder may have the old pages */
+	for (i = 0; i < CONT_PTES; i++) {
+		if (pte_none(pte[i]) || is_zero_pfn(pte_pfn(pte[i])))
+			continue;
+		page = vm_normal_page(vma, haddr + i * PAGE_SIZE, pte[i]);
+		if (page_count(page) != 1 || !trylock_page(page))
+			goto out_unlock;
+		old[i] = page;
+	}
+
+	cont_pte_clear(mm, vma, haddr, pte);
+	for (i = 0; i < CONT_PTES; i++) {
+		addr = haddr + i * PAGE_SIZE;
+		if (old[i])
+			copy_user_highpage(new + i, old[i], addr, vma);
+		else
+			clear_user_highpage(new + i, addr);
+		__SetPageUptodate(new + i);
+	}
+	for (i = 0; i < CONT_PTES; i++) {
+		if (!old[i]) {
+			nr_none++;
+			continue;
+		}
+		page_remove_rmap(old[i]);
+		unlock_page(old[i]);
+		put_page(old[i]);
+		old[i] = NULL;
+	}
+
+	add_mm_counter(mm, MM_ANONPAGES, nr_none);
+	cont_pte_install(mm, vma, haddr, pte, new);
+	count_vm_event(CONT_PTE_COLLAPSE_ALLOC);
+	cont_pte_pages_collapsed += CONT_PTES;
+	new = NULL;
+
+out_unlock:
+	for (i = 0; i < CONT_PTES; i++)
+		if (old[i])
+			unlock_page(old[i]);
+	pte_unmap_unlock(pte, ptl);
+	mmu_notifier_invalidate_range_end(mm, haddr, haddr + CONT_PTE_SIZE);
+	if (new)
+		cont_pte_free(new);
+	return true;
+}
+
+/*
+ * Tries to map the block at @haddr as a block again, with mmap_sem held
+ * for read.  Returns %false if the scan should rather stop for now.
+ */
+static bool cont_pte_collapse(struct mm_struct *mm, struct vm_area_struct *vma,
+			      unsigned long haddr)
+{
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *pte;
+	int ret;
+
+	pgd = pgd_offset(mm, haddr);
+	if (!pgd_present(*pgd))
+		return true;
+	pud = pud_offset(pgd, haddr);
+	if (!pud_present(*pud))
+		return true;
+	pmd = pmd_offset(pud, haddr);
+	if (!pmd_present(*pmd) || pmd_trans_huge(*pmd))
+		return true;
+
+	pte = pte_offset_map(pmd, haddr);
+	ret = cont_pte_check(vma, haddr, pte);
+	pte_unmap(pte);
+
+	switch (ret) {
+	case CONT_PTE_INPLACE:
+		cont_pte_promote(mm, vma, haddr, pmd);
+		break;
+	case CONT_PTE_COPY:
+		return cont_pte_copy(mm, vma, haddr, pmd);
+	}
+	return true;
+}
+
+static unsigned int cont_pte_scan_mm(unsigned int pages)
+{
+	struct cont_pte_mm_slot *slot;
+	struct vm_area_struct *vma;
+	unsigned long haddr, hend;
+	unsigned int progress = 0;
+	struct mm_struct *mm;
+
+	spin_lock(&cont_pte_mm_lock);
+	if (!cont_pte_scan.slot) {
+		/* The last mm may have exited since cont_pte_has_work() */
+		if (list_empty(&cont_pte_scan.mm_head)) {
+			spin_unlock(&cont_pte_mm_lock);
+			return 0;
+		}
+		cont_pte_scan.slot = list_entry(cont_pte_scan.mm_head.next,
+					struct cont_pte_mm_slot, mm_list);
+		cont_pte_scan.address = 0;
+	}
+	slot = cont_pte_scan.slot;
+	spin_unlock(&cont_pte_mm_lock);
+
+	mm = slot->mm;
+	down_read(&mm->mmap_sem);
+	if (unlikely(cont_pte_test_exit(mm)))
+		vma = NULL;
+	else
+		vma = find_vma(mm, cont_pte_scan.address);
+
+	for (; vma; vma = vma->vm_next) {
+		progress++;
+		if (!cont_pte_vma_suitable(vma) || !vma->anon_vma)
+			continue;
+
+		haddr = ALIGN(vma->vm_start, CONT_PTE_SIZE);
+		haddr = max(haddr, cont_pte_scan.address);
+		hend = vma->vm_end & CONT_PTE_MASK;
+		for (; haddr < hend; haddr += CONT_PTE_SIZE) {
+			if (unlikely(cont_pte_test_exit(mm)) ||
+			    progress >= pages)
+				goto out;
+			cont_pte_scan.address = haddr + CONT_PTE_SIZE;
+			progress += CONT_PTES;
+			if (!cont_pte_collapse(mm, vma, haddr)) {
+				progress = pages;
+				goto out;
+			}
+			cond_resched();
+		}
+		if (progress >= pages)
+			break;
+	}
+out:
+	up_read(&mm->mmap_sem);
+
+	spin_lock(&cont_pte_mm_lock);
+	if (cont_pte_test_exit(mm) || !vma) {
+		/* Done with this mm, on to the next */
+		if (slot->mm_list.next != &cont_pte_scan.mm_head) {
+			cont_pte_scan.slot = list_entry(slot->mm_list.next,
+					struct cont_pte_mm_slot, mm_list);
+		} else {
+			cont_pte_scan.slot = NULL;
+			cont_pte_full_scans++;
+		}
+		cont_pte_scan.address = 0;
+		if (cont_pte_test_exit(mm))
+			free_cont_pte_slot(slot);
+	}
+	spin_unlock(&cont_pte_mm_lock);
+
+	return progress;
+}
+
+static bool cont_pte_has_work(void)
+{
+	return cont_pte_enabled && !list_empty(&cont_pte_scan.mm_head);
+}
+
+static int kcontpted(void *none)
+{
+	unsigned int progress;
+
+	set_freezable();
+	set_user_nice(current, 19);
+
+	while (!kthread_should_stop()) {
+		/* Every mm counts as a page, so that empty ones end a pass */
+		for (progress = 0; progress < cont_pte_pages_to_scan &&
+		     cont_pte_has_work(); progress++)
+			progress += cont_pte_scan_mm(cont_pte_pages_to_scan -
+						     progress);
+
+		if (cont_pte_has_work())
+			wait_event_freezable_timeout(cont_pte_wait,
+				kthread_should_stop(),
+				msecs_to_jiffies(cont_pte_scan_sleep_millisecs));
+		else
+			wait_event_freezable(cont_pte_wait,
+				kthread_should_stop() || cont_pte_has_work());
+	}
+	return 0;
+}
+
+#ifdef CONFIG_SYSFS
+#define CONT_PTE_ATTR_RO(_name) \
+	static struct kobj_attribute _name##_attr = __ATTR_RO(_name)
+#define CONT_PTE_ATTR(_name) \
+	static struct kobj_attribute _name##_attr = \
+		__ATTR(_name, 0644, _name##_show, _name##_store)
+
+static ssize_t enabled_show(struct kobject *kobj,
+			    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", cont_pte_enabled);
+}
+
+static ssize_t enabled_store(struct kobject *kobj,
+			     struct kobj_attribute *attr,
+			     const char *buf, size_t count)
+{
+	unsigned long enabled;
+	int err;
+
+	err = strict_strtoul(buf, 10, &enabled);
+	if (err || enabled > 1)
+		return -EINVAL;
+
+	cont_pte_enabled = enabled;
+	if (enabled)
+		wake_up_interruptible(&cont_pte_wait);
+
+	return count;
+}
+CONT_PTE_ATTR(enabled);
+
+static ssize_t pages_to_scan_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", cont_pte_pages_to_scan);
+}
+
+static ssize_t pages_to_scan_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	unsigned long pages;
+	int err;
+
+	err = strict_strtoul(buf, 10, &pages);
+	if (err || !pages || pages > UINT_MAX)
+		return -EINVAL;
+
+	cont_pte_pages_to_scan = pages;
+
+	return count;
+}
+CONT_PTE_ATTR(pages_to_scan);
+
+static ssize_t scan_sleep_millisecs_show(struct kobject *kobj,
+					 struct kobj_attribute *attr,
+					 char *buf)
+{
+	return sprintf(buf, "%u\n", cont_pte_scan_sleep_millisecs);
+}
+
+static ssize_t scan_sleep_millisecs_store(struct kobject *kobj,
+					  struct kobj_attribute *attr,
+					  const char *buf, size_t count)
+{
+	unsigned long msecs;
+	int err;
+
+	err = strict_strtoul(buf, 10, &msecs);
+	if (err || msecs > UINT_MAX)
+		return -EINVAL;
+
+	cont_pte_scan_sleep_millisecs = msecs;
+	wake_up_interruptible(&cont_pte_wait);
+
+	return count;
+}
+CONT_PTE_ATTR(scan_sleep_millisecs);
+
+static ssize_t max_ptes_none_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", cont_pte_max_ptes_none);
+}
+
+static ssize_t max_ptes_none_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	unsigned long max_ptes_none;
+	int err;
+
+	err = strict_strtoul(buf, 10, &max_ptes_none);
+	if (err || max_ptes_none > CONT_PTES - 1)
+		return -EINVAL;
+
+	cont_pte_max_ptes_none = max_ptes_none;
+
+	return count;
+}
+CONT_PTE_ATTR(max_ptes_none);
+
+static ssize_t pages_collapsed_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", cont_pte_pages_collapsed);
+}
+CONT_PTE_ATTR_RO(pages_collapsed);
+
+static ssize_t full_scans_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", cont_pte_full_scans);
+}
+CONT_PTE_ATTR_RO(full_scans);
+
+static struct attribute *cont_pte_attrs[] = {
+	&enabled_attr.attr,
+	&pages_to_scan_attr.attr,
+	&scan_sleep_millisecs_attr.attr,
+	&max_ptes_none_attr.attr,
+	&pages_collapsed_attr.attr,
+	&full_scans_attr.attr,
+	NULL,
+};
+
+static struct attribute_group cont_pte_attr_group = {
+	.attrs = cont_pte_attrs,
+	.name = "cont_pte",
+};
+#endif /* CONFIG_SYSFS */
+
+static int __init cont_pte_init(void)
+{
+	struct task_struct *thread;
+	int err;
+
+	cont_pte_slot_cache = KMEM_CACHE(cont_pte_mm_slot, 0);
+	if (!cont_pte_slot_cache)
+		return -ENOMEM;
+
+	thread = kthread_run(kcontpted, NULL, "kcontpted");
+	if (IS_ERR(thread)) {
+		printk(KERN_ERR "cont_pte: creating kthread failed\n");
+		err = PTR_ERR(thread);
+		goto out_free;
+	}
+
+#ifdef CONFIG_SYSFS
+	err = sysfs_create_group(mm_kobj, &cont_pte_attr_group);
+	if (err) {
+		printk(KERN_ERR "cont_pte: register sysfs failed\n");
+		kthread_stop(thread);
+		goto out_free;
+	}
+#endif
+	return 0;
+
+out_free:
+	kmem_cache_destroy(cont_pte_slot_cache);
+	cont_pte_slot_cache = NULL;
+	return err;
+}
+module_init(cont_pte_init)
@@ -500,10 +500,14 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 
 	ret = add_to_page_cache(page, mapping, offset, gfp_mask);
 	if (ret == 0) {
-		if (page_is_file_cache(page))
-			lru_cache_add_file(page);
-		else
+		if (!page_is_file_cache(page))
 			lru_cache_add_anon(page);
+		else if (workingset_refault(mapping, offset)) {
+			/* Evicted too early, it belongs to the working set */
+			workingset_activation(page);
+			__lru_cache_add(page, LRU_ACTIVE_FILE);
+		} else
+			lru_cache_add_file(page);
 	}
 	return ret;
 }
@@ -1583,7 +1587,7 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 	ra->start = max_t(long, 0, offset - ra_pages / 2);
 	ra->size = ra_pages;
 	ra->async_size = ra_pages / 4;
-	ra_submit(ra, mapping, file);
+	ra_submit(ra, mapping, file, offset);
 }
 
 /*
@@ -1689,6 +1693,7 @@ retry_find:
 		return VM_FAULT_SIGBUS;
 	}
 
+	readahead_page_accessed(page);
 	vmf->page = page;
 	return ret | VM_FAULT_LOCKED;
 
@@ -1741,8 +1746,76 @@ page_not_uptodate:
 }
 EXPORT_SYMBOL(filemap_fault);
 
+/**
+ * filemap_map_pages - map the page cache pages around a read fault
+ * @vma:	vma in which the fault was taken
+ * @vmf:	struct vm_fault with the ptes to fill, locked by the caller
+ *
+ * Maps the pages from @vmf->pgoff to @vmf->max_pgoff that are uptodate
+ * in the page cache and not locked by anybody else.  Pages that would
+ * start async readahead are left to filemap_fault(), so that the
+ * readahead window keeps moving.  Never sleeps and never does any I/O.
+ */
+void filemap_map_pages(struct vm_area_struct *vma, struct vm_fault *vmf)
+{
+	struct file *file = vma->vm_file;
+	struct address_space *mapping = file->f_mapping;
+	unsigned long address = (unsigned long)vmf->virtual_address;
+	pgoff_t index = vmf->pgoff;
+	pgoff_t size;
+	struct page *pages[PAGEVEC_SIZE];
+	struct page *page;
+	unsigned int i, nr;
+	pte_t *pte;
+
+	while (index <= vmf->max_pgoff) {
+		nr = find_get_pages(mapping, index,
+				    min_t(pgoff_t, PAGEVEC_SIZE,
+					  vmf->max_pgoff - index + 1), pages);
+		if (!nr)
+			break;
+		index = pages[nr - 1]->index + 1;
+
+		for (i = 0; i < nr; i++) {
+			page = pages[i];
+			if (page->index > vmf->max_pgoff)
+				goto skip;
+			if (!PageUptodate(page) || PageReadahead(page) ||
+			    PageHWPoison(page))
+				goto skip;
+			if (!trylock_page(page))
+				goto skip;
+			if (page->mapping != mapping || !PageUptodate(page))
+				goto unlock;
+			size = (i_size_read(mapping->host) + PAGE_CACHE_SIZE - 1)
+					>> PAGE_CACHE_SHIFT;
+			if (page->index >= size)
+				goto unlock;
+			pte = vmf->pte + page->index - vmf->pgoff;
+			if (!pte_none(*pte))
+				goto unlock;
+
+			if (file->f_ra.mmap_miss > 0)
+				file->f_ra.mmap_miss--;
+			readahead_page_accessed(page);
+			/* The page reference goes to the pte */
+			do_set_pte(vma, address +
+				   ((page->index - vmf->pgoff) << PAGE_SHIFT),
+				   page, pte);
+			unlock_page(page);
+			continue;
+unlock:
+			unlock_page(page);
+skip:
+			page_cache_release(page);
+		}
+	}
+}
+EXPORT_SYMBOL(filemap_map_pages);
+
 const struct vm_operations_struct generic_file_vm_ops = {
 	.fault		= filemap_fault,
+	.map_pages	= filemap_map_pages,
 };
 
 /* This is used for a general mmap of a disk file */
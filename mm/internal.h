@@ -84,6 +84,21 @@ static inline void get_page_foll(struct page *page)
 }
 
 extern unsigned long highest_memmap_pfn;
+extern unsigned long zero_pfn;
+
+#ifndef is_zero_pfn
+static inline int is_zero_pfn(unsigned long pfn)
+{
+	return pfn == zero_pfn;
+}
+#endif
+
+#ifndef my_zero_pfn
+static inline unsigned long my_zero_pfn(unsigned long addr)
+{
+	return zero_pfn;
+}
+#endif
 
 /*
  * in mm/vmscan.c:
@@ -36,6 +36,7 @@
 #include <linux/hash.h>
 #include <linux/freezer.h>
 #include <linux/oom.h>
+#include <linux/math64.h>
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -78,6 +79,14 @@
  *    take 10 attempts to find a page in the unstable tree, once it is found,
  *    it is secured in the stable tree.  (When we scan a new page, we first
  *    compare it against the stable tree, and then against the unstable tree.)
+ *
+ * Both trees are split into KSM_NR_SHARDS shards by the page checksum, so
+ * pages of identical content always meet in the same shard.  ksmd walks the
+ * mm_slots and hands the pages it finds out in batches to up to nr_threads
+ * threads, itself included, each of which owns the trees of some shards.
+ * The threads only run while ksmd waits for them with ksm_thread_mutex
+ * held, and ksmd takes every rmap_item in a batch out of the trees before
+ * handing it out, so the threads never touch each other's rmap_items.
  */
 
 /**
@@ -115,11 +124,13 @@ struct ksm_scan {
  * @node: rb node of this ksm page in the stable tree
  * @hlist: hlist head of rmap_items using this ksm page
  * @kpfn: page frame number of this ksm page
+ * @shard: stable tree shard this node is in
  */
 struct stable_node {
 	struct rb_node node;
 	struct hlist_head hlist;
 	unsigned long kpfn;
+	unsigned int shard;
 };
 
 /**
@@ -128,7 +139,8 @@ struct stable_node {
  * @anon_vma: pointer to anon_vma for this mm,address, when in stable tree
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
- * @oldchecksum: previous checksum of the page at that virtual address
+ * @oldchecksum: previous checksum of the page at that virtual address,
+ *	which also selects the shard of the tree it is in
  * @node: rb node of this rmap_item in the unstable tree
  * @head: pointer to stable_node heading this list in the stable tree
  * @hlist: link into hlist of rmap_items hanging off that stable_node
@@ -152,9 +164,22 @@ struct rmap_item {
 #define UNSTABLE_FLAG	0x100	/* is a node of the unstable tree */
 #define STABLE_FLAG	0x200	/* is listed from the stable tree */
 
-/* The stable and unstable tree heads */
-static struct rb_root root_stable_tree = RB_ROOT;
-static struct rb_root root_unstable_tree = RB_ROOT;
+#define KSM_NR_SHARDS	16	/* power of two */
+#define KSM_MAX_THREADS	8
+#define KSM_BATCH	256	/* pages handed out to the threads at once */
+
+/* The stable and unstable tree heads, one of each per shard */
+static struct rb_root root_stable_tree[KSM_NR_SHARDS] = {
+	[0 ... KSM_NR_SHARDS - 1] = RB_ROOT
+};
+static struct rb_root root_unstable_tree[KSM_NR_SHARDS] = {
+	[0 ... KSM_NR_SHARDS - 1] = RB_ROOT
+};
+
+static inline unsigned int ksm_shard(u32 checksum)
+{
+	return checksum & (KSM_NR_SHARDS - 1);
+}
 
 #define MM_SLOTS_HASH_SHIFT 10
 #define MM_SLOTS_HASH_HEADS (1 << MM_SLOTS_HASH_SHIFT)
@@ -172,13 +197,13 @@ static struct kmem_cache *stable_node_cache;
 static struct kmem_cache *mm_slot_cache;
 
 /* The number of nodes in the stable tree */
-static unsigned long ksm_pages_shared;
+static atomic_long_t ksm_pages_shared;
 
 /* The number of page slots additionally sharing those nodes */
-static unsigned long ksm_pages_sharing;
+static atomic_long_t ksm_pages_sharing;
 
 /* The number of nodes in the unstable tree */
-static unsigned long ksm_pages_unshared;
+static atomic_long_t ksm_pages_unshared;
 
 /* The number of rmap_items in use: to calculate pages_volatile */
 static unsigned long ksm_rmap_items;
@@ -186,9 +211,58 @@ static unsigned long ksm_rmap_items;
 /* Number of pages ksmd should scan in one batch */
 static unsigned int ksm_thread_pages_to_scan = 100;
 
+/*
+ * Number of pages ksmd actually scans in one batch: raised up to
+ * KSM_SCAN_BOOST times pages_to_scan while the batches merge well,
+ * and brought back down as soon as they stop merging.
+ */
+static unsigned int ksm_scan_npages = 100;
+#define KSM_SCAN_BOOST		8
+#define KSM_SCAN_YIELD		32	/* boost at 1 merge per that many pages */
+
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/**
+ * struct ksm_work - page handed out to a ksm thread
+ * @rmap_item: reverse mapping of the page, out of the trees
+ * @page: the page, with a reference held
+ * @checksum: current checksum of the page
+ */
+struct ksm_work {
+	struct rmap_item *rmap_item;
+	struct page *page;
+	u32 checksum;
+};
+
+static struct ksm_work ksm_batch[KSM_BATCH];
+static unsigned int ksm_batch_nr;
+
+/**
+ * struct ksm_thread - a thread merging pages of some shards
+ * @task: the thread, ksmd for the first one
+ * @seq: last batch the thread worked on
+ * @merged: pages merged in the current batch
+ * @runtime: cpu time spent on the current batch, in ns
+ */
+struct ksm_thread {
+	struct task_struct *task;
+	unsigned long seq;
+	unsigned long merged;
+	u64 runtime;
+};
+
+static struct ksm_thread ksm_threads[KSM_MAX_THREADS];
+static unsigned int ksm_nr_threads = 1;
+static unsigned long ksm_batch_seq;
+static atomic_t ksm_batch_pending;
+static DECLARE_WAIT_QUEUE_HEAD(ksm_batch_wait);
+static DECLARE_WAIT_QUEUE_HEAD(ksm_batch_done_wait);
+
+/* Pages merged and cpu time spent by all ksm threads */
+static unsigned long ksm_pages_merged;
+static u64 ksm_cpu_ns;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -450,15 +524,15 @@ static void remove_node_from_stable_tree(struct stable_node *stable_node)
 
 	hlist_for_each_entry(rmap_item, hlist, &stable_node->hlist, hlist) {
 		if (rmap_item->hlist.next)
-			ksm_pages_sharing--;
+			atomic_long_dec(&ksm_pages_sharing);
 		else
-			ksm_pages_shared--;
+			atomic_long_dec(&ksm_pages_shared);
 		put_anon_vma(rmap_item->anon_vma);
 		rmap_item->address &= PAGE_MASK;
 		cond_resched();
 	}
 
-	rb_erase(&stable_node->node, &root_stable_tree);
+	rb_erase(&stable_node->node, &root_stable_tree[stable_node->shard]);
 	free_stable_node(stable_node);
 }
 
@@ -537,9 +611,9 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 		put_page(page);
 
 		if (stable_node->hlist.first)
-			ksm_pages_sharing--;
+			atomic_long_dec(&ksm_pages_sharing);
 		else
-			ksm_pages_shared--;
+			atomic_long_dec(&ksm_pages_shared);
 
 		put_anon_vma(rmap_item->anon_vma);
 		rmap_item->address &= PAGE_MASK;
@@ -556,9 +630,10 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 		age = (unsigned char)(ksm_scan.seqnr - rmap_item->address);
 		BUG_ON(age > 1);
 		if (!age)
-			rb_erase(&rmap_item->node, &root_unstable_tree);
+			rb_erase(&rmap_item->node, &root_unstable_tree[
+					ksm_shard(rmap_item->oldchecksum)]);
 
-		ksm_pages_unshared--;
+		atomic_long_dec(&ksm_pages_unshared);
 		rmap_item->address &= PAGE_MASK;
 	}
 out:
@@ -669,11 +744,22 @@ error:
 }
 #endif /* CONFIG_SYSFS */
 
+/*
+ * Only the first cacheline of every KSM_CHECKSUM_STRIDE bytes is hashed:
+ * the checksum just has to catch most pages that are being written to,
+ * the trees compare whole pages anyway.
+ */
+#define KSM_CHECKSUM_STRIDE	512
+#define KSM_CHECKSUM_BYTES	64
+
 static u32 calc_checksum(struct page *page)
 {
-	u32 checksum;
+	u32 checksum = 17;
+	unsigned int offset;
 	void *addr = kmap_atomic(page, KM_USER0);
-	checksum = jhash2(addr, PAGE_SIZE / 4, 17);
+	for (offset = 0; offset < PAGE_SIZE; offset += KSM_CHECKSUM_STRIDE)
+		checksum = jhash2(addr + offset, KSM_CHECKSUM_BYTES / 4,
+				  checksum);
 	kunmap_atomic(addr, KM_USER0);
 	return checksum;
 }
@@ -977,15 +1063,15 @@ static struct page *try_to_merge_two_pages(struct rmap_item *rmap_item,
 /*
  * stable_tree_search - search for page inside the stable tree
  *
- * This function checks if there is a page inside the stable tree
+ * This function checks if there is a page inside the stable tree shard
  * with identical content to the page that we are scanning right now.
  *
  * This function returns the stable tree node of identical content if found,
  * NULL otherwise.
  */
-static struct page *stable_tree_search(struct page *page)
+static struct page *stable_tree_search(struct page *page, unsigned int shard)
 {
-	struct rb_node *node = root_stable_tree.rb_node;
+	struct rb_node *node = root_stable_tree[shard].rb_node;
 	struct stable_node *stable_node;
 
 	stable_node = page_stable_node(page);
@@ -1026,9 +1112,10 @@ static struct page *stable_tree_search(struct page *page)
  * This function returns the stable tree node just allocated on success,
  * NULL otherwise.
  */
-static struct stable_node *stable_tree_insert(struct page *kpage)
+static struct stable_node *stable_tree_insert(struct page *kpage,
+					      unsigned int shard)
 {
-	struct rb_node **new = &root_stable_tree.rb_node;
+	struct rb_node **new = &root_stable_tree[shard].rb_node;
 	struct rb_node *parent = NULL;
 	struct stable_node *stable_node;
 
@@ -1065,11 +1152,12 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
 		return NULL;
 
 	rb_link_node(&stable_node->node, parent, new);
-	rb_insert_color(&stable_node->node, &root_stable_tree);
+	rb_insert_color(&stable_node->node, &root_stable_tree[shard]);
 
 	INIT_HLIST_HEAD(&stable_node->hlist);
 
 	stable_node->kpfn = page_to_pfn(kpage);
+	stable_node->shard = shard;
 	set_page_stable_node(kpage, stable_node);
 
 	return stable_node;
@@ -1095,7 +1183,8 @@ struct rmap_item *unstable_tree_search_insert(struct rmap_item *rmap_item,
 					      struct page **tree_pagep)
 
 {
-	struct rb_node **new = &root_unstable_tree.rb_node;
+	unsigned int shard = ksm_shard(rmap_item->oldchecksum);
+	struct rb_node **new = &root_unstable_tree[shard].rb_node;
 	struct rb_node *parent = NULL;
 
 	while (*new) {
@@ -1135,9 +1224,9 @@ struct rmap_item *unstable_tree_search_insert(struct rmap_item *rmap_item,
 	rmap_item->address |= UNSTABLE_FLAG;
 	rmap_item->address |= (ksm_scan.seqnr & SEQNR_MASK);
 	rb_link_node(&rmap_item->node, parent, new);
-	rb_insert_color(&rmap_item->node, &root_unstable_tree);
+	rb_insert_color(&rmap_item->node, &root_unstable_tree[shard]);
 
-	ksm_pages_unshared++;
+	atomic_long_inc(&ksm_pages_unshared);
 	return NULL;
 }
 
@@ -1154,9 +1243,9 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 	hlist_add_head(&rmap_item->hlist, &stable_node->hlist);
 
 	if (rmap_item->hlist.next)
-		ksm_pages_sharing++;
+		atomic_long_inc(&ksm_pages_sharing);
 	else
-		ksm_pages_shared++;
+		atomic_long_inc(&ksm_pages_shared);
 }
 
 /*
@@ -1166,21 +1255,23 @@ static void stable_tree_append(struct rmap_item *rmap_item,
  * both transferred to the stable tree.
  *
  * @page: the page that we are searching identical page to.
- * @rmap_item: the reverse mapping into the virtual address of this page
+ * @rmap_item: the reverse mapping into the virtual address of this page,
+ *	already removed from the trees
+ * @checksum: the current checksum of the page
+ *
+ * Returns the number of pages merged.
  */
-static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
+static int cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item,
+			      u32 checksum)
 {
 	struct rmap_item *tree_rmap_item;
 	struct page *tree_page = NULL;
 	struct stable_node *stable_node;
 	struct page *kpage;
-	unsigned int checksum;
 	int err;
 
-	remove_rmap_item_from_tree(rmap_item);
-
 	/* We first start with searching the page inside the stable tree */
-	kpage = stable_tree_search(page);
+	kpage = stable_tree_search(page, ksm_shard(checksum));
 	if (kpage) {
 		err = try_to_merge_with_ksm_page(rmap_item, page, kpage);
 		if (!err) {
@@ -1193,7 +1284,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			unlock_page(kpage);
 		}
 		put_page(kpage);
-		return;
+		return !err;
 	}
 
 	/*
@@ -1202,10 +1293,9 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
 	 */
-	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
-		return;
+		return 0;
 	}
 
 	tree_rmap_item =
@@ -1223,7 +1313,8 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			remove_rmap_item_from_tree(tree_rmap_item);
 
 			lock_page(kpage);
-			stable_node = stable_tree_insert(kpage);
+			stable_node = stable_tree_insert(kpage,
+							 ksm_shard(checksum));
 			if (stable_node) {
 				stable_tree_append(tree_rmap_item, stable_node);
 				stable_tree_append(rmap_item, stable_node);
@@ -1239,9 +1330,11 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			if (!stable_node) {
 				break_cow(tree_rmap_item);
 				break_cow(rmap_item);
-			}
+			} else
+				return 2;
 		}
 	}
+	return 0;
 }
 
 static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
@@ -1278,6 +1371,7 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 	struct mm_slot *slot;
 	struct vm_area_struct *vma;
 	struct rmap_item *rmap_item;
+	int i;
 
 	if (list_empty(&ksm_mm_head.mm_list))
 		return NULL;
@@ -1296,7 +1390,8 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 		 */
 		lru_add_drain_all();
 
-		root_unstable_tree = RB_ROOT;
+		for (i = 0; i < KSM_NR_SHARDS; i++)
+			root_unstable_tree[i] = RB_ROOT;
 
 		spin_lock(&ksm_mmlist_lock);
 		slot = list_entry(slot->mm_list.next, struct mm_slot, mm_list);
@@ -1358,6 +1453,16 @@ next_mm:
 		}
 	}
 
+	/*
+	 * The rmap_items of this mm still in the batch must be done with
+	 * before any can be freed, or the unstable tree reset for the next
+	 * pass: have the caller run the batch and come back here.
+	 */
+	if (ksm_batch_nr) {
+		up_read(&mm->mmap_sem);
+		return ERR_PTR(-EAGAIN);
+	}
+
 	if (ksm_test_exit(mm)) {
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &slot->rmap_list;
@@ -1403,6 +1508,103 @@ next_mm:
 	return NULL;
 }
 
+/*
+ * ksm_do_work - merge the pages of the batch that belong to the shards
+ * of ksm thread @id, and account the merges and cpu time to the thread.
+ */
+static void ksm_do_work(unsigned int id)
+{
+	struct ksm_thread *thread = &ksm_threads[id];
+	unsigned long long runtime = task_sched_runtime(current);
+	struct ksm_work *work;
+	unsigned int i;
+
+	thread->merged = 0;
+	for (i = 0; i < ksm_batch_nr; i++) {
+		work = &ksm_batch[i];
+		if (ksm_shard(work->checksum) % ksm_nr_threads != id)
+			continue;
+		thread->merged += cmp_and_merge_page(work->page,
+					work->rmap_item, work->checksum);
+		put_page(work->page);
+		cond_resched();
+	}
+	thread->runtime = task_sched_runtime(current) - runtime;
+}
+
+static int ksm_worker_thread(void *data)
+{
+	struct ksm_thread *thread = data;
+
+	set_user_nice(current, 5);
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(ksm_batch_wait,
+			thread->seq != ksm_batch_seq || kthread_should_stop());
+		if (thread->seq == ksm_batch_seq)
+			continue;
+		thread->seq = ksm_batch_seq;
+		ksm_do_work(thread - ksm_threads);
+		if (atomic_dec_and_test(&ksm_batch_pending))
+			wake_up(&ksm_batch_done_wait);
+	}
+	return 0;
+}
+
+/*
+ * ksm_run_batch - have all ksm threads merge the pages of the batch,
+ * ksmd included, and wait for them to finish.
+ *
+ * Returns the number of pages merged.
+ */
+static unsigned long ksm_run_batch(void)
+{
+	unsigned long merged = 0;
+	unsigned int i;
+
+	if (!ksm_batch_nr)
+		return 0;
+
+	if (ksm_nr_threads > 1) {
+		atomic_set(&ksm_batch_pending, ksm_nr_threads - 1);
+		ksm_batch_seq++;
+		wake_up_all(&ksm_batch_wait);
+	}
+	ksm_do_work(0);
+	if (ksm_nr_threads > 1)
+		wait_event(ksm_batch_done_wait,
+			   !atomic_read(&ksm_batch_pending));
+
+	for (i = 0; i < ksm_nr_threads; i++) {
+		merged += ksm_threads[i].merged;
+		ksm_cpu_ns += ksm_threads[i].runtime;
+	}
+	ksm_pages_merged += merged;
+	ksm_batch_nr = 0;
+	return merged;
+}
+
+/*
+ * Scan more pages per batch while they keep merging well, and go back
+ * towards pages_to_scan when they stop merging.
+ */
+static void ksm_adjust_scan_npages(unsigned int scanned,
+				   unsigned long merged)
+{
+	unsigned int min_npages = ksm_thread_pages_to_scan;
+	unsigned int max_npages = UINT_MAX;
+
+	if (min_npages <= UINT_MAX / KSM_SCAN_BOOST)
+		max_npages = min_npages * KSM_SCAN_BOOST;
+
+	if (!merged)
+		ksm_scan_npages /= 2;
+	else if (merged * KSM_SCAN_YIELD >= scanned)
+		ksm_scan_npages = ksm_scan_npages > max_npages / 2 ?
+					max_npages : ksm_scan_npages * 2;
+	ksm_scan_npages = clamp(ksm_scan_npages, min_npages, max_npages);
+}
+
 /**
  * ksm_do_scan  - the ksm scanner main worker function.
  * @scan_npages - number of pages we want to scan before we return.
@@ -1411,16 +1613,37 @@ static void ksm_do_scan(unsigned int scan_npages)
 {
 	struct rmap_item *rmap_item;
 	struct page *uninitialized_var(page);
+	struct ksm_work *work;
+	unsigned int scanned = 0;
+	unsigned long merged = 0;
 
-	while (scan_npages-- && likely(!freezing(current))) {
+	while (scan_npages && likely(!freezing(current))) {
 		cond_resched();
 		rmap_item = scan_get_next_rmap_item(&page);
+		if (IS_ERR(rmap_item)) {
+			merged += ksm_run_batch();
+			continue;
+		}
 		if (!rmap_item)
-			return;
-		if (!PageKsm(page) || !in_stable_tree(rmap_item))
-			cmp_and_merge_page(page, rmap_item);
-		put_page(page);
+			break;
+		scan_npages--;
+		scanned++;
+		if (PageKsm(page) && in_stable_tree(rmap_item)) {
+			put_page(page);
+			continue;
+		}
+
+		remove_rmap_item_from_tree(rmap_item);
+		work = &ksm_batch[ksm_batch_nr++];
+		work->rmap_item = rmap_item;
+		work->page = page;
+		work->checksum = calc_checksum(page);
+		if (ksm_batch_nr == KSM_BATCH)
+			merged += ksm_run_batch();
 	}
+	merged += ksm_run_batch();
+
+	ksm_adjust_scan_npages(scanned, merged);
 }
 
 static int ksmd_should_run(void)
@@ -1436,7 +1659,7 @@ static int ksm_scan_thread(void *nothing)
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
 		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+			ksm_do_scan(ksm_scan_npages);
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
@@ -1764,14 +1987,18 @@ static struct stable_node *ksm_check_stable_tree(unsigned long start_pfn,
 						 unsigned long end_pfn)
 {
 	struct rb_node *node;
+	unsigned int i;
 
-	for (node = rb_first(&root_stable_tree); node; node = rb_next(node)) {
-		struct stable_node *stable_node;
+	for (i = 0; i < KSM_NR_SHARDS; i++) {
+		for (node = rb_first(&root_stable_tree[i]); node;
+		     node = rb_next(node)) {
+			struct stable_node *stable_node;
 
-		stable_node = rb_entry(node, struct stable_node, node);
-		if (stable_node->kpfn >= start_pfn &&
-		    stable_node->kpfn < end_pfn)
-			return stable_node;
+			stable_node = rb_entry(node, struct stable_node, node);
+			if (stable_node->kpfn >= start_pfn &&
+			    stable_node->kpfn < end_pfn)
+				return stable_node;
+		}
 	}
 	return NULL;
 }
@@ -1867,11 +2094,55 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 		return -EINVAL;
 
 	ksm_thread_pages_to_scan = nr_pages;
+	ksm_scan_npages = nr_pages;
 
 	return count;
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t nr_threads_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_nr_threads);
+}
+
+static ssize_t nr_threads_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct ksm_thread *thread;
+	unsigned long nr;
+	int err;
+
+	err = strict_strtoul(buf, 10, &nr);
+	if (err || nr < 1 || nr > KSM_MAX_THREADS)
+		return -EINVAL;
+
+	/* No batch is running while we hold ksm_thread_mutex */
+	mutex_lock(&ksm_thread_mutex);
+	while (ksm_nr_threads < nr) {
+		thread = &ksm_threads[ksm_nr_threads];
+		thread->seq = ksm_batch_seq;
+		thread->task = kthread_run(ksm_worker_thread, thread,
+					   "ksmd/%u", ksm_nr_threads);
+		if (IS_ERR(thread->task)) {
+			err = PTR_ERR(thread->task);
+			thread->task = NULL;
+			break;
+		}
+		ksm_nr_threads++;
+	}
+	while (ksm_nr_threads > nr) {
+		thread = &ksm_threads[--ksm_nr_threads];
+		kthread_stop(thread->task);
+		thread->task = NULL;
+	}
+	mutex_unlock(&ksm_thread_mutex);
+
+	return err ? err : count;
+}
+KSM_ATTR(nr_threads);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -1924,21 +2195,21 @@ KSM_ATTR(run);
 static ssize_t pages_shared_show(struct kobject *kobj,
 				 struct kobj_attribute *attr, char *buf)
 {
-	return sprintf(buf, "%lu\n", ksm_pages_shared);
+	return sprintf(buf, "%ld\n", atomic_long_read(&ksm_pages_shared));
 }
 KSM_ATTR_RO(pages_shared);
 
 static ssize_t pages_sharing_show(struct kobject *kobj,
 				  struct kobj_attribute *attr, char *buf)
 {
-	return sprintf(buf, "%lu\n", ksm_pages_sharing);
+	return sprintf(buf, "%ld\n", atomic_long_read(&ksm_pages_sharing));
 }
 KSM_ATTR_RO(pages_sharing);
 
 static ssize_t pages_unshared_show(struct kobject *kobj,
 				   struct kobj_attribute *attr, char *buf)
 {
-	return sprintf(buf, "%lu\n", ksm_pages_unshared);
+	return sprintf(buf, "%ld\n", atomic_long_read(&ksm_pages_unshared));
 }
 KSM_ATTR_RO(pages_unshared);
 
@@ -1947,8 +2218,10 @@ static ssize_t pages_volatile_show(struct kobject *kobj,
 {
 	long ksm_pages_volatile;
 
-	ksm_pages_volatile = ksm_rmap_items - ksm_pages_shared
-				- ksm_pages_sharing - ksm_pages_unshared;
+	ksm_pages_volatile = ksm_rmap_items
+				- atomic_long_read(&ksm_pages_shared)
+				- atomic_long_read(&ksm_pages_sharing)
+				- atomic_long_read(&ksm_pages_unshared);
 	/*
 	 * It was not worth any locking to calculate that statistic,
 	 * but it might therefore sometimes be negative: conceal that.
@@ -1966,15 +2239,56 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t cpu_msecs_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	u64 cpu_ns;
+
+	mutex_lock(&ksm_thread_mutex);
+	cpu_ns = ksm_cpu_ns;
+	mutex_unlock(&ksm_thread_mutex);
+
+	return sprintf(buf, "%llu\n", div_u64(cpu_ns, NSEC_PER_MSEC));
+}
+KSM_ATTR_RO(cpu_msecs);
+
+/* Pages merged per second of cpu time spent by the ksm threads */
+static ssize_t merge_rate_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	unsigned long merged;
+	u64 cpu_ns;
+
+	mutex_lock(&ksm_thread_mutex);
+	merged = ksm_pages_merged;
+	cpu_ns = ksm_cpu_ns;
+	mutex_unlock(&ksm_thread_mutex);
+
+	return sprintf(buf, "%llu\n", cpu_ns ?
+		       div64_u64((u64)merged * NSEC_PER_SEC, cpu_ns) : 0);
+}
+KSM_ATTR_RO(merge_rate);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&nr_threads_attr.attr,
 	&run_attr.attr,
 	&pages_shared_attr.attr,
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&pages_merged_attr.attr,
+	&cpu_msecs_attr.attr,
+	&merge_rate_attr.attr,
 	NULL,
 };
 
@@ -1999,6 +2313,7 @@ static int __init ksm_init(void)
 		err = PTR_ERR(ksm_thread);
 		goto out_free;
 	}
+	ksm_threads[0].task = ksm_thread;
 
 #ifdef CONFIG_SYSFS
 	err = sysfs_create_group(mm_kobj, &ksm_attr_group);
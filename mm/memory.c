@@ -46,6 +46,7 @@
 #include <linux/highmem.h>
 #include <linux/pagemap.h>
 #include <linux/ksm.h>
+#include <linux/cont_pte.h>
 #include <linux/rmap.h>
 #include <linux/module.h>
 #include <linux/delayacct.h>
@@ -741,20 +742,6 @@ static inline int is_cow_mapping(vm_flags_t flags)
 	return (flags & (VM_SHARED | VM_MAYWRITE)) == VM_MAYWRITE;
 }
 
-#ifndef is_zero_pfn
-static inline int is_zero_pfn(unsigned long pfn)
-{
-	return pfn == zero_pfn;
-}
-#endif
-
-#ifndef my_zero_pfn
-static inline unsigned long my_zero_pfn(unsigned long addr)
-{
-	return zero_pfn;
-}
-#endif
-
 /*
  * vm_normal_page -- This function gets the "struct page" associated with a pte.
  *
@@ -2708,6 +2695,8 @@ gotten:
 		goto oom;
 
 	if (is_zero_pfn(pte_pfn(orig_pte))) {
+		if (cont_pte_fault(mm, vma, address, pmd))
+			return VM_FAULT_WRITE;
 		new_page = alloc_zeroed_user_highpage_movable(vma, address);
 		if (!new_page)
 			goto oom;
@@ -2949,11 +2938,11 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		goto out;
 	}
 	delayacct_set_flag(DELAYACCT_PF_SWAPIN);
-	page = lookup_swap_cache(entry);
+	page = lookup_swap_cache(entry, vma, address);
 	if (!page) {
 		grab_swap_token(mm); /* Contend for token _before_ read-in */
-		page = swapin_readahead(entry,
-					GFP_HIGHUSER_MOVABLE, vma, address);
+		page = swapin_vma_readahead(entry, GFP_HIGHUSER_MOVABLE,
+					    vma, address, pmd);
 		if (!page) {
 			/*
 			 * Back out if somebody else faulted in this pte
@@ -3161,6 +3150,10 @@ static int do_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		goto setpte;
 	}
 
+	/* A whole block of them where the architecture maps blocks */
+	if (cont_pte_fault(mm, vma, address, pmd))
+		return 0;
+
 	/* Allocate our own private page. */
 	if (unlikely(anon_vma_prepare(vma)))
 		goto oom;
@@ -3386,14 +3379,135 @@ unwritable_page:
 	return ret;
 }
 
+/**
+ * do_set_pte - map a page cache page read-only around a fault
+ * @vma: the vma the page is mapped into
+ * @address: user virtual address of the page
+ * @page: the page, locked and with a reference the caller keeps
+ * @pte: the pte to set, mapped and locked, and pte_none
+ *
+ * Used by ->map_pages() implementations.  Write faults on the page go
+ * through ->page_mkwrite or COW as usual later on.
+ */
+void do_set_pte(struct vm_area_struct *vma, unsigned long address,
+		struct page *page, pte_t *pte)
+{
+	pte_t entry;
+
+	flush_icache_page(vma, page);
+	entry = mk_pte(page, vma->vm_page_prot);
+	inc_mm_counter_fast(vma->vm_mm, MM_FILEPAGES);
+	page_add_file_rmap(page);
+	set_pte_at(vma->vm_mm, address, pte, entry);
+
+	/* no need to invalidate: a not-present page won't be cached */
+	update_mmu_cache(vma, address, pte);
+}
+
+/*
+ * Bytes of a file mapping around a read fault that are mapped at once
+ * if the pages are in the page cache already.  PAGE_SIZE disables it.
+ */
+int sysctl_fault_around_bytes __read_mostly = 65536;
+
+int fault_around_bytes_handler(struct ctl_table *table, int write,
+			       void __user *buffer, size_t *length,
+			       loff_t *ppos)
+{
+	struct ctl_table t;
+	int bytes = sysctl_fault_around_bytes;
+	int ret;
+
+	/* Parse into a copy, do_fault_around() must never see a raw value */
+	t = *table;
+	t.data = &bytes;
+	ret = proc_dointvec(&t, write, buffer, length, ppos);
+	if (ret || !write)
+		return ret;
+
+	/* A power of two of pages, within one page table */
+	bytes = clamp_t(int, bytes, PAGE_SIZE, PTRS_PER_PTE * PAGE_SIZE);
+	sysctl_fault_around_bytes = rounddown_pow_of_two(bytes);
+	return 0;
+}
+
+/*
+ * Map the pages around a read fault that are uptodate in the page cache
+ * already: the window is aligned to fault_around_bytes and kept within
+ * the vma and the page table of the faulting address.  ->map_pages()
+ * does no I/O and skips everything it cannot map right away, the fault
+ * itself is left to ->fault().
+ */
+static void do_fault_around(struct vm_area_struct *vma, unsigned long address,
+		pte_t *pte, pgoff_t pgoff, unsigned int flags)
+{
+	unsigned long start_addr;
+	unsigned long nr_pages = sysctl_fault_around_bytes >> PAGE_SHIFT;
+	unsigned long mask = ~(nr_pages * PAGE_SIZE - 1) & PAGE_MASK;
+	pgoff_t max_pgoff;
+	struct vm_fault vmf;
+	int off;
+
+	start_addr = max(address & mask, vma->vm_start);
+	off = ((address - start_addr) >> PAGE_SHIFT) & (PTRS_PER_PTE - 1);
+	pte -= off;
+	pgoff -= off;
+
+	/*
+	 * The window ends at the end of the page table, of the vma or
+	 * nr_pages after its start, whichever comes first.
+	 */
+	max_pgoff = pgoff - ((start_addr >> PAGE_SHIFT) & (PTRS_PER_PTE - 1)) +
+		PTRS_PER_PTE - 1;
+	max_pgoff = min3(max_pgoff,
+			 (pgoff_t)(vma_pages(vma) + vma->vm_pgoff - 1),
+			 (pgoff_t)(pgoff + nr_pages - 1));
+
+	/* Skip the ptes at the start that are mapped already */
+	while (!pte_none(*pte)) {
+		if (++pgoff > max_pgoff)
+			return;
+		start_addr += PAGE_SIZE;
+		pte++;
+	}
+
+	vmf.virtual_address = (void __user *)start_addr;
+	vmf.pte = pte;
+	vmf.pgoff = pgoff;
+	vmf.max_pgoff = max_pgoff;
+	vmf.flags = flags;
+	vmf.page = NULL;
+	vma->vm_ops->map_pages(vma, &vmf);
+}
+
 static int do_linear_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 		unsigned long address, pte_t *page_table, pmd_t *pmd,
 		unsigned int flags, pte_t orig_pte)
 {
 	pgoff_t pgoff = (((address & PAGE_MASK)
 			- vma->vm_start) >> PAGE_SHIFT) + vma->vm_pgoff;
+	spinlock_t *ptl;
 
 	pte_unmap(page_table);
+
+	/*
+	 * Read faults map the neighbouring pages that are in the page cache
+	 * too, unless the vma is marked for random access.  If the faulting
+	 * page was among them, we are done.
+	 */
+	if (!(flags & FAULT_FLAG_WRITE) && vma->vm_ops->map_pages &&
+	    !(vma->vm_flags & VM_RAND_READ) &&
+	    sysctl_fault_around_bytes >> PAGE_SHIFT > 1) {
+		page_table = pte_offset_map_lock(mm, pmd, address, &ptl);
+		do_fault_around(vma, address & PAGE_MASK, page_table, pgoff,
+				flags);
+		if (!pte_same(*page_table, orig_pte)) {
+			pte_unmap_unlock(page_table, ptl);
+			return 0;
+		}
+		pte_unmap_unlock(page_table, ptl);
+	}
+
 	return __do_fault(mm, vma, address, pmd, pgoff, flags, orig_pte);
 }
 
@@ -32,6 +32,9 @@ EXPORT_SYMBOL_GPL(file_ra_state_init);
 
 #define list_to_page(head) (list_entry((head)->prev, struct page, lru))
 
+/* No page of the readahead request is waited for by the caller */
+#define RA_NO_DEMAND	((pgoff_t)-1)
+
 /*
  * see if a page needs releasing upon read_cache_pages() failure
  * - the caller of read_cache_pages() may have set PG_private or PG_fscache
@@ -145,12 +148,16 @@ out:
  * behaviour which would occur if page allocations are causing VM writeback.
  * We really don't want to intermingle reads and writes like that.
  *
+ * @demand is the page the caller is about to wait for, or RA_NO_DEMAND.  It is
+ * read along with the others but not accounted as readahead: it is used right
+ * away and would only inflate the hit rate.
+ *
  * Returns the number of pages requested, or the maximum amount of I/O allowed.
  */
 static int
 __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 			pgoff_t offset, unsigned long nr_to_read,
-			unsigned long lookahead_size)
+			unsigned long lookahead_size, pgoff_t demand)
 {
 	struct inode *inode = mapping->host;
 	struct page *page;
@@ -158,6 +165,7 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	LIST_HEAD(page_pool);
 	int page_idx;
 	int ret = 0;
+	int nr_prefetched = 0;
 	loff_t isize = i_size_read(inode);
 
 	if (isize == 0)
@@ -184,11 +192,16 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		if (!page)
 			break;
 		page->index = page_offset;
+		if (page_offset != demand) {
+			__SetPagePrefetched(page);
+			nr_prefetched++;
+		}
 		list_add(&page->lru, &page_pool);
 		if (page_idx == nr_to_read - lookahead_size)
 			SetPageReadahead(page);
 		ret++;
 	}
+	count_vm_events(RA_PAGES, nr_prefetched);
 
 	/*
 	 * Now start the IO.  We ignore I/O errors - if the page is not
@@ -206,8 +219,10 @@ out:
  * Chunk the readahead into 2 megabyte units, so that we don't pin too much
  * memory at once.
  */
-int force_page_cache_readahead(struct address_space *mapping, struct file *filp,
-		pgoff_t offset, unsigned long nr_to_read)
+static int
+__force_page_cache_readahead(struct address_space *mapping, struct file *filp,
+			     pgoff_t offset, unsigned long nr_to_read,
+			     pgoff_t demand)
 {
 	int ret = 0;
 
@@ -223,7 +238,7 @@ int force_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		if (this_chunk > nr_to_read)
 			this_chunk = nr_to_read;
 		err = __do_page_cache_readahead(mapping, filp,
-						offset, this_chunk, 0);
+						offset, this_chunk, 0, demand);
 		if (err < 0) {
 			ret = err;
 			break;
@@ -235,6 +250,13 @@ int force_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	return ret;
 }
 
+int force_page_cache_readahead(struct address_space *mapping, struct file *filp,
+		pgoff_t offset, unsigned long nr_to_read)
+{
+	return __force_page_cache_readahead(mapping, filp, offset, nr_to_read,
+					    RA_NO_DEMAND);
+}
+
 /*
  * Given a desired number of PAGE_CACHE_SIZE readahead pages, return a
  * sensible upper limit.
@@ -246,15 +268,17 @@ unsigned long max_sane_readahead(unsigned long nr)
 }
 
 /*
- * Submit IO for the read-ahead request in file_ra_state.
+ * Submit IO for the read-ahead request in file_ra_state.  @demand is the
+ * page the caller faulted or read on, see __do_page_cache_readahead().
  */
 unsigned long ra_submit(struct file_ra_state *ra,
-		       struct address_space *mapping, struct file *filp)
+		       struct address_space *mapping, struct file *filp,
+		       pgoff_t demand)
 {
 	int actual;
 
-	actual = __do_page_cache_readahead(mapping, filp,
-					ra->start, ra->size, ra->async_size);
+	actual = __do_page_cache_readahead(mapping, filp, ra->start, ra->size,
+					   ra->async_size, demand);
 
 	return actual;
 }
@@ -334,7 +358,196 @@ static unsigned long get_next_ra_size(struct file_ra_state *ra,
  *
  * The code ramps up the readahead size aggressively at first, but slow down as
  * it approaches max_readhead.
+ *
+ * Several readers may share a file, or one reader may jump between a few
+ * places in it, like the lookups into an APK's central directory and the
+ * entries they point to.  Each file_ra_state therefore keeps RA_STREAMS
+ * streams, most recently used first, and a request is matched to the
+ * stream whose window or last request it continues.  The fields above
+ * always describe the window of streams[0], the stream being served.
+ * Each stream is classified from the distance between its requests:
+ *
+ *  - sequential:  the request continues the previous one or its window
+ *  - interleaved: the same, but other streams were served in between
+ *  - strided:     requests start a constant number of pages apart
+ *  - reverse:     each request ends where the previous one began
+ *  - random:      none of the above, read only what is asked for
+ *
+ * Strided and reverse streams get the next requests they are expected to
+ * make read ahead.  When a sequential stream misses on a page of its own
+ * window, the page was reclaimed before the reader got to it, and the
+ * window of the stream is limited to half of what it was until it has
+ * gone through a few windows without losing pages again.
+ */
+
+/*
+ * Do not let a stream's strided or reverse readahead cover more than this
+ * many of its requests at once.
+ */
+#define RA_MAX_REQUESTS		32
+
+static inline bool ra_pattern_sequential(unsigned int pattern)
+{
+	return pattern == RA_PATTERN_SEQUENTIAL ||
+	       pattern == RA_PATTERN_INTERLEAVED;
+}
+
+/*
+ * Does a request for @req_size pages at @offset continue stream @s?
+ */
+static bool ra_stream_continues(struct ra_stream *s, pgoff_t offset,
+				unsigned long req_size)
+{
+	if (s->pattern == RA_PATTERN_NONE)
+		return false;
+
+	/* sequential, within or right after the window */
+	if (offset >= s->start && offset <= s->start + s->size && s->size)
+		return true;
+	if (offset >= s->prev_index && offset <= s->prev_index + s->prev_req)
+		return true;
+
+	/* reverse, ending where the last request started */
+	if (offset < s->prev_index && offset + req_size >= s->prev_index)
+		return true;
+
+	/* strided, or the stride this stream was started with */
+	return s->stride && offset == s->prev_index + s->stride;
+}
+
+static void ra_stream_set_pattern(struct ra_stream *s, unsigned int pattern)
+{
+	if (s->pattern != pattern) {
+		s->pattern = pattern;
+		s->hits = 0;
+	} else if (s->hits < 255) {
+		s->hits++;
+	}
+}
+
+/*
+ * Classify the request at @offset that was found to continue @s.
+ * @switched tells whether another stream was served before it.
  */
+static void ra_stream_classify(struct ra_stream *s, pgoff_t offset,
+			       bool switched)
+{
+	long delta = offset - s->prev_index;
+
+	if ((delta >= 0 && delta <= s->prev_req) ||
+	    (s->size && offset >= s->start && offset <= s->start + s->size)) {
+		if (switched || s->pattern == RA_PATTERN_INTERLEAVED)
+			ra_stream_set_pattern(s, RA_PATTERN_INTERLEAVED);
+		else
+			ra_stream_set_pattern(s, RA_PATTERN_SEQUENTIAL);
+	} else if (delta < 0 && -delta <= s->prev_req * 2 + 1 &&
+		   delta != s->stride) {
+		ra_stream_set_pattern(s, RA_PATTERN_REVERSE);
+	} else if (delta == s->stride) {
+		ra_stream_set_pattern(s, RA_PATTERN_STRIDED);
+	} else {
+		ra_stream_set_pattern(s, RA_PATTERN_RANDOM);
+	}
+}
+
+/*
+ * Find the stream a request for @req_size pages at @offset belongs to,
+ * or start a new one in place of the least recently used, and make it
+ * the current stream.
+ */
+static struct ra_stream *ra_select_stream(struct file_ra_state *ra,
+					  pgoff_t offset,
+					  unsigned long req_size)
+{
+	struct ra_stream *s = &ra->streams[0];
+	struct ra_stream tmp;
+	long stride;
+	int i;
+
+	/* The window may have been set up by do_sync_mmap_readahead() */
+	if (s->pattern == RA_PATTERN_NONE && ra->size) {
+		s->pattern = RA_PATTERN_RANDOM;
+		s->prev_index = ra->start;
+	}
+	s->start = ra->start;
+	s->size = ra->size;
+	s->async_size = ra->async_size;
+
+	for (i = 0; i < RA_STREAMS; i++)
+		if (ra_stream_continues(&ra->streams[i], offset, req_size))
+			break;
+
+	if (i < RA_STREAMS) {
+		ra_stream_classify(&ra->streams[i], offset, i != 0);
+	} else {
+		/*
+		 * A new stream: remember its distance to the last request on
+		 * the file, a strided reader will make the next one there.
+		 */
+		i = RA_STREAMS - 1;
+		stride = offset - s->prev_index;
+		if (s->pattern == RA_PATTERN_NONE || stride != (int)stride)
+			stride = 0;
+		memset(&ra->streams[i], 0, sizeof(ra->streams[i]));
+		ra->streams[i].pattern = RA_PATTERN_RANDOM;
+		ra->streams[i].stride = stride;
+	}
+
+	if (i) {
+		tmp = ra->streams[i];
+		memmove(&ra->streams[1], &ra->streams[0], i * sizeof(tmp));
+		ra->streams[0] = tmp;
+	}
+
+	s->prev_index = offset;
+	s->prev_req = req_size;
+	ra->start = s->start;
+	ra->size = s->size;
+	ra->async_size = s->async_size;
+	return s;
+}
+
+/*
+ * Read ahead the next requests of a strided or reverse stream, ramping up
+ * the number of requests covered each time the pattern holds.
+ */
+static unsigned long
+ra_readahead_requests(struct address_space *mapping,
+		      struct file_ra_state *ra, struct file *filp,
+		      struct ra_stream *s, pgoff_t offset,
+		      unsigned long req_size, unsigned long max)
+{
+	unsigned long nr, i, ret = 0;
+	pgoff_t demand = offset;
+	struct blk_plug plug;
+	long step;
+
+	if (s->pattern == RA_PATTERN_REVERSE)
+		step = -(long)req_size;
+	else
+		step = s->stride;
+
+	nr = min_t(unsigned long, 2UL << min_t(int, s->hits, 5),
+		   min_t(unsigned long, RA_MAX_REQUESTS,
+			 max / max(req_size, 1UL)));
+
+	blk_start_plug(&plug);
+	for (i = 0; ; i++) {
+		ret += __do_page_cache_readahead(mapping, filp, offset,
+						 req_size, 0, demand);
+		if (i + 1 >= nr || (step < 0 && offset < -step))
+			break;
+		offset += step;
+	}
+	blk_finish_plug(&plug);
+
+	/* Expect the next request after the last one read */
+	s->prev_index = offset;
+	ra->start = offset;
+	ra->size = req_size;
+	ra->async_size = 0;
+	return ret;
+}
 
 /*
  * Count contiguously cached pages from @offset-1 to @offset-@max,
@@ -399,6 +612,11 @@ ondemand_readahead(struct address_space *mapping,
 		   unsigned long req_size)
 {
 	unsigned long max = max_sane_readahead(ra->ra_pages);
+	struct ra_stream *s;
+
+	s = ra_select_stream(ra, offset, req_size);
+	if (s->max)
+		max = min_t(unsigned long, max, s->max);
 
 	/*
 	 * start of file
@@ -409,9 +627,15 @@ ondemand_readahead(struct address_space *mapping,
 	/*
 	 * It's the expected callback offset, assume sequential access.
 	 * Ramp up sizes, and push forward the readahead window.
+	 * A whole window was used, relax the limit set after thrashing.
 	 */
 	if ((offset == (ra->start + ra->size - ra->async_size) ||
 	     offset == (ra->start + ra->size))) {
+		if (s->max) {
+			s->max += s->max / 4 + 1;
+			if (s->max >= ra->ra_pages)
+				s->max = 0;
+		}
 		ra->start += ra->size;
 		ra->size = get_next_ra_size(ra, max);
 		ra->async_size = ra->size;
@@ -442,16 +666,36 @@ ondemand_readahead(struct address_space *mapping,
 		goto readit;
 	}
 
+	/*
+	 * Sequential miss inside the stream's own window: pages it read
+	 * ahead were reclaimed before they were used.  Halve the window.
+	 */
+	if (!hit_readahead_marker && ra_pattern_sequential(s->pattern) &&
+	    offset > ra->start && offset < ra->start + ra->size) {
+		s->max = max_t(unsigned long, ra->size / 2, req_size);
+		max = min_t(unsigned long, max, s->max);
+		goto initial_readahead;
+	}
+
 	/*
 	 * oversize read
 	 */
 	if (req_size > max)
 		goto initial_readahead;
 
+	/*
+	 * strided or reverse stream
+	 */
+	if (s->pattern == RA_PATTERN_STRIDED ||
+	    (s->pattern == RA_PATTERN_REVERSE && s->hits))
+		return ra_readahead_requests(mapping, ra, filp, s, offset,
+					     req_size, max);
+
 	/*
 	 * sequential cache miss
 	 */
-	if (offset - (ra->prev_pos >> PAGE_CACHE_SHIFT) <= 1UL)
+	if (offset - (ra->prev_pos >> PAGE_CACHE_SHIFT) <= 1UL ||
+	    ra_pattern_sequential(s->pattern))
 		goto initial_readahead;
 
 	/*
@@ -465,7 +709,8 @@ ondemand_readahead(struct address_space *mapping,
 	 * standalone, small random read
 	 * Read as is, and do not pollute the readahead state.
 	 */
-	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
+	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0,
+					 offset);
 
 initial_readahead:
 	ra->start = offset;
@@ -483,7 +728,7 @@ readit:
 		ra->size += ra->async_size;
 	}
 
-	return ra_submit(ra, mapping, filp);
+	return ra_submit(ra, mapping, filp, offset);
 }
 
 /**
@@ -510,7 +755,8 @@ void page_cache_sync_readahead(struct address_space *mapping,
 
 	/* be dumb */
 	if (filp && (filp->f_mode & FMODE_RANDOM)) {
-		force_page_cache_readahead(mapping, filp, offset, req_size);
+		__force_page_cache_readahead(mapping, filp, offset, req_size,
+					     offset);
 		return;
 	}
 
@@ -75,6 +75,15 @@
  * SLUB assigns one slab for allocation to each processor.
  * Allocations only occur from these slabs called cpu slabs.
  *
+ * Each processor also keeps a short list of frozen partial slabs, the cpu
+ * partial list. A new cpu slab is taken from there before the node's
+ * partial list, and the cpu partial list is refilled with several slabs
+ * from the node's partial list under a single list_lock hold. A slab that
+ * gets its first free object back is put on the cpu partial list of the
+ * processor freeing the object instead of on the node's partial list.
+ * The cpu partial lists go back to the nodes in one go when they grow
+ * beyond cpu_partial free objects or when the cpu slabs are flushed.
+ *
  * Slabs with free elements are kept on a partial list and during regular
  * operations no list for full slabs is used. If an object in a full slab is
  * freed then the slab will show up again on the partial lists.
@@ -1420,12 +1429,41 @@ static inline int lock_and_freeze_slab(struct kmem_cache_node *n,
 	return 0;
 }
 
+static inline int kmem_cache_has_cpu_partial(struct kmem_cache *s)
+{
+	return s->cpu_partial && !kmem_cache_debug(s);
+}
+
 /*
- * Try to allocate a partial slab from a specific node.
+ * Put a frozen slab on the cpu partial list. The slab at the head of the
+ * list keeps the number of slabs and of free objects on the list.
+ *
+ * Must be called with interrupts disabled.
  */
-static struct page *get_partial_node(struct kmem_cache_node *n)
+static inline void __put_cpu_partial(struct kmem_cache_cpu *c,
+				     struct page *page)
 {
-	struct page *page;
+	struct page *head = c->partial;
+
+	page->pages = 1;
+	page->pobjects = page->objects - page->inuse;
+	if (head) {
+		page->pages += head->pages;
+		page->pobjects += head->pobjects;
+	}
+	page->next = head;
+	c->partial = page;
+}
+
+/*
+ * Try to allocate a partial slab from a specific node. Further slabs are
+ * moved to the cpu partial list while we hold the list_lock anyway.
+ */
+static struct page *get_partial_node(struct kmem_cache *s,
+		struct kmem_cache_node *n, struct kmem_cache_cpu *c)
+{
+	struct page *page, *page2, *found = NULL;
+	int objects = 0;
 
 	/*
 	 * Racy check. If we mistakenly see no partial slabs then we
@@ -1437,19 +1475,32 @@ static struct page *get_partial_node(struct kmem_cache_node *n)
 		return NULL;
 
 	spin_lock(&n->list_lock);
-	list_for_each_entry(page, &n->partial, lru)
-		if (lock_and_freeze_slab(n, page))
-			goto out;
-	page = NULL;
-out:
+	list_for_each_entry_safe(page, page2, &n->partial, lru) {
+		if (!lock_and_freeze_slab(n, page))
+			continue;
+		if (!found) {
+			/* The cpu slab is returned locked */
+			found = page;
+			if (!kmem_cache_has_cpu_partial(s))
+				break;
+			continue;
+		}
+		objects += page->objects - page->inuse;
+		__put_cpu_partial(c, page);
+		slab_unlock(page);
+		stat(s, CPU_PARTIAL_NODE);
+		if (objects > s->cpu_partial / 2)
+			break;
+	}
 	spin_unlock(&n->list_lock);
-	return page;
+	return found;
 }
 
 /*
  * Get a page from somewhere. Search in increasing NUMA distances.
  */
-static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags)
+static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags,
+		struct kmem_cache_cpu *c)
 {
 #ifdef CONFIG_NUMA
 	struct zonelist *zonelist;
@@ -1491,7 +1542,7 @@ static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags)
 
 			if (n && cpuset_zone_allowed_hardwall(zone, flags) &&
 					n->nr_partial > s->min_partial) {
-				page = get_partial_node(n);
+				page = get_partial_node(s, n, c);
 				if (page) {
 					/*
 					 * Return the object even if
@@ -1514,16 +1565,17 @@ static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags)
 /*
  * Get a partial page, lock it and return it.
  */
-static struct page *get_partial(struct kmem_cache *s, gfp_t flags, int node)
+static struct page *get_partial(struct kmem_cache *s, gfp_t flags, int node,
+		struct kmem_cache_cpu *c)
 {
 	struct page *page;
 	int searchnode = (node == NUMA_NO_NODE) ? numa_node_id() : node;
 
-	page = get_partial_node(get_node(s, searchnode));
+	page = get_partial_node(s, get_node(s, searchnode), c);
 	if (page || node != NUMA_NO_NODE)
 		return page;
 
-	return get_any_partial(s, flags);
+	return get_any_partial(s, flags, c);
 }
 
 /*
@@ -1573,6 +1625,76 @@ static void unfreeze_slab(struct kmem_cache *s, struct page *page, int tail)
 	}
 }
 
+/*
+ * Move all slabs of the cpu partial list back to the node partial lists,
+ * taking each list_lock once for a run of slabs from the same node, and
+ * free the empty ones beyond min_partial.
+ *
+ * Must be called with interrupts disabled.
+ */
+static void unfreeze_partials(struct kmem_cache *s, struct kmem_cache_cpu *c)
+{
+	struct kmem_cache_node *n = NULL, *n2;
+	struct page *page, *discard = NULL;
+
+	while ((page = c->partial)) {
+		c->partial = page->next;
+
+		n2 = get_node(s, page_to_nid(page));
+		if (n != n2) {
+			if (n)
+				spin_unlock(&n->list_lock);
+			n = n2;
+			spin_lock(&n->list_lock);
+		}
+
+		/* The slab_lock nests outside the list_lock */
+		if (!slab_trylock(page)) {
+			spin_unlock(&n->list_lock);
+			slab_lock(page);
+			spin_lock(&n->list_lock);
+		}
+
+		__ClearPageSlubFrozen(page);
+		if (!page->inuse && n->nr_partial >= s->min_partial) {
+			page->next = discard;
+			discard = page;
+		} else if (page->freelist) {
+			n->nr_partial++;
+			list_add_tail(&page->lru, &n->partial);
+		}
+		slab_unlock(page);
+	}
+	if (n)
+		spin_unlock(&n->list_lock);
+
+	while (discard) {
+		page = discard;
+		discard = page->next;
+		stat(s, DEACTIVATE_EMPTY);
+		discard_slab(s, page);
+		stat(s, FREE_SLAB);
+	}
+}
+
+/*
+ * Put a slab that got its first free object back on the cpu partial list,
+ * draining the list first if it holds enough free objects already.
+ *
+ * Must be called with interrupts disabled and the slab frozen.
+ */
+static void put_cpu_partial(struct kmem_cache *s, struct page *page)
+{
+	struct kmem_cache_cpu *c = this_cpu_ptr(s->cpu_slab);
+
+	if (c->partial && c->partial->pobjects > s->cpu_partial) {
+		unfreeze_partials(s, c);
+		stat(s, CPU_PARTIAL_DRAIN);
+	}
+	__put_cpu_partial(c, page);
+	stat(s, CPU_PARTIAL_FREE);
+}
+
 #ifdef CONFIG_PREEMPT
 /*
  * Calculate the next globally unique transaction for disambiguiation
@@ -1690,8 +1812,11 @@ static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
-	if (likely(c && c->page))
-		flush_slab(s, c);
+	if (likely(c)) {
+		if (c->page)
+			flush_slab(s, c);
+		unfreeze_partials(s, c);
+	}
 }
 
 static void flush_cpu_slab(void *d)
@@ -1857,7 +1982,17 @@ another_slab:
 	deactivate_slab(s, c);
 
 new_slab:
-	page = get_partial(s, gfpflags, node);
+	page = c->partial;
+	if (page && (node == NUMA_NO_NODE || page_to_nid(page) == node)) {
+		c->partial = page->next;
+		stat(s, CPU_PARTIAL_ALLOC);
+		slab_lock(page);
+		c->node = page_to_nid(page);
+		c->page = page;
+		goto load_freelist;
+	}
+
+	page = get_partial(s, gfpflags, node, c);
 	if (page) {
 		stat(s, ALLOC_FROM_PARTIAL);
 		c->node = page_to_nid(page);
@@ -2071,9 +2206,17 @@ static void __slab_free(struct kmem_cache *s, struct page *page,
 
 	/*
 	 * Objects left in the slab. If it was not on the partial list before
-	 * then add it.
+	 * then add it, preferably to our cpu partial list which does not
+	 * need the list_lock.
 	 */
 	if (unlikely(!prior)) {
+		if (kmem_cache_has_cpu_partial(s)) {
+			__SetPageSlubFrozen(page);
+			slab_unlock(page);
+			put_cpu_partial(s, page);
+			local_irq_restore(flags);
+			return;
+		}
 		add_partial(get_node(s, page_to_nid(page)), page, 1);
 		stat(s, FREE_ADD_PARTIAL);
 	}
@@ -2610,6 +2753,22 @@ static int kmem_cache_open(struct kmem_cache *s,
 	 * list to avoid pounding the page allocator excessively.
 	 */
 	set_min_partial(s, ilog2(s->size));
+
+	/*
+	 * The cpu partial lists hold fewer free objects the larger the
+	 * objects are. Debugging needs every slab on the node lists.
+	 */
+	if (kmem_cache_debug(s))
+		s->cpu_partial = 0;
+	else if (s->size >= PAGE_SIZE)
+		s->cpu_partial = 2;
+	else if (s->size >= 1024)
+		s->cpu_partial = 6;
+	else if (s->size >= 256)
+		s->cpu_partial = 13;
+	else
+		s->cpu_partial = 30;
+
 	s->refcount = 1;
 #ifdef CONFIG_NUMA
 	s->remote_node_defrag_ratio = 1000;
@@ -4157,6 +4316,60 @@ static ssize_t min_partial_store(struct kmem_cache *s, const char *buf,
 }
 SLAB_ATTR(min_partial);
 
+static ssize_t cpu_partial_show(struct kmem_cache *s, char *buf)
+{
+	return sprintf(buf, "%d\n", s->cpu_partial);
+}
+
+static ssize_t cpu_partial_store(struct kmem_cache *s, const char *buf,
+				 size_t length)
+{
+	unsigned long objects;
+	int err;
+
+	err = strict_strtoul(buf, 10, &objects);
+	if (err)
+		return err;
+	if (objects > INT_MAX || (objects && kmem_cache_debug(s)))
+		return -EINVAL;
+
+	s->cpu_partial = objects;
+	flush_all(s);
+	return length;
+}
+SLAB_ATTR(cpu_partial);
+
+static ssize_t slabs_cpu_partial_show(struct kmem_cache *s, char *buf)
+{
+	int objects = 0;
+	int pages = 0;
+	int cpu;
+	int len;
+
+	for_each_online_cpu(cpu) {
+		struct page *page = per_cpu_ptr(s->cpu_slab, cpu)->partial;
+
+		if (page) {
+			pages += page->pages;
+			objects += page->pobjects;
+		}
+	}
+
+	len = sprintf(buf, "%d(%d)", objects, pages);
+
+#ifdef CONFIG_SMP
+	for_each_online_cpu(cpu) {
+		struct page *page = per_cpu_ptr(s->cpu_slab, cpu)->partial;
+
+		if (page && len < PAGE_SIZE - 20)
+			len += sprintf(buf + len, " C%d=%d(%d)", cpu,
+				       page->pobjects, page->pages);
+	}
+#endif
+	return len + sprintf(buf + len, "\n");
+}
+SLAB_ATTR_RO(slabs_cpu_partial);
+
 static ssize_t ctor_show(struct kmem_cache *s, char *buf)
 {
 	if (!s->ctor)
@@ -4503,6 +4716,10 @@ STAT_ATTR(DEACTIVATE_TO_HEAD, deactivate_to_head);
 STAT_ATTR(DEACTIVATE_TO_TAIL, deactivate_to_tail);
 STAT_ATTR(DEACTIVATE_REMOTE_FREES, deactivate_remote_frees);
 STAT_ATTR(ORDER_FALLBACK, order_fallback);
+STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
+STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
+STAT_ATTR(CPU_PARTIAL_NODE, cpu_partial_node);
+STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
 #endif
 
 static struct attribute *slab_attrs[] = {
@@ -4511,10 +4728,12 @@ static struct attribute *slab_attrs[] = {
 	&objs_per_slab_attr.attr,
 	&order_attr.attr,
 	&min_partial_attr.attr,
+	&cpu_partial_attr.attr,
 	&objects_attr.attr,
 	&objects_partial_attr.attr,
 	&partial_attr.attr,
 	&cpu_slabs_attr.attr,
+	&slabs_cpu_partial_attr.attr,
 	&ctor_attr.attr,
 	&aliases_attr.attr,
 	&align_attr.attr,
@@ -4560,6 +4779,10 @@ static struct attribute *slab_attrs[] = {
 	&deactivate_to_tail_attr.attr,
 	&deactivate_remote_frees_attr.attr,
 	&order_fallback_attr.attr,
+	&cpu_partial_alloc_attr.attr,
+	&cpu_partial_free_attr.attr,
+	&cpu_partial_node_attr.attr,
+	&cpu_partial_drain_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
@@ -19,6 +19,8 @@
 #include <linux/pagevec.h>
 #include <linux/migrate.h>
 #include <linux/page_cgroup.h>
+#include <linux/blkdev.h>
+#include <linux/log2.h>
 
 #include <asm/pgtable.h>
 
@@ -254,20 +256,65 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
 	}
 }
 
+/*
+ * Virtual address based readahead state of a vma, packed in
+ * vma->swap_readahead_info: the page address of the last swap fault,
+ * the readahead window used for it and the number of readahead hits
+ * since.
+ */
+#define SWAP_RA_WIN_SHIFT	(PAGE_SHIFT / 2)
+#define SWAP_RA_HITS_MASK	((1UL << SWAP_RA_WIN_SHIFT) - 1)
+#define SWAP_RA_HITS_MAX	SWAP_RA_HITS_MASK
+#define SWAP_RA_WIN_MASK	(~PAGE_MASK & ~SWAP_RA_HITS_MASK)
+
+#define SWAP_RA_HITS(v)		((v) & SWAP_RA_HITS_MASK)
+#define SWAP_RA_WIN(v)		(((v) & SWAP_RA_WIN_MASK) >> SWAP_RA_WIN_SHIFT)
+#define SWAP_RA_ADDR(v)		((v) & PAGE_MASK)
+
+#define SWAP_RA_VAL(addr, win, hits)				\
+	(((addr) & PAGE_MASK) |					\
+	 (((win) << SWAP_RA_WIN_SHIFT) & SWAP_RA_WIN_MASK) |	\
+	 ((hits) & SWAP_RA_HITS_MASK))
+
+/* Page table entries copied for one readahead, bounds the window */
+#define SWAP_RA_MAX_PAGES	16
+
 /*
  * Lookup a swap entry in the swap cache. A found page will be returned
  * unlocked and with its refcount incremented - we rely on the kernel
  * lock getting page table operations atomic even if we drop the page
  * lock before returning.
+ *
+ * If the page was brought in by readahead, the hit is accounted to
+ * @vma, when given, which makes its next readahead window grow.
  */
-struct page * lookup_swap_cache(swp_entry_t entry)
+struct page *lookup_swap_cache(swp_entry_t entry, struct vm_area_struct *vma,
+			       unsigned long addr)
 {
 	struct page *page;
+	unsigned long ra_val;
+	unsigned long hits;
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		if (TestClearPageReadahead(page)) {
+			count_vm_event(SWAP_RA_HIT);
+			if (vma) {
+				ra_val = atomic_long_read(
+					&vma->swap_readahead_info);
+				hits = SWAP_RA_HITS(ra_val);
+				if (hits < SWAP_RA_HITS_MAX)
+					hits++;
+				atomic_long_set(&vma->swap_readahead_info,
+						SWAP_RA_VAL(addr,
+							SWAP_RA_WIN(ra_val),
+							hits));
+				vma->swap_ra_hits++;
+			}
+		}
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
@@ -279,12 +326,14 @@ struct page * lookup_swap_cache(swp_entry_t entry)
  * A failure return means that either the page allocation failed or that
  * the swap entry is no longer in use.
  */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry,
+			gfp_t gfp_mask, struct vm_area_struct *vma,
+			unsigned long addr, bool *new_page_allocated)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
 
+	*new_page_allocated = false;
 	do {
 		/*
 		 * First check the swap cache.  Since this is normally
@@ -350,6 +399,7 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 			 * Initiate read into locked page and return.
 			 */
 			lru_cache_add_anon(new_page);
+			*new_page_allocated = true;
 			swap_readpage(new_page);
 			return new_page;
 		}
@@ -368,6 +418,37 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	bool page_allocated;
+
+	return __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &page_allocated);
+}
+
+/*
+ * Start reading ahead the swap page at @entry.  Pages that actually had
+ * to be read are marked, so that lookup_swap_cache() can tell whether
+ * readahead did any good.
+ */
+static void swap_readahead_one(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	bool page_allocated;
+	struct page *page;
+
+	page = __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &page_allocated);
+	if (!page)
+		return;
+	if (page_allocated) {
+		SetPageReadahead(page);
+		count_vm_event(SWAP_RA);
+	}
+	page_cache_release(page);
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -391,7 +472,6 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			struct vm_area_struct *vma, unsigned long addr)
 {
 	int nr_pages;
-	struct page *page;
 	unsigned long offset;
 	unsigned long end_offset;
 
@@ -405,12 +485,141 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	nr_pages = valid_swaphandles(entry, &offset);
 	for (end_offset = offset + nr_pages; offset < end_offset; offset++) {
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
-		if (!page)
-			break;
-		page_cache_release(page);
+		if (offset == swp_offset(entry))
+			continue;
+		swap_readahead_one(swp_entry(swp_type(entry), offset),
+				   gfp_mask, vma, addr);
 	}
 	lru_add_drain();	/* Push any new pages onto the LRU now */
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+/*
+ * Number of pages to read around a swap fault at page @fpfn, given the
+ * previous fault of the vma at @pfn, the readahead hits since and the
+ * window used then.
+ */
+static unsigned int swap_ra_window(unsigned long fpfn, unsigned long pfn,
+				   unsigned long hits, unsigned int max_pages,
+				   unsigned int prev_win)
+{
+	unsigned int pages, last_ra;
+
+	/*
+	 * This heuristic has been found to work well on both sequential
+	 * and random loads, swapping to hard disk or to SSD: please
+	 * don't ask what the "+ 2" means, it just happens to work well,
+	 * that's all.
+	 */
+	pages = hits + 2;
+	if (pages == 2) {
+		/*
+		 * We can have no readahead hits to judge by: but must not
+		 * get stuck here forever, so check for an adjacent fault.
+		 */
+		if (fpfn != pfn + 1 && fpfn + 1 != pfn)
+			pages = 1;
+	} else {
+		pages = roundup_pow_of_two(pages);
+	}
+
+	if (pages > max_pages)
+		pages = max_pages;
+
+	/* Don't shrink readahead too fast */
+	last_ra = prev_win / 2;
+	if (pages < last_ra)
+		pages = last_ra;
+
+	return pages;
+}
+
+/**
+ * swapin_vma_readahead - swap in pages around a faulting address
+ * @entry: swap entry of this memory
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma this address belongs to
+ * @addr: faulting address
+ * @pmd: page middle directory entry covering @addr
+ *
+ * On devices set up for it, this reads ahead the swap entries found in
+ * the page table around @addr instead of the neighbouring swap slots:
+ * the pages next to each other in a vma are much more likely to be
+ * needed together than pages that happened to be swapped out together.
+ * The window follows the direction of consecutive faults and grows
+ * with the number of readahead pages the vma actually used.  Other
+ * devices use swapin_readahead().
+ *
+ * Caller must hold down_read on the vma->vm_mm if vma is not NULL.
+ */
+struct page *swapin_vma_readahead(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			pmd_t *pmd)
+{
+	pte_t ptes[SWAP_RA_MAX_PAGES];
+	struct blk_plug plug;
+	unsigned long ra_val, fpfn, pfn, start, end, left;
+	unsigned int max_pages, win, i, nr;
+	pte_t *pte;
+
+	vma->swap_ra_misses++;
+
+	if (!swap_vma_readahead(entry))
+		return swapin_readahead(entry, gfp_mask, vma, addr);
+
+	max_pages = min_t(unsigned int, 1 << page_cluster, SWAP_RA_MAX_PAGES);
+
+	ra_val = atomic_long_read(&vma->swap_readahead_info);
+	fpfn = addr >> PAGE_SHIFT;
+	pfn = SWAP_RA_ADDR(ra_val) >> PAGE_SHIFT;
+	win = swap_ra_window(fpfn, pfn, SWAP_RA_HITS(ra_val), max_pages,
+			     SWAP_RA_WIN(ra_val));
+	atomic_long_set(&vma->swap_readahead_info, SWAP_RA_VAL(addr, win, 0));
+
+	if (win <= 1)
+		goto skip;
+
+	/* Read in the direction of the faults, around the address if none */
+	if (fpfn == pfn + 1)
+		left = 0;
+	else if (fpfn + 1 == pfn)
+		left = win - 1;
+	else
+		left = (win - 1) / 2;
+	start = fpfn > left ? fpfn - left : 0;
+	end = start + win;
+
+	/* Stay within the vma and the page table page covering addr */
+	start = max3(start, vma->vm_start >> PAGE_SHIFT,
+		     (addr & PMD_MASK) >> PAGE_SHIFT);
+	end = min3(end, vma->vm_end >> PAGE_SHIFT,
+		   ((addr & PMD_MASK) + PMD_SIZE) >> PAGE_SHIFT);
+	nr = end - start;
+
+	/*
+	 * Copy the entries out: reading ahead allocates and may sleep.
+	 * Without the page table lock an entry may change under us, in
+	 * which case we read ahead a page that is not needed, or skip one.
+	 */
+	pte = pte_offset_map(pmd, start << PAGE_SHIFT);
+	for (i = 0; i < nr; i++)
+		ptes[i] = pte[i];
+	pte_unmap(pte);
+
+	blk_start_plug(&plug);
+	for (i = 0; i < nr; i++) {
+		swp_entry_t ra_entry;
+
+		if (start + i == fpfn || !is_swap_pte(ptes[i]))
+			continue;
+		ra_entry = pte_to_swp_entry(ptes[i]);
+		if (unlikely(non_swap_entry(ra_entry)))
+			continue;
+		swap_readahead_one(ra_entry, gfp_mask, vma,
+				   (start + i) << PAGE_SHIFT);
+	}
+	blk_finish_plug(&plug);
+	lru_add_drain();
+skip:
+	return read_swap_cache_async(entry, gfp_mask, vma, addr);
+}
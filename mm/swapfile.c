@@ -2116,6 +2116,17 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 			p->flags |= SWP_DISCARDABLE;
 	}
 
+	/*
+	 * Neighbouring slots on devices without seek cost, like zram or
+	 * flash, are rarely related: read ahead around the faulting
+	 * address there unless told otherwise.
+	 */
+	if (swap_flags & SWAP_FLAG_RA_VMA)
+		p->flags |= SWP_VMA_RA;
+	else if (!(swap_flags & SWAP_FLAG_RA_CLUSTER) &&
+		 (p->flags & SWP_SOLIDSTATE))
+		p->flags |= SWP_VMA_RA;
+
 	mutex_lock(&swapon_mutex);
 	prio = -1;
 	if (swap_flags & SWAP_FLAG_PREFER)
@@ -2124,11 +2135,12 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 	enable_swap_info(p, prio, swap_map);
 
 	printk(KERN_INFO "Adding %uk swap on %s.  "
-			"Priority:%d extents:%d across:%lluk %s%s\n",
+			"Priority:%d extents:%d across:%lluk %s%s%s\n",
 		p->pages<<(PAGE_SHIFT-10), name, p->prio,
 		nr_extents, (unsigned long long)span<<(PAGE_SHIFT-10),
 		(p->flags & SWP_SOLIDSTATE) ? "SS" : "",
-		(p->flags & SWP_DISCARDABLE) ? "D" : "");
+		(p->flags & SWP_DISCARDABLE) ? "D" : "",
+		(p->flags & SWP_VMA_RA) ? "V" : "");
 
 	mutex_unlock(&swapon_mutex);
 	atomic_inc(&proc_poll_event);
@@ -2296,6 +2308,15 @@ int swapcache_prepare(swp_entry_t entry)
 	return __swap_duplicate(entry, SWAP_HAS_CACHE);
 }
 
+/*
+ * Returns true if swap-in from the device holding @entry should read
+ * ahead by virtual address rather than by swap offset.
+ */
+bool swap_vma_readahead(swp_entry_t entry)
+{
+	return swap_info[swp_type(entry)]->flags & SWP_VMA_RA;
+}
+
 /*
  * swap_lock prevents swap_map being freed. Don't grab an extra
  * reference on the swaphandle, it doesn't matter if it becomes unused.
@@ -43,6 +43,8 @@
 #include <linux/sysctl.h>
 #include <linux/oom.h>
 #include <linux/prefetch.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -149,11 +151,81 @@ struct scan_control {
  * From 0 .. 100.  Higher means more swappy.
  */
 int vm_swappiness = 60;
+/*
+ * Pages isolated from an LRU list at a time.  Larger batches take
+ * zone->lru_lock less often at the cost of a coarser reclaim target.
+ */
+int vm_reclaim_batch = 2 * SWAP_CLUSTER_MAX;
 long vm_total_pages;	/* The total number of pages which the VM controls */
 
 static LIST_HEAD(shrinker_list);
 static DECLARE_RWSEM(shrinker_rwsem);
 
+/* Places where reclaim takes zone->lru_lock, for CONFIG_LRU_LOCK_STATS */
+enum lru_lock_site {
+	LRU_LOCK_ISOLATE_INACTIVE,
+	LRU_LOCK_PUTBACK_INACTIVE,
+	LRU_LOCK_ISOLATE_ACTIVE,
+	LRU_LOCK_PUTBACK_ACTIVE,
+	NR_LRU_LOCK_SITES
+};
+
+#ifdef CONFIG_LRU_LOCK_STATS
+#define LRU_LOCK_HIST_BUCKETS	24	/* log2 of nsecs */
+
+struct lru_lock_stat {
+	unsigned long	count;
+	u64		wait_ns;
+	u64		hold_ns;
+	u64		max_hold_ns;
+	unsigned long	hold_hist[LRU_LOCK_HIST_BUCKETS];
+};
+
+static DEFINE_PER_CPU(struct lru_lock_stat [NR_LRU_LOCK_SITES],
+		      lru_lock_stats);
+
+static inline u64 lru_lock_stat_start(void)
+{
+	return local_clock();
+}
+
+/* Called with zone->lru_lock just taken, returns the time it was taken at */
+static inline u64 lru_lock_stat_acquired(enum lru_lock_site site, u64 start)
+{
+	u64 now = local_clock();
+
+	__this_cpu_add(lru_lock_stats[site].wait_ns, now - start);
+	return now;
+}
+
+/* Called with zone->lru_lock held, right before releasing it */
+static void lru_lock_stat_release(enum lru_lock_site site, u64 locked)
+{
+	struct lru_lock_stat *st = &__get_cpu_var(lru_lock_stats)[site];
+	u64 held = local_clock() - locked;
+
+	st->count++;
+	st->hold_ns += held;
+	if (held > st->max_hold_ns)
+		st->max_hold_ns = held;
+	st->hold_hist[min_t(int, fls64(held), LRU_LOCK_HIST_BUCKETS - 1)]++;
+}
+#else
+static inline u64 lru_lock_stat_start(void)
+{
+	return 0;
+}
+
+static inline u64 lru_lock_stat_acquired(enum lru_lock_site site, u64 start)
+{
+	return start;
+}
+
+static inline void lru_lock_stat_release(enum lru_lock_site site, u64 locked)
+{
+}
+#endif /* CONFIG_LRU_LOCK_STATS */
+
 #ifdef CONFIG_CGROUP_MEM_RES_CTLR
 #define scanning_global_lru(sc)	(!(sc)->mem_cgroup)
 #else
@@ -524,9 +596,12 @@ static pageout_t pageout(struct page *page, struct address_space *mapping,
 
 /*
  * Same as remove_mapping, but if the page is removed from the mapping, it
- * gets returned with a refcount of 0.
+ * gets returned with a refcount of 0.  @reclaimed tells whether the page
+ * is evicted by reclaim, in which case a shadow entry is left behind for
+ * workingset detection.
  */
-static int __remove_mapping(struct address_space *mapping, struct page *page)
+static int __remove_mapping(struct address_space *mapping, struct page *page,
+			    bool reclaimed)
 {
 	BUG_ON(!PageLocked(page));
 	BUG_ON(mapping != page_mapping(page));
@@ -575,6 +650,10 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 
 		freepage = mapping->a_ops->freepage;
 
+		if (reclaimed && page_is_file_cache(page))
+			workingset_eviction(mapping, page);
+		if (reclaimed && PagePrefetched(page))
+			count_vm_event(RA_UNUSED);
 		__delete_from_page_cache(page);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
@@ -598,7 +677,7 @@ cannot_free:
  */
 int remove_mapping(struct address_space *mapping, struct page *page)
 {
-	if (__remove_mapping(mapping, page)) {
+	if (__remove_mapping(mapping, page, false)) {
 		/*
 		 * Unfreezing the refcount with 1 rather than 2 effectively
 		 * drops the pagecache ref for us without requiring another
@@ -952,7 +1031,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		if (!mapping || !__remove_mapping(mapping, page))
+		if (!mapping || !__remove_mapping(mapping, page, true))
 			goto keep_locked;
 
 		/*
@@ -1373,27 +1452,33 @@ putback_lru_pages(struct zone *zone, struct scan_control *sc,
 				unsigned long nr_anon, unsigned long nr_file,
 				struct list_head *page_list)
 {
-	struct page *page;
-	struct pagevec pvec;
+	struct page *page, *next;
 	struct zone_reclaim_stat *reclaim_stat = get_reclaim_stat(zone, sc);
+	LIST_HEAD(unevictable);
+	LIST_HEAD(pages_to_free);
+	u64 locked;
 
-	pagevec_init(&pvec, 1);
+	/*
+	 * Sort out the pages that cannot simply be added back before
+	 * taking the lock, so that the whole batch goes back under a
+	 * single hold of it.
+	 */
+	list_for_each_entry_safe(page, next, page_list, lru) {
+		VM_BUG_ON(PageLRU(page));
+		if (unlikely(!page_evictable(page, NULL)))
+			list_move(&page->lru, &unevictable);
+	}
 
 	/*
 	 * Put back any unfreeable pages.
 	 */
+	locked = lru_lock_stat_start();
 	spin_lock(&zone->lru_lock);
+	locked = lru_lock_stat_acquired(LRU_LOCK_PUTBACK_INACTIVE, locked);
 	while (!list_empty(page_list)) {
 		int lru;
 		page = lru_to_page(page_list);
-		VM_BUG_ON(PageLRU(page));
 		list_del(&page->lru);
-		if (unlikely(!page_evictable(page, NULL))) {
-			spin_unlock_irq(&zone->lru_lock);
-			putback_lru_page(page);
-			spin_lock_irq(&zone->lru_lock);
-			continue;
-		}
 		SetPageLRU(page);
 		lru = page_lru(page);
 		add_page_to_lru_list(zone, page, lru);
@@ -1402,17 +1487,32 @@ putback_lru_pages(struct zone *zone, struct scan_control *sc,
 			int numpages = hpage_nr_pages(page);
 			reclaim_stat->recent_rotated[file] += numpages;
 		}
-		if (!pagevec_add(&pvec, page)) {
-			spin_unlock_irq(&zone->lru_lock);
-			__pagevec_release(&pvec);
-			spin_lock_irq(&zone->lru_lock);
+		if (put_page_testzero(page)) {
+			__ClearPageLRU(page);
+			__ClearPageActive(page);
+			del_page_from_lru_list(zone, page, lru);
+
+			if (unlikely(PageCompound(page))) {
+				spin_unlock_irq(&zone->lru_lock);
+				(*get_compound_page_dtor(page))(page);
+				spin_lock_irq(&zone->lru_lock);
+			} else
+				list_add(&page->lru, &pages_to_free);
 		}
 	}
 	__mod_zone_page_state(zone, NR_ISOLATED_ANON, -nr_anon);
 	__mod_zone_page_state(zone, NR_ISOLATED_FILE, -nr_file);
 
+	lru_lock_stat_release(LRU_LOCK_PUTBACK_INACTIVE, locked);
 	spin_unlock_irq(&zone->lru_lock);
-	pagevec_release(&pvec);
+
+	free_hot_cold_page_list(&pages_to_free, 1);
+
+	while (!list_empty(&unevictable)) {
+		page = lru_to_page(&unevictable);
+		list_del(&page->lru);
+		putback_lru_page(page);
+	}
 }
 
 static noinline_for_stack void update_isolated_counts(struct zone *zone,
@@ -1502,6 +1602,7 @@ shrink_inactive_list(unsigned long nr_to_scan, struct zone *zone,
 	unsigned long nr_anon;
 	unsigned long nr_file;
 	isolate_mode_t reclaim_mode = ISOLATE_INACTIVE;
+	u64 locked;
 
 	while (unlikely(too_many_isolated(zone, file, sc))) {
 		congestion_wait(BLK_RW_ASYNC, HZ/10);
@@ -1522,7 +1623,9 @@ shrink_inactive_list(unsigned long nr_to_scan, struct zone *zone,
 	if (!sc->may_writepage)
 		reclaim_mode |= ISOLATE_CLEAN;
 
+	locked = lru_lock_stat_start();
 	spin_lock_irq(&zone->lru_lock);
+	locked = lru_lock_stat_acquired(LRU_LOCK_ISOLATE_INACTIVE, locked);
 
 	if (scanning_global_lru(sc)) {
 		nr_taken = isolate_pages_global(nr_to_scan, &page_list,
@@ -1545,12 +1648,14 @@ shrink_inactive_list(unsigned long nr_to_scan, struct zone *zone,
 	}
 
 	if (nr_taken == 0) {
+		lru_lock_stat_release(LRU_LOCK_ISOLATE_INACTIVE, locked);
 		spin_unlock_irq(&zone->lru_lock);
 		return 0;
 	}
 
 	update_isolated_counts(zone, sc, &nr_anon, &nr_file, &page_list);
 
+	lru_lock_stat_release(LRU_LOCK_ISOLATE_INACTIVE, locked);
 	spin_unlock_irq(&zone->lru_lock);
 
 	nr_reclaimed = shrink_page_list(&page_list, zone, sc);
@@ -1596,14 +1701,12 @@ shrink_inactive_list(unsigned long nr_to_scan, struct zone *zone,
 
 static void move_active_pages_to_lru(struct zone *zone,
 				     struct list_head *list,
+				     struct list_head *pages_to_free,
 				     enum lru_list lru)
 {
 	unsigned long pgmoved = 0;
-	struct pagevec pvec;
 	struct page *page;
 
-	pagevec_init(&pvec, 1);
-
 	while (!list_empty(list)) {
 		page = lru_to_page(list);
 
@@ -1614,12 +1717,17 @@ static void move_active_pages_to_lru(struct zone *zone,
 		mem_cgroup_add_lru_list(page, lru);
 		pgmoved += hpage_nr_pages(page);
 
-		if (!pagevec_add(&pvec, page) || list_empty(list)) {
-			spin_unlock_irq(&zone->lru_lock);
-			if (buffer_heads_over_limit)
-				pagevec_strip(&pvec);
-			__pagevec_release(&pvec);
-			spin_lock_irq(&zone->lru_lock);
+		if (put_page_testzero(page)) {
+			__ClearPageLRU(page);
+			__ClearPageActive(page);
+			del_page_from_lru_list(zone, page, lru);
+
+			if (unlikely(PageCompound(page))) {
+				spin_unlock_irq(&zone->lru_lock);
+				(*get_compound_page_dtor(page))(page);
+				spin_lock_irq(&zone->lru_lock);
+			} else
+				list_add(&page->lru, pages_to_free);
 		}
 	}
 	__mod_zone_page_state(zone, NR_LRU_BASE + lru, pgmoved);
@@ -1640,6 +1748,7 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 	struct zone_reclaim_stat *reclaim_stat = get_reclaim_stat(zone, sc);
 	unsigned long nr_rotated = 0;
 	isolate_mode_t reclaim_mode = ISOLATE_ACTIVE;
+	u64 locked;
 
 	lru_add_drain();
 
@@ -1648,7 +1757,9 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 	if (!sc->may_writepage)
 		reclaim_mode |= ISOLATE_CLEAN;
 
+	locked = lru_lock_stat_start();
 	spin_lock_irq(&zone->lru_lock);
+	locked = lru_lock_stat_acquired(LRU_LOCK_ISOLATE_ACTIVE, locked);
 	if (scanning_global_lru(sc)) {
 		nr_taken = isolate_pages_global(nr_pages, &l_hold,
 						&pgscanned, sc->order,
@@ -1674,6 +1785,7 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 	else
 		__mod_zone_page_state(zone, NR_ACTIVE_ANON, -nr_taken);
 	__mod_zone_page_state(zone, NR_ISOLATED_ANON + file, nr_taken);
+	lru_lock_stat_release(LRU_LOCK_ISOLATE_ACTIVE, locked);
 	spin_unlock_irq(&zone->lru_lock);
 
 	while (!list_empty(&l_hold)) {
@@ -1686,6 +1798,14 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 			continue;
 		}
 
+		if (unlikely(buffer_heads_over_limit)) {
+			if (page_has_private(page) && trylock_page(page)) {
+				if (page_has_private(page))
+					try_to_release_page(page, 0);
+				unlock_page(page);
+			}
+		}
+
 		if (page_referenced(page, 0, sc->mem_cgroup, &vm_flags)) {
 			nr_rotated += hpage_nr_pages(page);
 			/*
@@ -1710,7 +1830,9 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 	/*
 	 * Move pages back to the lru list.
 	 */
+	locked = lru_lock_stat_start();
 	spin_lock_irq(&zone->lru_lock);
+	locked = lru_lock_stat_acquired(LRU_LOCK_PUTBACK_ACTIVE, locked);
 	/*
 	 * Count referenced pages from currently used mappings as rotated,
 	 * even though only some of them are actually re-activated.  This
@@ -1719,12 +1841,15 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 	 */
 	reclaim_stat->recent_rotated[file] += nr_rotated;
 
-	move_active_pages_to_lru(zone, &l_active,
+	move_active_pages_to_lru(zone, &l_active, &l_hold,
 						LRU_ACTIVE + file * LRU_FILE);
-	move_active_pages_to_lru(zone, &l_inactive,
+	move_active_pages_to_lru(zone, &l_inactive, &l_hold,
 						LRU_BASE   + file * LRU_FILE);
 	__mod_zone_page_state(zone, NR_ISOLATED_ANON + file, -nr_taken);
+	lru_lock_stat_release(LRU_LOCK_PUTBACK_ACTIVE, locked);
 	spin_unlock_irq(&zone->lru_lock);
+
+	free_hot_cold_page_list(&l_hold, 1);
 }
 
 #ifdef CONFIG_SWAP
@@ -2053,7 +2178,7 @@ restart:
 		for_each_evictable_lru(l) {
 			if (nr[l]) {
 				nr_to_scan = min_t(unsigned long,
-						   nr[l], SWAP_CLUSTER_MAX);
+						   nr[l], vm_reclaim_batch);
 				nr[l] -= nr_to_scan;
 
 				nr_reclaimed += shrink_list(l, nr_to_scan,
@@ -3624,3 +3749,67 @@ void scan_unevictable_unregister_node(struct node *node)
 	sysdev_remove_file(&node->sysdev, &attr_scan_unevictable_pages);
 }
 #endif
+
+#ifdef CONFIG_LRU_LOCK_STATS
+static const char * const lru_lock_site_names[NR_LRU_LOCK_SITES] = {
+	[LRU_LOCK_ISOLATE_INACTIVE]	= "isolate_inactive",
+	[LRU_LOCK_PUTBACK_INACTIVE]	= "putback_inactive",
+	[LRU_LOCK_ISOLATE_ACTIVE]	= "isolate_active",
+	[LRU_LOCK_PUTBACK_ACTIVE]	= "putback_active",
+};
+
+static int lru_lock_stats_show(struct seq_file *m, void *unused)
+{
+	struct lru_lock_stat sum;
+	int site, cpu, i;
+
+	for (site = 0; site < NR_LRU_LOCK_SITES; site++) {
+		memset(&sum, 0, sizeof(sum));
+		for_each_possible_cpu(cpu) {
+			struct lru_lock_stat *st =
+				&per_cpu(lru_lock_stats, cpu)[site];
+
+			sum.count += st->count;
+			sum.wait_ns += st->wait_ns;
+			sum.hold_ns += st->hold_ns;
+			if (st->max_hold_ns > sum.max_hold_ns)
+				sum.max_hold_ns = st->max_hold_ns;
+			for (i = 0; i < LRU_LOCK_HIST_BUCKETS; i++)
+				sum.hold_hist[i] += st->hold_hist[i];
+		}
+
+		seq_printf(m, "%s: count %lu wait_ns %llu hold_ns %llu "
+			   "max_hold_ns %llu\n", lru_lock_site_names[site],
+			   sum.count, sum.wait_ns, sum.hold_ns,
+			   sum.max_hold_ns);
+		for (i = 0; i < LRU_LOCK_HIST_BUCKETS; i++) {
+			if (!sum.hold_hist[i])
+				continue;
+			seq_printf(m, "  %10u - %10u ns %10lu\n",
+				   i ? 1U << (i - 1) : 0, 1U << i,
+				   sum.hold_hist[i]);
+		}
+	}
+	return 0;
+}
+
+static int lru_lock_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lru_lock_stats_show, NULL);
+}
+
+static const struct file_operations lru_lock_stats_fops = {
+	.open		= lru_lock_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init lru_lock_stats_init(void)
+{
+	debugfs_create_file("lru_lock_stats", S_IRUGO, NULL, NULL,
+			    &lru_lock_stats_fops);
+	return 0;
+}
+late_initcall(lru_lock_stats_init);
+#endif /* CONFIG_LRU_LOCK_STATS */
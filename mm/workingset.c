@@ -0,0 +1,218 @@
+/*
+ * mm/workingset.c - Workingset detection
+ *
+ * This file is released under the GPLv2.
+ *
+ * Page cache pages enter the inactive file list and are only promoted
+ * to the active list once they are referenced a second time while on
+ * it.  A working set that is larger than the inactive list, but would
+ * fit into the memory currently taken by the active list, is therefore
+ * evicted before any of its pages gets the second reference, and keeps
+ * faulting back in as long as something else, like a streaming reader,
+ * keeps the inactive list moving.
+ *
+ * To detect this, every zone keeps an "inactive age" counter which is
+ * incremented whenever a page leaves the inactive list, either by
+ * eviction or by activation.  When a file page is reclaimed, a shadow
+ * entry holding the zone's current age is remembered for its mapping
+ * and offset.  When that page is faulted back in, the difference
+ * between the zone's age and the shadow's is the number of pages that
+ * left the inactive list in between: the refault distance.  Had the
+ * inactive list been longer by that distance, the page would still
+ * have been resident.  If the distance is not larger than the active
+ * list, the page is therefore part of a working set that competes with
+ * the active pages for memory, and it is activated straight away.
+ * Pages refaulting from further back, like those of a file that is
+ * read once, stay on the inactive list.
+ *
+ * Shadow entries are kept in a hash table sized after the amount of
+ * memory rather than in the page cache radix trees, so that none of
+ * the page cache lookup paths have to learn about them.  Each bucket
+ * holds a few entries that are replaced in FIFO order; an entry is
+ * identified by a hash of the mapping and offset only, so an unlucky
+ * collision can activate a page that did not deserve it, which is
+ * harmless.
+ */
+
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/swap.h>
+#include <linux/vmstat.h>
+#include <linux/bootmem.h>
+#include <linux/jhash.h>
+#include <linux/spinlock.h>
+#include <linux/init.h>
+
+#define SHADOW_WAYS		4
+#define SHADOW_LOCKS		256
+/* One shadow entry per that many pages of memory */
+#define SHADOW_SCALE		(PAGE_SHIFT + 1)
+
+#define SHADOW_ZONE_BITS	(NODES_SHIFT + ZONES_SHIFT)
+#define EVICTION_MASK		(~0U >> SHADOW_ZONE_BITS)
+
+struct shadow_bucket {
+	u32	key[SHADOW_WAYS];	/* 0 means unused */
+	u32	shadow[SHADOW_WAYS];
+};
+
+static struct shadow_bucket *shadow_table __read_mostly;
+static unsigned int shadow_mask __read_mostly;
+static spinlock_t shadow_locks[SHADOW_LOCKS];
+
+static struct shadow_bucket *shadow_lookup(struct address_space *mapping,
+					   pgoff_t index, u32 *key,
+					   spinlock_t **lock)
+{
+	unsigned long ptr = (unsigned long)mapping;
+	u32 hash;
+
+	hash = jhash_3words((u32)ptr, (u32)(ptr >> 16 >> 16), (u32)index, 0);
+	*key = jhash_2words(hash, (u32)(index >> 16 >> 16), 0x9e3779b9) | 1;
+	*lock = &shadow_locks[hash % SHADOW_LOCKS];
+	return &shadow_table[hash & shadow_mask];
+}
+
+static u32 pack_shadow(unsigned long eviction, struct zone *zone)
+{
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	return eviction;
+}
+
+static void unpack_shadow(u32 shadow, struct zone **zone,
+			  unsigned long *eviction)
+{
+	unsigned long entry = shadow;
+	int zid, nid;
+
+	zid = entry & ((1UL << ZONES_SHIFT) - 1);
+	entry >>= ZONES_SHIFT;
+	nid = entry & ((1UL << NODES_SHIFT) - 1);
+	entry >>= NODES_SHIFT;
+
+	*zone = NODE_DATA(nid)->node_zones + zid;
+	*eviction = entry;
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from memory
+ * @mapping: address space the page was backing
+ * @page: the page being evicted
+ *
+ * Called by reclaim with the page locked and about to be removed from
+ * the page cache.
+ */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	struct shadow_bucket *b;
+	unsigned long eviction;
+	spinlock_t *lock;
+	u32 key;
+	int i;
+
+	if (unlikely(!shadow_table))
+		return;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+	b = shadow_lookup(mapping, page->index, &key, &lock);
+
+	spin_lock(lock);
+	for (i = 0; i < SHADOW_WAYS - 1; i++)
+		if (b->key[i] == key)
+			break;
+	/* Drop the older entry for this page or the oldest one */
+	for (; i > 0; i--) {
+		b->key[i] = b->key[i - 1];
+		b->shadow[i] = b->shadow[i - 1];
+	}
+	b->key[0] = key;
+	b->shadow[0] = pack_shadow(eviction & EVICTION_MASK, zone);
+	spin_unlock(lock);
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @mapping: address space the page is added to
+ * @index: offset of the page in @mapping
+ *
+ * Consumes the shadow entry left by the eviction of the page at @index
+ * in @mapping, if there is one, and returns %true if the page should be
+ * activated because its refault distance shows it is part of the
+ * working set.
+ */
+bool workingset_refault(struct address_space *mapping, pgoff_t index)
+{
+	struct shadow_bucket *b;
+	unsigned long refault_distance;
+	unsigned long eviction;
+	struct zone *zone;
+	spinlock_t *lock;
+	bool found = false;
+	u32 key, shadow;
+	int i;
+
+	if (unlikely(!shadow_table))
+		return false;
+
+	b = shadow_lookup(mapping, index, &key, &lock);
+
+	spin_lock(lock);
+	for (i = 0; i < SHADOW_WAYS; i++) {
+		if (b->key[i] != key)
+			continue;
+		shadow = b->shadow[i];
+		found = true;
+		for (; i < SHADOW_WAYS - 1; i++) {
+			b->key[i] = b->key[i + 1];
+			b->shadow[i] = b->shadow[i + 1];
+		}
+		b->key[i] = 0;
+		break;
+	}
+	spin_unlock(lock);
+
+	if (!found)
+		return false;
+
+	unpack_shadow(shadow, &zone, &eviction);
+	refault_distance = (atomic_long_read(&zone->inactive_age) - eviction) &
+			   EVICTION_MASK;
+
+	inc_zone_state(zone, WORKINGSET_REFAULT);
+
+	if (refault_distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		inc_zone_state(zone, WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+static int __init workingset_init(void)
+{
+	int i;
+
+	for (i = 0; i < SHADOW_LOCKS; i++)
+		spin_lock_init(&shadow_locks[i]);
+
+	shadow_table = alloc_large_system_hash("Workingset shadow",
+					       sizeof(struct shadow_bucket),
+					       0, SHADOW_SCALE +
+					       ilog2(SHADOW_WAYS),
+					       0, NULL, &shadow_mask, 0);
+	if (shadow_table)
+		memset(shadow_table, 0,
+		       (shadow_mask + 1) * sizeof(struct shadow_bucket));
+	return 0;
+}
+module_init(workingset_init);
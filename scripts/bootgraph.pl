@@ -36,6 +36,11 @@
 # usage:
 # 	dmesg | perl scripts/bootgraph.pl > output.svg
 #
+# It also reads /sys/kernel/debug/initcall_timeline, where a kernel booted
+# with "initcall_debug" lists on which thread each initcall ran, which
+# shows the initcalls of parallel levels side by side:
+#	perl scripts/bootgraph.pl < /sys/kernel/debug/initcall_timeline > output.svg
+#
 
 use strict;
 
@@ -94,6 +99,21 @@ while (<>) {
 		}
 	}
 
+	if ($line =~ /^\s*(\d+s?|rootfs)\s+(\d+)\s+([0-9\.]+)\s+([0-9\.]+)\s+-?\d+\s+([a-zA-Z0-9\_\.]+)/) {
+		my $func = $5;
+		$start{$func} = $3;
+		$end{$func} = $4;
+		$type{$func} = 0;
+		$pids{$func} = "thread" . $2;
+		if ($3 < $firsttime) {
+			$firsttime = $3;
+		}
+		if ($4 > $maxtime) {
+			$maxtime = $4;
+		}
+		$count = $count + 1;
+	}
+
 	if ($line =~ /([0-9\.]+)\] async_continuing @ ([0-9]+)/) {
 		my $pid = $2;
 		my $func =  "wait_" . $pid . "_" . $pidctr{$pid};